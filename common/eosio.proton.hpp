@@ -20,7 +20,7 @@ using namespace std;
 #define SYSsym symbol("SYS", 4)  // PROTON
 
 struct kyc_prov {
-	name kyc_provider;
+	eosio::name kyc_provider;
 	string kyc_level;
 	uint64_t kyc_date;
 };
@@ -325,7 +325,7 @@ namespace eosio {
 
 
 		struct [[eosio::table]] userinfo {
-			name                                     acc;
+			eosio::name                              acc;
 			std::string                              name;
 			std::string                              avatar;
 			bool                                     verified;
@@ -346,7 +346,7 @@ namespace eosio {
 
 		struct [[eosio::table]] kyc_providers_list {
 			//uint64_t index
-			name            kyc_provider;
+			eosio::name     kyc_provider;
 			std::string     desc;
 			std::string     url;
 			std::string     iconurl;
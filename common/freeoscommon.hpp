@@ -1,7 +1,9 @@
 #pragma once
 
 #include "eosio.proton.hpp"
+#include "freeosprofile.hpp"
 #include <eosio/asset.hpp>
+#include <eosio/binary_extension.hpp>
 #include <eosio/eosio.hpp>
 #include <string>
 
@@ -10,10 +12,10 @@ using namespace eosio;
 #define _STRINGIZE(x) #x
 #define STRINGIZE(x) _STRINGIZE(x)
 
-std::string freeos_acct = STRINGIZE(FREEOS);
-std::string freeosconfig_acct = STRINGIZE(FREEOSCONFIG);
-std::string freeostokens_acct = STRINGIZE(FREEOSTOKENS);
-std::string freedao_acct = STRINGIZE(DIVIDEND);
+inline std::string freeos_acct = STRINGIZE(FREEOS);
+inline std::string freeosconfig_acct = STRINGIZE(FREEOSCONFIG);
+inline std::string freeostokens_acct = STRINGIZE(FREEOSTOKENS);
+inline std::string freedao_acct = STRINGIZE(DIVIDEND);
 
 const name VERIFICATION_CONTRACT =
     "eosio.proton"_n; // contains the usersinfo table
@@ -23,11 +25,13 @@ const name VERIFICATION_CONTRACT =
 const std::string SYSTEM_CURRENCY_CODE = "XPR";
 const std::string ERR_SYSTEM_CURRENCY_CODE = "you must stake XPR";
 const uint8_t SYSTEM_CURRENCY_PRECISION = 4;
+const int64_t SYSTEM_CURRENCY_UNITS = 10000; // 10^SYSTEM_CURRENCY_PRECISION
 const std::string SYSTEM_CURRENCY_CONTRACT = "eosio.token";
 #else
 const std::string SYSTEM_CURRENCY_CODE = "XUSDC";
 const std::string ERR_SYSTEM_CURRENCY_CODE = "you must stake XUSDC";
 const uint8_t SYSTEM_CURRENCY_PRECISION = 6;
+const int64_t SYSTEM_CURRENCY_UNITS = 1000000; // 10^SYSTEM_CURRENCY_PRECISION
 const std::string SYSTEM_CURRENCY_CONTRACT = "xtokens";
 #endif
 
@@ -49,6 +53,53 @@ const std::string MSG_FREEOS_SYSTEM_NOT_AVAILABLE =
 const std::string MSG_ACCOUNT_NOT_REGISTERED =
     "Account is not registered with freeos";
 
+// check() for messages that are expensive to build (string concatenation,
+// asset::to_string etc). The message is only built if the check fails, so a
+// passing check does not touch the heap.
+template <typename MessageBuilder>
+inline void check_lazy(bool pred, MessageBuilder &&build_message) {
+  if (!pred) {
+    check(false, build_message());
+  }
+}
+
+// parse an unsigned decimal parameter value. Used instead of stoi, which
+// drags the locale-aware libc++ parsing code into the wasm.
+inline uint32_t parse_uint(const std::string &value) {
+  uint32_t result = 0;
+  size_t pos = 0;
+
+  while (pos < value.size() && value[pos] == ' ') {
+    pos++;
+  }
+
+  size_t first_digit = pos;
+  while (pos < value.size() && value[pos] >= '0' && value[pos] <= '9') {
+    result = result * 10 + (value[pos] - '0');
+    pos++;
+  }
+
+  check(pos != first_digit, "parameter value is not a number");
+
+  return result;
+}
+
+// append the decimal representation of value to str. Used instead of
+// std::to_string.
+inline void append_uint(std::string &str, uint64_t value) {
+  char digits[20];
+  int length = 0;
+
+  do {
+    digits[length++] = '0' + (value % 10);
+    value /= 10;
+  } while (value != 0);
+
+  while (length > 0) {
+    str.push_back(digits[--length]);
+  }
+}
+
 namespace freedao {
 
 // Table definitions
@@ -60,16 +111,19 @@ struct[[ eosio::table("accounts"), eosio::contract("freeos") ]] account {
 
   uint64_t primary_key() const { return balance.symbol.code().raw(); }
 };
-typedef eosio::multi_index<"accounts"_n, account> accounts;
+typedef multi_index<"accounts"_n, account> accounts;
 
 // vested OPTION ledger
 struct[
     [ eosio::table("vestaccounts"), eosio::contract("freeos") ]] vestaccount {
   asset balance;
+  // LAZY_UNLOCK builds: the unlock factor the balance was last settled at,
+  // 1.0 when not present
+  binary_extension<double> unlockfactor;
 
   uint64_t primary_key() const { return balance.symbol.code().raw(); }
 };
-typedef eosio::multi_index<"vestaccounts"_n, vestaccount> vestaccounts_index;
+typedef multi_index<"vestaccounts"_n, vestaccount> vestaccounts_index;
 
 // currency stats
 struct[[ eosio::table("stat"), eosio::contract("freeos") ]] currency_stats {
@@ -80,7 +134,7 @@ struct[[ eosio::table("stat"), eosio::contract("freeos") ]] currency_stats {
 
   uint64_t primary_key() const { return supply.symbol.code().raw(); }
 };
-typedef eosio::multi_index<"stat"_n, currency_stats> stats;
+typedef multi_index<"stat"_n, currency_stats> stats;
 
 // the registered user table
 struct[[ eosio::table("users"), eosio::contract("freeos") ]] user {
@@ -97,7 +151,7 @@ struct[[ eosio::table("users"), eosio::contract("freeos") ]] user {
 
   uint64_t primary_key() const { return stake.symbol.code().raw(); }
 };
-using users_index = eosio::multi_index<"users"_n, user>;
+using users_index = multi_index<"users"_n, user>;
 
 // new statistics table - to replace counters
 struct[[ eosio::table("statistics"), eosio::contract("freeos") ]] statistic {
@@ -107,23 +161,68 @@ struct[[ eosio::table("statistics"), eosio::contract("freeos") ]] statistic {
   uint32_t unvestpercentiteration;
   uint32_t iteration;
   uint32_t failsafecounter;
+  // LAZY_UNLOCK builds: the cumulative unlock factor, 1.0 when not present
+  binary_extension<double> unlockfactor;
 
   uint64_t primary_key() const {
     return 0;
   } // return a constant (0 in this case) to ensure a single-row table
 };
-using statistic_index = eosio::multi_index<"statistics"_n, statistic>;
+using statistic_index = multi_index<"statistics"_n, statistic>;
+
+// the unlock factor of a statistics or vestaccounts record - a record written
+// before lazy unlock was enabled is at the start of the mode
+template <typename T> double unlock_factor_of(const T &record) {
+  return record.unlockfactor.has_value() ? record.unlockfactor.value() : 1.0;
+}
 
 
 // iterstats table - extension of statistics table // added v0.355
 struct[[ eosio::table("iterstats"), eosio::contract("freeos") ]] iterstat {
   uint32_t claimevents;
+  binary_extension<uint32_t> iteration; // the iteration claimevents is for
+
+  uint64_t primary_key() const {
+    return 0;
+  } // return a constant (0 in this case) to ensure a single-row table
+};
+using iterstats_index = multi_index<"iterstats"_n, iterstat>;
+
+// aggstats table - system-wide totals, kept up to date by the actions that
+// change them so that they can be read without scanning every user scope.
+// Created by the first registration of a new system, or set with aggset when
+// added to a running one - until then the actions skip their updates.
+struct[[ eosio::table("aggstats"), eosio::contract("freeos") ]] aggstat {
+  asset staked;             // total of the users table stakes
+  asset vested;             // total of the vestaccounts balances
+  asset refunds;            // total of the unstake requests queue
+  uint32_t refundcount = 0; // number of queued unstake requests
+  uint32_t verified = 0;    // registered users of account_type 'v'
+  uint32_t unverified = 0;  // registered users of other account types
 
   uint64_t primary_key() const {
     return 0;
   } // return a constant (0 in this case) to ensure a single-row table
 };
-using iterstats_index = eosio::multi_index<"iterstats"_n, iterstat>;
+using aggstats_index = multi_index<"aggstats"_n, aggstat>;
+
+// claimquote table - the current iteration's claim, calculated by tick when
+// the iteration starts
+struct[
+    [ eosio::table("claimquote"), eosio::contract("freeos") ]] claimquote {
+  uint32_t iteration;
+  uint16_t claim_tokens;
+  uint16_t vested_tokens;
+  uint16_t liquid_tokens;
+  uint16_t tokens_required;
+  uint16_t freedao_tokens; // for claim events up to tier_boundary
+  uint32_t tier_boundary;  // last claim event of the current multiplier tier
+
+  uint64_t primary_key() const {
+    return 0;
+  } // return a constant (0 in this case) to ensure a single-row table
+};
+using claimquote_index = multi_index<"claimquote"_n, claimquote>;
 
 
 // unvest history table - scoped on user account name
@@ -132,7 +231,7 @@ struct[[ eosio::table("unvests"), eosio::contract("freeos") ]] unvestevent {
 
   uint64_t primary_key() const { return 0; } // single record per user
 };
-using unvest_index = eosio::multi_index<"unvests"_n, unvestevent>;
+using unvest_index = multi_index<"unvests"_n, unvestevent>;
 
 // freedao deposits table
 struct[[ eosio::table("deposits"), eosio::contract("freeos") ]] deposit {
@@ -141,7 +240,7 @@ struct[[ eosio::table("deposits"), eosio::contract("freeos") ]] deposit {
 
   uint64_t primary_key() const { return iteration; }
 };
-using deposits_index = eosio::multi_index<"deposits"_n, deposit>;
+using deposits_index = multi_index<"deposits"_n, deposit>;
 
 // unstake requests queue
 struct[
@@ -153,11 +252,26 @@ struct[
   uint64_t primary_key() const { return staker.value; }
   uint64_t get_secondary() const { return iteration; }
 };
-using unstakerequest_index = eosio::multi_index<
+using unstakerequest_index = multi_index<
     "unstakereqs"_n, unstakerequest,
     indexed_by<"iteration"_n, const_mem_fun<unstakerequest, uint64_t,
                                             &unstakerequest::get_secondary>>>;
 
+// conversion requests queue - POINTs already burned, FREEOS to be issued and
+// transferred by convsettle in the order of the owners' first requests
+struct[[ eosio::table("convreqs"), eosio::contract("freeos") ]] convrequest {
+  name owner;
+  asset amount;      // FREEOS
+  uint64_t sequence; // queue position - one more than the last request's
+
+  uint64_t primary_key() const { return owner.value; }
+  uint64_t get_secondary() const { return sequence; }
+};
+using convrequest_index = multi_index<
+    "convreqs"_n, convrequest,
+    indexed_by<"sequence"_n, const_mem_fun<convrequest, uint64_t,
+                                           &convrequest::get_secondary>>>;
+
 // freeosconfig contract
 // CONFIG stake requirements table - code: freeosconfig, scope: freeosconfig
 struct[[
@@ -177,7 +291,7 @@ struct[[
 
   uint64_t primary_key() const { return threshold; }
 };
-using stakereq_index = eosio::multi_index<"stakereqs"_n, stakerequire>;
+using stakereq_index = multi_index<"stakereqs"_n, stakerequire>;
 
 // exchangerate table
 struct[
@@ -189,7 +303,7 @@ struct[
     return 0;
   } // return a constant (0 in this case) to ensure a single-row table
 };
-using exchange_index = eosio::multi_index<"exchangerate"_n, price>;
+using exchange_index = multi_index<"exchangerate"_n, price>;
 
 // iteration calendar table
 struct[
@@ -203,7 +317,7 @@ struct[
   uint64_t primary_key() const { return iteration_number; }
   uint64_t get_secondary() const { return start.time_since_epoch()._count; }
 };
-using iterations_index = eosio::multi_index<
+using iterations_index = multi_index<
     "iterations"_n, iteration,
     indexed_by<"start"_n,
                const_mem_fun<iteration, uint64_t, &iteration::get_secondary>>>;
@@ -218,7 +332,7 @@ struct[[
   uint64_t primary_key() const { return account.value; }
 };
 using transferers_index =
-    eosio::multi_index<"transferers"_n, transfer_whitelist>;
+    multi_index<"transferers"_n, transfer_whitelist>;
 
 // minters table - a whitelist of who can call the issue function
 struct[[
@@ -228,7 +342,7 @@ struct[[
 
   uint64_t primary_key() const { return account.value; }
 };
-using minters_index = eosio::multi_index<"minters"_n, minter_whitelist>;
+using minters_index = multi_index<"minters"_n, minter_whitelist>;
 
 // burners table - a whitelist of who can call the retire function
 struct[[
@@ -238,7 +352,7 @@ struct[[
 
   uint64_t primary_key() const { return account.value; }
 };
-using burners_index = eosio::multi_index<"burners"_n, burner_whitelist>;
+using burners_index = multi_index<"burners"_n, burner_whitelist>;
 
 // miscellaneous parameters table
 struct[
@@ -250,7 +364,7 @@ struct[
   uint64_t primary_key() const { return paramname.value; }
   uint64_t get_secondary() const { return virtualtable.value; }
 };
-using parameters_index = eosio::multi_index<
+using parameters_index = multi_index<
     "parameters"_n, parameter,
     indexed_by<"virtualtable"_n,
                const_mem_fun<parameter, uint64_t, &parameter::get_secondary>>>;
@@ -261,7 +375,7 @@ using parameters_index = eosio::multi_index<
 // https://github.com/ProtonProtocol/proton.contracts/blob/master/contracts/eosio.proton/include/eosio.proton/eosio.proton.hpp
 struct[
     [ eosio::table("usersinfo"), eosio::contract("freeosconfig") ]] userinfo {
-  name acc;
+  eosio::name acc;
   std::string name;
   std::string avatar;
   bool verified;
@@ -277,6 +391,6 @@ struct[
 
   uint64_t primary_key() const { return acc.value; }
 };
-typedef eosio::multi_index<"usersinfo"_n, userinfo> usersinfo;
+typedef multi_index<"usersinfo"_n, userinfo> usersinfo;
 
 } // namespace freedao
@@ -0,0 +1,208 @@
+#pragma once
+
+// Claim economics - the arithmetic behind claim, unvest and stake.
+//
+// Everything in this header is a pure function of plain inputs: no tables, no
+// eosio types and no intrinsics. The freeos contract reads its tables and
+// calls these functions, and native (off-chain) code can include this header
+// directly to compute exactly the same results.
+//
+// Warning: several of these calculations use mixed float/double/integer
+// arithmetic. The types are part of the behaviour - any changes need to be
+// thoroughly tested against the deployed contract.
+
+#include <cstdint>
+
+namespace freedao {
+namespace economics {
+
+// number of currency units in one POINT (POINT has a precision of 4)
+constexpr int64_t POINT_UNITS = 10000;
+
+// the tokens issued by a claim, in whole POINTs
+struct claim_split {
+  uint16_t claim_tokens;   // the iteration's claim amount
+  uint16_t vested_tokens;  // added to the user's vested balance
+  uint16_t liquid_tokens;  // transferred to the user
+  uint16_t freedao_tokens; // transferred to the freedao account
+  uint16_t minted_tokens;  // liquid + freedao, issued to the freeos account
+};
+
+// the vested proportion is never more than 90%
+constexpr float cap_vested_proportion(float proportion) {
+  return proportion > 0.9f ? 0.9f : proportion;
+}
+
+// vested proportion when an exchange rate record exists. 0.0f means the
+// exchange rate is favourable and nothing is vested.
+constexpr float vested_proportion_from_rate(double currentprice,
+                                            double targetprice) {
+  float proportion = 0.0f;
+
+  if (targetprice > 0 && currentprice < targetprice) {
+    proportion = 1.0f - (currentprice / targetprice);
+  }
+
+  return cap_vested_proportion(proportion);
+}
+
+// vested proportion from the 'vestpercent' parameter, used when there is no
+// exchange rate record
+constexpr float vested_proportion_from_percent(uint8_t int_percent) {
+  return cap_vested_proportion(((float)int_percent) / 100.0f);
+}
+
+// freedao multiplier tiers. A tier applies to the claim events of an
+// iteration up to and including last_claimevent.
+struct freedao_tier {
+  uint32_t last_claimevent;
+  double multiplier;
+};
+
+#ifdef TEST_BUILD
+constexpr freedao_tier FREEDAO_TIERS[] = {
+    {2, 3},
+    {4, 2},
+    {UINT32_MAX, 0.5},
+};
+#else
+constexpr freedao_tier FREEDAO_TIERS[] = {
+    {199, 19},   {499, 18},   {999, 17},   {1999, 16},
+    {2999, 15},  {4999, 14},  {7999, 10},  {12999, 6},
+    {20999, 4},  {33999, 2},  {54999, 1.5}, {UINT32_MAX, 0.07},
+};
+#endif
+
+// the freedao multiplier tier for the nth claim event of an iteration
+constexpr freedao_tier freedao_tier_for(uint32_t claimevents) {
+  for (const freedao_tier &tier : FREEDAO_TIERS) {
+    if (claimevents <= tier.last_claimevent) {
+      return tier;
+    }
+  }
+
+  // not reached - the last tier ends at UINT32_MAX
+  return FREEDAO_TIERS[sizeof(FREEDAO_TIERS) / sizeof(FREEDAO_TIERS[0]) - 1];
+}
+
+// freedao multiplier for the nth claim event of an iteration
+constexpr double freedao_multiplier(uint32_t claimevents) {
+  return freedao_tier_for(claimevents).multiplier;
+}
+
+// split an iteration's claim amount between the user's liquid and vested
+// balances and freedao
+constexpr claim_split split_claim(uint16_t claim_tokens, float vested_proportion,
+                                  double freedao_multiplier) {
+  claim_split split{};
+
+  split.claim_tokens = claim_tokens;
+  split.vested_tokens = claim_tokens * vested_proportion;
+  split.liquid_tokens = claim_tokens - split.vested_tokens;
+  split.freedao_tokens = claim_tokens * freedao_multiplier;
+  split.minted_tokens = split.liquid_tokens + split.freedao_tokens;
+
+  return split;
+}
+
+// the 'good times' unvest percentage for the next iteration - steps through
+// the Fibonacci sequence to a maximum of 21%
+constexpr uint32_t next_unvest_percentage(uint32_t current_unvest_percentage) {
+  switch (current_unvest_percentage) {
+  case 0:
+  case 15:
+    return 1;
+  case 1:
+    return 2;
+  case 2:
+    return 3;
+  case 3:
+    return 5;
+  case 5:
+    return 8;
+  case 8:
+    return 13;
+  case 13:
+  case 21:
+    return 21;
+  default:
+    return 0;
+  }
+}
+
+// the 'bad times' strategy - every failsafe_frequency iterations of
+// unfavourable exchange rate the unvest percentage is set to 15%
+struct failsafe_step {
+  uint32_t failsafecounter;
+  uint32_t unvestpercent;
+};
+
+constexpr failsafe_step next_failsafe(uint32_t failsafe_counter,
+                                      uint8_t failsafe_frequency) {
+  failsafe_counter++;
+
+  failsafe_step step{};
+  step.failsafecounter = failsafe_counter % failsafe_frequency;
+  step.unvestpercent = (failsafe_counter == failsafe_frequency ? 15 : 0);
+
+  return step;
+}
+
+// number of whole POINTs released by unvesting unvest_percent of a vested
+// balance of vested_units currency units. Rounds up to the next whole POINT.
+constexpr uint32_t unvest_tokens(uint64_t vested_units,
+                                 uint32_t unvest_percent) {
+  double percentage = unvest_percent / 100.0; // required to be a double
+
+  uint64_t converted_units = vested_units * percentage;
+
+  return (converted_units + (POINT_UNITS - 1)) / POINT_UNITS;
+}
+
+// lazy unlock (LAZY_UNLOCK builds) - the unlock factor is the proportion of a
+// vested balance that is still locked after every unvest percentage since the
+// mode began. It starts at 1.0 and moves on once per iteration.
+constexpr double next_unlock_factor(double unlock_factor,
+                                    uint32_t unvest_percent) {
+  return unlock_factor * ((100 - unvest_percent) / 100.0);
+}
+
+// number of whole POINTs unlocked from a vested balance of vested_units
+// currency units since it was settled at checkpoint_factor. Rounds up to the
+// next whole POINT, as unvest_tokens does, but never past the balance.
+constexpr uint32_t unlocked_tokens(uint64_t vested_units, double unlock_factor,
+                                   double checkpoint_factor) {
+  if (checkpoint_factor <= 0.0 || unlock_factor >= checkpoint_factor) {
+    return 0;
+  }
+
+  uint64_t locked_units = vested_units * (unlock_factor / checkpoint_factor);
+  uint64_t tokens =
+      (vested_units - locked_units + (POINT_UNITS - 1)) / POINT_UNITS;
+  uint64_t vested_tokens = vested_units / POINT_UNITS;
+
+  return tokens < vested_tokens ? tokens : vested_tokens;
+}
+
+// stake requirement (in whole units of the system currency) for an account
+// type, given the requirements of the applicable stakereqs band
+constexpr uint32_t stake_requirement(char account_type, uint32_t requirement_v,
+                                     uint32_t requirement_d,
+                                     uint32_t requirement_e) {
+  if (account_type == 'v') {
+    return requirement_v;
+  } else if (account_type == 'd') {
+    return requirement_d;
+  } else {
+    return requirement_e;
+  }
+}
+
+// the 'holding' balance, in currency units, a user without an AIRKEY must
+// have to claim in an iteration
+constexpr int64_t holding_requirement(uint16_t tokens_required) {
+  return tokens_required * POINT_UNITS;
+}
+
+} // namespace economics
+} // namespace freedao
@@ -0,0 +1,163 @@
+#pragma once
+
+// Hot-path instrumentation for the freeos and freeosconfig contracts.
+//
+// Compile with -DFREEOS_PROFILE (and deploy to a node running with
+// --contracts-console) to have each action print a line like:
+//
+//   profile claim: db_reads=14 rows_read=12 db_writes=9 inline_actions=0
+//   notifications=4 memory=131072
+//
+// db_reads counts multi_index lookups (find, get, begin, lower_bound,
+// upper_bound, get_index), rows_read the lookups that returned a row and
+// db_writes the emplace, modify and erase calls. memory is the size of the
+// wasm linear memory when the action finishes, i.e. the heap high-water mark.
+// Iterating with ++/-- is not counted.
+//
+// Without FREEOS_PROFILE, multi_index is eosio::multi_index and the PROFILE_
+// macros expand to nothing, so release builds are unaffected.
+
+#include <eosio/eosio.hpp>
+
+#ifdef FREEOS_PROFILE
+#include <eosio/print.hpp>
+#endif
+
+namespace freedao {
+
+#ifdef FREEOS_PROFILE
+
+namespace profile {
+
+struct counters {
+  uint32_t db_reads;
+  uint32_t rows_read;
+  uint32_t db_writes;
+  uint32_t inline_actions;
+  uint32_t notifications;
+};
+
+inline counters totals = {};
+inline uint32_t depth = 0;
+
+// counts for the outermost action in scope - actions that call other actions
+// as functions (e.g. claim calling tick) are reported as part of the caller
+class action_scope {
+public:
+  explicit action_scope(const char *action_name) : action_name(action_name) {
+    if (depth++ == 0) {
+      totals = {};
+    }
+  }
+
+  ~action_scope() {
+    if (--depth == 0) {
+      uint64_t memory = 0;
+#ifdef __wasm__
+      memory = __builtin_wasm_memory_size(0) * 65536;
+#endif
+      eosio::print("profile ", action_name, ": db_reads=", totals.db_reads,
+                   " rows_read=", totals.rows_read,
+                   " db_writes=", totals.db_writes,
+                   " inline_actions=", totals.inline_actions,
+                   " notifications=", totals.notifications,
+                   " memory=", memory, "\n");
+    }
+  }
+
+private:
+  const char *action_name;
+};
+
+// multi_index that counts its table accesses
+template <eosio::name::raw TableName, typename T, typename... Indices>
+class profiled_multi_index
+    : public eosio::multi_index<TableName, T, Indices...> {
+  using base = eosio::multi_index<TableName, T, Indices...>;
+
+public:
+  using base::base;
+  using typename base::const_iterator;
+
+  const_iterator read(const_iterator itr) const {
+    totals.db_reads++;
+    if (itr != base::end()) {
+      totals.rows_read++;
+    }
+    return itr;
+  }
+
+  const_iterator begin() const { return read(base::begin()); }
+  const_iterator find(uint64_t primary) const {
+    return read(base::find(primary));
+  }
+  const_iterator lower_bound(uint64_t primary) const {
+    return read(base::lower_bound(primary));
+  }
+  const_iterator upper_bound(uint64_t primary) const {
+    return read(base::upper_bound(primary));
+  }
+  const_iterator require_find(uint64_t primary,
+                              const char *error_msg = "unable to find key") const {
+    totals.db_reads++;
+    totals.rows_read++;
+    return base::require_find(primary, error_msg);
+  }
+  const T &get(uint64_t primary,
+               const char *error_msg = "unable to find key") const {
+    totals.db_reads++;
+    totals.rows_read++;
+    return base::get(primary, error_msg);
+  }
+
+  template <eosio::name::raw IndexName> auto get_index() const {
+    totals.db_reads++;
+    return base::template get_index<IndexName>();
+  }
+
+  template <typename Lambda>
+  const_iterator emplace(eosio::name payer, Lambda &&constructor) {
+    totals.db_writes++;
+    return base::emplace(payer, std::forward<Lambda>(constructor));
+  }
+  template <typename Lambda>
+  void modify(const_iterator itr, eosio::name payer, Lambda &&updater) {
+    totals.db_writes++;
+    base::modify(itr, payer, std::forward<Lambda>(updater));
+  }
+  template <typename Lambda>
+  void modify(const T &obj, eosio::name payer, Lambda &&updater) {
+    totals.db_writes++;
+    base::modify(obj, payer, std::forward<Lambda>(updater));
+  }
+  const_iterator erase(const_iterator itr) {
+    totals.db_writes++;
+    return base::erase(itr);
+  }
+  void erase(const T &obj) {
+    totals.db_writes++;
+    base::erase(obj);
+  }
+};
+
+} // namespace profile
+
+template <eosio::name::raw TableName, typename T, typename... Indices>
+using multi_index = profile::profiled_multi_index<TableName, T, Indices...>;
+
+#define PROFILE_ACTION(action_name)                                            \
+  freedao::profile::action_scope profile_action_scope(action_name)
+#define PROFILE_INLINE_ACTION() (freedao::profile::totals.inline_actions++)
+#define PROFILE_NOTIFICATION() (freedao::profile::totals.notifications++)
+
+#else
+
+using eosio::multi_index;
+
+#define PROFILE_ACTION(action_name)
+#define PROFILE_INLINE_ACTION()
+#define PROFILE_NOTIFICATION()
+
+#endif
+
+} // namespace freedao
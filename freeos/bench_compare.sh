@@ -0,0 +1,180 @@
+# Compare the per-action cost of the freeos and freeosconfig contracts with
+# the committed baselines, and fail if an action got more expensive.
+#
+# Runs the freeos.bench scenario on the host build (../freeossim/freeosbench
+# --scenario) and, for each labelled transaction, compares the table reads
+# and writes, the bytes packed and unpacked and the heap allocations and
+# bytes counted by the host's allocator with freeos.bench.baseline. Run
+# ../freeossim/compile.sh first.
+#
+# When freeos.wasm is a build of the current freeos.cpp (it contains its
+# VERSION string - see size_report.sh) the scenario is also run on freeos.wasm
+# and freeosconfig.wasm with ../freeossim/freeoswasm, and the WebAssembly
+# instructions executed are compared with freeos.bench.wasm.baseline. An
+# older freeos.wasm is not measured: rebuild it with compile_production.sh
+# (and freeosconfig's) to check the instructions. The instruction baseline is
+# only written by --update from such a build, and there is none until then.
+#
+# usage: ./bench_compare.sh [--update]
+#
+# --update rewrites the baselines with the current costs: commit them with the
+# change that moved them. Set MAX_INSTRUCTIONS_PCT to change the instruction
+# threshold (2 percent). Any increase in the host costs, or an action that
+# succeeded and now fails, is a regression.
+
+cd "$(dirname "$0")"
+
+FREEOSBENCH=../freeossim/freeosbench
+FREEOSWASM=../freeossim/freeoswasm
+SCENARIO=freeos.bench
+BASELINE=freeos.bench.baseline
+WASM_BASELINE=freeos.bench.wasm.baseline
+MAX_INSTRUCTIONS_PCT=${MAX_INSTRUCTIONS_PCT:-2}
+
+for tool in $FREEOSBENCH $FREEOSWASM; do
+  if [ ! -x $tool ]; then
+    echo "$tool not found - run ../freeossim/compile.sh"
+    exit 1
+  fi
+done
+
+VERSION=$(sed -n 's/^const std::string VERSION = "\(.*\)";/\1/p' freeos.cpp)
+WASM_CURRENT=0
+if grep -qaF "$VERSION" freeos.wasm; then
+  WASM_CURRENT=1
+fi
+
+CURRENT=$(mktemp)
+WASM_REPORT=$(mktemp)
+trap 'rm -f $CURRENT $WASM_REPORT' EXIT
+
+if ! $FREEOSBENCH --scenario $SCENARIO --report $CURRENT >/dev/null; then
+  echo "FAIL: $SCENARIO did not run on the host build"
+  exit 1
+fi
+if [ $WASM_CURRENT -eq 1 ] &&
+  ! $FREEOSWASM --quiet --report $WASM_REPORT $SCENARIO >/dev/null; then
+  echo "FAIL: $SCENARIO did not run on freeos.wasm"
+  exit 1
+fi
+
+if [ "$1" = "--update" ]; then
+  cp $CURRENT $BASELINE
+  echo "$BASELINE updated"
+  if [ $WASM_CURRENT -eq 1 ]; then
+    cp $WASM_REPORT $WASM_BASELINE
+    echo "$WASM_BASELINE updated"
+  else
+    echo "$WASM_BASELINE not updated: freeos.wasm is not version $VERSION"
+  fi
+  exit 0
+fi
+
+# baseline and current lines are: label db_reads db_writes bytes_packed
+# bytes_unpacked heap_allocs heap_bytes status
+awk '
+  NR == FNR {
+    order[++baselines] = $1
+    for (i = 2; i <= 8; i++) before[$1, i] = $i
+    next
+  }
+
+  {
+    seen[$1] = 1
+    if (!(($1, 2) in before)) {
+      printf "%-32s new: %d reads, %d writes, %d heap allocations\n", $1, $2,
+             $3, $6
+      next
+    }
+
+    problems = ""
+    split("reads writes packed unpacked heap-allocs heap-bytes", cost, " ")
+    for (i = 2; i <= 7; i++) {
+      if ($i > before[$1, i]) problems = problems " " cost[i - 1]
+    }
+    if (before[$1, 8] == "ok" && $8 != "ok") problems = problems " now-fails"
+
+    changes = ""
+    for (i = 2; i <= 8; i++) {
+      if ($i != before[$1, i]) changes = changes sprintf("  %s %s -> %s",
+        i == 8 ? "status" : cost[i - 1], before[$1, i], $i)
+    }
+    if (changes != "") {
+      printf "%-32s%s%s\n", $1, changes,
+             problems == "" ? "" : "  REGRESSION:" problems
+      changed++
+    }
+    if (problems != "") regressions++
+  }
+
+  END {
+    for (i = 1; i <= baselines; i++) {
+      if (!(order[i] in seen)) printf "%-32s removed from the scenario\n", order[i]
+    }
+    printf "\nhost build: %d transactions changed, %d regressions\n", changed,
+           regressions
+    exit regressions > 0
+  }
+' $BASELINE $CURRENT
+RESULT=$?
+
+if [ $WASM_CURRENT -eq 0 ]; then
+  echo "freeos.wasm: not version $VERSION - instructions not checked"
+elif [ ! -f $WASM_BASELINE ]; then
+  echo "freeos.wasm: no $WASM_BASELINE - instructions not checked" \
+    "(run ./bench_compare.sh --update and commit it)"
+else
+  # baseline and current lines are: label instructions db_reads db_writes
+  # heap_bytes status
+  awk -v max_pct=$MAX_INSTRUCTIONS_PCT '
+    function change(before, after) {
+      if (before == after) return ""
+      if (before == 0) return sprintf("%+d", after)
+      return sprintf("%+.1f%%", 100 * (after - before) / before)
+    }
+
+    NR == FNR {
+      order[++baselines] = $1
+      instructions[$1] = $2; status[$1] = $6
+      next
+    }
+
+    {
+      seen[$1] = 1
+      if (!($1 in instructions)) {
+        printf "%-32s new: %d instructions\n", $1, $2
+        next
+      }
+
+      problems = ""
+      if ($2 > instructions[$1] * (1 + max_pct / 100)) problems = problems " instructions"
+      if (status[$1] == "ok" && $6 != "ok") problems = problems " now-fails"
+
+      if (problems != "" || $2 != instructions[$1] || $6 != status[$1]) {
+        printf "%-32s %9d -> %9d %8s  %s -> %s%s\n", $1, instructions[$1], $2,
+               change(instructions[$1], $2), status[$1], $6,
+               problems == "" ? "" : "  REGRESSION:" problems
+        changed++
+      }
+      if (problems != "") regressions++
+      total_before += instructions[$1]; total_after += $2
+    }
+
+    END {
+      for (i = 1; i <= baselines; i++) {
+        if (!(order[i] in seen)) printf "%-32s removed from the scenario\n", order[i]
+      }
+      printf "\nfreeos.wasm: %d transactions changed, %d regressions; %d -> %d instructions in all %s\n",
+             changed, regressions, total_before, total_after,
+             change(total_before, total_after)
+      exit regressions > 0
+    }
+  ' $WASM_BASELINE $WASM_REPORT || RESULT=1
+fi
+
+if [ $RESULT -ne 0 ]; then
+  echo
+  echo "FAIL: an action is more expensive than in the baseline"
+  echo "(if that is intended, run ./bench_compare.sh --update and commit the baseline)"
+  exit 1
+fi
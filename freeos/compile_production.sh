@@ -1,2 +1,3 @@
-eosio-cpp -o freeos.wasm freeos.cpp -DFREEOS="\"freeosclaim\"" -DFREEOSCONFIG="\"freeoscfg\"" -DFREEOSTOKENS="\"freeostokens\"" -DDIVIDEND="\"freeosdivide\"" --abigen
+# Needs CDT 3.0 or later (cdt-cpp) - see ../README.md
+cdt-cpp -o freeos.wasm freeos.cpp -DFREEOS="\"freeosclaim\"" -DFREEOSCONFIG="\"freeoscfg\"" -DFREEOSTOKENS="\"freeostokens\"" -DDIVIDEND="\"freeosdivide\"" --abigen
 
@@ -0,0 +1,2 @@
+# Needs CDT 3.0 or later (cdt-cpp) - see ../README.md
+cdt-cpp -o freeos_profile.wasm freeos.cpp -DTEST_BUILD -DFREEOS_PROFILE -DFREEOS="\"freeos5\"" -DFREEOSCONFIG="\"freeoscfg5\"" -DFREEOSTOKENS="\"freeostoken5\"" -DDIVIDEND="\"freeosdiv5\"" --abigen
@@ -1,2 +1,3 @@
-eosio-cpp -o freeos.wasm freeos.cpp -DTEST_BUILD -DFREEOS="\"freeos\"" -DFREEOSCONFIG="\"freeosconfig\"" -DFREEOSTOKENS="\"freeostokens\"" -DDIVIDEND="\"optionsdiv\"" --abigen
+# Needs CDT 3.0 or later (cdt-cpp) - see ../README.md
+cdt-cpp -o freeos.wasm freeos.cpp -DTEST_BUILD -DFREEOS="\"freeos\"" -DFREEOSCONFIG="\"freeosconfig\"" -DFREEOSTOKENS="\"freeostokens\"" -DDIVIDEND="\"optionsdiv\"" --abigen
 
@@ -1,5 +1,5 @@
 #include "freeos.hpp"
-#include <cmath>
+#include <algorithm>
 #include <eosio/asset.hpp>
 #include <eosio/system.hpp>
 
@@ -7,22 +7,32 @@ namespace freedao {
 
 using namespace eosio;
 
-const std::string VERSION = "0.358";
+const std::string VERSION = "0.359";
+
+// memos for internal issue/transfer calls. These are only length-checked and
+// are not recorded, so fixed strings are used rather than building them per
+// call.
+const std::string_view MEMO_CLAIM = "claim";
+const std::string_view MEMO_UNLOCK = "unlocking POINTs";
 
 // ACTION
 void freeos::version() {
+  PROFILE_ACTION("version");
+
   iteration this_iteration = get_claim_iteration();
 
   std::string version_message = freeos_acct + "/" + freeosconfig_acct + "/" +
                                 freeostokens_acct + "/" + freedao_acct +
-                                " version = " + VERSION + " - iteration " +
-                                std::to_string(this_iteration.iteration_number);
+                                " version = " + VERSION + " - iteration ";
+  append_uint(version_message, this_iteration.iteration_number);
 
   check(false, version_message);
 }
 
 // ACTION
 void freeos::tick() {
+  PROFILE_ACTION("tick");
+
   // what iteration is in the statistics table?
   statistic_index statistic_table(get_self(), get_self().value);
   auto statistic_iterator = statistic_table.begin();
@@ -30,7 +40,8 @@ void freeos::tick() {
         "statistics record is not found");
 
   uint32_t old_iteration = statistic_iterator->iteration;
-  uint32_t new_iteration = get_claim_iteration().iteration_number;
+  iteration current_iteration = get_claim_iteration();
+  uint32_t new_iteration = current_iteration.iteration_number;
   uint32_t previous_unvest_iteration =
       statistic_iterator->unvestpercentiteration;
 
@@ -45,19 +56,33 @@ void freeos::tick() {
     if (new_iteration > previous_unvest_iteration) {
       // update unvest percent if required
       update_unvest_percentage();
+    }
 
-      // reset the iteration stats table i.e. set weekly claimevents = 0
-      reset_iteration_claimevents();
+    // the iterstats claimevents count is tagged with its iteration and
+    // restarts with the first claim of a new iteration. A record written
+    // before the tag was added is reset and tagged here, once.
+    iterstats_index iterstats_table(get_self(), get_self().value);
+    auto iterstat_iterator = iterstats_table.begin();
+    if (iterstat_iterator != iterstats_table.end() &&
+        !iterstat_iterator->iteration.has_value()) {
+      iterstats_table.modify(iterstat_iterator, _self, [&](auto &s) {
+        s.claimevents = 0;
+        s.iteration = new_iteration;
+      });
     }
 
     if (new_iteration != 0) {
       uint32_t previous_iteration = new_iteration - 1;
 
+      // calculate the claim for the new iteration
+      store_claim_quote(make_claim_quote(current_iteration));
+
       // delete the expired iteration record
       action delete_action = action(permission_level{get_self(), "active"_n},
                                     name(freeosconfig_acct), "iterclear"_n,
                                     std::make_tuple(previous_iteration));
 
+      PROFILE_INLINE_ACTION();
       delete_action.send();
     }
 
@@ -68,24 +93,6 @@ void freeos::tick() {
   }
 }
 
-// reset the iteration claimevents statistic (number of claim events in the curretn week) // new in v0.355
-void freeos::reset_iteration_claimevents() {
-  iterstats_index iterstats_table(get_self(), get_self().value);
-  auto iterstat_iterator = iterstats_table.begin();
-
-  if (iterstat_iterator == iterstats_table.end()) {
-    // insert the record
-    iterstats_table.emplace(get_self(), [&](auto &s) {
-      s.claimevents = 0;
-    });
-  } else {
-    // modify the record
-    iterstats_table.modify(iterstat_iterator, _self, [&](auto &s) {
-      s.claimevents = 0;
-    });
-  }
-}
-
 uint32_t freeos::get_cached_iteration() {
   statistic_index statistic_table(get_self(), get_self().value);
   auto statistic_iterator = statistic_table.begin();
@@ -98,6 +105,8 @@ uint32_t freeos::get_cached_iteration() {
 
 // ACTION
 void freeos::cron() {
+  PROFILE_ACTION("cron");
+
   require_auth("cron"_n);
 
   tick();
@@ -127,36 +136,8 @@ void freeos::update_unvest_percentage() {
 
     // move the unvest_percentage on to next level if we have reached a new
     // 'good times' iteration
-    switch (current_unvest_percentage) {
-    case 0:
-    case 15:
-      new_unvest_percentage = 1;
-      break;
-    case 1:
-      new_unvest_percentage = 2;
-      break;
-    case 2:
-      new_unvest_percentage = 3;
-      break;
-    case 3:
-      new_unvest_percentage = 5;
-      break;
-    case 5:
-      new_unvest_percentage = 8;
-      break;
-    case 8:
-      new_unvest_percentage = 13;
-      break;
-    case 13:
-      new_unvest_percentage = 21;
-      break;
-    case 21:
-      new_unvest_percentage = 21;
-      break;
-    default :
-      new_unvest_percentage = 0;
-      break;
-    }
+    new_unvest_percentage =
+        economics::next_unvest_percentage(current_unvest_percentage);
 
     // modify the statistics table with the new percentage. Also ensure the
     // failsafe counter is set to 0.
@@ -164,6 +145,10 @@ void freeos::update_unvest_percentage() {
       stat.unvestpercent = new_unvest_percentage;
       stat.unvestpercentiteration = get_cached_iteration();
       stat.failsafecounter = 0;
+#ifdef LAZY_UNLOCK
+      stat.unlockfactor = economics::next_unlock_factor(
+          unlock_factor_of(stat), new_unvest_percentage);
+#endif
     });
 
   } else {
@@ -175,29 +160,70 @@ void freeos::update_unvest_percentage() {
     uint8_t failsafe_frequency = 24;
 
     // read the frequency from the freeosconfig 'parameters' table
-    parameters_index parameters_table(name(freeosconfig_acct),
-                                      name(freeosconfig_acct).value);
+    parameters_index parameters_table{name(freeosconfig_acct),
+                                      name(freeosconfig_acct).value};
     auto parameter_iterator = parameters_table.find(name("failsafefreq").value);
 
     if (parameter_iterator != parameters_table.end()) {
-      failsafe_frequency = stoi(parameter_iterator->value);
+      failsafe_frequency = parse_uint(parameter_iterator->value);
     }
 
     // increment the failsafe_counter
-    uint32_t failsafe_counter = statistic_iterator->failsafecounter;
-    failsafe_counter++;
+    economics::failsafe_step failsafe = economics::next_failsafe(
+        statistic_iterator->failsafecounter, failsafe_frequency);
 
     // Store the new failsafecounter and unvestpercent
     statistic_table.modify(statistic_iterator, _self, [&](auto &stat) {
-      stat.failsafecounter = failsafe_counter % failsafe_frequency;
-      stat.unvestpercent = (failsafe_counter == failsafe_frequency ? 15 : 0);
+      stat.failsafecounter = failsafe.failsafecounter;
+      stat.unvestpercent = failsafe.unvestpercent;
       stat.unvestpercentiteration = get_cached_iteration();
+#ifdef LAZY_UNLOCK
+      stat.unlockfactor = economics::next_unlock_factor(
+          unlock_factor_of(stat), failsafe.unvestpercent);
+#endif
     });
   }
 }
 
+// the cumulative unlock factor - only moves on in a LAZY_UNLOCK build
+double freeos::get_unlock_factor() {
+  statistic_index statistic_table(get_self(), get_self().value);
+  auto statistic_iterator = statistic_table.begin();
+  check(statistic_iterator != statistic_table.end(),
+        "statistics record is not found");
+
+  return unlock_factor_of(*statistic_iterator);
+}
+
+// apply a change to the aggstats record. Until the record is seeded - by the
+// first registration of a new system, or by aggset on a running one - there
+// are no totals to keep up to date, and the change is skipped.
+template <typename F> void freeos::update_aggstats(F update) {
+  aggstats_index aggstats_table(get_self(), get_self().value);
+  auto aggstat_iterator = aggstats_table.begin();
+
+  if (aggstat_iterator != aggstats_table.end()) {
+    aggstats_table.modify(aggstat_iterator, _self, update);
+  }
+}
+
+// set the aggstats record, creating it if necessary
+void freeos::set_aggstats(const aggstat &aggregates) {
+  aggstats_index aggstats_table(get_self(), get_self().value);
+  auto aggstat_iterator = aggstats_table.begin();
+
+  if (aggstat_iterator == aggstats_table.end()) {
+    aggstats_table.emplace(get_self(), [&](auto &a) { a = aggregates; });
+  } else {
+    aggstats_table.modify(aggstat_iterator, _self,
+                          [&](auto &a) { a = aggregates; });
+  }
+}
+
 // ACTION
 void freeos::reguser(const name &user) {
+  PROFILE_ACTION("reguser");
+
   require_auth(user);
 
   // check that system is operational (global masterswitch parameter set to "1")
@@ -244,6 +270,13 @@ registration_status freeos::register_user(const name &user) {
     statistic_table.emplace(
         get_self(), [&](auto &stat) { stat.usercount = number_of_users = 1; });
 
+    // a new system - nothing is staked, vested or queued yet
+    aggstat aggregates;
+    aggregates.staked = asset(0, SYSTEM_CURRENCY_SYMBOL);
+    aggregates.vested = asset(0, NON_EXCHANGEABLE_SYMBOL);
+    aggregates.refunds = asset(0, SYSTEM_CURRENCY_SYMBOL);
+    set_aggstats(aggregates);
+
   } else {
     // modify
     statistic_table.modify(statistic_iterator, _self, [&](auto &stat) {
@@ -254,19 +287,19 @@ registration_status freeos::register_user(const name &user) {
   // get the current iteration
   iteration current_iteration = get_claim_iteration();
 
-  // examine the staking requirement for the user - if their staking requirement
-  // is 0 then we will consider them to have already staked
-  int64_t stake_requirement_amount = get_stake_requirement(account_type);
-  asset stake_requirement =
-      asset(stake_requirement_amount, SYSTEM_CURRENCY_SYMBOL);
-
   // register the user
-  users_table.emplace(get_self(), [&](auto &user) {
-    user.stake = asset(0, SYSTEM_CURRENCY_SYMBOL);
-    user.account_type = account_type;
-    user.registered_iteration = current_iteration.iteration_number;
-    user.staked_iteration =
-        stake_requirement.amount == 0 ? current_iteration.iteration_number : 0;
+  users_table.emplace(get_self(), [&](freedao::user &record) {
+    record = new_user_record(account_type, current_iteration.iteration_number,
+                             number_of_users);
+  });
+
+  // count the user in the aggregates
+  update_aggstats([&](auto &a) {
+    if (account_type == 'v') {
+      a.verified++;
+    } else {
+      a.unverified++;
+    }
   });
 
   // add the user to the vested accounts table
@@ -285,6 +318,8 @@ registration_status freeos::register_user(const name &user) {
 // action to allow user to reverify their account_type
 // ACTION
 void freeos::reverify(name user) {
+  PROFILE_ACTION("reverify");
+
   require_auth(user);
 
   // get the current iteration
@@ -303,6 +338,7 @@ void freeos::reverify(name user) {
         "user is not registered with freeos");
 
   // get the account type
+  char previous_account_type = user_iterator->account_type;
   char account_type = get_account_type(user);
 
   // examine the staking requirement for the user - if their staking requirement
@@ -319,6 +355,19 @@ void freeos::reverify(name user) {
       u.staked_iteration = current_iteration.iteration_number;
     }
   });
+
+  // move the user between the verified and unverified counts
+  if ((previous_account_type == 'v') != (account_type == 'v')) {
+    update_aggstats([&](auto &a) {
+      if (account_type == 'v') {
+        a.verified++;
+        a.unverified--;
+      } else {
+        a.verified--;
+        a.unverified++;
+      }
+    });
+  }
 }
 
 // determine the user account type from the Proton verification table
@@ -330,8 +379,8 @@ char freeos::get_account_type(name user) {
   // contract then use that one
   name verification_contract = VERIFICATION_CONTRACT;
 
-  parameters_index parameters_table(name(freeosconfig_acct),
-                                    name(freeosconfig_acct).value);
+  parameters_index parameters_table{name(freeosconfig_acct),
+                                    name(freeosconfig_acct).value};
   auto parameter_iterator = parameters_table.find(name("altverifyacc").value);
 
   if (parameter_iterator == parameters_table.end()) {
@@ -347,8 +396,8 @@ char freeos::get_account_type(name user) {
   }
 
   // access the verification table
-  usersinfo verification_table(name(verification_contract),
-                               name(verification_contract).value);
+  usersinfo verification_table{name(verification_contract),
+                               name(verification_contract).value};
   auto verification_iterator = verification_table.find(user.value);
 
   if (verification_iterator != verification_table.end()) {
@@ -356,7 +405,7 @@ char freeos::get_account_type(name user) {
     // verification
     user_account_type = 'd';
 
-    auto kyc_prov = verification_iterator->kyc;
+    const auto &kyc_prov = verification_iterator->kyc;
 
     for (int i = 0; i < kyc_prov.size(); i++) {
       size_t fn_pos = kyc_prov[i].kyc_level.find("firstname");
@@ -378,7 +427,10 @@ char freeos::get_account_type(name user) {
 #else
 [[eosio::on_notify("xtokens::transfer")]]
 #endif
-void freeos::stake(name user, name to, asset quantity, std::string memo) {
+void freeos::stake(name user, name to, asset quantity,
+                   const std::string &memo) {
+  PROFILE_ACTION("stake");
+
   if (memo == "freeos stake") {
     if (user == get_self()) {
       return;
@@ -425,52 +477,78 @@ void freeos::stake(name user, name to, asset quantity, std::string memo) {
 
     uint32_t stake_requirement_amount =
         get_stake_requirement(user_iterator->account_type);
-    asset stake_requirement = asset(stake_requirement_amount * (pow(10, SYSTEM_CURRENCY_PRECISION)),
-                                    SYSTEM_CURRENCY_SYMBOL);
-    check(stake_requirement == quantity,
-          "the stake amount is not what is required " + stake_requirement.to_string());
+    asset stake_requirement =
+        asset(stake_requirement_amount * SYSTEM_CURRENCY_UNITS,
+              SYSTEM_CURRENCY_SYMBOL);
+    check_lazy(stake_requirement == quantity, [&] {
+      return "the stake amount is not what is required " +
+             stake_requirement.to_string();
+    });
 
     // update the user record
     users_table.modify(user_iterator, _self, [&](auto &usr) {
       usr.stake = quantity;
       usr.staked_iteration = current_iteration;
     });
+
+    update_aggstats([&](auto &a) { a.staked += quantity; });
   }
 }
 
-uint32_t freeos::get_stake_requirement(char account_type) {
-  // default return value
-  uint32_t stake_requirement = 0;
+// the users record of a new registration - if the user's staking requirement
+// is 0 then we will consider them to have already staked
+user freeos::new_user_record(char account_type, uint32_t iteration_number,
+                             uint32_t number_of_users) {
+  user record{};
+  record.stake = asset(0, SYSTEM_CURRENCY_SYMBOL);
+  record.account_type = account_type;
+  record.registered_iteration = iteration_number;
+  record.staked_iteration =
+      get_stake_requirement(account_type, number_of_users) == 0
+          ? iteration_number
+          : 0;
+  return record;
+}
 
+uint32_t freeos::get_stake_requirement(char account_type) {
   // get the number of users
   statistic_index statistic_table(get_self(), get_self().value);
   auto statistic_iterator = statistic_table.begin();
   check(statistic_iterator != statistic_table.end(),
         "the statistics record is not found");
-  uint32_t number_of_users = statistic_iterator->usercount;
 
+  return get_stake_requirement(account_type, statistic_iterator->usercount);
+}
+
+// whether the stakereqs table has a band for the number of users, so that
+// get_stake_requirement can be called without failing
+bool freeos::has_stake_requirement(uint32_t number_of_users) {
+  stakereq_index stakereqs_table{name(freeosconfig_acct),
+                                 name(freeosconfig_acct).value};
+  return stakereqs_table.upper_bound(number_of_users) !=
+         stakereqs_table.begin();
+}
+
+uint32_t freeos::get_stake_requirement(char account_type,
+                                       uint32_t number_of_users) {
   // look up the freeosconfig stakereqs table
-  stakereq_index stakereqs_table(name(freeosconfig_acct),
-                                 name(freeosconfig_acct).value);
+  stakereq_index stakereqs_table{name(freeosconfig_acct),
+                                 name(freeosconfig_acct).value};
   auto sr_iterator = stakereqs_table.upper_bound(number_of_users);
   sr_iterator--;
 
   check(sr_iterator != stakereqs_table.end(),
         "stake requirements cannot be determined");
 
-  if (account_type == 'v') {
-    stake_requirement = sr_iterator->requirement_v;
-  } else if (account_type == 'd') {
-    stake_requirement = sr_iterator->requirement_d;
-  } else {
-    stake_requirement = sr_iterator->requirement_e;
-  }
-
-  return stake_requirement;
+  return economics::stake_requirement(account_type, sr_iterator->requirement_v,
+                                      sr_iterator->requirement_d,
+                                      sr_iterator->requirement_e);
 }
 
 // ACTION
 void freeos::unstake(const name &user) {
+  PROFILE_ACTION("unstake");
+
   require_auth(user);
 
   // user-activity-driven background process
@@ -514,6 +592,11 @@ void freeos::request_stake_refund(name user, asset amount) {
     unstake.iteration = current_iteration;
     unstake.amount = amount;
   });
+
+  update_aggstats([&](auto &a) {
+    a.refunds += amount;
+    a.refundcount++;
+  });
 }
 
 // refund stakes
@@ -521,12 +604,12 @@ void freeos::refund_stakes() {
   // read the number of unstakes to release - from the freeosconfig 'parameters'
   // table
   uint16_t number_to_release = 3; // default (safe) value if parameter not set
-  parameters_index parameters_table(name(freeosconfig_acct),
-                                    name(freeosconfig_acct).value);
+  parameters_index parameters_table{name(freeosconfig_acct),
+                                    name(freeosconfig_acct).value};
   auto parameter_iterator = parameters_table.find(name("unstakesnum").value);
 
   if (parameter_iterator != parameters_table.end()) {
-    number_to_release = stoi(parameter_iterator->value);
+    number_to_release = parse_uint(parameter_iterator->value);
   }
 
   uint32_t current_iteration = get_cached_iteration();
@@ -535,22 +618,40 @@ void freeos::refund_stakes() {
   auto iteration_index = unstakes_table.get_index<"iteration"_n>();
   auto unstake_iterator = iteration_index.begin();
 
+  // the queued total and count released, and the stakes refunded, for the
+  // aggregates
+  asset refunded = asset(0, SYSTEM_CURRENCY_SYMBOL);
+  uint32_t refunded_count = 0;
+  asset unstaked = asset(0, SYSTEM_CURRENCY_SYMBOL);
+
   for (uint16_t i = 0;
        i < number_to_release && unstake_iterator != iteration_index.end();
        i++) {
     if (unstake_iterator->iteration < current_iteration) {
       // process the unstake request
-      refund_stake(unstake_iterator->staker, unstake_iterator->amount);
+      unstaked +=
+          refund_stake(unstake_iterator->staker, unstake_iterator->amount);
+      refunded += unstake_iterator->amount;
+      refunded_count++;
       unstake_iterator = iteration_index.erase(unstake_iterator);
     } else {
       // we've reached stakes to be released in the future
       break;
     }
   }
+
+  if (refunded_count > 0) {
+    update_aggstats([&](auto &a) {
+      a.staked -= unstaked;
+      a.refunds -= refunded;
+      a.refundcount -= refunded_count;
+    });
+  }
 }
 
-// refund a stake
-void freeos::refund_stake(name user, asset amount) {
+// refund a stake - returns the stake the user record held, for the caller to
+// take off the aggregates
+asset freeos::refund_stake(name user, asset amount) {
   // find user record
   users_index users_table(get_self(), user.value);
   auto user_iterator =
@@ -563,18 +664,24 @@ void freeos::refund_stake(name user, asset amount) {
       std::make_tuple(get_self(), user, amount,
                       std::string("refund of freeos stake")));
 
+    PROFILE_INLINE_ACTION();
     transfer.send();
   }
 
   // update the user record
+  asset previous_stake = user_iterator->stake;
   users_table.modify(user_iterator, _self, [&](auto &usr) {
     usr.stake = asset(0, SYSTEM_CURRENCY_SYMBOL);
     usr.staked_iteration = 0;
   });
+
+  return previous_stake;
 }
 
 // ACTION
 void freeos::unstakecncl(const name &user) {
+  PROFILE_ACTION("unstakecncl");
+
   require_auth(user);
 
   unstakerequest_index unstakes_table(get_self(), get_self().value);
@@ -584,12 +691,18 @@ void freeos::unstakecncl(const name &user) {
         "user does not have an unstake request");
 
   // cancel the unstake - erase the unstake record
+  asset amount = unstake_iterator->amount;
   unstakes_table.erase(unstake_iterator);
+
+  update_aggstats([&](auto &a) {
+    a.refunds -= amount;
+    a.refundcount--;
+  });
 }
 
 bool freeos::check_master_switch() {
-  parameters_index parameters_table(name(freeosconfig_acct),
-                                    name(freeosconfig_acct).value);
+  parameters_index parameters_table{name(freeosconfig_acct),
+                                    name(freeosconfig_acct).value};
   auto parameter_iterator = parameters_table.find("masterswitch"_n.value);
 
   // check if the parameter is in the table or not
@@ -609,6 +722,8 @@ bool freeos::check_master_switch() {
 
 // ACTION
 void freeos::create(const name &issuer, const asset &maximum_supply) {
+  PROFILE_ACTION("create");
+
   require_auth(get_self());
 
   auto sym = maximum_supply.symbol;
@@ -628,7 +743,8 @@ void freeos::create(const name &issuer, const asset &maximum_supply) {
   });
 }
 
-void freeos::issue(const name &to, const asset &quantity, const string &memo) {
+void freeos::issue(const name &to, const asset &quantity,
+                   std::string_view memo) {
   auto sym = quantity.symbol;
   check(sym.is_valid(), "invalid symbol name");
   check(memo.size() <= 256, "memo has more than 256 bytes");
@@ -652,7 +768,7 @@ void freeos::issue(const name &to, const asset &quantity, const string &memo) {
   add_balance(st.issuer, quantity, st.issuer);
 }
 
-void freeos::retire(const asset &quantity, const string &memo) {
+void freeos::retire(const asset &quantity, std::string_view memo) {
   auto sym = quantity.symbol;
   check(sym.is_valid(), "invalid symbol name");
   check(memo.size() <= 256, "memo has more than 256 bytes");
@@ -677,11 +793,13 @@ void freeos::retire(const asset &quantity, const string &memo) {
 // ACTION
 void freeos::allocate(const name &from, const name &to, const asset &quantity,
                       const string &memo) {
+  PROFILE_ACTION("allocate");
+
   require_auth(from);
 
   // check if the 'from' account is in the transferer whitelist
-  transferers_index transferers_table(name(freeosconfig_acct),
-                                      name(freeosconfig_acct).value);
+  transferers_index transferers_table{name(freeosconfig_acct),
+                                      name(freeosconfig_acct).value};
   auto transferer_iterator = transferers_table.find(from.value);
 
   check(transferer_iterator != transferers_table.end(),
@@ -695,9 +813,11 @@ void freeos::allocate(const name &from, const name &to, const asset &quantity,
 // issue OPTIONs ACTION
 void freeos::mint(const name &minter, const name &to, const asset &quantity,
                   const string &memo) {
+  PROFILE_ACTION("mint");
+
   // check if the 'to' account is in the minter whitelist
-  minters_index minters_table(name(freeosconfig_acct),
-                              name(freeosconfig_acct).value);
+  minters_index minters_table{name(freeosconfig_acct),
+                              name(freeosconfig_acct).value};
   auto minter_iterator = minters_table.find(minter.value);
 
   check(minter_iterator != minters_table.end(), "the mint action is protected by minters whitelist");
@@ -712,9 +832,11 @@ void freeos::mint(const name &minter, const name &to, const asset &quantity,
 // retire OPTIONs ACTION
 void freeos::burn(const name &burner, const asset &quantity,
                   const string &memo) {
+  PROFILE_ACTION("burn");
+
   // check if the 'burner' account is in the burner whitelist
-  burners_index burners_table(name(freeosconfig_acct),
-                              name(freeosconfig_acct).value);
+  burners_index burners_table{name(freeosconfig_acct),
+                              name(freeosconfig_acct).value};
   auto burner_iterator = burners_table.find(burner.value);
 
   check(burner_iterator != burners_table.end(), "the burn action is protected by burners whitelist");
@@ -725,8 +847,118 @@ void freeos::burn(const name &burner, const asset &quantity,
   retire(quantity, memo);
 }
 
-void freeos::transfer(const name &from, const name &to, const asset &quantity,
+// Bulk allocate - the transferers whitelist is checked once for all the
+// recipients ACTION
+void freeos::allocmany(const name &from,
+                       const std::vector<std::pair<name, asset>> &recipients,
+                       const string &memo) {
+  PROFILE_ACTION("allocmany");
+
+  require_auth(from);
+
+  // check if the 'from' account is in the transferer whitelist
+  transferers_index transferers_table{name(freeosconfig_acct),
+                                      name(freeosconfig_acct).value};
+  auto transferer_iterator = transferers_table.find(from.value);
+
+  check(transferer_iterator != transferers_table.end(),
+        "the allocate action is protected by transferers whitelist");
+
+  distribute(from, recipients, memo, false);
+}
+
+// Bulk mint - the minters whitelist is checked once, and the total is issued
+// and distributed from the issuer account. That is a mint and an allocate, so
+// the minter must be a transferer too ACTION
+void freeos::mintmany(const name &minter,
+                      const std::vector<std::pair<name, asset>> &recipients,
                       const string &memo) {
+  PROFILE_ACTION("mintmany");
+
+  // check if the 'minter' account is in the minter whitelist
+  minters_index minters_table{name(freeosconfig_acct),
+                              name(freeosconfig_acct).value};
+  auto minter_iterator = minters_table.find(minter.value);
+
+  check(minter_iterator != minters_table.end(), "the mint action is protected by minters whitelist");
+
+  // and in the transferer whitelist
+  transferers_index transferers_table{name(freeosconfig_acct),
+                                      name(freeosconfig_acct).value};
+  auto transferer_iterator = transferers_table.find(minter.value);
+
+  check(transferer_iterator != transferers_table.end(),
+        "the mintmany action is protected by transferers whitelist");
+
+  require_auth(minter);
+
+  distribute(get_self(), recipients, memo, true);
+}
+
+// credit each recipient, then debit 'from' for the total - or, when minting,
+// add the total to the supply instead. 'from' must be the issuer to mint.
+void freeos::distribute(const name &from,
+                        const std::vector<std::pair<name, asset>> &recipients,
+                        std::string_view memo, bool mint) {
+  check(!recipients.empty(), "no recipients");
+  check(memo.size() <= 256, "memo has more than 256 bytes");
+
+  auto sym = recipients.front().second.symbol;
+  check(sym.is_valid(), "invalid symbol name");
+
+  // the currency stats are loaded once for all the recipients
+  stats statstable(get_self(), sym.code().raw());
+  auto existing = statstable.find(sym.code().raw());
+  check(existing != statstable.end(), "token with symbol does not exist");
+  const auto &st = *existing;
+  check(sym == st.supply.symbol, "symbol precision mismatch");
+
+  if (mint) {
+    check(from == st.issuer, "tokens can only be issued to issuer account");
+  }
+
+  // each recipient is paid once - reject a list naming one twice before
+  // anything is written
+  std::vector<name> names;
+  names.reserve(recipients.size());
+  for (const auto &recipient : recipients) {
+    names.push_back(recipient.first);
+  }
+  std::sort(names.begin(), names.end());
+  check(std::adjacent_find(names.begin(), names.end()) == names.end(),
+        "duplicate recipient");
+
+  require_recipient(from);
+  PROFILE_NOTIFICATION();
+
+  asset total = asset(0, sym);
+
+  for (const auto &[to, quantity] : recipients) {
+    check(from != to, "cannot transfer to self");
+    check(is_account(to), "to account does not exist");
+    check(quantity.symbol == sym, "all quantities must be in the same symbol");
+    check(quantity.is_valid(), "invalid quantity");
+    check(quantity.amount > 0, "must transfer positive quantity");
+
+    require_recipient(to);
+    PROFILE_NOTIFICATION();
+
+    total += quantity;
+    add_balance(to, quantity, from);
+  }
+
+  if (mint) {
+    check(total.amount <= st.max_supply.amount - st.supply.amount,
+          "quantity exceeds available supply");
+
+    statstable.modify(st, same_payer, [&](auto &s) { s.supply += total; });
+  } else {
+    sub_balance(from, total);
+  }
+}
+
+void freeos::transfer(const name &from, const name &to, const asset &quantity,
+                      std::string_view memo) {
   check(from != to, "cannot transfer to self");
   // require_auth(from);
   check(is_account(to), "to account does not exist");
@@ -741,6 +973,8 @@ void freeos::transfer(const name &from, const name &to, const asset &quantity,
 
   require_recipient(from);
   require_recipient(to);
+  PROFILE_NOTIFICATION();
+  PROFILE_NOTIFICATION();
 
   check(quantity.is_valid(), "invalid quantity");
   check(quantity.amount > 0, "must transfer positive quantity");
@@ -756,27 +990,11 @@ void freeos::transfer(const name &from, const name &to, const asset &quantity,
 // convert non-exchangeable currency for exchangeable currency
 // ACTION
 void freeos::convert(const name &owner, const asset &quantity) {
-  require_auth(owner);
-
-  auto sym = quantity.symbol;
-  check(sym == NON_EXCHANGEABLE_SYMBOL,
-        "invalid symbol name");
-
-  stats statstable(get_self(), sym.code().raw());
-  auto existing = statstable.find(sym.code().raw());
-  check(existing != statstable.end(), "token with symbol does not exist");
-  const auto &st = *existing;
+  PROFILE_ACTION("convert");
 
-  check(quantity.is_valid(), "invalid quantity");
-  check(quantity.amount > 0, "must convert positive quantity");
+  require_auth(owner);
 
-  statstable.modify(st, same_payer, [&](auto &s) {
-    s.supply -= quantity;
-    s.conditional_supply -= quantity;
-  });
-
-  // decrease owner's balance of non-exchangeable tokens
-  sub_balance(owner, quantity);
+  burn_for_conversion(owner, quantity);
 
   // Issue exchangeable tokens
   asset exchangeable_amount =
@@ -788,6 +1006,7 @@ void freeos::convert(const name &owner, const asset &quantity) {
       permission_level{get_self(), "active"_n}, name(freeostokens_acct),
       "issue"_n, std::make_tuple(name(freeos_acct), exchangeable_amount, memo));
 
+  PROFILE_INLINE_ACTION();
   issue_action.send();
 
   // transfer exchangeable tokens to the owner
@@ -796,9 +1015,162 @@ void freeos::convert(const name &owner, const asset &quantity) {
       "transfer"_n,
       std::make_tuple(name(freeos_acct), owner, exchangeable_amount, memo));
 
+  PROFILE_INLINE_ACTION();
   transfer_action.send();
 }
 
+// request a conversion - the POINTs are burned now and the FREEOS issued by
+// convsettle
+// ACTION
+void freeos::convreq(const name &owner, const asset &quantity) {
+  PROFILE_ACTION("convreq");
+
+  require_auth(owner);
+
+  burn_for_conversion(owner, quantity);
+
+  // add to the conversion requests queue
+  asset exchangeable_amount = asset(quantity.amount, EXCHANGEABLE_SYMBOL);
+
+  convrequest_index convreqs_table(get_self(), get_self().value);
+  auto convreq_iterator = convreqs_table.find(owner.value);
+
+  if (convreq_iterator == convreqs_table.end()) {
+    // join the back of the queue
+    auto sequence_index = convreqs_table.get_index<"sequence"_n>();
+    auto last_request = sequence_index.end();
+    uint64_t sequence = 0;
+    if (last_request != sequence_index.begin()) {
+      last_request--;
+      sequence = last_request->sequence + 1;
+    }
+
+    convreqs_table.emplace(get_self(), [&](auto &request) {
+      request.owner = owner;
+      request.amount = exchangeable_amount;
+      request.sequence = sequence;
+    });
+  } else {
+    convreqs_table.modify(convreq_iterator, same_payer, [&](auto &request) {
+      request.amount += exchangeable_amount;
+    });
+  }
+}
+
+// settle a batch of conversion requests - one issue for the batch, then a
+// transfer to each owner
+// ACTION
+void freeos::convsettle() {
+  PROFILE_ACTION("convsettle");
+
+  // read the number of requests to settle - from the freeosconfig 'parameters'
+  // table
+  uint16_t number_to_settle = 20; // default value if parameter not set
+  parameters_index parameters_table{name(freeosconfig_acct),
+                                    name(freeosconfig_acct).value};
+  auto parameter_iterator = parameters_table.find(name("convbatchnum").value);
+
+  if (parameter_iterator != parameters_table.end()) {
+    number_to_settle = parse_uint(parameter_iterator->value);
+  }
+
+  // the requests are settled oldest first
+  convrequest_index convreqs_table(get_self(), get_self().value);
+  auto sequence_index = convreqs_table.get_index<"sequence"_n>();
+
+  // the total of the batch
+  asset total = asset(0, EXCHANGEABLE_SYMBOL);
+  auto convreq_iterator = sequence_index.begin();
+  for (uint16_t i = 0;
+       i < number_to_settle && convreq_iterator != sequence_index.end();
+       i++, convreq_iterator++) {
+    total += convreq_iterator->amount;
+  }
+
+  check(total.amount > 0, "there are no conversion requests to settle");
+
+  std::string memo = std::string("conversion");
+
+  // issue the batch total of exchangeable tokens to the freeos account
+  action issue_action = action(
+      permission_level{get_self(), "active"_n}, name(freeostokens_acct),
+      "issue"_n, std::make_tuple(name(freeos_acct), total, memo));
+
+  PROFILE_INLINE_ACTION();
+  issue_action.send();
+
+  // transfer exchangeable tokens to each owner and remove their request
+  convreq_iterator = sequence_index.begin();
+  for (uint16_t i = 0;
+       i < number_to_settle && convreq_iterator != sequence_index.end();
+       i++) {
+    action transfer_action = action(
+        permission_level{get_self(), "active"_n}, name(freeostokens_acct),
+        "transfer"_n,
+        std::make_tuple(name(freeos_acct), convreq_iterator->owner,
+                        convreq_iterator->amount, memo));
+
+    PROFILE_INLINE_ACTION();
+    transfer_action.send();
+
+    convreq_iterator = sequence_index.erase(convreq_iterator);
+  }
+}
+
+// cancel a conversion request - the burned non-exchangeable currency is
+// restored to the owner
+// ACTION
+void freeos::convcancel(const name &owner) {
+  PROFILE_ACTION("convcancel");
+
+  require_auth(owner);
+
+  convrequest_index convreqs_table(get_self(), get_self().value);
+  auto convreq_iterator = convreqs_table.find(owner.value);
+  check(convreq_iterator != convreqs_table.end(),
+        "there is no conversion request to cancel");
+
+  asset quantity =
+      asset(convreq_iterator->amount.amount, NON_EXCHANGEABLE_SYMBOL);
+
+  // undo burn_for_conversion
+  stats statstable(get_self(), quantity.symbol.code().raw());
+  auto existing = statstable.find(quantity.symbol.code().raw());
+  check(existing != statstable.end(), "token with symbol does not exist");
+
+  statstable.modify(existing, same_payer, [&](auto &s) {
+    s.supply += quantity;
+    s.conditional_supply += quantity;
+  });
+
+  add_balance(owner, quantity, get_self());
+
+  convreqs_table.erase(convreq_iterator);
+}
+
+// burn the non-exchangeable currency of a conversion
+void freeos::burn_for_conversion(const name &owner, const asset &quantity) {
+  auto sym = quantity.symbol;
+  check(sym == NON_EXCHANGEABLE_SYMBOL,
+        "invalid symbol name");
+
+  stats statstable(get_self(), sym.code().raw());
+  auto existing = statstable.find(sym.code().raw());
+  check(existing != statstable.end(), "token with symbol does not exist");
+  const auto &st = *existing;
+
+  check(quantity.is_valid(), "invalid quantity");
+  check(quantity.amount > 0, "must convert positive quantity");
+
+  statstable.modify(st, same_payer, [&](auto &s) {
+    s.supply -= quantity;
+    s.conditional_supply -= quantity;
+  });
+
+  // decrease owner's balance of non-exchangeable tokens
+  sub_balance(owner, quantity);
+}
+
 void freeos::sub_balance(const name &owner, const asset &value) {
   accounts from_acnts(get_self(), owner.value);
 
@@ -822,6 +1194,8 @@ void freeos::add_balance(const name &owner, const asset &value,
 
 // ACTION
 void freeos::claim(const name &user) {
+  PROFILE_ACTION("claim");
+
   require_auth(user);
 
   // user-activity-driven background process
@@ -830,56 +1204,69 @@ void freeos::claim(const name &user) {
   // check that system is operational (global masterswitch parameter set to "1")
   check(check_master_switch(), MSG_FREEOS_SYSTEM_NOT_AVAILABLE);
 
-  // what iteration are we in?
-  iteration this_iteration = get_claim_iteration();
-  check(this_iteration.iteration_number != 0,
+  // what iteration are we in? - tick has brought the cached iteration up to
+  // date
+  uint32_t this_iteration = get_cached_iteration();
+  check(this_iteration != 0,
         "claiming is not possible at this time, please try later");
 
   // auto-register the user - if user is already registered then that is ok, the
   // register_user function responds silently
   registration_status result = register_user(user);
 
+  // get the claim amounts for this iteration, calculated when the iteration
+  // started
+  claimquote quote = get_claim_quote(this_iteration, true);
+
   // check user eligibility to claim
-  check(eligible_to_claim(user, this_iteration),
+  check(eligible_to_claim(user, this_iteration, quote.tokens_required),
         "user is not eligible to claim in this iteration");
 
   // update the number of claimevents
   uint32_t claim_event_count = update_claim_event_count();
 
   // update the number of claim events in the current iteration
-  uint32_t iteration_claim_event_count = update_iteration_claim_event_count();
-
-  // get freedao multiplier // new in v0.355 - freedao)multiplier calculated on iteration claimevents count
-  double freedao_multiplier = get_freedao_multiplier(iteration_claim_event_count);
+  uint32_t iteration_claim_event_count =
+      update_iteration_claim_event_count(this_iteration);
 
-  // calculate amounts to be transferred to user and FreeDAO
-  // first get the proportion that is vested
-  float vested_proportion = get_vested_proportion();
+  // the freedao amount depends on the iteration claimevents count - move the
+  // quote on if this claim has reached the next multiplier tier
+  if (requote_freedao_tier(quote, iteration_claim_event_count)) {
+    store_claim_quote(quote);
+  }
 
-  // work out the vested proportion and liquid proportion of OPTION to be
-  // claimed
-  uint16_t claim_tokens = this_iteration.claim_amount;
-  asset claim_amount =
-      asset(claim_tokens * 10000, NON_EXCHANGEABLE_SYMBOL);
+  // amounts to be transferred to user and FreeDAO
+  uint16_t minted_tokens = quote.liquid_tokens + quote.freedao_tokens;
 
-  uint16_t vested_tokens = claim_tokens * vested_proportion;
   asset vested_amount =
-      asset(vested_tokens * 10000, NON_EXCHANGEABLE_SYMBOL);
-
-  uint16_t liquid_tokens = claim_tokens - vested_tokens;
+      asset(quote.vested_tokens * 10000, NON_EXCHANGEABLE_SYMBOL);
   asset liquid_amount =
-      asset(liquid_tokens * 10000, NON_EXCHANGEABLE_SYMBOL);
-
-  uint16_t freedao_tokens = claim_tokens * freedao_multiplier;
+      asset(quote.liquid_tokens * 10000, NON_EXCHANGEABLE_SYMBOL);
   asset freedao_amount =
-      asset(freedao_tokens * 10000, NON_EXCHANGEABLE_SYMBOL);
-
-  uint16_t minted_tokens = liquid_tokens + freedao_tokens;
+      asset(quote.freedao_tokens * 10000, NON_EXCHANGEABLE_SYMBOL);
   asset minted_amount =
       asset(minted_tokens * 10000, NON_EXCHANGEABLE_SYMBOL);
 
-  // prepare the memo string
-  std::string memo = std::string("claim by ") + user.to_string();
+#ifdef LAZY_UNLOCK
+  // settle the user's outstanding unlocks - the unlocked POINTs are issued and
+  // transferred with the liquid amount
+  vestaccounts_index vestaccounts_table(get_self(), user.value);
+  auto vestaccount_iterator =
+      vestaccounts_table.find(vested_amount.symbol.code().raw());
+  double unlock_factor = get_unlock_factor();
+  asset unlocked_amount = asset(0, NON_EXCHANGEABLE_SYMBOL);
+
+  if (vestaccount_iterator != vestaccounts_table.end()) {
+    unlocked_amount.amount =
+        economics::unlocked_tokens(vestaccount_iterator->balance.amount,
+                                   unlock_factor,
+                                   unlock_factor_of(*vestaccount_iterator)) *
+        10000;
+  }
+
+  liquid_amount += unlocked_amount;
+  minted_amount += unlocked_amount;
+#endif
 
   // conditionally limited supply - increment the conditional_supply by total
   // amount of issue
@@ -898,25 +1285,41 @@ void freeos::claim(const name &user) {
   // Issue the required minted amount to the freeos account
   if (minted_amount.amount > 0) {
     // issue the minted options to cover transfers to freedao and the user
-    issue(get_self(), minted_amount, memo);
+    issue(get_self(), minted_amount, MEMO_CLAIM);
   }
 
   // transfer liquid OPTION to user
   if (liquid_amount.amount > 0) {
-    transfer(get_self(), user, liquid_amount, memo);
+    transfer(get_self(), user, liquid_amount, MEMO_CLAIM);
   }
 
 
   // transfer OPTION to freedao_acct
   if (freedao_amount.amount > 0) {
-    transfer(get_self(), name(freedao_acct), freedao_amount, memo);
+    transfer(get_self(), name(freedao_acct), freedao_amount, MEMO_CLAIM);
   }
 
   // record the deposit to the freedao account
-  record_deposit(this_iteration.iteration_number, freedao_amount);
+  record_deposit(this_iteration, freedao_amount);
 
   // update the user's vested OPTION balance
-  if (vested_tokens > 0) {
+#ifdef LAZY_UNLOCK
+  if (vestaccount_iterator == vestaccounts_table.end()) {
+    if (quote.vested_tokens > 0) {
+      vestaccounts_table.emplace(get_self(), [&](auto &a) {
+        a.balance = vested_amount;
+        a.unlockfactor = unlock_factor;
+      });
+    }
+  } else if (quote.vested_tokens > 0 ||
+             unlock_factor_of(*vestaccount_iterator) != unlock_factor) {
+    vestaccounts_table.modify(vestaccount_iterator, _self, [&](auto &a) {
+      a.balance += vested_amount - unlocked_amount;
+      a.unlockfactor = unlock_factor;
+    });
+  }
+#else
+  if (quote.vested_tokens > 0) {
     vestaccounts_index to_acnts(get_self(), user.value);
     auto to = to_acnts.find(vested_amount.symbol.code().raw());
     if (to == to_acnts.end()) {
@@ -925,6 +1328,17 @@ void freeos::claim(const name &user) {
       to_acnts.modify(to, _self, [&](auto &a) { a.balance += vested_amount; });
     }
   }
+#endif
+
+  // keep the vested total up to date
+#ifdef LAZY_UNLOCK
+  asset vested_change = vested_amount - unlocked_amount;
+#else
+  asset vested_change = vested_amount;
+#endif
+  if (vested_change.amount != 0) {
+    update_aggstats([&](auto &a) { a.vested += vested_change; });
+  }
 
   // update the user's issuance stats in their registration record
   users_index users(get_self(), user.value);
@@ -933,11 +1347,80 @@ void freeos::claim(const name &user) {
   if (user_iterator != users.end()) {
     users.modify(user_iterator, _self, [&](auto &u) {
       u.issuances += 1;
-      u.last_issuance = this_iteration.iteration_number;
+      u.last_issuance = this_iteration;
     });
   }
 }
 
+// calculate the claim for an iteration. The freedao amount is for the first
+// claim event of the iteration - see requote_freedao_tier.
+claimquote freeos::make_claim_quote(const iteration &this_iteration) {
+  economics::freedao_tier tier = economics::freedao_tier_for(1);
+
+  economics::claim_split split = economics::split_claim(
+      this_iteration.claim_amount, get_vested_proportion(), tier.multiplier);
+
+  claimquote quote;
+  quote.iteration = this_iteration.iteration_number;
+  quote.claim_tokens = split.claim_tokens;
+  quote.vested_tokens = split.vested_tokens;
+  quote.liquid_tokens = split.liquid_tokens;
+  quote.tokens_required = this_iteration.tokens_required;
+  quote.freedao_tokens = split.freedao_tokens;
+  quote.tier_boundary = tier.last_claimevent;
+
+  return quote;
+}
+
+// write the claim quote record
+void freeos::store_claim_quote(const claimquote &quote) {
+  claimquote_index claimquote_table(get_self(), get_self().value);
+  auto claimquote_iterator = claimquote_table.begin();
+
+  if (claimquote_iterator == claimquote_table.end()) {
+    claimquote_table.emplace(get_self(), [&](auto &q) { q = quote; });
+  } else {
+    claimquote_table.modify(claimquote_iterator, _self,
+                            [&](auto &q) { q = quote; });
+  }
+}
+
+// return the claim quote for the iteration. tick writes the quote when an
+// iteration starts. If it is missing or out of date (e.g. the contract was
+// upgraded mid-iteration) it is calculated here, and written if store is true.
+// N.B. exchange rate or iteration changes made during an iteration take effect
+// from the next iteration.
+claimquote freeos::get_claim_quote(uint32_t iteration_number, bool store) {
+  claimquote_index claimquote_table(get_self(), get_self().value);
+  auto claimquote_iterator = claimquote_table.begin();
+
+  if (claimquote_iterator != claimquote_table.end() &&
+      claimquote_iterator->iteration == iteration_number) {
+    return *claimquote_iterator;
+  }
+
+  claimquote quote = make_claim_quote(get_claim_iteration());
+  if (store) {
+    store_claim_quote(quote);
+  }
+
+  return quote;
+}
+
+// move the quote on to the freedao multiplier tier of the nth claim event of
+// the iteration. Returns true if the quote has changed.
+bool freeos::requote_freedao_tier(claimquote &quote, uint32_t claimevents) {
+  if (claimevents <= quote.tier_boundary) {
+    return false;
+  }
+
+  economics::freedao_tier tier = economics::freedao_tier_for(claimevents);
+  quote.freedao_tokens = quote.claim_tokens * tier.multiplier;
+  quote.tier_boundary = tier.last_claimevent;
+
+  return true;
+}
+
 // record a deposit to the freedao account
 void freeos::record_deposit(uint64_t iteration_number, asset amount) {
   deposits_index deposits_table(get_self(), get_self().value);
@@ -961,6 +1444,8 @@ void freeos::record_deposit(uint64_t iteration_number, asset amount) {
 // action to clear (remove) a deposit record from the deposit table
 // ACTION
 void freeos::depositclear(uint64_t iteration_number) {
+  PROFILE_ACTION("depositclear");
+
   require_auth(name(freedao_acct));
 
   deposits_index deposits_table(get_self(), get_self().value);
@@ -976,6 +1461,8 @@ void freeos::depositclear(uint64_t iteration_number) {
 
 // ACTION
 void freeos::unvest(const name &user) {
+  PROFILE_ACTION("unvest");
+
   require_auth(user);
 
   // user-activity-driven background process
@@ -988,6 +1475,7 @@ void freeos::unvest(const name &user) {
   uint32_t this_iteration = get_cached_iteration();
   check(this_iteration > 0, "unlocking is not possible at this time, please try later");
 
+#ifndef LAZY_UNLOCK
   // calculate the amount to be unvested - get the percentage for the iteration
   statistic_index statistic_table(get_self(), get_self().value);
   auto statistic_iterator = statistic_table.begin();
@@ -1009,6 +1497,7 @@ void freeos::unvest(const name &user) {
     check(unvest_iterator->iteration_number != this_iteration,
         "user has already unlocked in this iteration");
   }
+#endif
 
   // do the unvesting
   // get the user's unvested OPTION balance
@@ -1026,21 +1515,20 @@ void freeos::unvest(const name &user) {
   }
 
   // calculate the amount of vested OPTIONs to convert to liquid OPTIONs
-  // Warning: these calculations use mixed-type arithmetic. Any changes need to
-  // be thoroughly tested.
-
-  uint64_t vested_units =
-      user_vbalance.amount; // in currency units (i.e. number of 0.0001 OPTION)
-
-  double percentage = unvest_percent / 100.0; // required to be a double
-
-  uint64_t converted_units =
-      vested_units *
-      percentage; // in currency units (i.e. number of 0.0001 OPTION)
-
-  uint32_t rounded_up_options = (uint32_t)ceil(
-      converted_units /
-      10000.0); // ceil rounds up to the next whole number of OPTION
+#ifdef LAZY_UNLOCK
+  // lazy unlock - everything unlocked since the balance was last settled
+  double unlock_factor = get_unlock_factor();
+  uint32_t rounded_up_options = economics::unlocked_tokens(
+      user_vbalance.amount, unlock_factor,
+      unlock_factor_of(*vestaccount_iterator));
+
+  check(rounded_up_options > 0,
+        "no locked POINTs have been unlocked since your last unlock. Please "
+        "try during next claim period.");
+#else
+  uint32_t rounded_up_options =
+      economics::unvest_tokens(user_vbalance.amount, unvest_percent);
+#endif
 
   asset converted_options =
       asset(rounded_up_options * 10000,
@@ -1063,23 +1551,29 @@ void freeos::unvest(const name &user) {
     s.conditional_supply += converted_options;
   });
 
-  std::string memo = std::string("unlocking POINTs by ");
-  memo.append(user.to_string());
-
   // Issue the required amount to the freeos account
   if (converted_options.amount > 0) {
-    issue(get_self(), converted_options, memo);
+    issue(get_self(), converted_options, MEMO_UNLOCK);
   }
 
   // transfer liquid OPTIONs to user
   if (converted_options.amount > 0) {
-    transfer(get_self(), user, converted_options, memo);
+    transfer(get_self(), user, converted_options, MEMO_UNLOCK);
   }
 
   // subtract the amount transferred from the unvested record
-  vestaccounts_table.modify(vestaccount_iterator, _self,
-                            [&](auto &v) { v.balance -= converted_options; });
+  vestaccounts_table.modify(vestaccount_iterator, _self, [&](auto &v) {
+    v.balance -= converted_options;
+#ifdef LAZY_UNLOCK
+    v.unlockfactor = unlock_factor;
+#endif
+  });
 
+  if (converted_options.amount > 0) {
+    update_aggstats([&](auto &a) { a.vested -= converted_options; });
+  }
+
+#ifndef LAZY_UNLOCK
   // write the unvest event to the unvest history table
   unvest_iterator = unvest_table.begin();
   if (unvest_iterator == unvest_table.end()) {
@@ -1091,13 +1585,16 @@ void freeos::unvest(const name &user) {
       unvest.iteration_number = this_iteration;
     });
   }
+#endif
 }
 
 
 // ACTION
 void freeos::refundstake(const name &user) {
+  PROFILE_ACTION("refundstake");
+
   // determine who is allowed to run the action
-  parameters_index parameters_table(name(freeosconfig_acct), name(freeosconfig_acct).value);
+  parameters_index parameters_table{name(freeosconfig_acct), name(freeosconfig_acct).value};
   auto parameter_iterator = parameters_table.find(name("adminacc").value);
   if (parameter_iterator != parameters_table.end()) {
     require_auth(name(parameter_iterator->value));
@@ -1112,14 +1609,17 @@ void freeos::refundstake(const name &user) {
 
   asset user_stake = user_iterator->stake;
   if (user_stake.amount > 0) {
-    refund_stake(user, user_stake);
+    asset unstaked = refund_stake(user, user_stake);
+    update_aggstats([&](auto &a) { a.staked -= unstaked; });
   }
 }
 
 // ACTION
 void freeos::deregister(const name &user) {
+  PROFILE_ACTION("deregister");
+
   // determine who is allowed to run the action
-  parameters_index parameters_table(name(freeosconfig_acct), name(freeosconfig_acct).value);
+  parameters_index parameters_table{name(freeosconfig_acct), name(freeosconfig_acct).value};
   auto parameter_iterator = parameters_table.find(name("adminacc").value);
   if (parameter_iterator != parameters_table.end()) {
     require_auth(name(parameter_iterator->value));
@@ -1134,13 +1634,24 @@ void freeos::deregister(const name &user) {
 
   // check the amount of stake
   asset user_stake = user_iterator->stake;
+  asset unstaked = asset(0, SYSTEM_CURRENCY_SYMBOL);
   if (user_stake.amount > 0) {
-    refund_stake(user, user_stake);
+    unstaked = refund_stake(user, user_stake);
   }
 
   // erase the user record
+  char account_type = user_iterator->account_type;
   users_table.erase(user_iterator);
 
+  update_aggstats([&](auto &a) {
+    a.staked -= unstaked;
+    if (account_type == 'v') {
+      a.verified--;
+    } else {
+      a.unverified--;
+    }
+  });
+
   // decrement the statistics::usercount
   statistic_index statistic_table(get_self(), get_self().value);
   auto statistic_iterator = statistic_table.begin();
@@ -1152,6 +1663,203 @@ void freeos::deregister(const name &user) {
 
 }
 
+// ACTION
+void freeos::aggset(const aggstat &aggregates) {
+  PROFILE_ACTION("aggset");
+
+  // determine who is allowed to run the action
+  parameters_index parameters_table{name(freeosconfig_acct), name(freeosconfig_acct).value};
+  auto parameter_iterator = parameters_table.find(name("adminacc").value);
+  if (parameter_iterator != parameters_table.end()) {
+    require_auth(name(parameter_iterator->value));
+  } else {
+    require_auth(_self);
+  }
+
+  check(aggregates.staked.symbol == SYSTEM_CURRENCY_SYMBOL &&
+            aggregates.refunds.symbol == SYSTEM_CURRENCY_SYMBOL,
+        ERR_SYSTEM_CURRENCY_CODE);
+  check(aggregates.vested.symbol == NON_EXCHANGEABLE_SYMBOL,
+        "vested total must be in POINT");
+
+  set_aggstats(aggregates);
+}
+
+// read-only query actions. These must not modify tables or call tick(), so
+// that they can be run in read-only transactions.
+
+// ACTION
+claim_preview freeos::getclaimq(const name &user) {
+  PROFILE_ACTION("getclaimq");
+
+  claim_preview preview;
+  preview.eligible = false;
+  preview.liquid_amount = asset(0, NON_EXCHANGEABLE_SYMBOL);
+  preview.vested_amount = asset(0, NON_EXCHANGEABLE_SYMBOL);
+  preview.freedao_amount = asset(0, NON_EXCHANGEABLE_SYMBOL);
+
+  iteration this_iteration = get_claim_iteration();
+  preview.iteration = this_iteration.iteration_number;
+
+  users_index users_table(get_self(), user.value);
+  auto user_iterator = users_table.begin();
+
+  // apply the same checks as the claim action, in the same order
+  if (!check_master_switch()) {
+    preview.reason = MSG_FREEOS_SYSTEM_NOT_AVAILABLE;
+    return preview;
+  }
+
+  if (this_iteration.iteration_number == 0) {
+    preview.reason = "claiming is not possible at this time, please try later";
+    return preview;
+  }
+
+  // claim registers an unregistered user first - preview the record it would
+  // create, returning a reason where the lookups of the registration would
+  // abort
+  freedao::user record;
+  if (user_iterator != users_table.end()) {
+    record = *user_iterator;
+  } else {
+    statistic_index statistic_table(get_self(), get_self().value);
+    auto statistic_iterator = statistic_table.begin();
+    if (statistic_iterator == statistic_table.end()) {
+      preview.reason = "statistics record is not found";
+      return preview;
+    }
+
+    uint32_t number_of_users = statistic_iterator->usercount + 1;
+    if (!has_stake_requirement(number_of_users)) {
+      preview.reason = "stake requirements cannot be determined";
+      return preview;
+    }
+
+    record = new_user_record(get_account_type(user),
+                             this_iteration.iteration_number, number_of_users);
+  }
+
+  claimquote quote = get_claim_quote(this_iteration.iteration_number, false);
+
+  if (!eligible_to_claim(user, record, quote.iteration,
+                         quote.tokens_required)) {
+    preview.reason = "user is not eligible to claim in this iteration";
+    return preview;
+  }
+
+  // the claim would be the next claim event in this iteration
+  requote_freedao_tier(
+      quote,
+      get_iteration_claim_event_count(this_iteration.iteration_number) + 1);
+
+  preview.eligible = true;
+  preview.liquid_amount =
+      asset(quote.liquid_tokens * 10000, NON_EXCHANGEABLE_SYMBOL);
+  preview.vested_amount =
+      asset(quote.vested_tokens * 10000, NON_EXCHANGEABLE_SYMBOL);
+  preview.freedao_amount =
+      asset(quote.freedao_tokens * 10000, NON_EXCHANGEABLE_SYMBOL);
+
+#ifdef LAZY_UNLOCK
+  // the claim settles the user's outstanding unlocks and transfers them with
+  // the liquid amount
+  vestaccounts_index vestaccounts_table(get_self(), user.value);
+  auto vestaccount_iterator = vestaccounts_table.find(
+      symbol_code(NON_EXCHANGEABLE_CURRENCY_CODE).raw());
+  if (vestaccount_iterator != vestaccounts_table.end()) {
+    preview.liquid_amount.amount +=
+        economics::unlocked_tokens(vestaccount_iterator->balance.amount,
+                                   get_unlock_factor(),
+                                   unlock_factor_of(*vestaccount_iterator)) *
+        10000;
+  }
+#endif
+
+  return preview;
+}
+
+// ACTION
+user_status freeos::getuser(const name &user) {
+  PROFILE_ACTION("getuser");
+
+  user_status status{};
+
+  users_index users_table(get_self(), user.value);
+  auto user_iterator = users_table.begin();
+  status.registered = user_iterator != users_table.end();
+  if (status.registered) {
+    status.record = *user_iterator;
+  }
+
+  status.liquid_balance =
+      get_balance(get_self(), user, NON_EXCHANGEABLE_SYMBOL);
+  status.airkey_balance = get_balance(get_self(), user, AIRKEY_SYMBOL);
+  status.freeos_balance =
+      get_balance(name(freeostokens_acct), user, EXCHANGEABLE_SYMBOL);
+
+  status.vested_balance = asset(0, NON_EXCHANGEABLE_SYMBOL);
+  vestaccounts_index vestaccounts_table(get_self(), user.value);
+  auto vestaccount_iterator = vestaccounts_table.begin();
+  if (vestaccount_iterator != vestaccounts_table.end()) {
+    status.vested_balance = vestaccount_iterator->balance;
+  }
+
+  unvest_index unvest_table(get_self(), user.value);
+  auto unvest_iterator = unvest_table.begin();
+  if (unvest_iterator != unvest_table.end()) {
+    status.last_unvest = unvest_iterator->iteration_number;
+  }
+
+  unstakerequest_index unstakes_table(get_self(), get_self().value);
+  auto unstake_iterator = unstakes_table.find(user.value);
+  status.unstake_pending = unstake_iterator != unstakes_table.end();
+  if (status.unstake_pending) {
+    status.unstake = *unstake_iterator;
+  }
+
+  return status;
+}
+
+// ACTION
+system_stats freeos::getstats() {
+  PROFILE_ACTION("getstats");
+
+  system_stats result{};
+
+  statistic_index statistic_table(get_self(), get_self().value);
+  auto statistic_iterator = statistic_table.begin();
+  if (statistic_iterator != statistic_table.end()) {
+    result.statistics = *statistic_iterator;
+  }
+
+
+  symbol_code point = symbol_code(NON_EXCHANGEABLE_CURRENCY_CODE);
+  stats point_stats_table(get_self(), point.raw());
+  auto point_iterator = point_stats_table.find(point.raw());
+  if (point_iterator != point_stats_table.end()) {
+    result.point_stats = *point_iterator;
+  }
+
+  symbol_code airkey = symbol_code(AIRKEY_CURRENCY_CODE);
+  stats airkey_stats_table(get_self(), airkey.raw());
+  auto airkey_iterator = airkey_stats_table.find(airkey.raw());
+  if (airkey_iterator != airkey_stats_table.end()) {
+    result.airkey_stats = *airkey_iterator;
+  }
+
+  result.current = get_claim_iteration();
+  result.iterclaimevents =
+      get_iteration_claim_event_count(result.current.iteration_number);
+
+  aggstats_index aggstats_table(get_self(), get_self().value);
+  auto aggstat_iterator = aggstats_table.begin();
+  if (aggstat_iterator != aggstats_table.end()) {
+    result.aggregates = *aggstat_iterator;
+  }
+
+  return result;
+}
+
 //
 
 float freeos::get_vested_proportion() {
@@ -1159,8 +1867,8 @@ float freeos::get_vested_proportion() {
   // target price (so no need to vest)
   float proportion = 0.0f;
 
-  exchange_index exchangerate_table(name(freeosconfig_acct),
-                                    name(freeosconfig_acct).value);
+  exchange_index exchangerate_table{name(freeosconfig_acct),
+                                    name(freeosconfig_acct).value};
 
   // there is a single record
   auto exchangerate_iterator = exchangerate_table.begin();
@@ -1171,40 +1879,38 @@ float freeos::get_vested_proportion() {
     double currentprice = exchangerate_iterator->currentprice;
     double targetprice = exchangerate_iterator->targetprice;
 
-    if (targetprice > 0 && currentprice < targetprice) {
-      proportion = 1.0f - (currentprice / targetprice);
-    }
+    proportion = economics::vested_proportion_from_rate(currentprice, targetprice);
   } else {
     // use the default proportion specified in the 'vestpercent' parameter
-    parameters_index parameters_table(name(freeosconfig_acct),
-                                      name(freeosconfig_acct).value);
+    parameters_index parameters_table{name(freeosconfig_acct),
+                                      name(freeosconfig_acct).value};
     auto parameter_iterator = parameters_table.find(name("vestpercent").value);
 
     if (parameter_iterator != parameters_table.end()) {
-      uint8_t int_percent = stoi(parameter_iterator->value);
-      proportion = ((float)int_percent) / 100.0f;
+      uint8_t int_percent = parse_uint(parameter_iterator->value);
+      proportion = economics::vested_proportion_from_percent(int_percent);
     }
   }
 
-  // apply a cap of 0.9
-  if (proportion > 0.9f) {
-    proportion = 0.9f;
-  }
-
   return proportion;
 }
 
+// the current time. All of the contract's time-dependent behaviour goes
+// through this function, so that a host build (host/freeoshost.hpp), whose
+// clock the caller sets, can move the contract through iterations.
+time_point freeos::get_current_time() { return current_time_point(); }
+
 // return the current iteration record
 iteration freeos::get_claim_iteration() {
   iteration this_iteration =
       iteration{0, time_point(), time_point(), 0,
                 0}; // default null iteration value if outside of a claim period
 
-  uint64_t now = current_time_point().time_since_epoch()._count;
+  uint64_t now = get_current_time().time_since_epoch()._count;
 
   // find iteration that matches current time
-  iterations_index iterations_table(name(freeosconfig_acct),
-                                    name(freeosconfig_acct).value);
+  iterations_index iterations_table{name(freeosconfig_acct),
+                                    name(freeosconfig_acct).value};
   auto start_index = iterations_table.get_index<"start"_n>();
   auto iteration_iterator = start_index.upper_bound(now);
 
@@ -1223,16 +1929,26 @@ iteration freeos::get_claim_iteration() {
 }
 
 // calculate if user is eligible to claim in this iteration
-bool freeos::eligible_to_claim(const name &claimant, iteration this_iteration) {
+bool freeos::eligible_to_claim(const name &claimant, uint32_t iteration_number,
+                               uint16_t tokens_required) {
   // get the user record - if there is no record then user is not registered
   users_index users_table(get_self(), claimant.value);
   auto user_iterator = users_table.begin();
 
   check(user_iterator != users_table.end(), "user is not registered in freeos");
 
+  return eligible_to_claim(claimant, *user_iterator, iteration_number,
+                           tokens_required);
+}
+
+// calculate if the user with the users record is eligible to claim in this
+// iteration
+bool freeos::eligible_to_claim(const name &claimant, const user &record,
+                               uint32_t iteration_number,
+                               uint16_t tokens_required) {
   // has the user claimed this iteration - consult the last_issuance field in
   // the user record
-  if (user_iterator->last_issuance == this_iteration.iteration_number) {
+  if (record.last_issuance == iteration_number) {
     return false;
   }
 
@@ -1252,7 +1968,7 @@ bool freeos::eligible_to_claim(const name &claimant, iteration this_iteration) {
   // requirements
   if (user_airkey_balance.amount == 0) {
     // has the user staked?
-    if (user_iterator->staked_iteration == 0) {
+    if (record.staked_iteration == 0) {
       return false;
     }
 
@@ -1292,7 +2008,7 @@ bool freeos::eligible_to_claim(const name &claimant, iteration this_iteration) {
 
     // the 'holding' balance requirement for this iteration's claim
     int64_t iteration_holding_requirement =
-        this_iteration.tokens_required * 10000;
+        economics::holding_requirement(tokens_required);
 
     if (total_option_balance_amount < iteration_holding_requirement) {
       return false;
@@ -1319,8 +2035,31 @@ uint32_t freeos::update_claim_event_count() {
   return claimevents;
 }
 
-// increment number of claims in the current iteration - new in v0.355
-uint32_t freeos::update_iteration_claim_event_count() {
+// the iteration the iterstats claimevents count belongs to. Records written
+// before the iteration tag was added belong to the cached iteration (tick
+// tags them when the next iteration starts).
+static uint32_t counted_iteration(const iterstat &stat,
+                                  uint32_t cached_iteration) {
+  return stat.iteration.has_value() ? stat.iteration.value() : cached_iteration;
+}
+
+// number of claims made so far in the iteration. Read only.
+uint32_t freeos::get_iteration_claim_event_count(uint32_t iteration_number) {
+  iterstats_index iterstats_table(get_self(), get_self().value);
+  auto iterstat_record = iterstats_table.begin();
+
+  if (iterstat_record == iterstats_table.end() ||
+      counted_iteration(*iterstat_record, get_cached_iteration()) !=
+          iteration_number) {
+    return 0;
+  }
+
+  return iterstat_record->claimevents;
+}
+
+// increment number of claims in the current iteration - new in v0.355. The
+// count restarts at the first claim of each iteration.
+uint32_t freeos::update_iteration_claim_event_count(uint32_t iteration_number) {
   uint32_t iterclaimevents;
 
   iterstats_index iterstats_table(get_self(), get_self().value);
@@ -1330,53 +2069,22 @@ uint32_t freeos::update_iteration_claim_event_count() {
     // insert the iterstat record
     iterstats_table.emplace(get_self(), [&](auto &s) {
       s.claimevents = iterclaimevents = 1;
+      s.iteration = iteration_number;
     });
   } else {
     // modify the iterstat record
+    bool same_iteration =
+        counted_iteration(*iterstat_record, get_cached_iteration()) ==
+        iteration_number;
+
     iterstats_table.modify(iterstat_record, _self, [&](auto &s) {
-      s.claimevents = iterclaimevents = s.claimevents + 1;
+      s.claimevents = iterclaimevents =
+          same_iteration ? s.claimevents + 1 : 1;
+      s.iteration = iteration_number;
     });
   }
 
   return iterclaimevents;
 }
 
-double freeos::get_freedao_multiplier(uint32_t claimevents) {
-#ifdef TEST_BUILD
-  if (claimevents <= 2) {
-    return 3;
-  } else if (claimevents <= 4) {
-    return 2;
-  } else {
-    return 0.5;
-  }
-#else
-  if (claimevents <= 199) {
-    return 19;
-  } else if (claimevents <= 499) {
-    return 18;
-  } else if (claimevents <= 999) {
-    return 17;
-  } else if (claimevents <= 1999) {
-    return 16;
-  } else if (claimevents <= 2999) {
-    return 15;
-  } else if (claimevents <= 4999) {
-    return 14;
-  } else if (claimevents <= 7999) {
-    return 10;
-  } else if (claimevents <= 12999) {
-    return 6;
-  } else if (claimevents <= 20999) {
-    return 4;
-  } else if (claimevents <= 33999) {
-    return 2;
-  } else if (claimevents <= 54999) {
-    return 1.5;
-  } else {
-    return 0.07;
-  }
-#endif
-}
-
 } // namespace freedao
\ No newline at end of file
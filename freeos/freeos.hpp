@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../common/freeoscommon.hpp"
+#include "../common/freeoseconomics.hpp"
 #include <eosio/eosio.hpp>
 
 namespace eosiosystem {
@@ -16,6 +17,40 @@ enum registration_status {
   registered_success,
 };
 
+// return value of the getclaimq action
+struct claim_preview {
+  uint32_t iteration;   // the current iteration, 0 if outside a claim period
+  bool eligible;        // whether a claim would succeed now
+  std::string reason;   // why the user is not eligible, empty if eligible
+  asset liquid_amount;  // POINTs the user would receive, with those unlocked
+                        // since the last settlement in a LAZY_UNLOCK build
+  asset vested_amount;  // POINTs that would be added to the vested balance
+  asset freedao_amount; // POINTs that would be deposited to freedao
+};
+
+// return value of the getuser action
+struct user_status {
+  bool registered;
+  user record;             // the users table record, if registered
+  asset liquid_balance;    // POINT balance
+  asset vested_balance;    // vested POINT balance
+  asset airkey_balance;    // AIRKEY balance
+  asset freeos_balance;    // FREEOS balance held in the freeostokens contract
+  uint64_t last_unvest;    // iteration of the last unvest, 0 if never
+  bool unstake_pending;    // whether an unstake request is queued
+  unstakerequest unstake;  // the unstake request, if pending
+};
+
+// return value of the getstats action
+struct system_stats {
+  statistic statistics;       // the statistics record
+  uint32_t iterclaimevents;   // claim events in the current iteration
+  currency_stats point_stats; // POINT supply and conditional supply
+  currency_stats airkey_stats; // AIRKEY supply
+  iteration current;          // the current iteration record
+  aggstat aggregates;         // staked, vested and queued totals, user counts
+};
+
 /**
  * @defgroup freeos freeos contract
  * @ingroup eosiocontracts
@@ -110,10 +145,10 @@ public:
    */
 #ifdef TEST_BUILD
   [[eosio::on_notify("eosio.token::transfer")]] void stake(
-      name user, name to, asset quantity, std::string memo);
+      name user, name to, asset quantity, const std::string &memo);
 #else
   [[eosio::on_notify("xtokens::transfer")]] void stake(
-      name user, name to, asset quantity, std::string memo);
+      name user, name to, asset quantity, const std::string &memo);
 #endif
 
   /**
@@ -167,7 +202,7 @@ public:
    * @param memo - the memo string to accompany the transaction.
    */
   void transfer(const name &owner, const name &to, const asset &quantity,
-                const string &memo);
+                std::string_view memo);
 
   /**
    * Convert action.
@@ -181,6 +216,41 @@ public:
    */
   [[eosio::action]] void convert(const name &owner, const asset &quantity);
 
+  /**
+   * convreq action.
+   *
+   * @details Requests a conversion of non-exchangeable currency to
+   * exchangeable currency. The non-exchangeable currency is burned now and
+   * the request queued - convsettle issues and transfers the exchangeable
+   * currency. A second request before settlement adds to the first.
+   *
+   * @param owner - the account to convert from,
+   * @param quantity - the quantity of tokens to be converted.
+   */
+  [[eosio::action]] void convreq(const name &owner, const asset &quantity);
+
+  /**
+   * convsettle action.
+   *
+   * @details Settles a batch of queued conversion requests with one issue of
+   * their total exchangeable currency and a transfer to each owner. The batch
+   * size is the 'convbatchnum' parameter (20). Requests are settled in the
+   * order they were first made. Can be run by anyone.
+   */
+  [[eosio::action]] void convsettle();
+
+  /**
+   * convcancel action.
+   *
+   * @details Cancels the owner's queued conversion request and restores the
+   * non-exchangeable currency that convreq burned.
+   *
+   * @param owner - the account whose request is cancelled.
+   *
+   * @pre Requires authorisation of the owner account
+   */
+  [[eosio::action]] void convcancel(const name &owner);
+
   /**
    * claim action.
    *
@@ -204,6 +274,17 @@ public:
    * @details This action is run by the user to release this iteration's
    * allocation of vested freeos tokens.
    *
+   * In a LAZY_UNLOCK build it releases everything unlocked since the user's
+   * vested balance was last settled, whatever the number of iterations that
+   * passed, and can be run at any time. claim settles the same way.
+   *
+   * A LAZY_UNLOCK build must not be replaced by a default build while vested
+   * balances remain. Both builds keep the unlockfactor fields, but a default
+   * build stops moving the statistics factor on while each vestaccounts row
+   * keeps its checkpoint, and its per-iteration unvests are not settled
+   * against the checkpoints - so a LAZY_UNLOCK build deployed again would
+   * release what was unlocked before the switch on top of them.
+   *
    * @param owner - the user account to execute the unvest action for.
    *
    * @pre Requires authorisation of the user account
@@ -327,9 +408,107 @@ public:
   [[eosio::action]] void burn(const name &burner, const asset &quantity,
                               const string &memo);
 
+  /**
+   * allocmany - allocate to many accounts in one action
+   *
+   * @details Checks the transferers whitelist and loads the currency stats
+   * once, debits the 'from' account once for the total and credits each
+   * recipient in turn. Each recipient may appear once in the list.
+   *
+   * @param from        - the account to be deducted
+   * @param recipients  - the accounts to be incremented and their amounts, all
+   *                      in the same currency
+   * @param memo        - the memo accompanying the transaction
+   *
+   */
+  [[eosio::action]] void
+  allocmany(const name &from,
+            const std::vector<std::pair<name, asset>> &recipients,
+            const string &memo);
+
+  /**
+   * mintmany - mint to many accounts in one action
+   *
+   * @details Checks the minters whitelist and loads the currency stats once,
+   * issues the total and credits each recipient from the issuer account.
+   * Each recipient may appear once in the list.
+   *
+   * It does the work of a mint to the issuer followed by an allocate from it,
+   * so the minter must be in the transferers whitelist as well as the
+   * minters whitelist.
+   *
+   * @param minter      - the account calling the mintmany action
+   * @param recipients  - the accounts to be incremented and their amounts, all
+   *                      in the same currency
+   * @param memo        - the memo accompanying the transaction
+   *
+   */
+  [[eosio::action]] void
+  mintmany(const name &minter,
+           const std::vector<std::pair<name, asset>> &recipients,
+           const string &memo);
+
+  /**
+   * getclaimq action.
+   *
+   * @details Previews a claim by the user in the current iteration. Returns
+   * whether the user is eligible and the liquid, vested and freedao amounts
+   * that a claim would issue. An unregistered user is previewed as the claim
+   * action would register them.
+   *
+   * @param user - the user account to preview the claim for.
+   *
+   * Read only - the action does not modify any tables and does not run the
+   * tick background process, so it can be used in read-only transactions.
+   */
+  [[eosio::action, eosio::read_only]] claim_preview
+  getclaimq(const name &user);
+
+  /**
+   * getuser action.
+   *
+   * @details Returns the user's registration record, balances and any pending
+   * unstake request.
+   *
+   * @param user - the user account to return the status for.
+   *
+   * Read only - the action does not modify any tables.
+   */
+  [[eosio::action, eosio::read_only]] user_status getuser(const name &user);
+
+  /**
+   * getstats action.
+   *
+   * @details Returns the statistics, iterstats and aggstats records, the
+   * POINT and AIRKEY currency stats and the current iteration record.
+   *
+   * Read only - the action does not modify any tables.
+   */
+  [[eosio::action, eosio::read_only]] system_stats getstats();
+
+  /**
+   * aggset action.
+   *
+   * @details Sets the aggstats record. Used once, when the aggregates are
+   * added to a running system, with totals from a snapshot of its tables -
+   * from then on the actions keep them up to date. Until it is run the
+   * actions leave the totals alone, so send it in the transaction that
+   * deploys the contract, with the snapshot taken just before. A new system
+   * needs no aggset - its first registration creates the record.
+   *
+   * @param aggregates - the totals and user counts.
+   *
+   * @pre Requires authorisation of the adminacc parameter account, or of the
+   * contract account if that is not set
+   */
+  [[eosio::action]] void aggset(const aggstat &aggregates);
+
 private:
-  void issue(const name &to, const asset &quantity, const string &memo);
-  void retire(const asset &quantity, const string &memo);
+  void issue(const name &to, const asset &quantity, std::string_view memo);
+  void retire(const asset &quantity, std::string_view memo);
+  void distribute(const name &from,
+                  const std::vector<std::pair<name, asset>> &recipients,
+                  std::string_view memo, bool mint);
   void sub_balance(const name &owner, const asset &value);
   void add_balance(const name &owner, const asset &value,
                    const name &ram_payer);
@@ -337,22 +516,37 @@ private:
   registration_status register_user(const name &user);
 
   bool check_master_switch();
+  time_point get_current_time();
   uint32_t get_cached_iteration();
   bool checkschedulelogging();
   uint32_t get_stake_requirement(char account_type);
+  bool has_stake_requirement(uint32_t number_of_users);
+  uint32_t get_stake_requirement(char account_type, uint32_t number_of_users);
+  user new_user_record(char account_type, uint32_t iteration_number,
+                       uint32_t number_of_users);
   iteration get_claim_iteration();
-  bool eligible_to_claim(const name &claimant, iteration this_iteration);
+  bool eligible_to_claim(const name &claimant, uint32_t iteration_number,
+                         uint16_t tokens_required);
+  bool eligible_to_claim(const name &claimant, const user &record,
+                         uint32_t iteration_number, uint16_t tokens_required);
+  claimquote make_claim_quote(const iteration &this_iteration);
+  void store_claim_quote(const claimquote &quote);
+  claimquote get_claim_quote(uint32_t iteration_number, bool store);
+  bool requote_freedao_tier(claimquote &quote, uint32_t claimevents);
+  uint32_t get_iteration_claim_event_count(uint32_t iteration_number);
   uint32_t update_claim_event_count();
-  uint32_t update_iteration_claim_event_count();  // new in v0.355
-  double get_freedao_multiplier(uint32_t claimevents);
+  uint32_t update_iteration_claim_event_count(uint32_t iteration_number);  // new in v0.355
   float get_vested_proportion();
   void update_unvest_percentage();
+  double get_unlock_factor();
+  template <typename F> void update_aggstats(F update);
+  void set_aggstats(const aggstat &aggregates);
   void record_deposit(uint64_t iteration_number, asset amount);
   char get_account_type(name user);
   void request_stake_refund(name user, asset amount);
   void refund_stakes();
-  void refund_stake(name user, asset amount);
-  void reset_iteration_claimevents(); // new in v0.355
+  asset refund_stake(name user, asset amount);
+  void burn_for_conversion(const name &owner, const asset &quantity);
 };
 /** @}*/ // end of @defgroup freeos freeos contract
 } // namespace freedao
\ No newline at end of file
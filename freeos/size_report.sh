@@ -0,0 +1,64 @@
+# Report the size of freeos.wasm and check it against the committed budget.
+# Run one of the compile_*.sh scripts first - this reports on whatever
+# freeos.wasm is currently in this directory.
+#
+# usage: ./size_report.sh [number of functions to list]
+#        ./size_report.sh --set-budget
+#
+# Per-function code sizes need wasm-objdump (from wabt) on the PATH. Function
+# names are only shown if the wasm was built with a name section.
+#
+# A freeos.wasm that does not contain the VERSION string of freeos.cpp was
+# built from older sources, and fails the report whatever its size - bump
+# VERSION with every contract change. --set-budget writes the size of a build
+# of the current sources to freeos.wasm.budget: commit the budget together with
+# the freeos.wasm it was measured on. With no freeos.wasm.budget the size is
+# reported but not checked.
+
+cd "$(dirname "$0")"
+
+WASM=freeos.wasm
+BUDGET=$(cat freeos.wasm.budget 2>/dev/null)
+TOP=${1:-20}
+
+SIZE=$(wc -c <$WASM)
+echo "$WASM: $SIZE bytes (budget ${BUDGET:-not set}${BUDGET:+ bytes})"
+
+VERSION=$(sed -n 's/^const std::string VERSION = "\(.*\)";/\1/p' freeos.cpp)
+if ! grep -qaF "$VERSION" $WASM; then
+  echo
+  echo "FAIL: $WASM is not a build of freeos.cpp version $VERSION - rebuild it" \
+    "with one of the compile_*.sh scripts"
+  exit 1
+fi
+
+if [ "$1" = "--set-budget" ]; then
+  echo $SIZE >freeos.wasm.budget
+  echo "freeos.wasm.budget set to $SIZE bytes"
+  exit 0
+fi
+
+if command -v wasm-objdump >/dev/null; then
+  echo
+  echo "section sizes:"
+  wasm-objdump -h $WASM | grep 'size='
+
+  echo
+  echo "largest $TOP functions (code bytes):"
+  wasm-objdump -x -j Code $WASM | grep 'size=' |
+    sed 's/^ *- *//; s/ size=/ /' |
+    awk '{ name = $1; for (i = 3; i <= NF; i++) name = name " " $i; print $2, name }' |
+    sort -rn | head -n $TOP
+else
+  echo "wasm-objdump not found - skipping per-function sizes"
+fi
+
+if [ -z "$BUDGET" ]; then
+  echo
+  echo "no freeos.wasm.budget - run ./size_report.sh --set-budget and commit it" \
+    "with $WASM"
+elif [ $SIZE -gt $BUDGET ]; then
+  echo
+  echo "FAIL: $WASM is $((SIZE - BUDGET)) bytes over budget"
+  exit 1
+fi
@@ -1,4 +1,5 @@
-eosio-cpp -o freeosconfig.wasm freeosconfig.cpp -DTEST_BUILD -DFREEOS="\"freeos1\"" -DFREEOSCONFIG="\"freeoscfg1\"" -DFREEOSTOKENS="\"freeostoken1\"" -DDIVIDEND="\"optionsdiv1\"" --abigen
+# Needs CDT 3.0 or later (cdt-cpp) - see ../README.md
+cdt-cpp -o freeosconfig.wasm freeosconfig.cpp -DTEST_BUILD -DFREEOS="\"freeos1\"" -DFREEOSCONFIG="\"freeoscfg1\"" -DFREEOSTOKENS="\"freeostoken1\"" -DDIVIDEND="\"optionsdiv1\"" --abigen
 
 3d6c38bb8287374871781e7e0242638da284cdd5
 
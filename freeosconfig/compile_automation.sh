@@ -1,2 +1,3 @@
-eosio-cpp -o freeosconfig.wasm freeosconfig.cpp -DTEST_BUILD -DFREEOS="\"freeosa\"" -DFREEOSCONFIG="\"freeoscfga\"" -DFREEOSTOKENS="\"freeostokena\"" -DDIVIDEND="\"optionsdiva\"" --abigen
+# Needs CDT 3.0 or later (cdt-cpp) - see ../README.md
+cdt-cpp -o freeosconfig.wasm freeosconfig.cpp -DTEST_BUILD -DFREEOS="\"freeosa\"" -DFREEOSCONFIG="\"freeoscfga\"" -DFREEOSTOKENS="\"freeostokena\"" -DDIVIDEND="\"optionsdiva\"" --abigen
 
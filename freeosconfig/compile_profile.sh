@@ -0,0 +1,2 @@
+# Needs CDT 3.0 or later (cdt-cpp) - see ../README.md
+cdt-cpp -o freeosconfig_profile.wasm freeosconfig.cpp -DTEST_BUILD -DFREEOS_PROFILE -DFREEOS="\"freeosd\"" -DFREEOSCONFIG="\"freeoscfgd\"" -DFREEOSTOKENS="\"freeostokend\"" -DDIVIDEND="\"freeosdiv\"" --abigen
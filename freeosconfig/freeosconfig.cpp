@@ -8,6 +8,8 @@ const std::string VERSION = "0.112";
 
 // ACTION
 void freeosconfig::version() {
+  PROFILE_ACTION("version");
+
   std::string version_message = freeos_acct + "/" + freeosconfig_acct + "/" +
                                 freeostokens_acct + "/" + freedao_acct +
                                 " version = " + VERSION;
@@ -18,6 +20,7 @@ void freeosconfig::version() {
 // ACTION
 void freeosconfig::paramupsert(name virtualtable, name paramname,
                                std::string value) {
+  PROFILE_ACTION("paramupsert");
 
   require_auth(_self);
   parameters_index parameters_table(get_self(), get_self().value);
@@ -44,6 +47,8 @@ void freeosconfig::paramupsert(name virtualtable, name paramname,
 // erase parameter from the table
 // ACTION
 void freeosconfig::paramerase(name paramname) {
+  PROFILE_ACTION("paramerase");
+
   require_auth(_self);
 
   parameters_index parameters_table(get_self(), get_self().value);
@@ -59,6 +64,7 @@ void freeosconfig::paramerase(name paramname) {
 
 // ACTION
 void freeosconfig::currentrate(double price) {
+  PROFILE_ACTION("currentrate");
 
   // check if the exchange account is calling this action, or the contract itself
   parameters_index parameters_table(get_self(), get_self().value);
@@ -88,6 +94,7 @@ void freeosconfig::currentrate(double price) {
 
 // ACTION
 void freeosconfig::targetrate(double exchangerate) {
+  PROFILE_ACTION("targetrate");
 
   // require_auth(_self); // v0.111
   // v0.112 change - check if the locking contract account is calling this action, or the contract itself
@@ -129,6 +136,8 @@ void freeosconfig::targetrate(double exchangerate) {
 // erase rate from the table
 // ACTION
 void freeosconfig::rateerase() {
+  PROFILE_ACTION("rateerase");
+
   require_auth(_self);
 
   exchange_index rates_table(get_self(), get_self().value);
@@ -150,6 +159,7 @@ void freeosconfig::stakeupsert(uint64_t threshold, uint32_t value_a,
                                uint32_t value_u, uint32_t value_v,
                                uint32_t value_w, uint32_t value_x,
                                uint32_t value_y) {
+  PROFILE_ACTION("stakeupsert");
 
   require_auth(_self);
   stakereq_index stakereqs_table(get_self(), get_self().value);
@@ -195,6 +205,8 @@ void freeosconfig::stakeupsert(uint64_t threshold, uint32_t value_a,
 // erase stake requirement from the table
 // ACTION
 void freeosconfig::stakeerase(uint64_t threshold) {
+  PROFILE_ACTION("stakeerase");
+
   require_auth(_self);
 
   stakereq_index stakereqs_table(get_self(), get_self().value);
@@ -211,6 +223,8 @@ void freeosconfig::stakeerase(uint64_t threshold) {
 // add an account to the transferers whitelist
 // ACTION
 void freeosconfig::transfadd(name account) {
+  PROFILE_ACTION("transfadd");
+
   require_auth(_self);
 
   transferers_index transferers_table(get_self(), get_self().value);
@@ -221,6 +235,8 @@ void freeosconfig::transfadd(name account) {
 // erase an account from the transferers whitelist
 // ACTION
 void freeosconfig::transferase(name account) {
+  PROFILE_ACTION("transferase");
+
   require_auth(_self);
 
   transferers_index transferers_table(get_self(), get_self().value);
@@ -237,6 +253,8 @@ void freeosconfig::transferase(name account) {
 // add an account to the issuers whitelist
 // ACTION
 void freeosconfig::minteradd(name account) {
+  PROFILE_ACTION("minteradd");
+
   require_auth(_self);
 
   minters_index minters_table(get_self(), get_self().value);
@@ -246,6 +264,8 @@ void freeosconfig::minteradd(name account) {
 // erase an account from the issuers whitelist
 // ACTION
 void freeosconfig::mintererase(name account) {
+  PROFILE_ACTION("mintererase");
+
   require_auth(_self);
 
   minters_index minters_table(get_self(), get_self().value);
@@ -262,6 +282,8 @@ void freeosconfig::mintererase(name account) {
 // add an account to the burners whitelist
 // ACTION
 void freeosconfig::burneradd(name account) {
+  PROFILE_ACTION("burneradd");
+
   require_auth(_self);
 
   burners_index burners_table(get_self(), get_self().value);
@@ -271,6 +293,8 @@ void freeosconfig::burneradd(name account) {
 // erase an account from the burners whitelist
 // ACTION
 void freeosconfig::burnererase(name account) {
+  PROFILE_ACTION("burnererase");
+
   require_auth(_self);
 
   burners_index burners_table(get_self(), get_self().value);
@@ -289,6 +313,7 @@ void freeosconfig::burnererase(name account) {
 void freeosconfig::iterupsert(uint32_t iteration_number, time_point start,
                               time_point end, uint16_t claim_amount,
                               uint16_t tokens_required) {
+  PROFILE_ACTION("iterupsert");
 
   require_auth(_self);
 
@@ -322,6 +347,8 @@ void freeosconfig::iterupsert(uint32_t iteration_number, time_point start,
 // erase an iteration record from the iterations table - contract action
 // ACTION
 void freeosconfig::itererase(uint32_t iteration_number) {
+  PROFILE_ACTION("itererase");
+
   require_auth(_self);
 
   iter_delete(iteration_number);
@@ -331,6 +358,8 @@ void freeosconfig::itererase(uint32_t iteration_number) {
 // contract
 // ACTION
 void freeosconfig::iterclear(uint32_t iteration_number) {
+  PROFILE_ACTION("iterclear");
+
   require_auth(name(freeos_acct));
 
   iter_delete(iteration_number);
@@ -356,6 +385,7 @@ void freeosconfig::iter_delete(uint32_t iteration_number) {
 // Required for development purposes as eosio.proton kyc verification is not available on the Proton Testnet.
 // Will be removed from the production build.
 void freeosconfig::userverify(name acc, name verifier, bool verified) {
+  PROFILE_ACTION("userverify");
 
   require_auth(get_self());
 
@@ -404,6 +434,7 @@ void freeosconfig::userverify(name acc, name verifier, bool verified) {
 // Will be removed from the production build.
 void freeosconfig::addkyc(name acc, name kyc_provider, std::string kyc_level,
                           uint64_t kyc_date) {
+  PROFILE_ACTION("addkyc");
 
   require_auth(get_self());
 
@@ -0,0 +1,95 @@
+# Generate freeosactions.hpp - an action struct per action of the contracts'
+# ABIs, for freeospack.hpp, a struct per ABI struct that the actions take as
+# an argument (e.g. abigen's pair_name_asset for a std::pair<name, asset>),
+# and a list of each contract's action names.
+#
+# usage: ./abi_actions.sh ../freeos/freeos.abi ../freeosconfig/freeosconfig.abi >freeosactions.hpp
+#
+# Needs jq.
+
+if [ $# -eq 0 ]; then
+  echo "usage: $0 <abi file>..."
+  exit 1
+fi
+
+cat <<'HEADER'
+#pragma once
+
+// Generated by abi_actions.sh from the contracts' ABIs - do not edit.
+//
+// One struct per action, in a namespace per contract. Each has the action's
+// name as action_name, its arguments as fields and write(), which serializes
+// the arguments in ABI order (see freeospack.hpp). A name is a uint64_t (see
+// name_value), a string is a string_view of the caller's memory, an array is
+// a std::vector and an ABI struct argument is a struct of its own, defined
+// before the actions. action_names lists the contract's actions.
+
+#include "freeospack.hpp"
+
+namespace freedao {
+namespace relay {
+HEADER
+
+for ABI in "$@"; do
+  CONTRACT=$(basename "$ABI" .abi)
+
+  jq -r --arg contract "$CONTRACT" '
+    . as $abi |
+    ($abi.structs | map({key: .name, value: .fields}) | from_entries) as $structs |
+    def element: sub("\\[\\]$"; "");
+    def ctype:
+      if endswith("[]") then "std::vector<\(element | ctype)>"
+      elif $structs[.] != null then .
+      else
+        {"name": "uint64_t", "bool": "bool", "uint8": "uint8_t",
+         "int8": "int8_t", "uint16": "uint16_t", "int16": "int16_t",
+         "uint32": "uint32_t", "int32": "int32_t", "uint64": "uint64_t",
+         "int64": "int64_t", "float32": "float", "float64": "double",
+         "time_point": "int64_t", "time_point_sec": "uint32_t",
+         "symbol": "uint64_t", "symbol_code": "uint64_t", "asset": "asset",
+         "string": "std::string_view"}[.]
+        // error("unsupported ABI type " + .)
+      end;
+    # the ABI structs a type is made of, those they are made of first
+    def uses:
+      element | select($structs[.] != null) |
+      ($structs[.][] | .type | uses), .;
+    def definition($name):
+      $structs[$name] as $fields |
+      "struct \($name) {",
+      (if $abi.actions | any(.name == $name) then
+        "  static constexpr uint64_t action_name = name_value(\"\($name)\");"
+      else empty end),
+      ($fields[] | "  \(.type | ctype) \(.name);"),
+      "",
+      (if ($fields | length) == 0 then
+        "  template <typename Stream> void write(Stream &) const {}"
+      else
+        "  template <typename Stream> void write(Stream &s) const {",
+        ($fields[] | "    write_value(s, \(.name));"),
+        "  }"
+      end),
+      "};";
+    "\nnamespace \($contract) {",
+    ([.actions[].name as $action | $structs[$action][] | .type | uses]
+      | reduce .[] as $type ([]; if index([$type]) then . else . + [$type] end)
+      | .[] as $type |
+      "\n// \($type) - an argument type",
+      definition($type)),
+    (.actions | sort_by(.name)[] |
+      .name as $action |
+      "\n// \($action)(\([$structs[$action][] | "\(.name): \(.type)"] | join(", ")))",
+      definition($action)),
+    "\n// the actions of the ABI",
+    "constexpr uint64_t action_names[] = {",
+    (.actions | sort_by(.name)[] | "    \(.name)::action_name,"),
+    "};",
+    "\n} // namespace \($contract)"
+  ' "$ABI" || exit 1
+done
+
+cat <<'FOOTER'
+
+} // namespace relay
+} // namespace freedao
+FOOTER
@@ -0,0 +1,28 @@
+# Build the native tools (not contracts): the freeosbench per-action
+# benchmark suite, the freeosfuzz worst-case cost fuzzer, the freeosflow
+# multi-contract flow tracer, the freeosreplay history replayer, the
+# freeosdiff legacy arithmetic differ and the freeossim population simulator,
+# which run the contracts' host build (../host, built first with the same
+# arguments), the freeosram RAM report, the freeosexport snapshot exporter,
+# the freeosaudit ledger auditor, the freeospack action packer, the freeosecon
+# Monte Carlo economics simulator (-O3, so that its kernels are vectorized;
+# add -march=native for wider vectors) and the freeoswasm WebAssembly runner
+# (__float128 for softfloat, so x86-64 or another target GCC supports it on).
+# Run abi_actions.sh to regenerate freeosactions.hpp when the ABIs change.
+# Add -DTEST_BUILD to model a test build of the contract.
+set -e
+../host/compile.sh "$@"
+HOST="-Wno-attributes -I../host -DFREEOS=freeosclaim \
+  -DFREEOSCONFIG=freeoscfg -DFREEOSTOKENS=freeostokens -DDIVIDEND=freeosdivide"
+g++ -std=c++17 -O2 $HOST -o freeosbench freeosbench.cpp ../host/libfreeoshost.a "$@"
+g++ -std=c++17 -O2 -pthread $HOST -o freeossim freeossim.cpp ../host/libfreeoshost.a "$@"
+g++ -std=c++17 -O2 $HOST -o freeosreplay freeosreplay.cpp ../host/libfreeoshost.a "$@"
+g++ -std=c++17 -O2 -o freeosram freeosram.cpp "$@"
+g++ -std=c++17 -O2 -o freeosexport freeosexport.cpp "$@"
+g++ -std=c++17 -O2 -pthread -o freeosaudit freeosaudit.cpp "$@"
+g++ -std=c++17 -O2 $HOST -o freeosflow freeosflow.cpp ../host/libfreeoshost.a "$@"
+g++ -std=c++17 -O2 -o freeospack freeospack.cpp "$@"
+g++ -std=c++17 -O2 -pthread $HOST -o freeosdiff freeosdiff.cpp ../host/libfreeoshost.a "$@"
+g++ -std=c++17 -O3 -pthread -o freeosecon freeosecon.cpp "$@"
+g++ -std=c++17 -O2 $HOST -o freeosfuzz freeosfuzz.cpp ../host/libfreeoshost.a "$@"
+g++ -std=c++17 -O2 -o freeoswasm freeoswasm.cpp "$@"
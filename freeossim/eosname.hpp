@@ -0,0 +1,53 @@
+#pragma once
+
+// eosio account names for the native tools - the same encoding as
+// eosio::name, without the eosio headers.
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace freedao {
+namespace sim {
+
+// the value of a name, e.g. for ordering by primary key
+constexpr uint64_t name_value(std::string_view account) {
+  uint64_t value = 0;
+
+  for (size_t i = 0; i < account.size() && i < 13; i++) {
+    char c = account[i];
+    uint64_t symbol = 0;
+    if (c >= 'a' && c <= 'z') {
+      symbol = c - 'a' + 6;
+    } else if (c >= '1' && c <= '5') {
+      symbol = c - '1' + 1;
+    }
+
+    if (i < 12) {
+      value |= (symbol & 0x1f) << (64 - 5 * (i + 1));
+    } else {
+      value |= symbol & 0x0f;
+    }
+  }
+
+  return value;
+}
+
+// the name of a value
+inline std::string name_string(uint64_t value) {
+  static const char charmap[] = ".12345abcdefghijklmnopqrstuvwxyz";
+  std::string account(13, '.');
+
+  uint64_t tmp = value;
+  for (int i = 0; i <= 12; i++) {
+    char c = charmap[tmp & (i == 0 ? 0x0f : 0x1f)];
+    account[12 - i] = c;
+    tmp >>= (i == 0 ? 4 : 5);
+  }
+
+  account.erase(account.find_last_not_of('.') + 1);
+  return account;
+}
+
+} // namespace sim
+} // namespace freedao
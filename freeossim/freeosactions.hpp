@@ -0,0 +1,578 @@
+#pragma once
+
+// Generated by abi_actions.sh from the contracts' ABIs - do not edit.
+//
+// One struct per action, in a namespace per contract. Each has the action's
+// name as action_name, its arguments as fields and write(), which serializes
+// the arguments in ABI order (see freeospack.hpp). A name is a uint64_t (see
+// name_value), a string is a string_view of the caller's memory, an array is
+// a std::vector and an ABI struct argument is a struct of its own, defined
+// before the actions. action_names lists the contract's actions.
+
+#include "freeospack.hpp"
+
+namespace freedao {
+namespace relay {
+
+namespace freeos {
+
+// aggstat - an argument type
+struct aggstat {
+  asset staked;
+  asset vested;
+  asset refunds;
+  uint32_t refundcount;
+  uint32_t verified;
+  uint32_t unverified;
+
+  template <typename Stream> void write(Stream &s) const {
+    write_value(s, staked);
+    write_value(s, vested);
+    write_value(s, refunds);
+    write_value(s, refundcount);
+    write_value(s, verified);
+    write_value(s, unverified);
+  }
+};
+
+// pair_name_asset - an argument type
+struct pair_name_asset {
+  uint64_t first;
+  asset second;
+
+  template <typename Stream> void write(Stream &s) const {
+    write_value(s, first);
+    write_value(s, second);
+  }
+};
+
+// aggset(aggregates: aggstat)
+struct aggset {
+  static constexpr uint64_t action_name = name_value("aggset");
+  aggstat aggregates;
+
+  template <typename Stream> void write(Stream &s) const {
+    write_value(s, aggregates);
+  }
+};
+
+// allocate(from: name, to: name, quantity: asset, memo: string)
+struct allocate {
+  static constexpr uint64_t action_name = name_value("allocate");
+  uint64_t from;
+  uint64_t to;
+  asset quantity;
+  std::string_view memo;
+
+  template <typename Stream> void write(Stream &s) const {
+    write_value(s, from);
+    write_value(s, to);
+    write_value(s, quantity);
+    write_value(s, memo);
+  }
+};
+
+// allocmany(from: name, recipients: pair_name_asset[], memo: string)
+struct allocmany {
+  static constexpr uint64_t action_name = name_value("allocmany");
+  uint64_t from;
+  std::vector<pair_name_asset> recipients;
+  std::string_view memo;
+
+  template <typename Stream> void write(Stream &s) const {
+    write_value(s, from);
+    write_value(s, recipients);
+    write_value(s, memo);
+  }
+};
+
+// burn(burner: name, quantity: asset, memo: string)
+struct burn {
+  static constexpr uint64_t action_name = name_value("burn");
+  uint64_t burner;
+  asset quantity;
+  std::string_view memo;
+
+  template <typename Stream> void write(Stream &s) const {
+    write_value(s, burner);
+    write_value(s, quantity);
+    write_value(s, memo);
+  }
+};
+
+// claim(user: name)
+struct claim {
+  static constexpr uint64_t action_name = name_value("claim");
+  uint64_t user;
+
+  template <typename Stream> void write(Stream &s) const {
+    write_value(s, user);
+  }
+};
+
+// convcancel(owner: name)
+struct convcancel {
+  static constexpr uint64_t action_name = name_value("convcancel");
+  uint64_t owner;
+
+  template <typename Stream> void write(Stream &s) const {
+    write_value(s, owner);
+  }
+};
+
+// convert(owner: name, quantity: asset)
+struct convert {
+  static constexpr uint64_t action_name = name_value("convert");
+  uint64_t owner;
+  asset quantity;
+
+  template <typename Stream> void write(Stream &s) const {
+    write_value(s, owner);
+    write_value(s, quantity);
+  }
+};
+
+// convreq(owner: name, quantity: asset)
+struct convreq {
+  static constexpr uint64_t action_name = name_value("convreq");
+  uint64_t owner;
+  asset quantity;
+
+  template <typename Stream> void write(Stream &s) const {
+    write_value(s, owner);
+    write_value(s, quantity);
+  }
+};
+
+// convsettle()
+struct convsettle {
+  static constexpr uint64_t action_name = name_value("convsettle");
+
+  template <typename Stream> void write(Stream &) const {}
+};
+
+// create(issuer: name, maximum_supply: asset)
+struct create {
+  static constexpr uint64_t action_name = name_value("create");
+  uint64_t issuer;
+  asset maximum_supply;
+
+  template <typename Stream> void write(Stream &s) const {
+    write_value(s, issuer);
+    write_value(s, maximum_supply);
+  }
+};
+
+// cron()
+struct cron {
+  static constexpr uint64_t action_name = name_value("cron");
+
+  template <typename Stream> void write(Stream &) const {}
+};
+
+// depositclear(iteration_number: uint64)
+struct depositclear {
+  static constexpr uint64_t action_name = name_value("depositclear");
+  uint64_t iteration_number;
+
+  template <typename Stream> void write(Stream &s) const {
+    write_value(s, iteration_number);
+  }
+};
+
+// deregister(user: name)
+struct deregister {
+  static constexpr uint64_t action_name = name_value("deregister");
+  uint64_t user;
+
+  template <typename Stream> void write(Stream &s) const {
+    write_value(s, user);
+  }
+};
+
+// getclaimq(user: name)
+struct getclaimq {
+  static constexpr uint64_t action_name = name_value("getclaimq");
+  uint64_t user;
+
+  template <typename Stream> void write(Stream &s) const {
+    write_value(s, user);
+  }
+};
+
+// getstats()
+struct getstats {
+  static constexpr uint64_t action_name = name_value("getstats");
+
+  template <typename Stream> void write(Stream &) const {}
+};
+
+// getuser(user: name)
+struct getuser {
+  static constexpr uint64_t action_name = name_value("getuser");
+  uint64_t user;
+
+  template <typename Stream> void write(Stream &s) const {
+    write_value(s, user);
+  }
+};
+
+// mint(minter: name, to: name, quantity: asset, memo: string)
+struct mint {
+  static constexpr uint64_t action_name = name_value("mint");
+  uint64_t minter;
+  uint64_t to;
+  asset quantity;
+  std::string_view memo;
+
+  template <typename Stream> void write(Stream &s) const {
+    write_value(s, minter);
+    write_value(s, to);
+    write_value(s, quantity);
+    write_value(s, memo);
+  }
+};
+
+// mintmany(minter: name, recipients: pair_name_asset[], memo: string)
+struct mintmany {
+  static constexpr uint64_t action_name = name_value("mintmany");
+  uint64_t minter;
+  std::vector<pair_name_asset> recipients;
+  std::string_view memo;
+
+  template <typename Stream> void write(Stream &s) const {
+    write_value(s, minter);
+    write_value(s, recipients);
+    write_value(s, memo);
+  }
+};
+
+// refundstake(user: name)
+struct refundstake {
+  static constexpr uint64_t action_name = name_value("refundstake");
+  uint64_t user;
+
+  template <typename Stream> void write(Stream &s) const {
+    write_value(s, user);
+  }
+};
+
+// reguser(user: name)
+struct reguser {
+  static constexpr uint64_t action_name = name_value("reguser");
+  uint64_t user;
+
+  template <typename Stream> void write(Stream &s) const {
+    write_value(s, user);
+  }
+};
+
+// reverify(user: name)
+struct reverify {
+  static constexpr uint64_t action_name = name_value("reverify");
+  uint64_t user;
+
+  template <typename Stream> void write(Stream &s) const {
+    write_value(s, user);
+  }
+};
+
+// tick()
+struct tick {
+  static constexpr uint64_t action_name = name_value("tick");
+
+  template <typename Stream> void write(Stream &) const {}
+};
+
+// unstake(user: name)
+struct unstake {
+  static constexpr uint64_t action_name = name_value("unstake");
+  uint64_t user;
+
+  template <typename Stream> void write(Stream &s) const {
+    write_value(s, user);
+  }
+};
+
+// unstakecncl(user: name)
+struct unstakecncl {
+  static constexpr uint64_t action_name = name_value("unstakecncl");
+  uint64_t user;
+
+  template <typename Stream> void write(Stream &s) const {
+    write_value(s, user);
+  }
+};
+
+// unvest(user: name)
+struct unvest {
+  static constexpr uint64_t action_name = name_value("unvest");
+  uint64_t user;
+
+  template <typename Stream> void write(Stream &s) const {
+    write_value(s, user);
+  }
+};
+
+// version()
+struct version {
+  static constexpr uint64_t action_name = name_value("version");
+
+  template <typename Stream> void write(Stream &) const {}
+};
+
+// the actions of the ABI
+constexpr uint64_t action_names[] = {
+    aggset::action_name,
+    allocate::action_name,
+    allocmany::action_name,
+    burn::action_name,
+    claim::action_name,
+    convcancel::action_name,
+    convert::action_name,
+    convreq::action_name,
+    convsettle::action_name,
+    create::action_name,
+    cron::action_name,
+    depositclear::action_name,
+    deregister::action_name,
+    getclaimq::action_name,
+    getstats::action_name,
+    getuser::action_name,
+    mint::action_name,
+    mintmany::action_name,
+    refundstake::action_name,
+    reguser::action_name,
+    reverify::action_name,
+    tick::action_name,
+    unstake::action_name,
+    unstakecncl::action_name,
+    unvest::action_name,
+    version::action_name,
+};
+
+} // namespace freeos
+
+namespace freeosconfig {
+
+// burneradd(account: name)
+struct burneradd {
+  static constexpr uint64_t action_name = name_value("burneradd");
+  uint64_t account;
+
+  template <typename Stream> void write(Stream &s) const {
+    write_value(s, account);
+  }
+};
+
+// burnererase(account: name)
+struct burnererase {
+  static constexpr uint64_t action_name = name_value("burnererase");
+  uint64_t account;
+
+  template <typename Stream> void write(Stream &s) const {
+    write_value(s, account);
+  }
+};
+
+// currentrate(price: float64)
+struct currentrate {
+  static constexpr uint64_t action_name = name_value("currentrate");
+  double price;
+
+  template <typename Stream> void write(Stream &s) const {
+    write_value(s, price);
+  }
+};
+
+// iterclear(iteration_number: uint32)
+struct iterclear {
+  static constexpr uint64_t action_name = name_value("iterclear");
+  uint32_t iteration_number;
+
+  template <typename Stream> void write(Stream &s) const {
+    write_value(s, iteration_number);
+  }
+};
+
+// itererase(iteration_number: uint32)
+struct itererase {
+  static constexpr uint64_t action_name = name_value("itererase");
+  uint32_t iteration_number;
+
+  template <typename Stream> void write(Stream &s) const {
+    write_value(s, iteration_number);
+  }
+};
+
+// iterupsert(iteration_number: uint32, start: time_point, end: time_point, claim_amount: uint16, tokens_required: uint16)
+struct iterupsert {
+  static constexpr uint64_t action_name = name_value("iterupsert");
+  uint32_t iteration_number;
+  int64_t start;
+  int64_t end;
+  uint16_t claim_amount;
+  uint16_t tokens_required;
+
+  template <typename Stream> void write(Stream &s) const {
+    write_value(s, iteration_number);
+    write_value(s, start);
+    write_value(s, end);
+    write_value(s, claim_amount);
+    write_value(s, tokens_required);
+  }
+};
+
+// minteradd(account: name)
+struct minteradd {
+  static constexpr uint64_t action_name = name_value("minteradd");
+  uint64_t account;
+
+  template <typename Stream> void write(Stream &s) const {
+    write_value(s, account);
+  }
+};
+
+// mintererase(account: name)
+struct mintererase {
+  static constexpr uint64_t action_name = name_value("mintererase");
+  uint64_t account;
+
+  template <typename Stream> void write(Stream &s) const {
+    write_value(s, account);
+  }
+};
+
+// paramerase(paramname: name)
+struct paramerase {
+  static constexpr uint64_t action_name = name_value("paramerase");
+  uint64_t paramname;
+
+  template <typename Stream> void write(Stream &s) const {
+    write_value(s, paramname);
+  }
+};
+
+// paramupsert(virtualtable: name, paramname: name, value: string)
+struct paramupsert {
+  static constexpr uint64_t action_name = name_value("paramupsert");
+  uint64_t virtualtable;
+  uint64_t paramname;
+  std::string_view value;
+
+  template <typename Stream> void write(Stream &s) const {
+    write_value(s, virtualtable);
+    write_value(s, paramname);
+    write_value(s, value);
+  }
+};
+
+// rateerase()
+struct rateerase {
+  static constexpr uint64_t action_name = name_value("rateerase");
+
+  template <typename Stream> void write(Stream &) const {}
+};
+
+// stakeerase(threshold: uint64)
+struct stakeerase {
+  static constexpr uint64_t action_name = name_value("stakeerase");
+  uint64_t threshold;
+
+  template <typename Stream> void write(Stream &s) const {
+    write_value(s, threshold);
+  }
+};
+
+// stakeupsert(threshold: uint64, value_a: uint32, value_b: uint32, value_c: uint32, value_d: uint32, value_e: uint32, value_u: uint32, value_v: uint32, value_w: uint32, value_x: uint32, value_y: uint32)
+struct stakeupsert {
+  static constexpr uint64_t action_name = name_value("stakeupsert");
+  uint64_t threshold;
+  uint32_t value_a;
+  uint32_t value_b;
+  uint32_t value_c;
+  uint32_t value_d;
+  uint32_t value_e;
+  uint32_t value_u;
+  uint32_t value_v;
+  uint32_t value_w;
+  uint32_t value_x;
+  uint32_t value_y;
+
+  template <typename Stream> void write(Stream &s) const {
+    write_value(s, threshold);
+    write_value(s, value_a);
+    write_value(s, value_b);
+    write_value(s, value_c);
+    write_value(s, value_d);
+    write_value(s, value_e);
+    write_value(s, value_u);
+    write_value(s, value_v);
+    write_value(s, value_w);
+    write_value(s, value_x);
+    write_value(s, value_y);
+  }
+};
+
+// targetrate(price: float64)
+struct targetrate {
+  static constexpr uint64_t action_name = name_value("targetrate");
+  double price;
+
+  template <typename Stream> void write(Stream &s) const {
+    write_value(s, price);
+  }
+};
+
+// transfadd(account: name)
+struct transfadd {
+  static constexpr uint64_t action_name = name_value("transfadd");
+  uint64_t account;
+
+  template <typename Stream> void write(Stream &s) const {
+    write_value(s, account);
+  }
+};
+
+// transferase(account: name)
+struct transferase {
+  static constexpr uint64_t action_name = name_value("transferase");
+  uint64_t account;
+
+  template <typename Stream> void write(Stream &s) const {
+    write_value(s, account);
+  }
+};
+
+// version()
+struct version {
+  static constexpr uint64_t action_name = name_value("version");
+
+  template <typename Stream> void write(Stream &) const {}
+};
+
+// the actions of the ABI
+constexpr uint64_t action_names[] = {
+    burneradd::action_name,
+    burnererase::action_name,
+    currentrate::action_name,
+    iterclear::action_name,
+    itererase::action_name,
+    iterupsert::action_name,
+    minteradd::action_name,
+    mintererase::action_name,
+    paramerase::action_name,
+    paramupsert::action_name,
+    rateerase::action_name,
+    stakeerase::action_name,
+    stakeupsert::action_name,
+    targetrate::action_name,
+    transfadd::action_name,
+    transferase::action_name,
+    version::action_name,
+};
+
+} // namespace freeosconfig
+
+} // namespace relay
+} // namespace freedao
@@ -0,0 +1,444 @@
+// freeosaudit - reconciles the freeos ledgers in a columnar snapshot.
+//
+// Reads the .fcol files written by freeosexport (stat, accounts,
+// vestaccounts, users and, if present, iterations) and checks:
+//
+//   - every stat row: supply equals the sum of the accounts balances of its
+//     symbol, and 0 <= conditional_supply <= supply <= max_supply
+//   - conditional_supply is only ever changed by claim, unvest and convert,
+//     all of which are POINT-only, so it must be 0 for every other symbol.
+//     For POINT, supply - conditional_supply is what mint has issued less
+//     what burn has retired, which the snapshot cannot know - pass it with
+//     --minted to check it
+//   - every accounts balance is non-negative and of a symbol in stat
+//   - every vested balance is a whole number of POINTs, non-negative, and no
+//     more than the user's issuances could have vested: issuances times the
+//     largest iteration claim amount times the 90% vested proportion cap
+//
+// The accounts and vestaccounts rows are split into one range per thread,
+// on scope boundaries, and each thread sums its range with branch-free loops
+// that the compiler vectorises. Rows are only looked at one by one in a range
+// whose sums show a discrepancy, to list the accounts involved.
+//
+// usage: ./freeosaudit [options] <snapshot dir> - see usage() below
+
+#include "eosname.hpp"
+#include "freeoscolumns.hpp"
+
+#include "../common/freeoseconomics.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdarg>
+#include <cstdlib>
+#include <thread>
+#include <utility>
+
+using namespace freedao;
+using namespace freedao::sim;
+
+static void usage(const char *program) {
+  std::printf(
+      "usage: %s [options] <snapshot dir>\n"
+      "  --threads N        worker threads, 0 for one per core (0)\n"
+      "  --minted AMOUNT    POINT issued by mint less retired by burn, in\n"
+      "                     POINT units (not checked)\n"
+      "  --detail N         list up to N accounts per discrepancy (20)\n",
+      program);
+}
+
+// the symbol code of a symbol column value, e.g. "POINT"
+static std::string symbol_code(uint64_t symbol) {
+  std::string code;
+  for (symbol >>= 8; symbol != 0; symbol >>= 8) {
+    code += char(symbol & 0xff);
+  }
+  return code;
+}
+
+// the symbol column value of a symbol code and precision
+static uint64_t symbol_value(const std::string &code, uint8_t precision) {
+  uint64_t symbol = 0;
+  for (size_t i = code.size(); i > 0; i--) {
+    symbol = symbol << 8 | uint8_t(code[i - 1]);
+  }
+  return symbol << 8 | precision;
+}
+
+// a range of rows, starting and ending on a scope boundary
+struct row_range {
+  uint64_t begin;
+  uint64_t end;
+};
+
+// split the rows into up to parts ranges, without splitting a scope. The
+// snapshot rows are grouped by scope.
+static std::vector<row_range> partition(const uint64_t *scopes, uint64_t rows,
+                                        unsigned parts) {
+  std::vector<row_range> ranges;
+  uint64_t begin = 0;
+
+  for (unsigned p = 1; p <= parts && begin < rows; p++) {
+    uint64_t end = rows * p / parts;
+    while (end > begin && end < rows && scopes[end] == scopes[end - 1]) {
+      end++;
+    }
+    if (end > begin) {
+      ranges.push_back({begin, end});
+      begin = end;
+    }
+  }
+
+  return ranges;
+}
+
+// run work(range index) on a thread per range
+template <typename Work>
+static void for_each_range(size_t ranges, Work &&work) {
+  std::vector<std::thread> pool;
+  for (size_t r = 0; r < ranges; r++) {
+    pool.emplace_back(work, r);
+  }
+  for (std::thread &t : pool) {
+    t.join();
+  }
+}
+
+// the sum of the amounts of one symbol, and how many rows it has
+struct symbol_sum {
+  int64_t amount = 0;
+  uint64_t rows = 0;
+  bool negative = false;
+};
+
+static symbol_sum sum_symbol(const int64_t *amounts, const uint64_t *symbols,
+                             row_range range, uint64_t symbol) {
+  symbol_sum sum;
+  int64_t lowest = 0;
+
+  for (uint64_t i = range.begin; i < range.end; i++) {
+    int64_t match = symbols[i] == symbol;
+    int64_t amount = amounts[i] * match;
+    sum.amount += amount;
+    sum.rows += match;
+    lowest = std::min(lowest, amount);
+  }
+
+  sum.negative = lowest < 0;
+  return sum;
+}
+
+struct audit {
+  unsigned detail = 20;
+  uint64_t discrepancies = 0;
+
+  void fail(const char *format, ...) __attribute__((format(printf, 2, 3))) {
+    va_list args;
+    va_start(args, format);
+    std::printf("DISCREPANCY: ");
+    std::vprintf(format, args);
+    std::printf("\n");
+    va_end(args);
+    discrepancies++;
+  }
+
+  // list an account involved in a discrepancy, up to the detail limit
+  void account(unsigned &listed, uint64_t scope, int64_t amount,
+               uint64_t symbol, const char *reason) {
+    if (listed++ < detail) {
+      std::printf("  %-13s %20lld %-7s %s\n", name_string(scope).c_str(),
+                  (long long)amount, symbol_code(symbol).c_str(), reason);
+    } else if (listed == detail + 1) {
+      std::printf("  ...\n");
+    }
+  }
+};
+
+// open <dir>/<table>.fcol. Returns false if it cannot be read.
+static bool open_table(column_file &file, const std::string &dir,
+                       const char *table, bool required) {
+  std::string path = dir + "/" + table + ".fcol";
+  if (!file.open(path)) {
+    if (required) {
+      std::fprintf(stderr, "cannot read %s\n", path.c_str());
+    }
+    return false;
+  }
+  return true;
+}
+
+static bool missing_column(const char *table, const char *column) {
+  std::fprintf(stderr, "%s has no %s column\n", table, column);
+  return true;
+}
+
+int main(int argc, char *argv[]) {
+  unsigned threads = 0;
+  bool check_minted = false;
+  int64_t minted = 0;
+  audit a;
+  int arg = 1;
+
+  for (; arg + 1 < argc && argv[arg][0] == '-'; arg += 2) {
+    if (std::strcmp(argv[arg], "--threads") == 0) {
+      threads = std::strtoul(argv[arg + 1], nullptr, 10);
+    } else if (std::strcmp(argv[arg], "--minted") == 0) {
+      check_minted = true;
+      minted = std::strtoll(argv[arg + 1], nullptr, 10);
+    } else if (std::strcmp(argv[arg], "--detail") == 0) {
+      a.detail = std::strtoul(argv[arg + 1], nullptr, 10);
+    } else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  if (arg + 1 != argc) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  auto started = std::chrono::steady_clock::now();
+  std::string dir = argv[arg];
+
+  column_file stat, accounts, vestaccounts, users, iterations;
+  if (!open_table(stat, dir, "stat", true) ||
+      !open_table(accounts, dir, "accounts", true) ||
+      !open_table(vestaccounts, dir, "vestaccounts", true) ||
+      !open_table(users, dir, "users", true)) {
+    return 1;
+  }
+  bool have_iterations = open_table(iterations, dir, "iterations", false);
+
+  const int64_t *supply = stat.values<int64_t>("supply.amount");
+  const uint64_t *supply_symbol = stat.values<uint64_t>("supply.symbol");
+  const int64_t *max_supply = stat.values<int64_t>("max_supply.amount");
+  const int64_t *conditional = stat.values<int64_t>("conditional_supply.amount");
+  const uint64_t *account_scope = accounts.values<uint64_t>("scope");
+  const int64_t *balance = accounts.values<int64_t>("balance.amount");
+  const uint64_t *balance_symbol = accounts.values<uint64_t>("balance.symbol");
+  const uint64_t *vest_scope = vestaccounts.values<uint64_t>("scope");
+  const int64_t *vested = vestaccounts.values<int64_t>("balance.amount");
+  const uint64_t *vested_symbol = vestaccounts.values<uint64_t>("balance.symbol");
+  const uint64_t *user_scope = users.values<uint64_t>("scope");
+  const uint32_t *issuances = users.values<uint32_t>("issuances");
+  const uint16_t *claim_amount =
+      have_iterations ? iterations.values<uint16_t>("claim_amount") : nullptr;
+
+  if ((!supply && missing_column("stat", "supply")) ||
+      (!supply_symbol && missing_column("stat", "supply")) ||
+      (!max_supply && missing_column("stat", "max_supply")) ||
+      (!conditional && missing_column("stat", "conditional_supply")) ||
+      (!account_scope && missing_column("accounts", "scope")) ||
+      (!balance && missing_column("accounts", "balance")) ||
+      (!balance_symbol && missing_column("accounts", "balance")) ||
+      (!vest_scope && missing_column("vestaccounts", "scope")) ||
+      (!vested && missing_column("vestaccounts", "balance")) ||
+      (!vested_symbol && missing_column("vestaccounts", "balance")) ||
+      (!user_scope && missing_column("users", "scope")) ||
+      (!issuances && missing_column("users", "issuances")) ||
+      (have_iterations && !claim_amount &&
+       missing_column("iterations", "claim_amount"))) {
+    return 1;
+  }
+
+  // supply against the accounts balances, per symbol and range
+  std::vector<row_range> ranges =
+      partition(account_scope, accounts.rows(), threads);
+  const uint64_t symbols = stat.rows();
+  std::vector<symbol_sum> sums(ranges.size() * symbols);
+
+  for_each_range(ranges.size(), [&](size_t r) {
+    for (uint64_t s = 0; s < symbols; s++) {
+      sums[r * symbols + s] =
+          sum_symbol(balance, balance_symbol, ranges[r], supply_symbol[s]);
+    }
+  });
+
+  uint64_t matched_rows = 0;
+  const uint64_t point = symbol_value("POINT", 4);
+
+  std::printf("%-7s %20s %20s %20s %20s\n", "symbol", "supply", "balances",
+              "conditional", "max supply");
+  for (uint64_t s = 0; s < symbols; s++) {
+    int64_t total = 0;
+    for (size_t r = 0; r < ranges.size(); r++) {
+      total += sums[r * symbols + s].amount;
+      matched_rows += sums[r * symbols + s].rows;
+    }
+
+    std::string code = symbol_code(supply_symbol[s]);
+    std::printf("%-7s %20lld %20lld %20lld %20lld\n", code.c_str(),
+                (long long)supply[s], (long long)total,
+                (long long)conditional[s], (long long)max_supply[s]);
+
+    if (total != supply[s]) {
+      a.fail("%s supply %lld, accounts hold %lld (difference %lld)",
+             code.c_str(), (long long)supply[s], (long long)total,
+             (long long)(supply[s] - total));
+    }
+    if (supply[s] > max_supply[s]) {
+      a.fail("%s supply exceeds max supply", code.c_str());
+    }
+    if (conditional[s] < 0 || conditional[s] > supply[s]) {
+      a.fail("%s conditional_supply %lld is outside 0..supply", code.c_str(),
+             (long long)conditional[s]);
+    }
+    if (supply_symbol[s] != point && conditional[s] != 0) {
+      a.fail("%s conditional_supply is %lld - only POINT has one",
+             code.c_str(), (long long)conditional[s]);
+    }
+    if (supply_symbol[s] == point && check_minted &&
+        supply[s] - conditional[s] != minted) {
+      a.fail("POINT supply - conditional_supply is %lld, mint less burn is "
+             "%lld (difference %lld)",
+             (long long)(supply[s] - conditional[s]), (long long)minted,
+             (long long)(supply[s] - conditional[s] - minted));
+    }
+  }
+
+  // the accounts behind the balance discrepancies
+  bool bad_accounts = matched_rows != accounts.rows();
+  for (size_t i = 0; i < sums.size() && !bad_accounts; i++) {
+    bad_accounts = sums[i].negative;
+  }
+
+  if (bad_accounts) {
+    a.fail("accounts rows with a negative balance or a symbol not in stat");
+    unsigned listed = 0;
+
+    for (size_t r = 0; r < ranges.size(); r++) {
+      bool negative = false;
+      uint64_t range_rows = 0;
+      for (uint64_t s = 0; s < symbols; s++) {
+        negative |= sums[r * symbols + s].negative;
+        range_rows += sums[r * symbols + s].rows;
+      }
+      if (!negative && range_rows == ranges[r].end - ranges[r].begin) {
+        continue;
+      }
+
+      for (uint64_t i = ranges[r].begin; i < ranges[r].end; i++) {
+        bool known = std::find(supply_symbol, supply_symbol + symbols,
+                               balance_symbol[i]) != supply_symbol + symbols;
+        if (!known || balance[i] < 0) {
+          a.account(listed, account_scope[i], balance[i], balance_symbol[i],
+                    known ? "negative balance" : "symbol not in stat");
+        }
+      }
+    }
+  }
+
+  // vested balances against the users' issuances
+  std::vector<std::pair<uint64_t, uint32_t>> user_issuances(users.rows());
+  for (uint64_t i = 0; i < users.rows(); i++) {
+    user_issuances[i] = {user_scope[i], issuances[i]};
+  }
+  if (!std::is_sorted(user_issuances.begin(), user_issuances.end())) {
+    std::sort(user_issuances.begin(), user_issuances.end());
+  }
+
+  uint16_t max_claim = 0;
+  for (uint64_t i = 0; have_iterations && i < iterations.rows(); i++) {
+    max_claim = std::max(max_claim, claim_amount[i]);
+  }
+  // the most a single claim can vest
+  const int64_t max_vested =
+      int64_t(max_claim * economics::cap_vested_proportion(1.0f)) *
+      economics::POINT_UNITS;
+
+  // a vested balance that is not accounted for, and why
+  struct vest_problem {
+    uint64_t row;
+    const char *reason;
+  };
+
+  std::vector<row_range> vest_ranges =
+      partition(vest_scope, vestaccounts.rows(), threads);
+  std::vector<std::vector<vest_problem>> problems(vest_ranges.size());
+  std::vector<int64_t> vested_totals(vest_ranges.size());
+  std::vector<uint64_t> deregistered(vest_ranges.size());
+
+  for_each_range(vest_ranges.size(), [&](size_t r) {
+    row_range range = vest_ranges[r];
+    int64_t total = 0;
+    int64_t bad = 0;
+
+    for (uint64_t i = range.begin; i < range.end; i++) {
+      total += vested[i];
+      bad |= (vested[i] % economics::POINT_UNITS) | (vested[i] < 0) |
+             (vested_symbol[i] != point);
+    }
+    vested_totals[r] = total;
+
+    for (uint64_t i = range.begin; i < range.end; i++) {
+      if (bad != 0 && (vested[i] % economics::POINT_UNITS != 0 ||
+                       vested[i] < 0 || vested_symbol[i] != point)) {
+        problems[r].push_back({i, vested_symbol[i] != point
+                                      ? "not a POINT balance"
+                                      : "not a whole number of POINTs"});
+        continue;
+      }
+      if (vested[i] == 0) {
+        continue;
+      }
+
+      auto user = std::lower_bound(
+          user_issuances.begin(), user_issuances.end(),
+          std::make_pair(vest_scope[i], uint32_t(0)));
+      if (user == user_issuances.end() || user->first != vest_scope[i]) {
+        deregistered[r]++; // left behind by deregister
+      } else if (user->second == 0) {
+        problems[r].push_back({i, "vested balance with no issuances"});
+      } else if (have_iterations && vested[i] > max_vested * user->second) {
+        problems[r].push_back({i, "more than the issuances can have vested"});
+      }
+    }
+  });
+
+  int64_t vested_total = 0;
+  uint64_t deregistered_total = 0;
+  uint64_t problem_total = 0;
+  for (size_t r = 0; r < vest_ranges.size(); r++) {
+    vested_total += vested_totals[r];
+    deregistered_total += deregistered[r];
+    problem_total += problems[r].size();
+  }
+
+  std::printf("\n%llu vested balances, %lld POINT units in total, %llu of "
+              "deregistered users\n",
+              (unsigned long long)vestaccounts.rows(), (long long)vested_total,
+              (unsigned long long)deregistered_total);
+  if (!have_iterations) {
+    std::printf("(no iterations table - vested balances not checked against "
+                "issuances)\n");
+  }
+
+  if (problem_total > 0) {
+    a.fail("%llu vested balances inconsistent with claim history",
+           (unsigned long long)problem_total);
+    unsigned listed = 0;
+    for (const auto &range_problems : problems) {
+      for (const vest_problem &p : range_problems) {
+        a.account(listed, vest_scope[p.row], vested[p.row],
+                  vested_symbol[p.row], p.reason);
+      }
+    }
+  }
+
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - started)
+                       .count();
+  std::printf("\n%llu accounts rows, %llu vestaccounts rows, %llu users rows "
+              "on %u threads in %.2f s: %llu discrepancies\n",
+              (unsigned long long)accounts.rows(),
+              (unsigned long long)vestaccounts.rows(),
+              (unsigned long long)users.rows(), threads, seconds,
+              (unsigned long long)a.discrepancies);
+
+  return a.discrepancies == 0 ? 0 : 2;
+}
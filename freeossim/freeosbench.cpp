@@ -0,0 +1,649 @@
+// freeosbench - the per-action benchmark suite, on the host build of the
+// contracts (../host, see freeoshost.hpp).
+//
+// Each fixture is a freeos system in its iteration <deposits> + 1 with:
+//   - <users> registered users, a third each of 'v', 'd' and 'e' accounts,
+//     staked as the stake bands require
+//   - a deposits row for each of the <deposits> iterations before
+//   - <queue> unstake requests of those users, due for refund
+//   - the benchmarked actors, whose usersinfo records have <kyc> KYC entries,
+//     registered (and staked, claimed, ...) by the contract's own actions
+// The population's rows are written straight into the tables; only the
+// actors go through the contract.
+//
+// Every action runs on the same fixture - each run is rolled back - and is
+// run --repeat times for its wall time (the median). The counts are the
+// same on every run. One CSV line per fixture and action goes to the output:
+//
+//   users,kyc,queue,deposits,action,status,wall_ns,finds,lower_bounds,nexts,
+//   gets,stores,updates,removes,idx_reads,idx_writes,bytes_packed,
+//   bytes_unpacked,heap_allocs,heap_bytes,heap_peak,inline_actions,
+//   notifications,ram_bytes
+//
+// The counts are the whole transaction's, every receiver's - the stake
+// includes the token contract's transfer. heap_allocs and heap_bytes are the
+// contracts' allocations (the allocator's, i.e. operator new), heap_peak the
+// most bytes allocated and not yet freed at once. See counters in
+// freeoshost.hpp for the rest.
+//
+// The fixtures are the cross product of the --users, --kyc, --queue and
+// --deposits values. A fixture takes about 2 KB of memory per user, so 10M
+// users need about 20 GB.
+//
+// With --scenario, it runs a freeoswasm script (see freeosscript.hpp) on the
+// host build instead, for bench_compare.sh. A code directive deploys the host
+// build of the contract its .wasm is built from (freeos, freeosconfig or
+// eosio.token), every account the script names exists, and the --report has
+// a line per transaction:
+//
+//   label db_reads db_writes bytes_packed bytes_unpacked heap_allocs
+//   heap_bytes ok|failed
+//
+// usage: ./freeosbench [options] - see usage() below
+
+#include "freeoshost.hpp"
+
+#include "../common/freeoscommon.hpp"
+
+#include "freeosscript.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace freedao;
+using namespace freedao::host;
+
+namespace {
+
+void usage(const char *program) {
+  std::printf(
+      "usage: %s [options]\n"
+      "  --users N      registered users (1000, 10000 and 100000)\n"
+      "  --kyc N        KYC entries in the actors' usersinfo records (1 and 8)\n"
+      "  --queue N      unstake requests due for refund (0 and 1000)\n"
+      "  --deposits N   iterations of deposit history (1 and 52)\n"
+      "  --repeat N     runs of each action, for its wall time (5)\n"
+      "  --output FILE  the CSV file (standard output)\n"
+      "  --scenario FILE  run a freeoswasm script instead of the fixtures\n"
+      "  --report FILE  with --scenario, a line per transaction to FILE\n"
+      "Each of --users, --kyc, --queue and --deposits can be given more than\n"
+      "once; the fixtures are every combination.\n",
+      program);
+}
+
+struct fixture_config {
+  uint64_t users;
+  uint32_t kyc;
+  uint32_t queue;
+  uint32_t deposits;
+};
+
+// the actors
+const eosio::name newcomer("newcomer");   // not registered
+const eosio::name claimer("claimer");     // 'v', claimed last iteration
+const eosio::name staker("staker");       // 'e', registered, not staked
+const eosio::name stakeholder("stakehold"); // 'e', staked
+const eosio::name unstaker("unstaker");   // 'e', staked, unstake requested
+
+// the stake of an 'e' account with the default stake bands
+constexpr int64_t e_stake_whole = 20;
+
+eosio::asset stake_units(int64_t whole) {
+  return eosio::asset(whole * SYSTEM_CURRENCY_UNITS, system_symbol());
+}
+
+// the population's user names: 'u' and the index in base 26
+eosio::name population_name(uint64_t index) {
+  char text[13] = "uaaaaaaaaaaa";
+  for (int i = 11; i > 0 && index > 0; i--) {
+    text[i] = char('a' + index % 26);
+    index /= 26;
+  }
+  return eosio::name(text);
+}
+
+char population_type(uint64_t index) {
+  static const char types[] = {'v', 'd', 'e'};
+  return types[index % 3];
+}
+
+// the stake of a population user, in whole units - the default stake bands
+int64_t population_stake(uint64_t index) {
+  switch (population_type(index)) {
+  case 'd':
+    return 10;
+  case 'e':
+    return e_stake_whole;
+  default:
+    return 0;
+  }
+}
+
+std::vector<std::string> kyc_levels(uint32_t entries) {
+  std::vector<std::string> levels;
+  for (uint32_t i = 0; i < entries; i++) {
+    levels.push_back(i == 0 ? "firstname,lastname,birthdate" : "address");
+  }
+  return levels;
+}
+
+eosio::time_point iteration_start(const system_config &config,
+                                  uint32_t iteration) {
+  return config.start + eosio::microseconds(config.iteration_length.count() *
+                                            int64_t(iteration - 1));
+}
+
+// push a freeos action that takes the user as its argument
+void push_ok(chain &c, const char *action, eosio::name user) {
+  expect_success(c.push(freeos_account(), eosio::name(action), user, user));
+}
+
+void stake(chain &c, eosio::name user) {
+  expect_success(c.push(system_token_account(), eosio::name("transfer"), user,
+                        user, freeos_account(), stake_units(e_stake_whole),
+                        std::string("freeos stake")));
+}
+
+// the population, the deposits and the statistics and aggstats records that
+// go with them
+void write_population(chain &c, const fixture_config &f) {
+  const eosio::name freeos = freeos_account();
+  aggstat totals;
+  totals.staked = stake_units(0);
+  totals.vested = eosio::asset(0, point_symbol());
+  totals.refunds = stake_units(0);
+
+  c.run_as(freeos, [&] {
+    for (uint64_t i = 0; i < f.users; i++) {
+      eosio::name account = population_name(i);
+      char type = population_type(i);
+      eosio::asset staked = stake_units(population_stake(i));
+
+      users_index users_table(freeos, account.value);
+      users_table.emplace(freeos, [&](user &u) {
+        u.stake = staked;
+        u.account_type = type;
+        u.registered_iteration = 1;
+        u.staked_iteration = 1;
+        u.votes = 0;
+        u.issuances = f.deposits;
+        u.last_issuance = f.deposits;
+      });
+      vestaccounts_index vestaccounts_table(freeos, account.value);
+      vestaccounts_table.emplace(freeos, [&](vestaccount &v) {
+        v.balance = eosio::asset(0, point_symbol());
+      });
+
+      totals.staked += staked;
+      (type == 'v' ? totals.verified : totals.unverified)++;
+    }
+
+    deposits_index deposits_table(freeos, freeos.value);
+    for (uint32_t i = 1; i <= f.deposits; i++) {
+      deposits_table.emplace(freeos, [&](deposit &d) {
+        d.iteration = i;
+        d.accrued = eosio::asset(f.users * 10000, point_symbol());
+      });
+    }
+
+    statistic_index statistic_table(freeos, freeos.value);
+    statistic_table.emplace(freeos, [&](statistic &s) {
+      s.usercount = uint32_t(f.users);
+      s.claimevents = 0;
+      s.unvestpercent = 0;
+      s.unvestpercentiteration = 0;
+      s.iteration = 0;
+      s.failsafecounter = 0;
+    });
+
+    aggstats_index aggstats_table(freeos, freeos.value);
+    aggstats_table.emplace(freeos, [&](aggstat &a) { a = totals; });
+  });
+
+  for (uint64_t i = 0; i < f.users; i++) {
+    c.create_account(population_name(i));
+  }
+}
+
+// queue unstake requests of staked population users, made in iteration, and
+// give freeos the stake currency to refund them
+void write_queue(chain &c, const fixture_config &f, uint32_t iteration) {
+  const eosio::name freeos = freeos_account();
+  eosio::asset queued = stake_units(0);
+  uint32_t requests = 0;
+
+  c.run_as(freeos, [&] {
+    unstakerequest_index unstakes_table(freeos, freeos.value);
+    for (uint64_t i = 0; i < f.users && requests < f.queue; i++) {
+      if (population_stake(i) == 0) {
+        continue;
+      }
+      unstakes_table.emplace(freeos, [&](unstakerequest &r) {
+        r.staker = population_name(i);
+        r.iteration = iteration;
+        r.amount = stake_units(population_stake(i));
+      });
+      queued += stake_units(population_stake(i));
+      requests++;
+    }
+
+    aggstats_index aggstats_table(freeos, freeos.value);
+    aggstats_table.modify(aggstats_table.begin(), freeos, [&](aggstat &a) {
+      a.refunds += queued;
+      a.refundcount += requests;
+    });
+  });
+
+  if (queued.amount > 0) {
+    fund_user(c, freeos, queued);
+  }
+}
+
+// a fixture, ready for the benchmarks - see the top of the file
+system_config build_fixture(chain &c, const fixture_config &f) {
+  system_config config;
+  config.iterations = f.deposits + 3;
+  bootstrap_freeos(c, config);
+
+  // an exchange rate at its target, so that unvest has a percentage
+  expect_success(c.push(freeosconfig_account(), eosio::name("targetrate"),
+                        freeosconfig_account(), 0.01));
+  expect_success(c.push(freeosconfig_account(), eosio::name("currentrate"),
+                        freeosconfig_account(), 1.0));
+
+  c.set_time(iteration_start(config, f.deposits));
+  write_population(c, f);
+
+  // the actors, in the last iteration of the deposit history. Those without
+  // a usersinfo record are 'e' accounts.
+  set_verification(c, newcomer, kyc_levels(f.kyc));
+  set_verification(c, claimer, kyc_levels(f.kyc));
+  for (eosio::name actor : {staker, stakeholder, unstaker}) {
+    fund_user(c, actor, stake_units(e_stake_whole));
+  }
+
+  push_ok(c, "reguser", claimer);
+  push_ok(c, "claim", claimer);
+  push_ok(c, "reguser", staker);
+  stake(c, stakeholder);
+  stake(c, unstaker);
+
+  // the benchmarked iteration
+  c.set_time(iteration_start(config, f.deposits + 1));
+  expect_success(c.push(freeos_account(), eosio::name("tick"), claimer));
+  push_ok(c, "unstake", unstaker);
+  write_queue(c, f, f.deposits);
+
+  return config;
+}
+
+struct benchmark {
+  const char *action;
+  std::vector<eosio::action> actions;
+  bool read_only = false;
+  bool next_iteration = false; // run at the start of the next iteration
+};
+
+std::vector<benchmark> benchmarks() {
+  const eosio::name freeos = freeos_account();
+  auto make = [](eosio::name account, const char *action, eosio::name actor,
+                 auto &&...args) {
+    return chain::make_action(account, eosio::name(action), actor, args...);
+  };
+
+  return {
+      {"reguser", {make(freeos, "reguser", newcomer, newcomer)}},
+      {"stake",
+       {make(system_token_account(), "transfer", staker, staker, freeos,
+             stake_units(e_stake_whole), std::string("freeos stake"))}},
+      {"claim", {make(freeos, "claim", claimer, claimer)}},
+      {"unvest", {make(freeos, "unvest", claimer, claimer)}},
+      {"unstake", {make(freeos, "unstake", stakeholder, stakeholder)}},
+      {"unstakecncl", {make(freeos, "unstakecncl", unstaker, unstaker)}},
+      {"convert",
+       {make(freeos, "convert", claimer, claimer,
+             eosio::asset(10000, point_symbol()))}},
+      {"tick", {make(freeos, "tick", claimer)}},
+      {"tick-rollover", {make(freeos, "tick", claimer)}, false, true},
+      {"getclaimq", {make(freeos, "getclaimq", claimer, claimer)}, true},
+  };
+}
+
+const char CSV_HEADER[] =
+    "users,kyc,queue,deposits,action,status,wall_ns,finds,lower_bounds,nexts,"
+    "gets,stores,updates,removes,idx_reads,idx_writes,bytes_packed,"
+    "bytes_unpacked,heap_allocs,heap_bytes,heap_peak,inline_actions,"
+    "notifications,ram_bytes\n";
+
+void run_fixture(const fixture_config &f, unsigned repeat, FILE *out) {
+  chain c;
+  system_config config = build_fixture(c, f);
+  eosio::time_point now = c.time();
+
+  for (const benchmark &b : benchmarks()) {
+    std::vector<uint64_t> wall;
+    transaction_trace trace;
+
+    for (unsigned run = 0; run < repeat; run++) {
+      c.checkpoint();
+      if (b.next_iteration) {
+        c.set_time(iteration_start(config, f.deposits + 2));
+      }
+      trace = c.push_transaction(b.actions, b.read_only);
+      c.rollback();
+      c.set_time(now);
+      wall.push_back(trace.total().wall_ns);
+    }
+    std::sort(wall.begin(), wall.end());
+
+    if (!trace.succeeded) {
+      std::fprintf(stderr, "%s (%llu users): %s\n", b.action,
+                   (unsigned long long)f.users, trace.error.c_str());
+    }
+
+    counters cost = trace.total();
+    std::fprintf(
+        out,
+        "%llu,%u,%u,%u,%s,%s,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,"
+        "%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%lld\n",
+        (unsigned long long)f.users, f.kyc, f.queue, f.deposits, b.action,
+        trace.succeeded ? "ok" : "failed",
+        (unsigned long long)wall[wall.size() / 2],
+        (unsigned long long)cost.finds, (unsigned long long)cost.lower_bounds,
+        (unsigned long long)cost.nexts, (unsigned long long)cost.gets,
+        (unsigned long long)cost.stores, (unsigned long long)cost.updates,
+        (unsigned long long)cost.removes,
+        (unsigned long long)(cost.idx_finds + cost.idx_lower_bounds +
+                             cost.idx_nexts),
+        (unsigned long long)(cost.idx_stores + cost.idx_updates +
+                             cost.idx_removes),
+        (unsigned long long)cost.bytes_packed,
+        (unsigned long long)cost.bytes_unpacked,
+        (unsigned long long)cost.heap_allocations(),
+        (unsigned long long)cost.heap_bytes,
+        (unsigned long long)cost.heap_peak,
+        (unsigned long long)cost.inline_actions,
+        (unsigned long long)cost.notifications, (long long)cost.ram_bytes);
+  }
+  std::fflush(out);
+}
+
+// the host build of the contract a .wasm file is built from
+apply_function host_contract(const std::string &wasm_file) {
+  std::string stem = wasm_file.substr(wasm_file.find_last_of('/') + 1);
+  stem = stem.substr(0, stem.find(".wasm"));
+  if (stem == "freeos") {
+    return apply_freeos;
+  }
+  if (stem == "freeosconfig") {
+    return apply_freeosconfig;
+  }
+  if (stem == "eosio.token" || stem == "token") {
+    return apply_token;
+  }
+  return nullptr;
+}
+
+// the scenario's accounts exist - those of its actors, contracts and name
+// fields
+void create_accounts(chain &c, const std::vector<std::string> &words) {
+  for (size_t i = 0; i < words.size(); i++) {
+    const std::string &word = words[i];
+    if (word.compare(0, 5, "name:") == 0) {
+      c.create_account(eosio::name(word.substr(5)));
+    } else if (i < 3) {
+      std::stringstream list(word);
+      std::string account;
+      while (std::getline(list, account, i == 0 ? '/' : ',')) {
+        c.create_account(eosio::name(account));
+      }
+    }
+  }
+}
+
+int run_scenario(const char *file, const char *report_file) {
+  std::ifstream script(file);
+  if (!script) {
+    std::perror(file);
+    return 1;
+  }
+
+  FILE *report = nullptr;
+  if (report_file != nullptr &&
+      (report = std::fopen(report_file, "w")) == nullptr) {
+    std::perror(report_file);
+    return 1;
+  }
+
+  chain c;
+  for (eosio::name account :
+       {freeos_account(), freeosconfig_account(), freeostokens_account(),
+        freedao_account(), system_token_account(), verification_account()}) {
+    c.create_account(account);
+  }
+
+  uint64_t transactions = 0, failed = 0;
+  std::map<std::string, int> occurrences;
+  std::string label;
+  std::string line;
+  for (int number = 1; std::getline(script, line); number++) {
+    std::vector<std::string> words = script::split(line);
+    if (words.empty()) {
+      continue;
+    }
+    std::string error;
+    auto fail = [&](const std::string &why) {
+      std::fprintf(stderr, "%s:%d: %s\n", file, number, why.c_str());
+      return 1;
+    };
+
+    if (words[0] == "code") {
+      apply_function apply =
+          words.size() == 3 ? host_contract(words[2]) : nullptr;
+      if (apply == nullptr) {
+        return fail("usage: code <account> <freeos, freeosconfig or "
+                    "eosio.token wasm file>");
+      }
+      c.set_contract(eosio::name(words[1]), apply);
+      continue;
+    }
+
+    if (words[0] == "time") {
+      int64_t seconds;
+      if (words.size() != 2 || !script::parse_time(words[1], seconds)) {
+        return fail("usage: time <seconds or YYYY-MM-DDTHH:MM:SS>");
+      }
+      c.set_time(eosio::time_point(eosio::seconds(seconds)));
+      continue;
+    }
+
+    if (words[0] == "label") {
+      if (words.size() != 2) {
+        return fail("usage: label <label>");
+      }
+      label = words[1];
+      continue;
+    }
+
+    if (words[0] == "row") {
+      std::vector<uint8_t> primary, value;
+      if (words.size() < 6 ||
+          !script::pack_fields({words[4]}, 0, primary, error) ||
+          primary.size() != 8 || !script::pack_fields(words, 5, value, error)) {
+        return fail(error.empty()
+                        ? "usage: row <code> <scope> <table> <primary> ..."
+                        : error);
+      }
+      uint64_t key;
+      std::memcpy(&key, primary.data(), 8);
+      eosio::name code(words[1]);
+      c.set_row_data(code, eosio::name(words[2]).value, eosio::name(words[3]),
+                     code, key, std::vector<char>(value.begin(), value.end()));
+      continue;
+    }
+
+    // an action
+    if (words.size() < 3) {
+      return fail("usage: <contract> <action> <actor> <field> ...");
+    }
+    create_accounts(c, words);
+
+    eosio::action a;
+    size_t slash = words[0].find('/');
+    eosio::name receiver(words[0].substr(0, slash));
+    a.account = slash == std::string::npos
+                    ? receiver
+                    : eosio::name(words[0].substr(slash + 1));
+    a.name = eosio::name(words[1]);
+    std::stringstream actors(words[2]);
+    std::string actor;
+    while (std::getline(actors, actor, ',')) {
+      a.authorization.push_back({eosio::name(actor), eosio::name("active")});
+    }
+    std::vector<uint8_t> data;
+    if (!script::pack_fields(words, 3, data, error)) {
+      return fail(error);
+    }
+    a.data.assign(data.begin(), data.end());
+
+    transaction_trace trace = receiver == a.account
+                                  ? c.push_action(a)
+                                  : c.push_notification(receiver, a);
+    transactions++;
+    failed += !trace.succeeded;
+
+    if (label.empty()) {
+      label = a.account.to_string() + "::" + words[1];
+      int n = ++occurrences[label];
+      if (n > 1) {
+        label += "#" + std::to_string(n);
+      }
+    }
+
+    counters cost = trace.total();
+    std::printf("%d: %s: %llu db reads, %llu db writes, %llu bytes packed, "
+                "%llu unpacked, %llu heap allocations, %llu heap bytes - %s\n",
+                number, label.c_str(), (unsigned long long)cost.db_reads(),
+                (unsigned long long)cost.db_writes(),
+                (unsigned long long)cost.bytes_packed,
+                (unsigned long long)cost.bytes_unpacked,
+                (unsigned long long)cost.heap_allocations(),
+                (unsigned long long)cost.heap_bytes,
+                trace.succeeded ? "ok" : trace.error.c_str());
+    if (report != nullptr) {
+      std::fprintf(report, "%s %llu %llu %llu %llu %llu %llu %s\n",
+                   label.c_str(), (unsigned long long)cost.db_reads(),
+                   (unsigned long long)cost.db_writes(),
+                   (unsigned long long)cost.bytes_packed,
+                   (unsigned long long)cost.bytes_unpacked,
+                   (unsigned long long)cost.heap_allocations(),
+                   (unsigned long long)cost.heap_bytes,
+                   trace.succeeded ? "ok" : "failed");
+    }
+    label.clear();
+  }
+
+  if (report != nullptr && std::fclose(report) != 0) {
+    std::perror(report_file);
+    return 1;
+  }
+
+  std::printf("\n%llu transactions, %llu failed\n",
+              (unsigned long long)transactions, (unsigned long long)failed);
+  return 0;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  std::vector<uint64_t> users;
+  std::vector<uint32_t> kyc, queue, deposits;
+  unsigned repeat = 5;
+  const char *output = nullptr;
+  const char *scenario = nullptr;
+  const char *report = nullptr;
+
+  for (int arg = 1; arg < argc; arg += 2) {
+    if (arg + 1 >= argc) {
+      usage(argv[0]);
+      return 1;
+    }
+    const char *option = argv[arg];
+    const char *value = argv[arg + 1];
+    uint64_t number = std::strtoull(value, nullptr, 10);
+
+    if (std::strcmp(option, "--users") == 0) {
+      users.push_back(number);
+    } else if (std::strcmp(option, "--kyc") == 0 && number > 0) {
+      kyc.push_back(uint32_t(number));
+    } else if (std::strcmp(option, "--queue") == 0) {
+      queue.push_back(uint32_t(number));
+    } else if (std::strcmp(option, "--deposits") == 0 && number > 0) {
+      deposits.push_back(uint32_t(number));
+    } else if (std::strcmp(option, "--repeat") == 0 && number > 0) {
+      repeat = unsigned(number);
+    } else if (std::strcmp(option, "--output") == 0) {
+      output = value;
+    } else if (std::strcmp(option, "--scenario") == 0) {
+      scenario = value;
+    } else if (std::strcmp(option, "--report") == 0) {
+      report = value;
+    } else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  if (scenario != nullptr) {
+    return run_scenario(scenario, report);
+  }
+
+  if (users.empty()) {
+    users = {1000, 10000, 100000};
+  }
+  if (kyc.empty()) {
+    kyc = {1, 8};
+  }
+  if (queue.empty()) {
+    queue = {0, 1000};
+  }
+  if (deposits.empty()) {
+    deposits = {1, 52};
+  }
+
+  FILE *out = stdout;
+  if (output != nullptr && (out = std::fopen(output, "w")) == nullptr) {
+    std::perror(output);
+    return 1;
+  }
+
+  std::fputs(CSV_HEADER, out);
+  try {
+    for (uint64_t u : users) {
+      for (uint32_t k : kyc) {
+        for (uint32_t q : queue) {
+          for (uint32_t d : deposits) {
+            run_fixture({u, k, q, d}, repeat, out);
+          }
+        }
+      }
+    }
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "fixture setup failed: %s\n", e.what());
+    return 1;
+  }
+
+  if (out != stdout && std::fclose(out) != 0) {
+    std::perror(output);
+    return 1;
+  }
+  return 0;
+}
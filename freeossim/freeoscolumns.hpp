@@ -0,0 +1,232 @@
+#pragma once
+
+// Columnar table snapshot files, written by freeosexport.
+//
+// One file per table. The file starts with a file_header and a column_header
+// per column, followed by the column data. Each column holds one value per
+// row (the first column is the row's scope), as a packed little-endian array
+// aligned to 8 bytes, so a column can be scanned in place from a memory
+// mapping. A string column is an array of rows + 1 uint64_t offsets followed
+// by the string bytes.
+//
+// An asset field becomes two columns, <field>.amount (i64) and <field>.symbol
+// (u64). A time_point is i64 microseconds, a time_point_sec u32 seconds and a
+// name u64 (see eosname.hpp). A binary extension field that is missing from a
+// row reads as 0.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace freedao {
+namespace sim {
+
+constexpr char COLUMN_FILE_MAGIC[8] = {'F', 'R', 'E', 'E', 'C', 'O', 'L', '1'};
+
+enum column_type : uint32_t {
+  col_u8,
+  col_i8,
+  col_u16,
+  col_i16,
+  col_u32,
+  col_i32,
+  col_u64,
+  col_i64,
+  col_f32,
+  col_f64,
+  col_name,
+  col_string,
+};
+
+constexpr uint32_t COLUMN_WIDTH[] = {1, 1, 2, 2, 4, 4, 8, 8, 4, 8, 8, 0};
+
+struct file_header {
+  char magic[8];
+  uint32_t columns;
+  uint32_t reserved;
+  uint64_t rows;
+};
+
+struct column_header {
+  char name[48];
+  uint32_t type;
+  uint32_t reserved;
+  uint64_t offset; // from the start of the file
+  uint64_t size;   // bytes
+};
+
+// builds a column in memory
+class column_builder {
+public:
+  column_builder(std::string name, column_type type)
+      : name(std::move(name)), type(type) {
+    if (type == col_string) {
+      offsets.push_back(0);
+    }
+  }
+
+  // append a fixed-width value (the low bytes of value)
+  void append(uint64_t value) {
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&value);
+    data.insert(data.end(), bytes, bytes + COLUMN_WIDTH[type]);
+  }
+
+  void append_string(std::string_view value) {
+    data.insert(data.end(), value.begin(), value.end());
+    offsets.push_back(data.size());
+  }
+
+  uint64_t size() const {
+    return offsets.size() * sizeof(uint64_t) + data.size();
+  }
+
+  const std::string name;
+  const column_type type;
+  std::vector<uint64_t> offsets; // string columns only
+  std::vector<uint8_t> data;
+};
+
+// write a column file. Returns false on an I/O error.
+inline bool write_column_file(const std::string &path, uint64_t rows,
+                              const std::vector<column_builder> &columns) {
+  FILE *file = std::fopen(path.c_str(), "wb");
+  if (file == nullptr) {
+    return false;
+  }
+
+  file_header header = {};
+  std::memcpy(header.magic, COLUMN_FILE_MAGIC, sizeof(header.magic));
+  header.columns = columns.size();
+  header.rows = rows;
+
+  std::vector<column_header> column_headers(columns.size());
+  uint64_t offset =
+      sizeof(file_header) + columns.size() * sizeof(column_header);
+
+  for (size_t i = 0; i < columns.size(); i++) {
+    column_header &c = column_headers[i];
+    std::strncpy(c.name, columns[i].name.c_str(), sizeof(c.name) - 1);
+    c.type = columns[i].type;
+    c.offset = offset;
+    c.size = columns[i].size();
+    offset += (c.size + 7) & ~uint64_t(7);
+  }
+
+  bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+            std::fwrite(column_headers.data(), sizeof(column_header),
+                        column_headers.size(),
+                        file) == column_headers.size();
+
+  static const uint8_t padding[8] = {};
+  for (size_t i = 0; ok && i < columns.size(); i++) {
+    const column_builder &c = columns[i];
+    ok = std::fwrite(c.offsets.data(), sizeof(uint64_t), c.offsets.size(),
+                     file) == c.offsets.size() &&
+         std::fwrite(c.data.data(), 1, c.data.size(), file) == c.data.size();
+
+    size_t pad = ((c.size() + 7) & ~uint64_t(7)) - c.size();
+    ok = ok && std::fwrite(padding, 1, pad, file) == pad;
+  }
+
+  return std::fclose(file) == 0 && ok;
+}
+
+// a memory-mapped column file
+class column_file {
+public:
+  column_file() = default;
+  column_file(const column_file &) = delete;
+  column_file &operator=(const column_file &) = delete;
+
+  ~column_file() {
+    if (base != nullptr) {
+      munmap(const_cast<uint8_t *>(base), length);
+    }
+  }
+
+  // map the file. Returns false if it cannot be read or is not a column file.
+  bool open(const std::string &path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      return false;
+    }
+
+    struct stat st;
+    bool ok = fstat(fd, &st) == 0 && size_t(st.st_size) >= sizeof(file_header);
+    if (ok) {
+      length = st.st_size;
+      void *mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+      base = mapping == MAP_FAILED ? nullptr
+                                   : static_cast<const uint8_t *>(mapping);
+    }
+    ::close(fd);
+
+    if (base == nullptr) {
+      return false;
+    }
+
+    const file_header *header = reinterpret_cast<const file_header *>(base);
+    return std::memcmp(header->magic, COLUMN_FILE_MAGIC, 8) == 0 &&
+           sizeof(file_header) + header->columns * sizeof(column_header) <=
+               length;
+  }
+
+  uint64_t rows() const { return header()->rows; }
+  uint32_t column_count() const { return header()->columns; }
+
+  const column_header &column(uint32_t index) const {
+    return reinterpret_cast<const column_header *>(base +
+                                                   sizeof(file_header))[index];
+  }
+
+  // the column with the given name, nullptr if there is none
+  const column_header *find(std::string_view name) const {
+    for (uint32_t i = 0; i < column_count(); i++) {
+      if (name == column(i).name) {
+        return &column(i);
+      }
+    }
+
+    return nullptr;
+  }
+
+  // the values of a fixed-width column, nullptr if there is no such column
+  // or T does not match its width
+  template <typename T> const T *values(std::string_view name) const {
+    const column_header *c = find(name);
+    if (c == nullptr || c->type == col_string ||
+        COLUMN_WIDTH[c->type] != sizeof(T)) {
+      return nullptr;
+    }
+
+    return reinterpret_cast<const T *>(base + c->offset);
+  }
+
+  // a value of a string column
+  std::string_view string_at(const column_header &c, uint64_t row) const {
+    const uint64_t *offsets =
+        reinterpret_cast<const uint64_t *>(base + c.offset);
+    const char *bytes = reinterpret_cast<const char *>(offsets + rows() + 1);
+
+    return std::string_view(bytes + offsets[row], offsets[row + 1] - offsets[row]);
+  }
+
+private:
+  const file_header *header() const {
+    return reinterpret_cast<const file_header *>(base);
+  }
+
+  const uint8_t *base = nullptr;
+  size_t length = 0;
+};
+
+} // namespace sim
+} // namespace freedao
@@ -0,0 +1,1325 @@
+// freeosdiff - differential check of the freeos claim arithmetic: runs the
+// same action streams through the legacy implementation (the contract's
+// arithmetic before freeoseconomics.hpp and the tick-time claim quote) and
+// the contracts' host build (../host, see freeoshost.hpp), and compares the
+// table rows the legacy implementation models, and the inline actions and
+// notifications it expects, after each step.
+//
+// The steps are the parts of the contract with mixed float/double/integer
+// arithmetic and the table state they depend on:
+//
+//   iteration   the iteration changes - its iterations record is set, the
+//               clock moves to its start and tick runs: update_unvest_
+//               percentage, the claim quote and iterclear
+//   claim       the claim split, freedao multiplier tier, claim event counts,
+//               balances and the issue and transfers
+//   unvest      the unvest amount and balances
+//   stake       get_stake_requirement for the user's type and the usercount.
+//               The user transfers the legacy requirement, which the contract
+//               rejects if its own is different.
+//   reguser     the user registers
+//   rate        the freeosconfig exchangerate record is set or erased
+//   param       the 'vestpercent' or 'failsafefreq' parameter is set
+//
+// Stake, claim and unvest tick first, and stake and claim register the user
+// if need be, as in the contract. Each user has a fixed account type - its
+// eosio.proton record is written when the stream starts. A step that fails
+// in one implementation must fail in the other, and then leaves the tables as
+// they were.
+//
+// After a step, the rows of its user and the statistics, iterstats, POINT
+// stat and freeos and freedao balance rows are compared - after an iteration
+// step, every user's rows. Of the effects, the iterclear inline action and the
+// notifications of the user and freedao by freeos's transfers are compared:
+// issue and transfer are calls within freeos, so their amounts are compared
+// through the balances and supply.
+//
+// The implementations are expected to differ in two ways, which are only
+// exercised on request:
+//
+//   --midrate   the current contract fixes an iteration's vested proportion
+//               when the iteration starts, the legacy one on every claim. By
+//               default the rate and parameters only change just before an
+//               iteration step.
+//   --hostile   parameters that are not plain numbers - the legacy contract
+//               read them with std::stoi, the current one with parse_uint.
+//
+// A LAZY_UNLOCK build differs in unvest, which the legacy implementation does
+// not model.
+//
+// Random streams are run for a range of seeds, in parallel, each on its own
+// host chain. A recorded history can be run with --replay, using the actions
+// file written by replay_convert.sh (see freeosreplay.cpp).
+//
+// usage: ./freeosdiff [options] - see usage() below
+
+#include "freeoshost.hpp"
+
+#include "../common/freeoscommon.hpp"
+
+#include "freeosscript.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace freedao;
+using namespace freedao::host;
+
+static void usage(const char *program) {
+  std::printf(
+      "usage: %s [options]\n"
+      "  --seeds N          number of random streams (100)\n"
+      "  --first-seed N     the first seed (1)\n"
+      "  --steps N          steps per stream (2000)\n"
+      "  --users N          users per stream (64)\n"
+      "  --threads N        worker threads, 0 for one per core (0)\n"
+      "  --midrate          change the rate and parameters mid-iteration too\n"
+      "  --hostile          include parameter values that are not plain\n"
+      "                     numbers\n"
+      "  --replay ACTIONS   run a recorded history instead (its iterations,\n"
+      "                     rate and parameter changes, and claim, unvest,\n"
+      "                     stake and reguser actions)\n",
+      program);
+}
+
+// the freeosconfig records the legacy arithmetic reads, and the iteration by
+// the clock
+struct environment {
+  uint32_t clock_iteration = 0;
+  uint16_t claim_amount = 0;
+  uint16_t tokens_required = 0;
+  bool has_rate = false;
+  double currentprice = 0;
+  double targetprice = 0;
+  bool has_vestpercent = true;
+  std::string vestpercent;
+  bool has_failsafefreq = false;
+  std::string failsafefreq;
+  std::vector<stake_band> stakereqs;
+  int64_t max_supply = 0; // of POINT
+};
+
+// a user's rows
+struct user_state {
+  int64_t liquid = 0;
+  int64_t vested = 0;
+  int64_t stake = 0;
+  uint32_t issuances = 0;
+  uint32_t last_issuance = 0;
+  uint32_t last_unvest = 0;
+  uint32_t staked_iteration = 0;
+  char account_type = 0; // 0 until registered
+  bool registered = false;
+
+  bool operator==(const user_state &o) const {
+    return liquid == o.liquid && vested == o.vested && stake == o.stake &&
+           issuances == o.issuances && last_issuance == o.last_issuance &&
+           last_unvest == o.last_unvest &&
+           staked_iteration == o.staked_iteration &&
+           account_type == o.account_type && registered == o.registered;
+  }
+};
+
+// the modelled tables. iteration_claimevents is the claim event count of the
+// current iteration, however it is stored.
+struct tables {
+  uint32_t usercount = 0;
+  uint32_t claimevents = 0;
+  uint32_t unvestpercent = 0;
+  uint32_t unvestpercentiteration = 0;
+  uint32_t iteration = 0;
+  uint32_t failsafecounter = 0;
+  uint32_t iteration_claimevents = 0;
+  int64_t supply = 0;
+  int64_t conditional_supply = 0;
+  int64_t freeos = 0; // freeos's POINT balance, which it transfers from
+  int64_t freedao = 0;
+  std::vector<user_state> users;
+};
+
+// an inline action or a freeos::transfer/issue call of the legacy contract
+struct inline_record {
+  char action; // 'i' issue, 't' transfer, 'c' iterclear
+  uint32_t to; // user index, or UINT32_MAX for freedao or freeos
+  int64_t amount;
+};
+
+constexpr uint32_t FREEDAO = UINT32_MAX;
+constexpr uint32_t OTHER_ACCOUNT = UINT32_MAX - 1;
+
+// what a step visibly did besides its table changes
+struct effect {
+  char kind;   // 'c' iterclear, 'n' notification by freeos
+  uint32_t to; // notification: user index, FREEDAO or OTHER_ACCOUNT
+
+  bool operator==(const effect &o) const {
+    return kind == o.kind && to == o.to;
+  }
+  bool operator<(const effect &o) const {
+    return kind != o.kind ? kind < o.kind : to < o.to;
+  }
+};
+
+enum step_kind {
+  step_iteration,
+  step_claim,
+  step_unvest,
+  step_stake,
+  step_reguser,
+  step_rate,
+  step_param,
+};
+
+struct step {
+  step_kind kind;
+  uint32_t user = 0;
+  uint32_t value = 0; // iteration
+  int64_t start = 0;  // iteration: its start and end, seconds
+  int64_t end = 0;
+  uint16_t claim_amount = 0;
+  uint16_t tokens_required = 0;
+  double currentprice = 0; // rate: a targetprice of 0 erases the record
+  double targetprice = 0;
+  bool failsafefreq = false; // param: which parameter
+  std::string text;          // param: the value
+};
+
+// ---------------------------------------------------------------------------
+// the legacy arithmetic, as the contract had it
+
+namespace legacy {
+
+// std::stoi, which aborted the transaction on a bad value
+static bool stoi(const std::string &value, int &result) {
+  try {
+    result = std::stoi(value);
+    return true;
+  } catch (...) {
+    return false;
+  }
+}
+
+static bool get_vested_proportion(const environment &env, float &proportion) {
+  proportion = 0.0f;
+
+  if (env.has_rate) {
+    double currentprice = env.currentprice;
+    double targetprice = env.targetprice;
+
+    if (targetprice > 0 && currentprice < targetprice) {
+      proportion = 1.0f - (currentprice / targetprice);
+    }
+  } else if (env.has_vestpercent) {
+    int value;
+    if (!stoi(env.vestpercent, value)) {
+      return false;
+    }
+    uint8_t int_percent = value;
+    proportion = ((float)int_percent) / 100.0f;
+  }
+
+  if (proportion > 0.9f) {
+    proportion = 0.9f;
+  }
+
+  return true;
+}
+
+static double get_freedao_multiplier(uint32_t claimevents) {
+#ifdef TEST_BUILD
+  if (claimevents <= 2) {
+    return 3;
+  } else if (claimevents <= 4) {
+    return 2;
+  } else {
+    return 0.5;
+  }
+#else
+  if (claimevents <= 199) {
+    return 19;
+  } else if (claimevents <= 499) {
+    return 18;
+  } else if (claimevents <= 999) {
+    return 17;
+  } else if (claimevents <= 1999) {
+    return 16;
+  } else if (claimevents <= 2999) {
+    return 15;
+  } else if (claimevents <= 4999) {
+    return 14;
+  } else if (claimevents <= 7999) {
+    return 10;
+  } else if (claimevents <= 12999) {
+    return 6;
+  } else if (claimevents <= 20999) {
+    return 4;
+  } else if (claimevents <= 33999) {
+    return 2;
+  } else if (claimevents <= 54999) {
+    return 1.5;
+  } else {
+    return 0.07;
+  }
+#endif
+}
+
+class engine {
+public:
+  bool tick(tables &t, const environment &env, uint32_t new_iteration,
+            std::vector<inline_record> &out) {
+    // the statistics record is written by the first registration
+    if (t.usercount == 0) {
+      return false;
+    }
+
+    uint32_t previous_unvest_iteration = t.unvestpercentiteration;
+    t.iteration = new_iteration;
+
+    if (new_iteration > previous_unvest_iteration) {
+      float vested_proportion;
+      if (!get_vested_proportion(env, vested_proportion)) {
+        return false;
+      }
+
+      if (vested_proportion == 0.0f) {
+        uint32_t new_unvest_percentage;
+        switch (t.unvestpercent) {
+        case 0:
+        case 15:
+          new_unvest_percentage = 1;
+          break;
+        case 1:
+          new_unvest_percentage = 2;
+          break;
+        case 2:
+          new_unvest_percentage = 3;
+          break;
+        case 3:
+          new_unvest_percentage = 5;
+          break;
+        case 5:
+          new_unvest_percentage = 8;
+          break;
+        case 8:
+          new_unvest_percentage = 13;
+          break;
+        case 13:
+          new_unvest_percentage = 21;
+          break;
+        case 21:
+          new_unvest_percentage = 21;
+          break;
+        default:
+          new_unvest_percentage = 0;
+          break;
+        }
+        t.unvestpercent = new_unvest_percentage;
+        t.unvestpercentiteration = new_iteration;
+        t.failsafecounter = 0;
+      } else {
+        uint8_t failsafe_frequency = 24;
+        if (env.has_failsafefreq) {
+          int value;
+          if (!stoi(env.failsafefreq, value)) {
+            return false;
+          }
+          failsafe_frequency = value;
+        }
+
+        uint32_t failsafe_counter = t.failsafecounter;
+        failsafe_counter++;
+        if (failsafe_frequency == 0) {
+          return false; // integer division by zero traps in wasm
+        }
+        t.failsafecounter = failsafe_counter % failsafe_frequency;
+        t.unvestpercent = (failsafe_counter == failsafe_frequency ? 15 : 0);
+        t.unvestpercentiteration = new_iteration;
+      }
+
+      t.iteration_claimevents = 0;
+    }
+
+    if (new_iteration != 0) {
+      out.push_back({'c', new_iteration - 1, 0});
+    }
+    return true;
+  }
+
+  // register_user - nothing to do if the user is registered already
+  void register_user(tables &t, const environment &env, user_state &u,
+                     char account_type) {
+    if (u.registered) {
+      return;
+    }
+
+    t.usercount++;
+    u.registered = true;
+    u.account_type = account_type;
+    if (stake_requirement(t.usercount, env, account_type) == 0) {
+      u.staked_iteration = env.clock_iteration;
+    }
+  }
+
+  bool claim(tables &t, const environment &env, user_state &u,
+             std::vector<inline_record> &out, uint32_t user) {
+    if (u.last_issuance == t.iteration || u.staked_iteration == 0 ||
+        u.liquid + u.vested < env.tokens_required * 10000) {
+      return false;
+    }
+
+    t.claimevents++;
+    uint32_t iteration_claim_event_count = ++t.iteration_claimevents;
+
+    double freedao_multiplier =
+        get_freedao_multiplier(iteration_claim_event_count);
+    float vested_proportion;
+    if (!get_vested_proportion(env, vested_proportion)) {
+      return false;
+    }
+
+    uint16_t claim_tokens = env.claim_amount;
+    uint16_t vested_tokens = claim_tokens * vested_proportion;
+    uint16_t liquid_tokens = claim_tokens - vested_tokens;
+    uint16_t freedao_tokens = claim_tokens * freedao_multiplier;
+    uint16_t minted_tokens = liquid_tokens + freedao_tokens;
+
+    t.conditional_supply += minted_tokens * 10000;
+    if (minted_tokens * 10000 > 0 &&
+        !issue(t, env, out, minted_tokens * 10000)) {
+      return false;
+    }
+    if (liquid_tokens * 10000 > 0 &&
+        !transfer(t, out, user, u.liquid, liquid_tokens * 10000)) {
+      return false;
+    }
+    if (freedao_tokens * 10000 > 0 &&
+        !transfer(t, out, FREEDAO, t.freedao, freedao_tokens * 10000)) {
+      return false;
+    }
+    if (vested_tokens > 0) {
+      u.vested += vested_tokens * 10000;
+    }
+
+    u.issuances += 1;
+    u.last_issuance = t.iteration;
+    return true;
+  }
+
+  bool unvest(tables &t, const environment &env, user_state &u,
+              std::vector<inline_record> &out, uint32_t user) {
+    uint32_t unvest_percent = t.unvestpercent;
+    if (t.iteration == 0 || !(unvest_percent > 0 && unvest_percent <= 100) ||
+        u.last_unvest == t.iteration) {
+      return false;
+    }
+    if (u.vested == 0) {
+      return true;
+    }
+
+    uint64_t vested_units = u.vested;
+    double percentage = unvest_percent / 100.0;
+    uint64_t converted_units = vested_units * percentage;
+    uint32_t rounded_up_options = (uint32_t)ceil(converted_units / 10000.0);
+    int64_t converted = rounded_up_options * 10000LL;
+
+    t.conditional_supply += converted;
+    if (converted > 0 && (!issue(t, env, out, converted) ||
+                          !transfer(t, out, user, u.liquid, converted))) {
+      return false;
+    }
+    u.vested -= converted;
+    u.last_unvest = t.iteration;
+    return true;
+  }
+
+  // freeos::issue to freeos, which checks the maximum supply
+  bool issue(tables &t, const environment &env,
+             std::vector<inline_record> &out, int64_t amount) {
+    if (amount > env.max_supply - t.supply) {
+      return false;
+    }
+    out.push_back({'i', FREEDAO, amount});
+    t.supply += amount;
+    t.freeos += amount;
+    return true;
+  }
+
+  // freeos::transfer from freeos, which checks its balance - a claim's
+  // uint16_t amounts can wrap, so that it transfers more than it issued
+  bool transfer(tables &t, std::vector<inline_record> &out, uint32_t to,
+                int64_t &balance, int64_t amount) {
+    if (amount > t.freeos) {
+      return false;
+    }
+    out.push_back({'t', to, amount});
+    t.freeos -= amount;
+    balance += amount;
+    return true;
+  }
+
+  uint32_t stake_requirement(uint32_t usercount, const environment &env,
+                             char account_type) {
+    const stake_band *band = &env.stakereqs.front();
+    for (const stake_band &b : env.stakereqs) {
+      if (b.threshold <= usercount) {
+        band = &b;
+      }
+    }
+
+    uint32_t stake_requirement = 0;
+    if (account_type == 'v') {
+      stake_requirement = band->requirement_v;
+    } else if (account_type == 'd') {
+      stake_requirement = band->requirement_d;
+    } else {
+      stake_requirement = band->requirement_e;
+    }
+    return stake_requirement;
+  }
+};
+
+} // namespace legacy
+
+// ---------------------------------------------------------------------------
+
+static const eosio::name ticker("ticker");
+
+// one stream through the legacy implementation and a host chain
+class differ {
+public:
+  differ(const std::vector<eosio::name> &users,
+         const std::vector<char> &account_types);
+
+  // apply a step to both. Returns false, with the differences in report, if
+  // they disagree.
+  bool apply(const step &s, std::string &report);
+
+private:
+  bool run_legacy(const step &s, uint32_t stake,
+                  std::vector<inline_record> &out);
+  bool run_chain(const step &s, uint32_t stake, std::vector<effect> &out,
+                 std::string &error);
+  void set_config(const step &s);
+  void read_chain(tables &t) const;
+  user_state read_user(uint32_t user) const;
+  std::vector<effect> legacy_effects() const;
+  void compare(std::string &report, bool ok_a, bool ok_b,
+               const std::string &error);
+
+  chain c;
+  environment env;
+  legacy::engine legacy_engine;
+  std::vector<eosio::name> users;
+  std::vector<char> account_types;
+  std::unordered_map<uint64_t, uint32_t> user_index;
+  tables a; // legacy
+  tables b; // the chain's rows
+  std::vector<inline_record> out_a;
+  std::vector<effect> out_b;
+};
+
+differ::differ(const std::vector<eosio::name> &users,
+               const std::vector<char> &account_types)
+    : users(users), account_types(account_types) {
+  // no iterations - the iteration steps add them
+  system_config config;
+  config.iterations = 0;
+  bootstrap_freeos(c, config);
+
+  env.vestpercent = std::to_string(config.vest_percent);
+  env.stakereqs = config.stake_bands;
+  auto stat = c.get_row<currency_stats>(
+      freeos_account(), point_symbol().code().raw(), eosio::name("stat"),
+      point_symbol().code().raw());
+  env.max_supply = stat->max_supply.amount;
+
+  // a 'v' account has a KYC entry with its names, a 'd' account a record
+  // without one, and an 'e' account no record
+  for (uint32_t i = 0; i < users.size(); i++) {
+    if (account_types[i] == 'v') {
+      set_verification(c, users[i], {"firstname,lastname"});
+    } else if (account_types[i] == 'd') {
+      set_verification(c, users[i], {});
+    } else {
+      c.create_account(users[i]);
+    }
+    user_index[users[i].value] = i;
+  }
+  c.create_account(ticker);
+
+  a.users.resize(users.size());
+  b.users.resize(users.size());
+}
+
+bool differ::run_legacy(const step &s, uint32_t stake,
+                        std::vector<inline_record> &out) {
+  tables before = a;
+  bool ok = true;
+  out.clear();
+
+  // stake, claim and unvest tick first, as cron does - so an iteration
+  // change that failed is retried by each of them
+  if (s.kind == step_iteration ||
+      (s.kind != step_reguser && a.iteration != env.clock_iteration)) {
+    ok = legacy_engine.tick(a, env, env.clock_iteration, out);
+  }
+
+  user_state &u = a.users[s.user];
+  switch (ok ? s.kind : step_iteration) {
+  case step_iteration:
+  case step_rate:
+  case step_param:
+    break;
+  case step_claim:
+    ok = a.iteration != 0;
+    if (ok) {
+      legacy_engine.register_user(a, env, u, account_types[s.user]);
+      ok = legacy_engine.claim(a, env, u, out, s.user);
+    }
+    break;
+  case step_unvest:
+    ok = legacy_engine.unvest(a, env, u, out, s.user);
+    break;
+  case step_stake:
+    ok = a.iteration != 0;
+    if (ok) {
+      legacy_engine.register_user(a, env, u, account_types[s.user]);
+      uint32_t requirement =
+          legacy_engine.stake_requirement(a.usercount, env, u.account_type);
+      // a transfer must be of a positive quantity
+      ok = u.staked_iteration == 0 && requirement == stake && stake > 0;
+    }
+    if (ok) {
+      u.stake = stake * SYSTEM_CURRENCY_UNITS;
+      u.staked_iteration = a.iteration;
+    }
+    break;
+  case step_reguser:
+    // registering a registered user does nothing
+    ok = env.clock_iteration != 0;
+    if (ok) {
+      legacy_engine.register_user(a, env, u, account_types[s.user]);
+    }
+    break;
+  }
+
+  if (!ok) {
+    a = before;
+    out.clear();
+  }
+  return ok;
+}
+
+bool differ::run_chain(const step &s, uint32_t stake,
+                       std::vector<effect> &out, std::string &error) {
+  const eosio::name freeos = freeos_account();
+  const eosio::name freeosconfig = freeosconfig_account();
+  const eosio::name user = users[s.user];
+  transaction_trace trace;
+  out.clear();
+
+  switch (s.kind) {
+  case step_iteration: {
+    eosio::time_point start{eosio::seconds(s.start)};
+    expect_success(c.push(freeosconfig, eosio::name("iterupsert"),
+                          freeosconfig, s.value, start,
+                          eosio::time_point(eosio::seconds(s.end)),
+                          s.claim_amount, s.tokens_required));
+    c.set_time(start);
+    trace = c.push(freeos, eosio::name("tick"), ticker);
+    break;
+  }
+  case step_claim:
+  case step_unvest:
+  case step_reguser: {
+    static const char *const ACTIONS[] = {"", "claim", "unvest", "",
+                                          "reguser"};
+    trace = c.push(freeos, eosio::name(ACTIONS[s.kind]), user, user);
+    break;
+  }
+  case step_stake: {
+    eosio::asset quantity(stake * SYSTEM_CURRENCY_UNITS, system_symbol());
+    if (stake > 0) {
+      fund_user(c, user, quantity);
+    }
+    trace = c.push(system_token_account(), eosio::name("transfer"), user,
+                   user, freeos, quantity, std::string("freeos stake"));
+    break;
+  }
+  case step_rate:
+  case step_param:
+    return true;
+  }
+
+  error = trace.error;
+  if (!trace.succeeded) {
+    return false;
+  }
+
+  for (const action_trace &t : trace.actions) {
+    if (t.account == freeosconfig && t.receiver == freeosconfig &&
+        t.action == eosio::name("iterclear")) {
+      out.push_back({'c', 0});
+    } else if (t.account == freeos && t.receiver != freeos) {
+      auto i = user_index.find(t.receiver.value);
+      out.push_back({'n', i != user_index.end() ? i->second
+                          : t.receiver == freedao_account() ? FREEDAO
+                                                            : OTHER_ACCOUNT});
+    }
+  }
+  std::sort(out.begin(), out.end());
+  out.erase(std::unique(out.begin(), out.end()), out.end());
+  return true;
+}
+
+// what the legacy calls would show on chain: its iterclear, and a
+// notification of each account freeos transfers to
+std::vector<effect> differ::legacy_effects() const {
+  std::vector<effect> effects;
+  for (const inline_record &r : out_a) {
+    if (r.action == 'c') {
+      effects.push_back({'c', 0});
+    } else if (r.action == 't') {
+      effects.push_back({'n', r.to});
+    }
+  }
+  std::sort(effects.begin(), effects.end());
+  effects.erase(std::unique(effects.begin(), effects.end()), effects.end());
+  return effects;
+}
+
+// set the freeosconfig records of a rate or param step
+void differ::set_config(const step &s) {
+  const eosio::name freeosconfig = freeosconfig_account();
+
+  if (s.kind == step_param) {
+    expect_success(c.push(freeosconfig, eosio::name("paramupsert"),
+                          freeosconfig, eosio::name(),
+                          eosio::name(s.failsafefreq ? "failsafefreq"
+                                                     : "vestpercent"),
+                          s.text));
+    (s.failsafefreq ? env.has_failsafefreq : env.has_vestpercent) = true;
+    (s.failsafefreq ? env.failsafefreq : env.vestpercent) = s.text;
+    return;
+  }
+
+  if (s.targetprice == 0) {
+    if (env.has_rate) {
+      expect_success(c.push(freeosconfig, eosio::name("rateerase"),
+                            freeosconfig));
+    }
+  } else {
+    expect_success(c.push_transaction(
+        {chain::make_action(freeosconfig, eosio::name("targetrate"),
+                            freeosconfig, s.targetprice),
+         chain::make_action(freeosconfig, eosio::name("currentrate"),
+                            freeosconfig, s.currentprice)}));
+  }
+
+  // the record as written - targetrate has a floor
+  auto rate = c.get_row<price>(freeosconfig, freeosconfig.value,
+                               eosio::name("exchangerate"), 0);
+  env.has_rate = rate.has_value();
+  env.currentprice = rate ? rate->currentprice : 0;
+  env.targetprice = rate ? rate->targetprice : 0;
+}
+
+// the chain's rows of the tables other than the users'
+void differ::read_chain(tables &t) const {
+  const eosio::name freeos = freeos_account();
+  const uint64_t point = point_symbol().code().raw();
+
+  auto statistics =
+      c.get_row<statistic>(freeos, freeos.value, eosio::name("statistics"), 0);
+  if (statistics) {
+    t.usercount = statistics->usercount;
+    t.claimevents = statistics->claimevents;
+    t.unvestpercent = statistics->unvestpercent;
+    t.unvestpercentiteration = statistics->unvestpercentiteration;
+    t.iteration = statistics->iteration;
+    t.failsafecounter = statistics->failsafecounter;
+  }
+
+  // the count is the current iteration's if it is tagged with it
+  auto iterstats =
+      c.get_row<iterstat>(freeos, freeos.value, eosio::name("iterstats"), 0);
+  t.iteration_claimevents = iterstats && iterstats->iteration.has_value() &&
+                                    iterstats->iteration.value() == t.iteration
+                                ? iterstats->claimevents
+                                : 0;
+
+  auto stat = c.get_row<currency_stats>(freeos, point, eosio::name("stat"),
+                                        point);
+  t.supply = stat->supply.amount;
+  t.conditional_supply = stat->conditional_supply.amount;
+
+  auto own = c.get_row<account>(freeos, freeos.value, eosio::name("accounts"),
+                                point);
+  t.freeos = own ? own->balance.amount : 0;
+  auto freedao = c.get_row<account>(freeos, freedao_account().value,
+                                    eosio::name("accounts"), point);
+  t.freedao = freedao ? freedao->balance.amount : 0;
+}
+
+user_state differ::read_user(uint32_t i) const {
+  const eosio::name freeos = freeos_account();
+  const uint64_t scope = users[i].value;
+  const uint64_t point = point_symbol().code().raw();
+  user_state u;
+
+  if (auto liquid =
+          c.get_row<account>(freeos, scope, eosio::name("accounts"), point)) {
+    u.liquid = liquid->balance.amount;
+  }
+  if (auto vested = c.get_row<vestaccount>(
+          freeos, scope, eosio::name("vestaccounts"), point)) {
+    u.vested = vested->balance.amount;
+  }
+  if (auto record = c.get_row<freedao::user>(
+          freeos, scope, eosio::name("users"), system_symbol().code().raw())) {
+    u.registered = true;
+    u.account_type = record->account_type;
+    u.stake = record->stake.amount;
+    u.issuances = record->issuances;
+    u.last_issuance = record->last_issuance;
+    u.staked_iteration = record->staked_iteration;
+  }
+  if (auto unvest =
+          c.get_row<unvestevent>(freeos, scope, eosio::name("unvests"), 0)) {
+    u.last_unvest = unvest->iteration_number;
+  }
+  return u;
+}
+
+#define COMPARE(field)                                                       \
+  if (a.field != b.field) {                                                  \
+    report += " " #field "=" + std::to_string(a.field) + "/" +               \
+              std::to_string(b.field);                                       \
+  }
+
+void differ::compare(std::string &report, bool ok_a, bool ok_b,
+                     const std::string &error) {
+  if (ok_a != ok_b) {
+    report += std::string(" ok=") + (ok_a ? "yes" : "no") + "/" +
+              (ok_b ? "yes" : "no");
+    if (!ok_b) {
+      report += " (" + error + ")";
+    }
+  }
+
+  COMPARE(usercount)
+  COMPARE(claimevents)
+  COMPARE(unvestpercent)
+  COMPARE(unvestpercentiteration)
+  COMPARE(iteration)
+  COMPARE(failsafecounter)
+  COMPARE(iteration_claimevents)
+  COMPARE(supply)
+  COMPARE(conditional_supply)
+  COMPARE(freeos)
+  COMPARE(freedao)
+
+  for (size_t i = 0; i < a.users.size(); i++) {
+    if (!(a.users[i] == b.users[i])) {
+      report += " user" + std::to_string(i) + ".liquid=" +
+                std::to_string(a.users[i].liquid) + "/" +
+                std::to_string(b.users[i].liquid) + " vested=" +
+                std::to_string(a.users[i].vested) + "/" +
+                std::to_string(b.users[i].vested) + " stake=" +
+                std::to_string(a.users[i].stake) + "/" +
+                std::to_string(b.users[i].stake);
+    }
+  }
+
+  std::vector<effect> effects_a = legacy_effects();
+  if (!(effects_a == out_b)) {
+    report += " effects differ (" + std::to_string(effects_a.size()) + "/" +
+              std::to_string(out_b.size()) + ")";
+  }
+}
+
+bool differ::apply(const step &s, std::string &report) {
+  report.clear();
+  if (s.kind == step_rate || s.kind == step_param) {
+    set_config(s);
+    return true;
+  }
+  if (s.kind == step_iteration) {
+    env.clock_iteration = s.value;
+    env.claim_amount = s.claim_amount;
+    env.tokens_required = s.tokens_required;
+  }
+
+  // the stake the user transfers - the legacy requirement, for the usercount
+  // after the stake has registered the user
+  uint32_t stake = 0;
+  if (s.kind == step_stake) {
+    const user_state &u = a.users[s.user];
+    stake = legacy_engine.stake_requirement(
+        a.usercount + !u.registered, env,
+        u.registered ? u.account_type : account_types[s.user]);
+  }
+
+  std::string error;
+  bool ok_a = run_legacy(s, stake, out_a);
+  bool ok_b = run_chain(s, stake, out_b, error);
+
+  read_chain(b);
+  if (s.kind == step_iteration) {
+    for (uint32_t i = 0; i < users.size(); i++) {
+      b.users[i] = read_user(i);
+    }
+  } else {
+    b.users[s.user] = read_user(s.user);
+  }
+
+  compare(report, ok_a, ok_b, error);
+  return report.empty();
+}
+
+static std::string describe(const step &s) {
+  static const char *const NAMES[] = {"iteration", "claim", "unvest", "stake",
+                                      "reguser",   "rate",  "param"};
+  std::ostringstream text;
+  text << NAMES[s.kind];
+  switch (s.kind) {
+  case step_iteration:
+    text << " " << s.value << " claim_amount=" << s.claim_amount
+         << " tokens_required=" << s.tokens_required;
+    break;
+  case step_rate:
+    text << " current=" << s.currentprice << " target=" << s.targetprice;
+    break;
+  case step_param:
+    text << (s.failsafefreq ? " failsafefreq=" : " vestpercent=") << "'"
+         << s.text << "'";
+    break;
+  default:
+    text << " user" << s.user;
+  }
+  return text.str();
+}
+
+// parameter values. Those after the first NUMERIC_VALUES are text that
+// std::stoi and parse_uint read differently - e.g. stoi reads "-5" as 251 and
+// rejects "99999999999" - so they are only used with --hostile.
+constexpr size_t NUMERIC_VALUES = 11;
+static const char *const PARAM_VALUES[] = {
+    "0",   "1",  "24", "50", "90", "100", "255", "256",        "300",
+    " 7",  "08", "12a", "",  "abc", "-5", "+9",  "99999999999"};
+
+struct stream_options {
+  uint32_t users = 64;
+  bool midrate = false;
+  bool hostile = false;
+};
+
+// the start of the random streams' iteration 1, and the iteration length
+constexpr int64_t STREAM_START = 1640995200; // 2022-01-01
+constexpr int64_t ITERATION_SECONDS = 7 * 24 * 3600;
+
+// true with probability p
+static bool chance(std::mt19937_64 &random, double p) {
+  return (random() >> 11) * 0x1.0p-53 < p;
+}
+
+// true if the contract reads a 'failsafefreq' value as a frequency of 0 - its
+// division by zero traps in wasm, but would stop the host process, so random
+// streams do not set it
+static bool zero_frequency(const std::string &text) {
+  size_t pos = text.find_first_not_of(' ');
+  uint32_t value = 0;
+  bool digits = false;
+  for (; pos < text.size() && text[pos] >= '0' && text[pos] <= '9'; pos++) {
+    value = value * 10 + (text[pos] - '0');
+    digits = true;
+  }
+  return digits && uint8_t(value) == 0;
+}
+
+// a random exchange rate or parameter change. The current rate must be
+// positive.
+static step random_config_step(std::mt19937_64 &random,
+                               const stream_options &options) {
+  step s;
+  if (chance(random, 0.6)) {
+    s.kind = step_rate;
+    s.targetprice = chance(random, 0.2) ? 0 : (random() % 2000) / 1000.0;
+    s.currentprice = (1 + random() % 2000) / 1000.0;
+  } else {
+    size_t values = options.hostile
+                        ? sizeof(PARAM_VALUES) / sizeof(PARAM_VALUES[0])
+                        : NUMERIC_VALUES;
+    s.kind = step_param;
+    s.failsafefreq = chance(random, 0.5);
+    do {
+      s.text = PARAM_VALUES[random() % values];
+    } while (s.failsafefreq && zero_frequency(s.text));
+  }
+  return s;
+}
+
+// a random step. Rate and parameter changes come just before an iteration
+// step, unless options.midrate is set.
+static step random_step(std::mt19937_64 &random, const stream_options &options,
+                        uint32_t &iteration, bool &iteration_next) {
+  step s;
+  uint64_t r = random() % 1000;
+
+  if (iteration_next || iteration == 0) {
+    if (r < 450) {
+      iteration_next = true;
+      return random_config_step(random, options);
+    }
+    iteration_next = false;
+    s.kind = step_iteration;
+    s.value = ++iteration;
+    s.start = STREAM_START + (iteration - 1) * ITERATION_SECONDS;
+    s.end = s.start + ITERATION_SECONDS - 1;
+    s.claim_amount =
+        chance(random, 0.1) ? random() % 65536 : random() % 1000;
+    s.tokens_required = chance(random, 0.5) ? 0 : random() % 200;
+    return s;
+  }
+
+  s.user = random() % options.users;
+  if (r < 30) {
+    iteration_next = true;
+    return random_step(random, options, iteration, iteration_next);
+  } else if (options.midrate && r < 60) {
+    return random_config_step(random, options);
+  } else if (r < 120) {
+    s.kind = step_reguser;
+  } else if (r < 220) {
+    s.kind = step_stake;
+  } else if (r < 400) {
+    s.kind = step_unvest;
+  } else {
+    s.kind = step_claim;
+  }
+  return s;
+}
+
+// the users of a random stream - useraaaa, useraaab, ... - with the account
+// types in turn
+static void stream_users(uint32_t count, std::vector<eosio::name> &users,
+                         std::vector<char> &account_types) {
+  for (uint32_t i = 0; i < count; i++) {
+    std::string name = "user";
+    for (uint32_t n = i, digit = 0; digit < 4; digit++, n /= 26) {
+      name.insert(name.begin() + 4, char('a' + n % 26));
+    }
+    users.push_back(eosio::name(name));
+    account_types.push_back("vde"[i % 3]);
+  }
+}
+
+// the account type a user's KYC entries give it - see get_account_type
+static char account_type_of(const std::map<std::string, std::string> *kyc) {
+  if (kyc == nullptr) {
+    return 'e';
+  }
+  for (const auto &[provider, level] : *kyc) {
+    if (level.find("firstname") != std::string::npos &&
+        level.find("lastname") != std::string::npos) {
+      return 'v';
+    }
+  }
+  return 'd';
+}
+
+// a recorded history as steps. Each user has the account type the
+// verification contract's actions gave it by its first step.
+static bool read_replay(const char *actions_path, std::vector<step> &steps,
+                        std::vector<eosio::name> &users,
+                        std::vector<char> &account_types) {
+  struct replay_iteration {
+    uint32_t number;
+    int64_t start, end;
+    uint16_t claim_amount, tokens_required;
+  };
+  std::vector<replay_iteration> iterations;
+
+  std::ifstream actions_file(actions_path);
+  if (!actions_file) {
+    return false;
+  }
+
+  // the KYC entries of the accounts with a usersinfo record, by provider
+  std::map<std::string, std::map<std::string, std::string>> usersinfo_records;
+  std::unordered_map<std::string, uint32_t> accounts;
+  uint32_t iteration = 0;
+  double currentprice = 0;
+  double targetprice = 0;
+  std::string line;
+
+  // a bad number stops the read
+  try {
+    while (std::getline(actions_file, line)) {
+      // <time> <contract> <action> <actors> <cpu_us> <field> ...
+      std::vector<std::string> words = script::split(line);
+      int64_t time;
+      if (words.size() < 5 || !script::parse_time(words[0], time)) {
+        continue;
+      }
+      const std::string &contract = words[1];
+      const std::string &action = words[2];
+      auto field = [&](size_t i) {
+        size_t colon = i + 5 < words.size() ? words[i + 5].find(':')
+                                            : std::string::npos;
+        return colon == std::string::npos ? std::string()
+                                          : words[i + 5].substr(colon + 1);
+      };
+
+      if (contract == verification_account().to_string()) {
+        if (action == "addkyc" || action == "updatekyc") {
+          usersinfo_records[field(0)][field(1)] = field(2);
+        } else if (action == "removekyc") {
+          auto record = usersinfo_records.find(field(0));
+          if (record != usersinfo_records.end()) {
+            record->second.erase(field(1));
+          }
+        } else if (action == "remove") {
+          usersinfo_records.erase(field(0));
+        } else {
+          usersinfo_records[field(0)];
+        }
+        continue;
+      }
+
+      step s;
+      std::string account = field(0);
+      if (contract == freeosconfig_account().to_string()) {
+        if (action == "iterupsert") {
+          int64_t start, end;
+          if (!script::parse_time(field(1), start) ||
+              !script::parse_time(field(2), end)) {
+            return false;
+          }
+          replay_iteration i = {uint32_t(std::stoul(field(0))), start, end,
+                                uint16_t(std::stoul(field(3))),
+                                uint16_t(std::stoul(field(4)))};
+          iterations.erase(std::remove_if(iterations.begin(), iterations.end(),
+                                          [&](const replay_iteration &it) {
+                                            return it.number == i.number;
+                                          }),
+                           iterations.end());
+          iterations.push_back(i);
+          continue;
+        }
+        if (action == "currentrate" || action == "targetrate" ||
+            action == "rateerase") {
+          (action == "currentrate" ? currentprice : targetprice) =
+              action == "rateerase" ? 0 : std::stod(field(0));
+          if (currentprice <= 0) {
+            continue; // the legacy arithmetic needs a current rate
+          }
+          s.kind = step_rate;
+          s.currentprice = currentprice;
+          s.targetprice = targetprice;
+        } else if (action == "paramupsert" &&
+                   (field(1) == "vestpercent" || field(1) == "failsafefreq")) {
+          s.kind = step_param;
+          s.failsafefreq = field(1) == "failsafefreq";
+          s.text = field(2);
+        } else {
+          continue;
+        }
+      } else if (contract == freeos_account().to_string() &&
+                 action == "claim") {
+        s.kind = step_claim;
+      } else if (contract == freeos_account().to_string() &&
+                 action == "unvest") {
+        s.kind = step_unvest;
+      } else if (contract == freeos_account().to_string() &&
+                 action == "reguser") {
+        s.kind = step_reguser;
+      } else if (contract == system_token_account().to_string() &&
+                 action == "transfer") {
+        s.kind = step_stake; // from, to, quantity, memo
+      } else {
+        continue;
+      }
+
+      const replay_iteration *current = nullptr;
+      for (const replay_iteration &it : iterations) {
+        if (time >= it.start && time <= it.end) {
+          current = &it;
+        }
+      }
+      if (current != nullptr && current->number != iteration) {
+        step next;
+        next.kind = step_iteration;
+        next.value = iteration = current->number;
+        next.start = current->start;
+        next.end = current->end;
+        next.claim_amount = current->claim_amount;
+        next.tokens_required = current->tokens_required;
+        steps.push_back(next);
+      }
+
+      if (s.kind != step_rate && s.kind != step_param) {
+        auto [user, added] = accounts.try_emplace(account, accounts.size());
+        if (added) {
+          auto record = usersinfo_records.find(account);
+          users.push_back(eosio::name(account));
+          account_types.push_back(account_type_of(
+              record == usersinfo_records.end() ? nullptr : &record->second));
+        }
+        s.user = user->second;
+      }
+      steps.push_back(s);
+    }
+
+  } catch (const std::logic_error &) {
+    return false;
+  }
+
+  return true;
+}
+
+int main(int argc, char *argv[]) {
+  uint64_t seeds = 100;
+  uint64_t first_seed = 1;
+  uint64_t steps_per_stream = 2000;
+  stream_options options;
+  unsigned threads = 0;
+  const char *replay_actions = nullptr;
+
+  for (int i = 1; i < argc; i++) {
+    std::string option = argv[i];
+    if (option == "--midrate") {
+      options.midrate = true;
+      continue;
+    }
+    if (option == "--hostile") {
+      options.hostile = true;
+      continue;
+    }
+    if (option == "--replay" && i + 1 < argc) {
+      replay_actions = argv[++i];
+      continue;
+    }
+    if (i + 1 >= argc) {
+      usage(argv[0]);
+      return 1;
+    }
+    const char *value = argv[++i];
+
+    if (option == "--seeds") {
+      seeds = std::strtoull(value, nullptr, 10);
+    } else if (option == "--first-seed") {
+      first_seed = std::strtoull(value, nullptr, 10);
+    } else if (option == "--steps") {
+      steps_per_stream = std::strtoull(value, nullptr, 10);
+    } else if (option == "--users") {
+      options.users = std::max(1ul, std::strtoul(value, nullptr, 10));
+    } else if (option == "--threads") {
+      threads = std::strtoul(value, nullptr, 10);
+    } else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  if (replay_actions != nullptr) {
+    std::vector<step> steps;
+    std::vector<eosio::name> users;
+    std::vector<char> account_types;
+    try {
+      if (!read_replay(replay_actions, steps, users, account_types)) {
+        std::fprintf(stderr, "cannot read the replay file\n");
+        return 1;
+      }
+
+      differ d(users, account_types);
+      std::string report;
+      for (size_t i = 0; i < steps.size(); i++) {
+        if (!d.apply(steps[i], report)) {
+          std::printf("DIVERGES at step %zu, %s:%s\n", i,
+                      describe(steps[i]).c_str(), report.c_str());
+          return 2;
+        }
+      }
+    } catch (const eosio::check_failure &e) {
+      std::fprintf(stderr, "setup failed: %s\n", e.what());
+      return 1;
+    }
+    std::printf("%zu steps, no differences\n", steps.size());
+    return 0;
+  }
+
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  std::vector<eosio::name> users;
+  std::vector<char> account_types;
+  stream_users(options.users, users, account_types);
+
+  std::atomic<uint64_t> next_seed{0};
+  std::atomic<uint64_t> diverged{0};
+  std::mutex output;
+  auto started = std::chrono::steady_clock::now();
+
+  std::vector<std::thread> pool;
+  for (unsigned t = 0; t < threads; t++) {
+    pool.emplace_back([&] {
+      std::string report;
+      for (uint64_t n; (n = next_seed++) < seeds;) {
+        uint64_t seed = first_seed + n;
+        std::mt19937_64 random(seed);
+        uint32_t iteration = 0;
+        bool iteration_next = false;
+
+        try {
+          differ d(users, account_types);
+          for (uint64_t i = 0; i < steps_per_stream; i++) {
+            step s = random_step(random, options, iteration, iteration_next);
+            if (!d.apply(s, report)) {
+              std::lock_guard<std::mutex> lock(output);
+              std::printf("seed %llu DIVERGES at step %llu, %s:%s\n",
+                          (unsigned long long)seed, (unsigned long long)i,
+                          describe(s).c_str(), report.c_str());
+              diverged++;
+              break;
+            }
+          }
+        } catch (const eosio::check_failure &e) {
+          std::lock_guard<std::mutex> lock(output);
+          std::printf("seed %llu: setup failed: %s\n",
+                      (unsigned long long)seed, e.what());
+          diverged++;
+        }
+      }
+    });
+  }
+  for (std::thread &t : pool) {
+    t.join();
+  }
+
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - started)
+                       .count();
+  std::printf("%llu seeds x %llu steps on %u threads in %.2f s (%.0f steps/s): "
+              "%llu diverged\n",
+              (unsigned long long)seeds, (unsigned long long)steps_per_stream,
+              threads, seconds, seeds * steps_per_stream / seconds,
+              (unsigned long long)diverged.load());
+
+  return diverged == 0 ? 0 : 2;
+}
@@ -0,0 +1,447 @@
+// freeosecon - Monte Carlo simulation of the freeos economics: vesting,
+// unvesting and supply over many iterations, many users and many exchange
+// rate paths.
+//
+// Where freeossim runs each action on the host build of the contracts,
+// freeosecon only models the balances, so that years of iterations can be run
+// for millions of users under hundreds of exchange rate paths. Every user is registered, staked and
+// meets the holding requirement; the claim and unvest decisions are random,
+// per user and per iteration. Each path is a geometric random walk of the
+// exchange rate (one step per iteration) and its iterations run as the
+// contract's do:
+//
+//   1. tick - the vested proportion comes from the rate (get_vested_proportion)
+//      and the unvest percentage steps through the Fibonacci percentages when
+//      it is 0, or the failsafe when it is not (update_unvest_percentage)
+//   2. claim - each claiming user gets the iteration's vested and liquid
+//      tokens; freedao gets claim_amount times the multiplier of each claim
+//      event's tier (get_freedao_multiplier)
+//   3. unvest - each unvesting user releases unvestpercent of their vested
+//      balance, rounded up to a whole POINT
+//
+// using the freeoseconomics.hpp functions. The users' balances are held as
+// arrays (one per field, not one struct per user) and updated by branch-free
+// kernels that the compiler vectorizes at -O3 (the unvest kernel's division
+// by POINT_UNITS does not vectorize, but still runs without branches); the
+// paths are spread over the worker threads.
+//
+// The output is the 5th, 50th and 95th percentile over the paths of the POINT
+// supply, conditional supply and vested total after each iteration (and the
+// rate and unvest percentage), every --every iterations, and optionally every
+// iteration to a CSV file.
+//
+// usage: ./freeosecon [options] - see usage() below
+
+#include "freeossim.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+using namespace freedao;
+using namespace freedao::sim;
+
+static void usage(const char *program) {
+  std::printf(
+      "usage: %s [options]\n"
+      "  --users N          number of users (1000000)\n"
+      "  --iterations N     number of iterations (520)\n"
+      "  --paths N          number of exchange rate paths (64)\n"
+      "  --threads N        worker threads, 0 for one per core (0)\n"
+      "  --seed N           random seed (1)\n"
+      "  --claim N          iteration claim amount, POINTs (100)\n"
+      "  --failsafe N       'failsafefreq' parameter (24)\n"
+      "  --price P          starting currentprice (1.0)\n"
+      "  --target P         targetprice (1.0)\n"
+      "  --drift D          mean log change of the rate per iteration (0)\n"
+      "  --volatility V     standard deviation of the log change (0.05)\n"
+      "  --premint N        POINTs issued outside the conditional supply (0)\n"
+      "  --p-claim P        probability of claiming each iteration (0.85)\n"
+      "  --p-unvest P       probability of unvesting each iteration (0.3)\n"
+      "  --every N          print every Nth iteration (52)\n"
+      "  --csv FILE         write every iteration to FILE\n",
+      program);
+}
+
+struct econ_config {
+  uint64_t users = 1000000;
+  uint32_t iterations = 520;
+  uint32_t paths = 64;
+  unsigned threads = 0;
+  uint64_t seed = 1;
+  uint16_t claim_amount = 100;
+  uint8_t failsafe_frequency = 24;
+  double price = 1.0;
+  double target = 1.0;
+  double drift = 0.0;
+  double volatility = 0.05;
+  int64_t premint = 0;
+  double p_claim = 0.85;
+  double p_unvest = 0.3;
+  uint32_t every = 52;
+};
+
+// one path's results after one iteration
+struct iteration_result {
+  double price;
+  uint32_t unvestpercent;
+  int64_t supply;
+  int64_t conditional_supply;
+  int64_t vested;
+  int64_t freedao;
+};
+
+// the users' balances, one array per field
+struct population {
+  std::vector<int64_t> liquid;
+  std::vector<int64_t> vested;
+
+  explicit population(uint64_t users) : liquid(users), vested(users) {}
+
+  void clear() {
+    std::fill(liquid.begin(), liquid.end(), 0);
+    std::fill(vested.begin(), vested.end(), 0);
+  }
+};
+
+// a counter-based random number for user i, so that every lane of a kernel
+// computes its own. 32 bits (the lowbias32 hash of key + i), as 64-bit
+// multiplies do not vectorize without AVX-512.
+static inline uint32_t lane_random(uint32_t key, uint32_t i) {
+  uint32_t z = key + i * 0x9e3779b9u;
+  z ^= z >> 16;
+  z *= 0x7feb352du;
+  z ^= z >> 15;
+  z *= 0x846ca68bu;
+  z ^= z >> 16;
+  return z;
+}
+
+// a probability as a threshold for the top 31 bits of lane_random
+static inline uint32_t threshold(double p) {
+  return p >= 1.0 ? (uint32_t(1) << 31) : uint32_t(p * 0x1.0p31);
+}
+
+// the claims of one iteration. Returns the number of claim events.
+static uint64_t claim_kernel(int64_t *__restrict liquid,
+                             int64_t *__restrict vested, uint32_t users,
+                             uint32_t key, uint32_t p_claim,
+                             const economics::claim_split &quote) {
+  const int64_t liquid_units = quote.liquid_tokens * economics::POINT_UNITS;
+  const int64_t vested_units = quote.vested_tokens * economics::POINT_UNITS;
+  uint64_t claims = 0;
+
+  for (uint32_t i = 0; i < users; i++) {
+    int64_t claimed = -int64_t((lane_random(key, i) >> 1) < p_claim); // 0 or ~0
+    liquid[i] += claimed & liquid_units;
+    vested[i] += claimed & vested_units;
+    claims -= claimed;
+  }
+
+  return claims;
+}
+
+// the unvests of one iteration. Returns the currency units released.
+static int64_t unvest_kernel(int64_t *__restrict liquid,
+                             int64_t *__restrict vested, uint32_t users,
+                             uint32_t key, uint32_t p_unvest,
+                             uint32_t unvest_percent) {
+  int64_t released = 0;
+
+  for (uint32_t i = 0; i < users; i++) {
+    int64_t unvesting = -int64_t((lane_random(key, i) >> 1) < p_unvest);
+    int64_t converted =
+        unvesting & (economics::unvest_tokens(vested[i], unvest_percent) *
+                     economics::POINT_UNITS);
+    vested[i] -= converted;
+    liquid[i] += converted;
+    released += converted;
+  }
+
+  return released;
+}
+
+// the vested total
+static int64_t vested_total(const int64_t *__restrict vested, uint64_t users) {
+  int64_t total = 0;
+  for (uint64_t i = 0; i < users; i++) {
+    total += vested[i];
+  }
+  return total;
+}
+
+// the freedao tokens of claim events 1 to claims, in currency units
+static int64_t freedao_units(uint16_t claim_tokens, uint64_t claims) {
+  int64_t units = 0;
+  uint64_t first_event = 1;
+
+  for (const economics::freedao_tier &tier : economics::FREEDAO_TIERS) {
+    if (first_event > claims) {
+      break;
+    }
+    uint64_t last_event = std::min<uint64_t>(claims, tier.last_claimevent);
+    uint16_t freedao_tokens = claim_tokens * tier.multiplier;
+    units += int64_t(last_event - first_event + 1) * freedao_tokens *
+             economics::POINT_UNITS;
+    first_event = uint64_t(tier.last_claimevent) + 1;
+  }
+
+  return units;
+}
+
+// run one exchange rate path
+static void run_path(const econ_config &cfg, uint32_t path, population &users,
+                     iteration_result *results) {
+  user_random random(cfg.seed, path, 0);
+  users.clear();
+
+  double price = cfg.price;
+  uint32_t unvestpercent = 0;
+  uint32_t failsafecounter = 0;
+  int64_t conditional_supply = 0;
+  int64_t freedao = 0;
+  const uint32_t p_claim = threshold(cfg.p_claim);
+  const uint32_t p_unvest = threshold(cfg.p_unvest);
+
+  for (uint32_t iteration = 1; iteration <= cfg.iterations; iteration++) {
+    // the rate moves, then the tick
+    double u1 = ((random.next() >> 11) + 1) * 0x1.0p-53;
+    double u2 = (random.next() >> 11) * 0x1.0p-53;
+    double z = std::sqrt(-2.0 * std::log(u1)) * std::cos(2 * M_PI * u2);
+    price *= std::exp(cfg.drift - cfg.volatility * cfg.volatility / 2 +
+                      cfg.volatility * z);
+
+    float vested_proportion =
+        economics::vested_proportion_from_rate(price, cfg.target);
+    if (vested_proportion == 0.0f) {
+      unvestpercent = economics::next_unvest_percentage(unvestpercent);
+      failsafecounter = 0;
+    } else {
+      economics::failsafe_step failsafe =
+          economics::next_failsafe(failsafecounter, cfg.failsafe_frequency);
+      failsafecounter = failsafe.failsafecounter;
+      unvestpercent = failsafe.unvestpercent;
+    }
+
+    economics::claim_split quote = economics::split_claim(
+        cfg.claim_amount, vested_proportion, economics::freedao_multiplier(1));
+
+    uint32_t key = random.next();
+    uint64_t claims = claim_kernel(users.liquid.data(), users.vested.data(),
+                                   cfg.users, key, p_claim, quote);
+    int64_t freedao_claimed = freedao_units(quote.claim_tokens, claims);
+    conditional_supply +=
+        int64_t(claims) * quote.liquid_tokens * economics::POINT_UNITS +
+        freedao_claimed;
+    freedao += freedao_claimed;
+
+    if (unvestpercent > 0 && unvestpercent <= 100) {
+      key = random.next();
+      conditional_supply +=
+          unvest_kernel(users.liquid.data(), users.vested.data(), cfg.users,
+                        key, p_unvest, unvestpercent);
+    }
+
+    iteration_result &r = results[iteration - 1];
+    r.price = price;
+    r.unvestpercent = unvestpercent;
+    r.conditional_supply = conditional_supply;
+    r.supply = cfg.premint + conditional_supply;
+    r.vested = vested_total(users.vested.data(), cfg.users);
+    r.freedao = freedao;
+  }
+}
+
+static bool parse_options(int argc, char *argv[], econ_config &cfg,
+                          const char *&csv) {
+  for (int i = 1; i < argc; i++) {
+    std::string option = argv[i];
+
+    if (i + 1 >= argc) {
+      return false;
+    }
+    const char *value = argv[++i];
+
+    if (option == "--users") {
+      cfg.users = std::strtoull(value, nullptr, 10);
+    } else if (option == "--iterations") {
+      cfg.iterations = std::strtoul(value, nullptr, 10);
+    } else if (option == "--paths") {
+      cfg.paths = std::strtoul(value, nullptr, 10);
+    } else if (option == "--threads") {
+      cfg.threads = std::strtoul(value, nullptr, 10);
+    } else if (option == "--seed") {
+      cfg.seed = std::strtoull(value, nullptr, 10);
+    } else if (option == "--claim") {
+      cfg.claim_amount = std::strtoul(value, nullptr, 10);
+    } else if (option == "--failsafe") {
+      cfg.failsafe_frequency = std::strtoul(value, nullptr, 10);
+    } else if (option == "--price") {
+      cfg.price = std::strtod(value, nullptr);
+    } else if (option == "--target") {
+      cfg.target = std::strtod(value, nullptr);
+    } else if (option == "--drift") {
+      cfg.drift = std::strtod(value, nullptr);
+    } else if (option == "--volatility") {
+      cfg.volatility = std::strtod(value, nullptr);
+    } else if (option == "--premint") {
+      cfg.premint = std::strtoll(value, nullptr, 10) * economics::POINT_UNITS;
+    } else if (option == "--p-claim") {
+      cfg.p_claim = std::strtod(value, nullptr);
+    } else if (option == "--p-unvest") {
+      cfg.p_unvest = std::strtod(value, nullptr);
+    } else if (option == "--every") {
+      cfg.every = std::strtoul(value, nullptr, 10);
+    } else if (option == "--csv") {
+      csv = value;
+    } else {
+      return false;
+    }
+  }
+
+  return cfg.users > 0 && cfg.users <= UINT32_MAX && cfg.iterations > 0 &&
+         cfg.paths > 0 &&
+         cfg.failsafe_frequency > 0 && cfg.every > 0;
+}
+
+// the 5th, 50th and 95th percentiles of one field over the paths
+template <typename Field>
+static void percentiles(const std::vector<iteration_result> &results,
+                        const econ_config &cfg, uint32_t iteration,
+                        Field field, double out[3]) {
+  std::vector<double> values(cfg.paths);
+  for (uint32_t path = 0; path < cfg.paths; path++) {
+    values[path] = field(results[uint64_t(path) * cfg.iterations + iteration]);
+  }
+  std::sort(values.begin(), values.end());
+
+  const double proportions[3] = {0.05, 0.5, 0.95};
+  for (int i = 0; i < 3; i++) {
+    out[i] = values[std::min<uint64_t>(cfg.paths - 1,
+                                       uint64_t(proportions[i] * cfg.paths))];
+  }
+}
+
+int main(int argc, char *argv[]) {
+  econ_config cfg;
+  const char *csv = nullptr;
+
+  if (!parse_options(argc, argv, cfg, csv)) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  if (cfg.threads == 0) {
+    cfg.threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  cfg.threads = std::min<unsigned>(cfg.threads, cfg.paths);
+
+  auto start_time = std::chrono::steady_clock::now();
+
+  std::vector<iteration_result> results(uint64_t(cfg.paths) * cfg.iterations);
+  std::atomic<uint32_t> next_path{0};
+
+  auto worker = [&] {
+    population users(cfg.users);
+    for (uint32_t path = next_path++; path < cfg.paths; path = next_path++) {
+      run_path(cfg, path, users,
+               &results[uint64_t(path) * cfg.iterations]);
+    }
+  };
+
+  std::vector<std::thread> pool;
+  for (unsigned t = 1; t < cfg.threads; t++) {
+    pool.emplace_back(worker);
+  }
+  worker();
+  for (std::thread &thread : pool) {
+    thread.join();
+  }
+
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start_time)
+                       .count();
+
+  FILE *csv_file = nullptr;
+  if (csv != nullptr) {
+    csv_file = std::fopen(csv, "w");
+    if (csv_file == nullptr) {
+      std::perror(csv);
+      return 1;
+    }
+    std::fprintf(csv_file,
+                 "iteration,price_p5,price_p50,price_p95,unvestpercent_p50,"
+                 "supply_p5,supply_p50,supply_p95,conditional_supply_p5,"
+                 "conditional_supply_p50,conditional_supply_p95,vested_p5,"
+                 "vested_p50,vested_p95,freedao_p50\n");
+  }
+
+  std::printf("%9s %20s %4s %38s %38s %38s\n", "iteration",
+              "price p5/p50/p95", "unv%", "supply p5/p50/p95 (POINT)",
+              "conditional supply p5/p50/p95", "vested p5/p50/p95");
+
+  for (uint32_t iteration = 0; iteration < cfg.iterations; iteration++) {
+    double price[3], unvest[3], supply[3], conditional[3], vested[3],
+        freedao[3];
+    percentiles(results, cfg, iteration,
+                [](const iteration_result &r) { return r.price; }, price);
+    percentiles(results, cfg, iteration,
+                [](const iteration_result &r) { return r.unvestpercent; },
+                unvest);
+    percentiles(results, cfg, iteration,
+                [](const iteration_result &r) {
+                  return double(r.supply) / economics::POINT_UNITS;
+                },
+                supply);
+    percentiles(results, cfg, iteration,
+                [](const iteration_result &r) {
+                  return double(r.conditional_supply) / economics::POINT_UNITS;
+                },
+                conditional);
+    percentiles(results, cfg, iteration,
+                [](const iteration_result &r) {
+                  return double(r.vested) / economics::POINT_UNITS;
+                },
+                vested);
+    percentiles(results, cfg, iteration,
+                [](const iteration_result &r) {
+                  return double(r.freedao) / economics::POINT_UNITS;
+                },
+                freedao);
+
+    if ((iteration + 1) % cfg.every == 0 || iteration + 1 == cfg.iterations) {
+      std::printf("%9u %6.3f/%6.3f/%6.3f %4.0f %12.0f/%12.0f/%12.0f "
+                  "%12.0f/%12.0f/%12.0f %12.0f/%12.0f/%12.0f\n",
+                  iteration + 1, price[0], price[1], price[2], unvest[1],
+                  supply[0], supply[1], supply[2], conditional[0],
+                  conditional[1], conditional[2], vested[0], vested[1],
+                  vested[2]);
+    }
+
+    if (csv_file != nullptr) {
+      std::fprintf(csv_file,
+                   "%u,%.6f,%.6f,%.6f,%.0f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,"
+                   "%.4f,%.4f,%.4f,%.4f\n",
+                   iteration + 1, price[0], price[1], price[2], unvest[1],
+                   supply[0], supply[1], supply[2], conditional[0],
+                   conditional[1], conditional[2], vested[0], vested[1],
+                   vested[2], freedao[1]);
+    }
+  }
+
+  if (csv_file != nullptr) {
+    std::fclose(csv_file);
+  }
+
+  double updates = double(cfg.users) * cfg.iterations * cfg.paths;
+  std::printf("\n%u paths x %u iterations x %llu users in %.2fs (%.0f "
+              "user-iterations/s, %u threads)\n",
+              cfg.paths, cfg.iterations, (unsigned long long)cfg.users,
+              seconds, updates / seconds, cfg.threads);
+
+  return 0;
+}
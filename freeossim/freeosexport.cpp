@@ -0,0 +1,255 @@
+// freeosexport - converts a table dump into columnar snapshot files.
+//
+// Reads a dump written by snapshot_dump.sh (or - for stdin), or by any other
+// source of the raw rows, one line at a time:
+//
+//   layout <table> <field>:<abi type> ...
+//   row <table> <scope> <row as hex>
+//
+// The layout lines come from the contracts' ABIs and must precede the rows
+// of their table. Each row is decoded with its table's layout and appended to
+// the table's columns, and <output dir>/<table>.fcol is written at the end
+// (see freeoscolumns.hpp for the format).
+//
+// usage: ./freeosexport <dump file> <output dir>
+
+#include "eosname.hpp"
+#include "freeoscolumns.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+using namespace freedao::sim;
+
+// how a field of an ABI struct is decoded
+enum field_kind {
+  fld_fixed,  // a fixed-width integer or float, one column
+  fld_asset,  // amount and symbol, two columns
+  fld_string, // varuint32 length and bytes
+};
+
+struct field_layout {
+  field_kind kind;
+  uint32_t width;   // bytes, fld_fixed
+  bool extension;   // binary extension - may be missing from the row
+  size_t column;    // the field's (first) column
+};
+
+struct table_export {
+  std::vector<field_layout> fields;
+  std::vector<column_builder> columns;
+  uint64_t rows = 0;
+};
+
+struct abi_type {
+  const char *name;
+  field_kind kind;
+  column_type type;
+};
+
+constexpr abi_type ABI_TYPES[] = {
+    {"bool", fld_fixed, col_u8},         {"uint8", fld_fixed, col_u8},
+    {"int8", fld_fixed, col_i8},         {"uint16", fld_fixed, col_u16},
+    {"int16", fld_fixed, col_i16},       {"uint32", fld_fixed, col_u32},
+    {"int32", fld_fixed, col_i32},       {"uint64", fld_fixed, col_u64},
+    {"int64", fld_fixed, col_i64},       {"float32", fld_fixed, col_f32},
+    {"float64", fld_fixed, col_f64},     {"name", fld_fixed, col_name},
+    {"symbol", fld_fixed, col_u64},      {"symbol_code", fld_fixed, col_u64},
+    {"time_point", fld_fixed, col_i64},  {"time_point_sec", fld_fixed, col_u32},
+    {"asset", fld_asset, col_i64},       {"string", fld_string, col_string},
+};
+
+// add a field and its columns to a table. Returns false for an unsupported
+// type.
+static bool add_field(table_export &table, const std::string &name,
+                      std::string type) {
+  field_layout field = {};
+  field.extension = !type.empty() && type.back() == '$';
+  if (field.extension) {
+    type.pop_back();
+  }
+
+  for (const abi_type &t : ABI_TYPES) {
+    if (type != t.name) {
+      continue;
+    }
+
+    field.kind = t.kind;
+    field.width = COLUMN_WIDTH[t.type];
+    field.column = table.columns.size();
+
+    if (t.kind == fld_asset) {
+      table.columns.emplace_back(name + ".amount", col_i64);
+      table.columns.emplace_back(name + ".symbol", col_u64);
+    } else {
+      table.columns.emplace_back(name, t.type);
+    }
+
+    table.fields.push_back(field);
+    return true;
+  }
+
+  return false;
+}
+
+static bool decode_hex(const std::string &hex, std::vector<uint8_t> &bytes) {
+  if (hex.size() % 2 != 0) {
+    return false;
+  }
+
+  bytes.resize(hex.size() / 2);
+  for (size_t i = 0; i < bytes.size(); i++) {
+    unsigned value;
+    if (std::sscanf(hex.c_str() + 2 * i, "%2x", &value) != 1) {
+      return false;
+    }
+    bytes[i] = value;
+  }
+
+  return true;
+}
+
+// little-endian integer of the given width
+static uint64_t read_uint(const uint8_t *bytes, uint32_t width) {
+  uint64_t value = 0;
+  std::memcpy(&value, bytes, width);
+  return value;
+}
+
+// decode a row and append it to the table's columns. Returns false if the
+// row does not match the layout.
+static bool append_row(table_export &table, const std::string &scope,
+                       const std::vector<uint8_t> &row) {
+  size_t pos = 0;
+
+  table.columns[0].append(name_value(scope));
+
+  for (const field_layout &field : table.fields) {
+    bool missing = pos == row.size() && field.extension;
+
+    switch (field.kind) {
+    case fld_fixed:
+      if (missing) {
+        table.columns[field.column].append(0);
+        break;
+      }
+      if (pos + field.width > row.size()) {
+        return false;
+      }
+      table.columns[field.column].append(read_uint(&row[pos], field.width));
+      pos += field.width;
+      break;
+
+    case fld_asset:
+      if (missing) {
+        table.columns[field.column].append(0);
+        table.columns[field.column + 1].append(0);
+        break;
+      }
+      if (pos + 16 > row.size()) {
+        return false;
+      }
+      table.columns[field.column].append(read_uint(&row[pos], 8));
+      table.columns[field.column + 1].append(read_uint(&row[pos + 8], 8));
+      pos += 16;
+      break;
+
+    case fld_string: {
+      uint32_t length = 0;
+      for (int shift = 0; !missing; shift += 7) {
+        if (pos >= row.size() || shift > 28) {
+          return false;
+        }
+        uint8_t b = row[pos++];
+        length |= uint32_t(b & 0x7f) << shift;
+        if ((b & 0x80) == 0) {
+          break;
+        }
+      }
+      if (pos + length > row.size()) {
+        return false;
+      }
+      table.columns[field.column].append_string(std::string_view(
+          reinterpret_cast<const char *>(row.data() + pos), length));
+      pos += length;
+      break;
+    }
+    }
+  }
+
+  table.rows++;
+  return pos == row.size();
+}
+
+int main(int argc, char *argv[]) {
+  if (argc != 3) {
+    std::printf("usage: %s <dump file> <output dir>\n", argv[0]);
+    return 1;
+  }
+
+  std::ifstream dump_file;
+  std::istream *dump = &std::cin;
+  if (std::string(argv[1]) != "-") {
+    dump_file.open(argv[1]);
+    if (!dump_file) {
+      std::perror(argv[1]);
+      return 1;
+    }
+    dump = &dump_file;
+  }
+
+  std::map<std::string, table_export> tables;
+  std::vector<uint8_t> row;
+  std::string line;
+  uint64_t line_number = 0;
+
+  while (std::getline(*dump, line)) {
+    line_number++;
+    std::istringstream fields(line);
+    std::string kind, table_name;
+
+    if (!(fields >> kind >> table_name)) {
+      continue;
+    }
+
+    if (kind == "layout") {
+      table_export &table = tables[table_name];
+      table = table_export();
+      table.columns.emplace_back("scope", col_name);
+
+      std::string field;
+      while (fields >> field) {
+        size_t colon = field.find(':');
+        if (colon == std::string::npos ||
+            !add_field(table, field.substr(0, colon), field.substr(colon + 1))) {
+          std::fprintf(stderr, "line %llu: unsupported field %s\n",
+                       (unsigned long long)line_number, field.c_str());
+          return 1;
+        }
+      }
+    } else if (kind == "row") {
+      auto table = tables.find(table_name);
+      std::string scope, hex;
+      if (table == tables.end() || !(fields >> scope >> hex) ||
+          !decode_hex(hex, row) || !append_row(table->second, scope, row)) {
+        std::fprintf(stderr, "line %llu: cannot decode %s row\n",
+                     (unsigned long long)line_number, table_name.c_str());
+        return 1;
+      }
+    }
+  }
+
+  for (const auto &[name, table] : tables) {
+    std::string path = std::string(argv[2]) + "/" + name + ".fcol";
+    if (!write_column_file(path, table.rows, table.columns)) {
+      std::perror(path.c_str());
+      return 1;
+    }
+    std::printf("%-14s %12llu rows -> %s\n", name.c_str(),
+                (unsigned long long)table.rows, path.c_str());
+  }
+
+  return 0;
+}
@@ -0,0 +1,329 @@
+// freeosflow - runs whole freeos flows on the host build of the contracts
+// (../host, see freeoshost.hpp) and traces every action, notification and
+// inline action they cause.
+//
+// The host chain executes actions in chain order: an action runs on its own
+// contract, then on each account it notified (require_recipient), in the
+// order they were notified, and then the inline actions sent by all of those,
+// in the order they were sent - each of them in the same way, depth first.
+// The contracts are the host builds of:
+//
+//   freeos        stake (the system token transfer notification), claim,
+//                 unvest, unstake, convert and tick
+//   freeosconfig  iterclear
+//   system token  eosio.token, for the staked currency - transfer
+//   freeostokens  eosio.token, for FREEOS - issue and transfer
+//
+// and any other account (the user, freedao) receives notifications without
+// a contract. The user's eosio.proton usersinfo record is written to the
+// verification account's table, which reguser reads.
+//
+// A flow is a transaction: if an action in it fails, the flow is reported as
+// failed, with the actions that ran up to the failure, and the chain is left
+// as it was before the flow.
+//
+// The flows run one after another for one user, in the order given:
+//
+//   reguser, stake, claim, unvest, unstake, convert   the user's actions
+//   tick                                              the ticker's tick
+//   next                                              the chain clock moves
+//                                                     on to the next
+//                                                     iteration (no action)
+//
+// The stake is a transfer of the user's stake requirement, which the user is
+// issued first. The chain starts in iteration 1, which no tick has rolled
+// over to yet.
+//
+// usage: ./freeosflow [options] <flow>... - see usage() below
+
+#include "freeoshost.hpp"
+
+#include "../common/freeoscommon.hpp"
+#include "../common/freeoseconomics.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace freedao;
+using namespace freedao::host;
+
+static void usage(const char *program) {
+  std::printf(
+      "usage: %s [options] <flow>...\n"
+      "  --claim N          iteration claim amount, POINTs (100)\n"
+      "  --hold N           iteration tokens required, POINTs (0)\n"
+      "  --vest N           'vestpercent' parameter (50)\n"
+      "  --failsafe N       'failsafefreq' parameter (not set: 24)\n"
+      "  --stakereq U:V,D,E stakereqs band from U users - repeat for more bands\n"
+      "                     (0:0,10,20)\n"
+      "  --type C           the user's account type, v, d or e (d)\n"
+      "  --convert N        POINTs converted by convert, 0 for the whole liquid\n"
+      "                     balance (0)\n"
+      "flows: reguser stake claim unvest unstake convert tick next\n"
+      "(default: reguser stake claim next tick claim unvest convert unstake\n"
+      " next tick tick)\n",
+      program);
+}
+
+static const eosio::name flow_user("user");
+static const eosio::name ticker("ticker");
+
+// parse a stakereqs band given as <users>:<v>,<d>,<e>
+static bool parse_stake_band(const char *value, stake_band &band) {
+  unsigned long long threshold;
+  if (std::sscanf(value, "%llu:%u,%u,%u", &threshold, &band.requirement_v,
+                  &band.requirement_d, &band.requirement_e) != 4) {
+    return false;
+  }
+  band.threshold = threshold;
+  return true;
+}
+
+// freeos, freeosconfig, the token contracts and one user
+class flow_runner {
+public:
+  flow_runner(const system_config &config, char account_type,
+              const char *failsafe, int64_t convert_amount);
+
+  // run a flow and print its trace. Returns false for an unknown flow.
+  bool run(const std::string &flow);
+
+private:
+  std::optional<user> user_record() const;
+  eosio::asset stake_requirement() const;
+  eosio::asset liquid_balance() const;
+  void print(const std::string &flow, const transaction_trace &trace) const;
+
+  chain c;
+  const system_config config;
+  const char account_type;
+  const int64_t convert_amount;
+  uint32_t chain_iteration = 1; // the iteration of the chain clock
+};
+
+flow_runner::flow_runner(const system_config &config, char account_type,
+                         const char *failsafe, int64_t convert_amount)
+    : config(config), account_type(account_type),
+      convert_amount(convert_amount) {
+  bootstrap_freeos(c, config);
+
+  if (failsafe != nullptr) {
+    expect_success(c.push(freeosconfig_account(), eosio::name("paramupsert"),
+                          freeosconfig_account(), eosio::name(),
+                          eosio::name("failsafefreq"), std::string(failsafe)));
+  }
+
+  // a 'v' account has a KYC entry with its names, a 'd' account a record
+  // without one, and an 'e' account no record
+  if (account_type == 'v') {
+    set_verification(c, flow_user, {"firstname,lastname"});
+  } else if (account_type == 'd') {
+    set_verification(c, flow_user, {});
+  } else {
+    c.create_account(flow_user);
+  }
+  c.create_account(ticker);
+}
+
+std::optional<user> flow_runner::user_record() const {
+  auto users = c.get_table<user>(freeos_account(), flow_user.value,
+                                 eosio::name("users"));
+  if (users.empty()) {
+    return std::nullopt;
+  }
+  return users.front();
+}
+
+// what stake asks of the user - get_stake_requirement, for the usercount
+// after the stake registers the user if it has to
+eosio::asset flow_runner::stake_requirement() const {
+  const eosio::name freeos = freeos_account();
+  auto statistics =
+      c.get_row<statistic>(freeos, freeos.value, eosio::name("statistics"), 0);
+  uint64_t usercount = statistics ? statistics->usercount : 0;
+  usercount += !user_record();
+
+  const stake_band *band = &config.stake_bands.front();
+  for (const stake_band &b : config.stake_bands) {
+    if (b.threshold <= usercount) {
+      band = &b;
+    }
+  }
+
+  uint32_t whole = economics::stake_requirement(
+      account_type, band->requirement_v, band->requirement_d,
+      band->requirement_e);
+  return eosio::asset(whole * SYSTEM_CURRENCY_UNITS, system_symbol());
+}
+
+eosio::asset flow_runner::liquid_balance() const {
+  auto row = c.get_row<account>(freeos_account(), flow_user.value,
+                                eosio::name("accounts"),
+                                point_symbol().code().raw());
+  return row ? row->balance : eosio::asset(0, point_symbol());
+}
+
+bool flow_runner::run(const std::string &flow) {
+  const eosio::name freeos = freeos_account();
+  eosio::action act;
+
+  if (flow == "next") {
+    chain_iteration++;
+    c.set_time(config.start +
+               eosio::microseconds(config.iteration_length.count() *
+                                   int64_t(chain_iteration - 1)));
+    std::printf("next: the chain clock is in iteration %u\n\n",
+                chain_iteration);
+    return true;
+  } else if (flow == "stake") {
+    eosio::asset requirement = stake_requirement();
+    if (requirement.amount > 0) {
+      fund_user(c, flow_user, requirement);
+    }
+    act = chain::make_action(system_token_account(), eosio::name("transfer"),
+                             flow_user, flow_user, freeos, requirement,
+                             std::string("freeos stake"));
+  } else if (flow == "convert") {
+    eosio::asset amount =
+        convert_amount > 0
+            ? eosio::asset(convert_amount * economics::POINT_UNITS,
+                           point_symbol())
+            : liquid_balance();
+    act = chain::make_action(freeos, eosio::name("convert"), flow_user,
+                             flow_user, amount);
+  } else if (flow == "tick") {
+    act = chain::make_action(freeos, eosio::name("tick"), ticker);
+  } else if (flow == "reguser" || flow == "claim" || flow == "unvest" ||
+             flow == "unstake") {
+    act = chain::make_action(freeos, eosio::name(flow), flow_user, flow_user);
+  } else {
+    return false;
+  }
+
+  print(flow, c.push_action(act));
+  return true;
+}
+
+void flow_runner::print(const std::string &flow,
+                        const transaction_trace &trace) const {
+  std::printf("%s: %s\n", flow.c_str(),
+              trace.succeeded ? "executed" : ("FAILS - " + trace.error).c_str());
+  std::printf("  %-3s %-13s %-30s %6s %6s %6s %6s %8s %8s\n", "#", "receiver",
+              "action", "reads", "writes", "inline", "notify", "ram",
+              "wall_us");
+
+  counters total;
+  std::map<std::string, counters> by_receiver;
+  uint32_t ordinal = 0;
+
+  for (const action_trace &t : trace.actions) {
+    bool notification = t.receiver != t.account;
+    std::string action = std::string(2 * t.depth, ' ') +
+                         (notification ? "> " : "") + t.account.to_string() +
+                         "::" + t.action.to_string();
+    // a failed transaction's trace ends with the receiver that failed. Any
+    // other receiver without wall time is an account without a contract.
+    bool failed = !trace.succeeded && &t == &trace.actions.back();
+    const char *note =
+        failed ? "failed" : (t.cost.wall_ns == 0 ? "no contract" : "");
+
+    std::printf("  %-3u %-13s %-30s %6llu %6llu %6llu %6llu %8lld %8.1f  %s\n",
+                ++ordinal, t.receiver.to_string().c_str(), action.c_str(),
+                (unsigned long long)t.cost.db_reads(),
+                (unsigned long long)t.cost.db_writes(),
+                (unsigned long long)t.cost.inline_actions,
+                (unsigned long long)t.cost.notifications,
+                (long long)t.cost.ram_bytes, t.cost.wall_ns / 1000.0, note);
+    total += t.cost;
+    by_receiver[t.receiver.to_string()] += t.cost;
+  }
+
+  std::printf("  %-3s %-13s %-30s %6llu %6llu %6llu %6llu %8lld %8.1f\n", "",
+              "total", "", (unsigned long long)total.db_reads(),
+              (unsigned long long)total.db_writes(),
+              (unsigned long long)total.inline_actions,
+              (unsigned long long)total.notifications,
+              (long long)total.ram_bytes, total.wall_ns / 1000.0);
+  for (const auto &[receiver, cost] : by_receiver) {
+    if (cost.db_reads() + cost.db_writes() > 0) {
+      std::printf("  %-3s %-13s %-30s %6llu %6llu\n", "", receiver.c_str(), "",
+                  (unsigned long long)cost.db_reads(),
+                  (unsigned long long)cost.db_writes());
+    }
+  }
+  std::printf("\n");
+}
+
+int main(int argc, char *argv[]) {
+  system_config config;
+  char account_type = 'd';
+  const char *failsafe = nullptr;
+  int64_t convert_amount = 0;
+  bool default_bands = true;
+  int arg = 1;
+
+  for (; arg + 1 < argc && argv[arg][0] == '-'; arg += 2) {
+    std::string option = argv[arg];
+    const char *value = argv[arg + 1];
+
+    if (option == "--claim") {
+      config.claim_amount = std::strtoul(value, nullptr, 10);
+    } else if (option == "--hold") {
+      config.tokens_required = std::strtoul(value, nullptr, 10);
+    } else if (option == "--vest") {
+      config.vest_percent = std::strtoul(value, nullptr, 10);
+    } else if (option == "--failsafe") {
+      failsafe = value;
+    } else if (option == "--stakereq") {
+      stake_band band;
+      if (!parse_stake_band(value, band)) {
+        usage(argv[0]);
+        return 1;
+      }
+      if (default_bands) {
+        config.stake_bands.clear();
+        default_bands = false;
+      }
+      config.stake_bands.push_back(band);
+    } else if (option == "--type") {
+      account_type = value[0];
+    } else if (option == "--convert") {
+      convert_amount = std::strtoll(value, nullptr, 10);
+    } else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  // the stakereqs lookup needs the bands in threshold order
+  std::sort(config.stake_bands.begin(), config.stake_bands.end(),
+            [](const stake_band &a, const stake_band &b) {
+              return a.threshold < b.threshold;
+            });
+
+  std::vector<std::string> flows(argv + arg, argv + argc);
+  if (flows.empty()) {
+    flows = {"reguser", "stake", "claim",   "next",    "tick", "claim",
+             "unvest",  "convert", "unstake", "next", "tick", "tick"};
+  }
+
+  try {
+    flow_runner runner(config, account_type, failsafe, convert_amount);
+    for (const std::string &flow : flows) {
+      if (!runner.run(flow)) {
+        usage(argv[0]);
+        return 1;
+      }
+    }
+  } catch (const eosio::check_failure &e) {
+    std::fprintf(stderr, "setup failed: %s\n", e.what());
+    return 1;
+  }
+
+  return 0;
+}
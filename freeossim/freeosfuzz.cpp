@@ -0,0 +1,1032 @@
+// freeosfuzz - searches for the most expensive inputs to the freeos and
+// freeosconfig actions, on the host build of the contracts (../host).
+//
+// Each target decodes a fuzz input (a byte string) into an action's arguments
+// and the table state it reads - e.g. the user's eosio.proton usersinfo row,
+// the freeosconfig parameters and whitelists or the unstake and conversion
+// queues - writes that state to a freeos system in a session, pushes the
+// action and rolls the session back. The cost is the host chain's count for
+// the transaction (see counters in freeoshost.hpp): table reads and writes,
+// inline actions, notifications, the bytes unpacked (the action data and
+// every row read) and the bytes the contracts allocate. State is written with
+// the contracts' own actions where they have one (paramupsert, transfadd,
+// convreq, ...), otherwise with run_as. A setup action that fails leaves that
+// part of the state as it was.
+//
+// The search works like libFuzzer's: a corpus of inputs is mutated, and an
+// input is kept if it reaches a new feature or costs more than any input
+// before it. The host build has no branch coverage, so the features of an
+// input are its outcome (success or the error message), the actions in its
+// trace and the power of two of each of its counts, like libFuzzer's value
+// profile. Mutation favours the most expensive inputs, so the cost is
+// maximized. The most expensive input of each target is then printed field by
+// field.
+//
+// Every action of the freeos and freeosconfig ABIs is a target, named after
+// the action (freeosconfig's version is config.version). The stake target is
+// freeos's notification of a transfer, without the token contract. userverify
+// and addkyc are targets of a test build (./compile.sh -DTEST_BUILD).
+//
+// usage: ./freeosfuzz [options] [target ...] - see usage() below
+
+#include "freeoshost.hpp"
+
+#include "../common/freeoscommon.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace freedao;
+using namespace freedao::host;
+
+static void usage(const char *program) {
+  std::printf(
+      "usage: %s [options] [target ...]\n"
+      "  --runs N           inputs to try per target (2000)\n"
+      "  --max-len N        longest fuzz input, bytes (512)\n"
+      "  --seed N           random seed (1)\n"
+      "  --save DIR         write the most expensive input of each target to\n"
+      "                     DIR/<target>.bin\n"
+      "  --replay FILE      run FILE through the (single) target and print\n"
+      "                     its cost\n"
+      "Targets are all of them by default.\n",
+      program);
+}
+
+// limits on the sizes the inputs decode to. Action data is limited by the
+// chain's max_transaction_net_usage (512 KiB by default); the others are
+// generous sizes for rows written by other contracts and accounts, and for
+// the queues.
+constexpr uint32_t MAX_ACTION_DATA = 512 * 1024;
+constexpr uint32_t MAX_ROW_STRING = 64 * 1024;
+constexpr uint32_t MAX_ROW_VECTOR = 256;
+constexpr uint32_t MAX_QUEUE = 1024;
+
+// the cost of one action
+struct fuzz_cost {
+  uint64_t db_reads = 0;
+  uint64_t db_writes = 0;
+  uint64_t inline_actions = 0;
+  uint64_t notifications = 0;
+  uint64_t bytes_decoded = 0; // action data and rows unpacked
+  uint64_t bytes_packed = 0;  // rows written, inline actions, return values
+  uint64_t heap_allocations = 0;
+  uint64_t bytes_allocated = 0;
+
+  explicit fuzz_cost(const counters &total = counters())
+      : db_reads(total.db_reads()), db_writes(total.db_writes()),
+        inline_actions(total.inline_actions),
+        notifications(total.notifications),
+        bytes_decoded(total.bytes_unpacked), bytes_packed(total.bytes_packed),
+        heap_allocations(total.heap_allocations()),
+        bytes_allocated(total.heap_bytes) {}
+
+  // a single figure to maximize, in rough microseconds of a nodeos
+  // producer: a table lookup or write costs several microseconds, an inline
+  // action or notification tens, and bytes a few nanoseconds each
+  double score() const {
+    return 3.0 * db_reads + 5.0 * db_writes + 25.0 * inline_actions +
+           15.0 * notifications + 0.004 * bytes_decoded +
+           0.002 * (bytes_packed + bytes_allocated);
+  }
+};
+
+// a fuzz input, read as the values a target asks for. Reads past the end
+// return zeroes, as libFuzzer's FuzzedDataProvider does. With trace set,
+// each value read is recorded by name.
+class fuzz_input {
+public:
+  fuzz_input(const uint8_t *data, size_t size, std::string *trace = nullptr)
+      : data(data), size(size), trace(trace) {}
+
+  uint32_t value(const char *name, uint32_t max) {
+    uint32_t v = 0;
+    for (int i = 0; i < 4 && pos < size; i++) {
+      v = v << 8 | data[pos++];
+    }
+    v = max == UINT32_MAX ? v : v % (max + 1);
+    record(name, v);
+    return v;
+  }
+
+  bool flag(const char *name) {
+    bool v = pos < size && (data[pos++] & 1);
+    record(name, v);
+    return v;
+  }
+
+private:
+  void record(const char *name, uint32_t v) {
+    if (trace != nullptr) {
+      *trace += std::string("  ") + name + "=" + std::to_string(v) + "\n";
+    }
+  }
+
+  const uint8_t *data;
+  size_t size;
+  size_t pos = 0;
+  std::string *trace;
+};
+
+// ---------------------------------------------------------------------------
+// the freeos system the targets run on, in iteration 2:
+// - alice: 'e', staked, claimed in iteration 1
+// - bob: 'v', claimed in iteration 1
+// - carol: 'e', unregistered, with the stake currency
+// - dave: 'e', staked, with an unstake request made in iteration 2
+// - queue_name(0 .. MAX_QUEUE - 1): accounts for the queues and the
+//   allocmany and mintmany recipients
+// freeos holds the stake currency to refund MAX_QUEUE requests.
+
+static const eosio::name alice("alice");
+static const eosio::name bob("bob");
+static const eosio::name carol("carol");
+static const eosio::name dave("dave");
+
+// the stake of a queued unstake request, in whole units
+constexpr int64_t QUEUED_STAKE = 20;
+
+static eosio::asset stake_units(int64_t whole) {
+  return eosio::asset(whole * SYSTEM_CURRENCY_UNITS, system_symbol());
+}
+
+static eosio::asset points(int64_t amount) {
+  return eosio::asset(amount, point_symbol());
+}
+
+// 'q' and the index in base 26
+static eosio::name queue_name(uint32_t index) {
+  char text[13] = "qaaaaaaaaaaa";
+  for (int i = 11; i > 0 && index > 0; i--) {
+    text[i] = char('a' + index % 26);
+    index /= 26;
+  }
+  return eosio::name(text);
+}
+
+static void build_system(chain &c) {
+  const eosio::name freeos = freeos_account();
+  system_config config;
+  bootstrap_freeos(c, config);
+  c.create_account(eosio::name("cron"));
+  for (uint32_t i = 0; i < MAX_QUEUE; i++) {
+    c.create_account(queue_name(i));
+  }
+  fund_user(c, freeos, stake_units(QUEUED_STAKE * MAX_QUEUE));
+
+  set_verification(c, bob, {"firstname,lastname"});
+  for (eosio::name user : {alice, carol, dave}) {
+    fund_user(c, user, stake_units(100));
+  }
+  for (eosio::name user : {alice, bob, dave}) {
+    expect_success(c.push(freeos, eosio::name("reguser"), user, user));
+  }
+  for (eosio::name user : {alice, dave}) {
+    expect_success(c.push(system_token_account(), eosio::name("transfer"), user,
+                          user, freeos, stake_units(20),
+                          std::string("freeos stake")));
+  }
+  for (eosio::name user : {alice, bob}) {
+    expect_success(c.push(freeos, eosio::name("claim"), user, user));
+  }
+
+  c.advance(config.iteration_length);
+  expect_success(c.push(freeos, eosio::name("tick"), alice));
+  expect_success(c.push(freeos, eosio::name("unstake"), dave, dave));
+}
+
+// ---------------------------------------------------------------------------
+// the state the inputs decode to
+
+// a setup action - its failure leaves the state as it was
+template <typename... Args>
+static void setup(chain &c, eosio::name account, const char *action,
+                  eosio::name actor, Args &&...args) {
+  c.push(account, eosio::name(action), actor, std::forward<Args>(args)...);
+}
+
+static void set_parameter(chain &c, const char *paramname,
+                          const std::string &value) {
+  setup(c, freeosconfig_account(), "paramupsert", freeosconfig_account(),
+        eosio::name(), eosio::name(paramname), value);
+}
+
+// a number as parse_uint reads it, after padding spaces
+static std::string padded(uint32_t padding, uint32_t value) {
+  return std::string(padding, ' ') + std::to_string(value);
+}
+
+static eosio::name pick_user(fuzz_input &in, const char *name) {
+  static const eosio::name users[] = {alice, bob, carol, dave};
+  return users[in.value(name, 3)];
+}
+
+// the freeosconfig parameters and exchange rate the actions read. Any
+// parameter can be set to any string by paramupsert.
+static void set_parameters(fuzz_input &in, chain &c) {
+  if (in.flag("masterswitch off")) {
+    set_parameter(c, "masterswitch",
+                  std::string(in.value("masterswitch length", MAX_ROW_STRING),
+                              '0'));
+  }
+  if (uint32_t padding = in.value("vestpercent padding", MAX_ROW_STRING)) {
+    set_parameter(c, "vestpercent", padded(padding, 50));
+  }
+  if (uint32_t padding = in.value("failsafefreq padding", MAX_ROW_STRING)) {
+    set_parameter(c, "failsafefreq", padded(padding, 24));
+  }
+  uint32_t unstakesnum = in.value("unstakesnum", UINT16_MAX);
+  uint32_t padding = in.value("unstakesnum padding", MAX_ROW_STRING);
+  set_parameter(c, "unstakesnum", padded(padding, unstakesnum));
+
+  if (in.flag("exchangerate record")) {
+    setup(c, freeosconfig_account(), "targetrate", freeosconfig_account(),
+          0.01);
+    setup(c, freeosconfig_account(), "currentrate", freeosconfig_account(),
+          in.flag("unfavourable rate") ? 0.005 : 1.0);
+  }
+}
+
+// the start of iteration 3, for the actions that run tick
+static void set_clock(fuzz_input &in, chain &c) {
+  if (in.flag("new iteration")) {
+    c.advance(system_config().iteration_length);
+  }
+}
+
+// unstake requests made in iteration 1, due for refund, by staked users
+static void queue_unstakes(fuzz_input &in, chain &c) {
+  uint32_t requests = in.value("unstake requests due", MAX_QUEUE);
+  if (requests == 0) {
+    return;
+  }
+
+  const eosio::name freeos = freeos_account();
+  eosio::asset stake = stake_units(QUEUED_STAKE);
+  c.run_as(freeos, [&] {
+    unstakerequest_index unstakes_table(freeos, freeos.value);
+    for (uint32_t i = 0; i < requests; i++) {
+      eosio::name staker = queue_name(i);
+      users_index users_table(freeos, staker.value);
+      users_table.emplace(freeos, [&](user &u) {
+        u.stake = stake;
+        u.account_type = 'e';
+        u.registered_iteration = 1;
+        u.staked_iteration = 1;
+        u.votes = 0;
+        u.issuances = 0;
+        u.last_issuance = 0;
+      });
+      unstakes_table.emplace(freeos, [&](unstakerequest &r) {
+        r.staker = staker;
+        r.iteration = 1;
+        r.amount = stake;
+      });
+    }
+
+    aggstats_index aggstats_table(freeos, freeos.value);
+    aggstats_table.modify(aggstats_table.begin(), freeos, [&](aggstat &a) {
+      a.staked += stake * requests;
+      a.refunds += stake * requests;
+      a.refundcount += requests;
+      a.unverified += requests;
+    });
+  });
+}
+
+// the user's usersinfo record in the verification contract, read whole by
+// get_account_type - or in freeosconfig's own table, which its test build
+// actions write
+static void write_usersinfo(fuzz_input &in, chain &c, eosio::name user,
+                            eosio::name verifier = verification_account()) {
+  if (!in.flag("usersinfo row")) {
+    return;
+  }
+
+  userinfo info;
+  info.acc = user;
+  info.name.assign(in.value("usersinfo name length", MAX_ROW_STRING), 'n');
+  info.avatar.assign(in.value("usersinfo avatar length", MAX_ROW_STRING), 'a');
+  info.verified = true;
+  info.date = 0;
+  info.verifiedon = 0;
+  info.verifier = verifier;
+  info.raccs.resize(in.value("usersinfo raccs", MAX_ROW_VECTOR));
+  info.aacts.resize(in.value("usersinfo aacts", MAX_ROW_VECTOR));
+  uint32_t ac = in.value("usersinfo ac", MAX_ROW_VECTOR);
+  std::string ac_value(in.value("usersinfo ac string length", MAX_ROW_STRING),
+                       'c');
+  info.ac.assign(ac, {eosio::name(), ac_value});
+
+  // the search for a level with a firstname and a lastname reads up to it
+  uint32_t kyc = in.value("usersinfo kyc entries", MAX_ROW_VECTOR);
+  uint32_t level_length = in.value("kyc_level length", MAX_ROW_STRING);
+  uint32_t verified_entry =
+      in.value("first kyc entry with both names", MAX_ROW_VECTOR);
+  for (uint32_t i = 0; i < kyc; i++) {
+    std::string level(level_length, 'x');
+    if (i == verified_entry) {
+      level += "firstname,lastname";
+    }
+    info.kyc.push_back(kyc_prov{verifier, level, 0});
+  }
+
+  c.run_as(verifier, [&] {
+    usersinfo verification_table(verifier, verifier.value);
+    auto record = verification_table.find(user.value);
+    if (record == verification_table.end()) {
+      verification_table.emplace(verifier, [&](userinfo &u) { u = info; });
+    } else {
+      verification_table.modify(record, verifier,
+                                [&](userinfo &u) { u = info; });
+    }
+  });
+}
+
+// account in a freeosconfig whitelist, with the action that adds it there
+static void whitelist(fuzz_input &in, chain &c, const char *name,
+                      const char *add, eosio::name account) {
+  if (in.flag(name)) {
+    setup(c, freeosconfig_account(), add, freeosconfig_account(), account);
+  }
+}
+
+static std::string memo(fuzz_input &in) {
+  return std::string(in.value("memo length", MAX_ACTION_DATA), 'm');
+}
+
+static std::vector<std::pair<eosio::name, eosio::asset>>
+recipients(fuzz_input &in) {
+  std::vector<std::pair<eosio::name, eosio::asset>> list;
+  uint32_t count = in.value("recipients", MAX_ROW_VECTOR);
+  for (uint32_t i = 0; i < count; i++) {
+    list.emplace_back(queue_name(i), points(1));
+  }
+  return list;
+}
+
+// ---------------------------------------------------------------------------
+// the targets
+
+// the action a target pushes
+struct fuzz_action {
+  eosio::action action;
+  eosio::name notified; // deliver it as a notification to this receiver
+  bool read_only = false;
+};
+
+template <typename... Args>
+static fuzz_action freeos_action(const char *action, eosio::name actor,
+                                 Args &&...args) {
+  return {chain::make_action(freeos_account(), eosio::name(action), actor,
+                             std::forward<Args>(args)...)};
+}
+
+template <typename... Args>
+static fuzz_action config_action(const char *action, Args &&...args) {
+  return {chain::make_action(freeosconfig_account(), eosio::name(action),
+                             freeosconfig_account(),
+                             std::forward<Args>(args)...)};
+}
+
+static fuzz_action read_only(fuzz_action action) {
+  action.read_only = true;
+  return action;
+}
+
+// an action of a user that runs tick first
+static fuzz_action ticking(fuzz_input &in, chain &c, const char *action) {
+  set_parameters(in, c);
+  set_clock(in, c);
+  queue_unstakes(in, c);
+  eosio::name user = pick_user(in, "user");
+  return freeos_action(action, user, user);
+}
+
+// an action of the admin account on a user
+static fuzz_action admin(fuzz_input &in, const char *action) {
+  return freeos_action(action, freeos_account(), pick_user(in, "user"));
+}
+
+// a freeosconfig action on a whitelist
+static fuzz_action whitelist_action(fuzz_input &in, chain &c, const char *add,
+                                    const char *action) {
+  eosio::name account = pick_user(in, "account");
+  whitelist(in, c, "already listed", add, account);
+  return config_action(action, account);
+}
+
+static eosio::asset quantity(fuzz_input &in, eosio::symbol symbol) {
+  return eosio::asset(in.value("quantity", 1000000), symbol);
+}
+
+struct fuzz_target {
+  const char *name;
+  std::function<fuzz_action(fuzz_input &, chain &)> prepare;
+};
+
+static std::vector<fuzz_target> make_targets() {
+  using F = fuzz_input;
+  return {
+      // freeos
+      {"version", [](F &, chain &) { return freeos_action("version", alice); }},
+      {"tick",
+       [](F &in, chain &c) {
+         set_parameters(in, c);
+         set_clock(in, c);
+         queue_unstakes(in, c);
+         return freeos_action("tick", alice);
+       }},
+      {"cron",
+       [](F &in, chain &c) {
+         set_parameters(in, c);
+         set_clock(in, c);
+         queue_unstakes(in, c);
+         return freeos_action("cron", eosio::name("cron"));
+       }},
+      {"reguser",
+       [](F &in, chain &c) {
+         set_parameters(in, c);
+         eosio::name user = pick_user(in, "user");
+         write_usersinfo(in, c, user);
+         return freeos_action("reguser", user, user);
+       }},
+      {"reverify",
+       [](F &in, chain &c) {
+         eosio::name user = pick_user(in, "user");
+         write_usersinfo(in, c, user);
+         return freeos_action("reverify", user, user);
+       }},
+      {"stake",
+       [](F &in, chain &c) {
+         std::string text = in.flag("memo is 'freeos stake'")
+                                ? std::string("freeos stake")
+                                : memo(in);
+         set_parameters(in, c);
+         set_clock(in, c);
+         queue_unstakes(in, c);
+         eosio::name user = pick_user(in, "user");
+         write_usersinfo(in, c, user);
+         fuzz_action stake{chain::make_action(
+             system_token_account(), eosio::name("transfer"), user, user,
+             freeos_account(), stake_units(in.value("stake", 100)), text)};
+         stake.notified = freeos_account();
+         return stake;
+       }},
+      {"unstake", [](F &in, chain &c) { return ticking(in, c, "unstake"); }},
+      {"unstakecncl",
+       [](F &in, chain &) {
+         eosio::name user = pick_user(in, "user");
+         return freeos_action("unstakecncl", user, user);
+       }},
+      {"refundstake",
+       [](F &in, chain &c) {
+         queue_unstakes(in, c);
+         return admin(in, "refundstake");
+       }},
+      {"deregister", [](F &in, chain &) { return admin(in, "deregister"); }},
+      {"claim", [](F &in, chain &c) { return ticking(in, c, "claim"); }},
+      {"unvest", [](F &in, chain &c) { return ticking(in, c, "unvest"); }},
+      {"getclaimq",
+       [](F &in, chain &c) {
+         set_parameters(in, c);
+         set_clock(in, c);
+         eosio::name user = pick_user(in, "user");
+         write_usersinfo(in, c, user);
+         return read_only(freeos_action("getclaimq", user, user));
+       }},
+      {"getuser",
+       [](F &in, chain &) {
+         eosio::name user = pick_user(in, "user");
+         return read_only(freeos_action("getuser", user, user));
+       }},
+      {"getstats",
+       [](F &in, chain &c) {
+         set_clock(in, c);
+         return read_only(freeos_action("getstats", alice));
+       }},
+      {"create",
+       [](F &in, chain &) {
+         std::string code(1 + in.value("symbol length", 6), 'A');
+         return freeos_action(
+             "create", freeos_account(), freeos_account(),
+             eosio::asset(in.value("maximum supply", UINT32_MAX),
+                          eosio::symbol(code, 4)));
+       }},
+      {"convert",
+       [](F &in, chain &) {
+         eosio::name user = pick_user(in, "user");
+         return freeos_action("convert", user, user,
+                              quantity(in, point_symbol()));
+       }},
+      {"convreq",
+       [](F &in, chain &c) {
+         eosio::name user = pick_user(in, "user");
+         if (in.flag("already requested")) {
+           setup(c, freeos_account(), "convreq", user, user, points(1));
+         }
+         return freeos_action("convreq", user, user,
+                              quantity(in, point_symbol()));
+       }},
+      {"convsettle",
+       [](F &in, chain &c) {
+         uint32_t batch = in.value("convbatchnum", UINT16_MAX);
+         set_parameter(c, "convbatchnum",
+                       padded(in.value("convbatchnum padding", MAX_ROW_STRING),
+                              batch));
+
+         // requests by the queue accounts, already burned
+         const eosio::name freeos = freeos_account();
+         uint32_t requests = in.value("conversion requests", MAX_QUEUE);
+         c.run_as(freeos, [&] {
+           convrequest_index convreqs_table(freeos, freeos.value);
+           for (uint32_t i = 0; i < requests; i++) {
+             convreqs_table.emplace(freeos, [&](convrequest &r) {
+               r.owner = queue_name(i);
+               r.amount = eosio::asset(10000, freeos_symbol());
+               r.sequence = i;
+             });
+           }
+         });
+         return freeos_action("convsettle", alice);
+       }},
+      {"convcancel",
+       [](F &in, chain &c) {
+         eosio::name user = pick_user(in, "user");
+         if (in.flag("requested")) {
+           setup(c, freeos_account(), "convreq", user, user, points(10000));
+         }
+         return freeos_action("convcancel", user, user);
+       }},
+      {"depositclear",
+       [](F &in, chain &) {
+         return freeos_action("depositclear", freedao_account(),
+                              uint64_t(in.value("iteration", 4)));
+       }},
+      {"allocate",
+       [](F &in, chain &c) {
+         eosio::name from = pick_user(in, "from");
+         eosio::name to = pick_user(in, "to");
+         whitelist(in, c, "in the transferers whitelist", "transfadd", from);
+         return freeos_action("allocate", from, from, to,
+                              quantity(in, point_symbol()), memo(in));
+       }},
+      {"mint",
+       [](F &in, chain &c) {
+         eosio::name minter = pick_user(in, "minter");
+         eosio::name to = pick_user(in, "to");
+         whitelist(in, c, "in the minters whitelist", "minteradd", minter);
+         return freeos_action("mint", minter, minter, to,
+                              quantity(in, point_symbol()), memo(in));
+       }},
+      {"burn",
+       [](F &in, chain &c) {
+         eosio::name burner = pick_user(in, "burner");
+         whitelist(in, c, "in the burners whitelist", "burneradd", burner);
+         return freeos_action("burn", burner, burner,
+                              quantity(in, point_symbol()), memo(in));
+       }},
+      {"allocmany",
+       [](F &in, chain &c) {
+         eosio::name from = pick_user(in, "from");
+         whitelist(in, c, "in the transferers whitelist", "transfadd", from);
+         auto list = recipients(in);
+         return freeos_action("allocmany", from, from, list, memo(in));
+       }},
+      {"mintmany",
+       [](F &in, chain &c) {
+         eosio::name minter = pick_user(in, "minter");
+         whitelist(in, c, "in the minters whitelist", "minteradd", minter);
+         whitelist(in, c, "in the transferers whitelist", "transfadd", minter);
+         auto list = recipients(in);
+         return freeos_action("mintmany", minter, minter, list, memo(in));
+       }},
+      {"aggset",
+       [](F &in, chain &) {
+         aggstat aggregates;
+         aggregates.staked = stake_units(in.value("staked", 1000000));
+         aggregates.vested = points(in.value("vested", UINT32_MAX));
+         aggregates.refunds = stake_units(in.value("refunds", 1000000));
+         aggregates.refundcount = in.value("refundcount", UINT32_MAX);
+         aggregates.verified = in.value("verified", UINT32_MAX);
+         aggregates.unverified = in.value("unverified", UINT32_MAX);
+         return freeos_action("aggset", freeos_account(), aggregates);
+       }},
+
+      // freeosconfig - paramupsert's value is stored whatever its length,
+      // and then read by every action that reads the parameter
+      {"config.version", [](F &, chain &) { return config_action("version"); }},
+      {"paramupsert",
+       [](F &in, chain &c) {
+         if (in.flag("parameter exists")) {
+           set_parameter(c, "fuzz",
+                         std::string(in.value("existing value length",
+                                              MAX_ACTION_DATA),
+                                     'v'));
+         }
+         return config_action(
+             "paramupsert", eosio::name(), eosio::name("fuzz"),
+             std::string(in.value("value length", MAX_ACTION_DATA), 'v'));
+       }},
+      {"paramerase",
+       [](F &in, chain &c) {
+         if (in.flag("parameter exists")) {
+           set_parameter(c, "fuzz",
+                         std::string(in.value("value length", MAX_ROW_STRING),
+                                     'v'));
+         }
+         return config_action("paramerase", eosio::name("fuzz"));
+       }},
+      {"stakeupsert",
+       [](F &in, chain &) {
+         uint64_t threshold = in.value("threshold", UINT32_MAX);
+         uint32_t v = in.value("requirement", UINT32_MAX);
+         return config_action("stakeupsert", threshold, v, v, v, v, v, v, v,
+                              v, v, v);
+       }},
+      {"stakeerase",
+       [](F &in, chain &) {
+         return config_action("stakeerase",
+                              uint64_t(in.value("threshold", 1)));
+       }},
+      {"iterupsert",
+       [](F &in, chain &) {
+         uint32_t number = in.value("iteration", 60);
+         eosio::time_point start =
+             system_config().start +
+             eosio::microseconds(system_config().iteration_length.count() *
+                                 int64_t(number));
+         return config_action(
+             "iterupsert", number, start,
+             start + eosio::seconds(in.value("length", 1209600)),
+             uint16_t(in.value("claim amount", UINT16_MAX)),
+             uint16_t(in.value("tokens required", UINT16_MAX)));
+       }},
+      {"itererase",
+       [](F &in, chain &) {
+         return config_action("itererase", in.value("iteration", 60));
+       }},
+      // sent inline by tick
+      {"iterclear",
+       [](F &in, chain &) {
+         return fuzz_action{chain::make_action(
+             freeosconfig_account(), eosio::name("iterclear"),
+             freeos_account(), in.value("iteration", 60))};
+       }},
+      {"currentrate",
+       [](F &in, chain &) {
+         return config_action("currentrate",
+                              in.value("price", 1000000) / 10000.0);
+       }},
+      {"targetrate",
+       [](F &in, chain &) {
+         return config_action("targetrate",
+                              in.value("price", 1000000) / 10000.0);
+       }},
+      {"rateerase",
+       [](F &in, chain &c) {
+         if (in.flag("rate exists")) {
+           setup(c, freeosconfig_account(), "targetrate",
+                 freeosconfig_account(), 0.01);
+         }
+         return config_action("rateerase");
+       }},
+      {"transfadd",
+       [](F &in, chain &c) {
+         return whitelist_action(in, c, "transfadd", "transfadd");
+       }},
+      {"transferase",
+       [](F &in, chain &c) {
+         return whitelist_action(in, c, "transfadd", "transferase");
+       }},
+      {"minteradd",
+       [](F &in, chain &c) {
+         return whitelist_action(in, c, "minteradd", "minteradd");
+       }},
+      {"mintererase",
+       [](F &in, chain &c) {
+         return whitelist_action(in, c, "minteradd", "mintererase");
+       }},
+      {"burneradd",
+       [](F &in, chain &c) {
+         return whitelist_action(in, c, "burneradd", "burneradd");
+       }},
+      {"burnererase",
+       [](F &in, chain &c) {
+         return whitelist_action(in, c, "burneradd", "burnererase");
+       }},
+#ifdef TEST_BUILD
+      {"userverify",
+       [](F &in, chain &c) {
+         eosio::name user = pick_user(in, "user");
+         write_usersinfo(in, c, user, freeosconfig_account());
+         return config_action("userverify", user, freeosconfig_account(),
+                              in.flag("verified"));
+       }},
+      // the row's kyc entries are compared and the vector is copied on
+      // modify
+      {"addkyc",
+       [](F &in, chain &c) {
+         eosio::name user = pick_user(in, "user");
+         write_usersinfo(in, c, user, freeosconfig_account());
+         eosio::name provider =
+             in.flag("provider already approved") ? freeosconfig_account()
+                                                  : eosio::name("kycprovider");
+         return config_action(
+             "addkyc", user, provider,
+             std::string(in.value("kyc_level length", MAX_ACTION_DATA), 'k'),
+             uint64_t(0));
+       }},
+#endif
+  };
+}
+
+// ---------------------------------------------------------------------------
+// the search
+
+using input = std::vector<uint8_t>;
+
+// the power of two of a count, 0 for 0
+static uint64_t bucket(uint64_t count) {
+  uint64_t bits = 0;
+  for (; count > 0; count >>= 1) {
+    bits++;
+  }
+  return bits;
+}
+
+static void add_features(const transaction_trace &trace,
+                         std::set<uint64_t> &features) {
+  features.insert(std::hash<std::string>()(trace.error));
+  // the actions, not their receivers - a transfer notifies each recipient
+  for (const auto &action : trace.actions) {
+    features.insert(action.account.value ^ (action.action.value * 31) ^
+                    (uint64_t(action.receiver != action.account) << 8) ^
+                    action.depth);
+  }
+
+  counters total = trace.total();
+  const uint64_t counts[] = {total.db_reads(),       total.db_writes(),
+                             total.inline_actions,   total.notifications,
+                             total.bytes_unpacked,   total.bytes_packed,
+                             total.heap_allocations(), total.heap_bytes};
+  for (size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) {
+    features.insert(uint64_t(i + 1) << 56 | bucket(counts[i]));
+  }
+}
+
+struct run_result {
+  fuzz_cost cost;
+  std::string outcome; // "ok" or the error
+};
+
+static run_result run_input(chain &c, const fuzz_target &target,
+                            const input &data, std::set<uint64_t> *features,
+                            std::string *trace = nullptr) {
+  eosio::time_point now = c.time();
+  c.checkpoint();
+
+  fuzz_input in(data.data(), data.size(), trace);
+  fuzz_action a = target.prepare(in, c);
+  transaction_trace result =
+      a.notified != eosio::name()
+          ? c.push_notification(a.notified, a.action)
+          : c.push_transaction({a.action}, a.read_only);
+
+  c.rollback();
+  c.set_time(now);
+
+  if (features != nullptr) {
+    add_features(result, *features);
+  }
+  return {fuzz_cost(result.total()), result.succeeded ? "ok" : result.error};
+}
+
+// apply 1 to 4 random mutations, libFuzzer style
+static void mutate(input &data, const std::vector<input> &corpus,
+                   std::mt19937_64 &random, size_t max_len) {
+  static const uint8_t interesting[] = {0x00, 0x01, 0x7f, 0x80, 0xff};
+
+  int mutations = 1 + random() % 4;
+  for (int m = 0; m < mutations; m++) {
+    if (data.empty()) {
+      data.push_back(random());
+      continue;
+    }
+    size_t at = random() % data.size();
+
+    switch (random() % 7) {
+    case 0: // flip a bit
+      data[at] ^= 1 << (random() % 8);
+      break;
+    case 1: // a random byte
+      data[at] = random();
+      break;
+    case 2: // an interesting byte
+      data[at] = interesting[random() % sizeof(interesting)];
+      break;
+    case 3: // insert bytes
+      if (data.size() < max_len) {
+        size_t n = std::min<size_t>(1 + random() % 8, max_len - data.size());
+        for (size_t i = 0; i < n; i++) {
+          data.insert(data.begin() + at, uint8_t(random()));
+        }
+      }
+      break;
+    case 4: { // erase bytes
+      size_t n = std::min<size_t>(1 + random() % 8, data.size() - at);
+      data.erase(data.begin() + at, data.begin() + at + n);
+      break;
+    }
+    case 5: // increment a byte
+      data[at]++;
+      break;
+    case 6: { // copy part of another corpus entry over this one
+      const input &other = corpus[random() % corpus.size()];
+      if (!other.empty()) {
+        size_t from = random() % other.size();
+        size_t n = std::min(other.size() - from, data.size() - at);
+        std::copy_n(other.begin() + from, n, data.begin() + at);
+      }
+      break;
+    }
+    }
+  }
+}
+
+struct search_result {
+  input worst;
+  run_result worst_run;
+  size_t corpus = 0;
+  size_t features = 0;
+};
+
+static search_result search(chain &c, const fuzz_target &target, uint64_t runs,
+                            size_t max_len, uint64_t seed) {
+  std::mt19937_64 random(seed);
+  std::set<uint64_t> features;
+  std::vector<input> corpus = {input()};
+
+  search_result result;
+  result.worst_run = run_input(c, target, corpus[0], &features);
+  std::vector<double> scores = {result.worst_run.cost.score()};
+
+  for (uint64_t run = 0; run < runs; run++) {
+    // half the time mutate the most expensive input, otherwise any
+    size_t parent = random() % 2 == 0
+                        ? std::max_element(scores.begin(), scores.end()) -
+                              scores.begin()
+                        : random() % corpus.size();
+    input data = corpus[parent];
+    mutate(data, corpus, random, max_len);
+
+    std::set<uint64_t> reached;
+    run_result outcome = run_input(c, target, data, &reached);
+
+    size_t known = features.size();
+    features.insert(reached.begin(), reached.end());
+    bool more_expensive =
+        outcome.cost.score() > result.worst_run.cost.score();
+
+    if (features.size() > known || more_expensive) {
+      corpus.push_back(data);
+      scores.push_back(outcome.cost.score());
+    }
+    if (more_expensive) {
+      result.worst = data;
+      result.worst_run = outcome;
+    }
+  }
+
+  result.corpus = corpus.size();
+  result.features = features.size();
+  return result;
+}
+
+static void print_run(const run_result &run) {
+  const fuzz_cost &cost = run.cost;
+  std::printf("  db_reads=%llu db_writes=%llu inline_actions=%llu "
+              "notifications=%llu\n"
+              "  bytes_decoded=%llu bytes_packed=%llu heap_allocations=%llu "
+              "bytes_allocated=%llu score=%.0f\n"
+              "  outcome: %s\n",
+              (unsigned long long)cost.db_reads,
+              (unsigned long long)cost.db_writes,
+              (unsigned long long)cost.inline_actions,
+              (unsigned long long)cost.notifications,
+              (unsigned long long)cost.bytes_decoded,
+              (unsigned long long)cost.bytes_packed,
+              (unsigned long long)cost.heap_allocations,
+              (unsigned long long)cost.bytes_allocated, cost.score(),
+              run.outcome.c_str());
+}
+
+int main(int argc, char *argv[]) {
+  uint64_t runs = 2000;
+  size_t max_len = 512;
+  uint64_t seed = 1;
+  const char *save = nullptr;
+  const char *replay = nullptr;
+  int arg = 1;
+
+  for (; arg + 1 < argc && argv[arg][0] == '-'; arg += 2) {
+    std::string option = argv[arg];
+    const char *value = argv[arg + 1];
+
+    if (option == "--runs") {
+      runs = std::strtoull(value, nullptr, 10);
+    } else if (option == "--max-len") {
+      max_len = std::max(1ul, std::strtoul(value, nullptr, 10));
+    } else if (option == "--seed") {
+      seed = std::strtoull(value, nullptr, 10);
+    } else if (option == "--save") {
+      save = value;
+    } else if (option == "--replay") {
+      replay = value;
+    } else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  const std::vector<fuzz_target> targets = make_targets();
+  std::vector<const fuzz_target *> selected;
+  for (; arg < argc; arg++) {
+    const fuzz_target *found = nullptr;
+    for (const fuzz_target &t : targets) {
+      if (std::strcmp(t.name, argv[arg]) == 0) {
+        found = &t;
+      }
+    }
+    if (found == nullptr) {
+      std::fprintf(stderr, "unknown target %s\n", argv[arg]);
+      usage(argv[0]);
+      return 1;
+    }
+    selected.push_back(found);
+  }
+  if (selected.empty()) {
+    for (const fuzz_target &t : targets) {
+      selected.push_back(&t);
+    }
+  }
+
+  chain c;
+  build_system(c);
+
+  if (replay != nullptr) {
+    std::ifstream file(replay, std::ios::binary);
+    if (!file || selected.size() != 1) {
+      usage(argv[0]);
+      return 1;
+    }
+    input data((std::istreambuf_iterator<char>(file)),
+               std::istreambuf_iterator<char>());
+    std::string trace;
+    run_result run = run_input(c, *selected[0], data, nullptr, &trace);
+    std::printf("%s:\n%s", selected[0]->name, trace.c_str());
+    print_run(run);
+    return 0;
+  }
+
+  for (const fuzz_target *target : selected) {
+    auto started = std::chrono::steady_clock::now();
+    search_result result = search(c, *target, runs, max_len, seed);
+    double seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - started)
+                         .count();
+
+    std::string trace;
+    run_input(c, *target, result.worst, nullptr, &trace);
+
+    std::printf("%s: %llu runs in %.2fs, %zu features, corpus %zu\n"
+                "most expensive input (%zu bytes):\n%s",
+                target->name, (unsigned long long)runs, seconds,
+                result.features, result.corpus, result.worst.size(),
+                trace.c_str());
+    print_run(result.worst_run);
+    std::printf("\n");
+
+    if (save != nullptr) {
+      std::string path = std::string(save) + "/" + target->name + ".bin";
+      std::ofstream file(path, std::ios::binary);
+      file.write(reinterpret_cast<const char *>(result.worst.data()),
+                 result.worst.size());
+      if (!file) {
+        std::perror(path.c_str());
+        return 1;
+      }
+    }
+  }
+
+  return 0;
+}
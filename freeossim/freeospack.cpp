@@ -0,0 +1,204 @@
+// freeospack - packs relayer actions into transactions with freeospack.hpp,
+// offline, and reports the transactions and the packing rate.
+//
+// Reads one action per line (or - for stdin):
+//
+//   claim <user>
+//   unvest <user>
+//   reguser <user>
+//   unstake <user>
+//   stake <user> <quantity>       e.g. stake alice 10.000000 XUSDC
+//
+// Each action is authorised by the user's active permission, except that
+// --relayer authorises them all with the relayer's. The packed transactions
+// have an empty TaPoS header (a relayer's sink sets it before signing) and
+// are written as hex with --hex.
+//
+// usage: ./freeospack [options] <actions file> - see usage() below
+
+#include "freeosactions.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+using namespace freedao::relay;
+
+static void usage(const char *program) {
+  std::printf(
+      "usage: %s [options] <actions file>\n"
+      "  --freeos NAME      the freeos account (freeosclaim)\n"
+      "  --token NAME       the staked currency's token contract (xtokens)\n"
+      "  --relayer NAME     authorise every action with NAME@active\n"
+      "  --max-bytes N      packed transaction size limit (2048)\n"
+      "  --max-cpu N        estimated CPU limit per transaction, us (10000)\n"
+      "  --max-actions N    actions per transaction, at most 127 (50)\n"
+      "  --cpu ACTION=N     CPU estimate for an action, us - repeat for more\n"
+      "                     (500 for each)\n"
+      "  --hex              write each transaction as hex\n",
+      program);
+}
+
+// an action line, kept so that the string_views in the actions stay valid
+struct relay_action {
+  std::string action;
+  std::string user;
+  asset quantity = {};
+};
+
+int main(int argc, char *argv[]) {
+  std::string freeos_account = "freeosclaim";
+  std::string token_account = "xtokens";
+  std::string relayer;
+  batch_limits limits;
+  bool hex = false;
+  int arg = 1;
+
+  for (; arg < argc && argv[arg][0] == '-' && argv[arg][1] != '\0'; arg++) {
+    std::string option = argv[arg];
+
+    if (option == "--hex") {
+      hex = true;
+      continue;
+    }
+    if (arg + 1 >= argc) {
+      usage(argv[0]);
+      return 1;
+    }
+    const char *value = argv[++arg];
+
+    if (option == "--freeos") {
+      freeos_account = value;
+    } else if (option == "--token") {
+      token_account = value;
+    } else if (option == "--relayer") {
+      relayer = value;
+    } else if (option == "--max-bytes") {
+      limits.max_bytes = std::strtoul(value, nullptr, 10);
+    } else if (option == "--max-cpu") {
+      limits.max_cpu_us = std::strtoul(value, nullptr, 10);
+    } else if (option == "--max-actions") {
+      limits.max_actions = std::strtoul(value, nullptr, 10);
+    } else if (option == "--cpu") {
+      const char *equals = std::strchr(value, '=');
+      if (equals == nullptr) {
+        usage(argv[0]);
+        return 1;
+      }
+      limits.cpu_us[name_value(std::string_view(value, equals - value))] =
+          std::strtoul(equals + 1, nullptr, 10);
+    } else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  if (arg + 1 != argc) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  std::ifstream actions_file;
+  std::istream *input = &std::cin;
+  if (std::string(argv[arg]) != "-") {
+    actions_file.open(argv[arg]);
+    if (!actions_file) {
+      std::perror(argv[arg]);
+      return 1;
+    }
+    input = &actions_file;
+  }
+
+  std::vector<relay_action> actions;
+  std::string line;
+  while (std::getline(*input, line)) {
+    std::istringstream fields(line);
+    relay_action a;
+    std::string amount, code;
+
+    if (!(fields >> a.action >> a.user)) {
+      continue;
+    }
+    if (a.action == "stake" &&
+        !(fields >> amount >> code && parse_asset(amount + " " + code,
+                                                  a.quantity))) {
+      std::fprintf(stderr, "bad stake: %s\n", line.c_str());
+      return 1;
+    }
+    actions.push_back(std::move(a));
+  }
+
+  const uint64_t freeos = name_value(freeos_account);
+  const uint64_t token = name_value(token_account);
+  const uint64_t active = name_value("active");
+
+  uint64_t transactions = 0;
+  uint64_t packed_bytes = 0;
+  uint64_t packed_actions = 0;
+
+  auto started = std::chrono::steady_clock::now();
+  {
+    batcher batch(limits, [&](packed_transaction &trx) {
+      transactions++;
+      packed_bytes += trx.size();
+      packed_actions += trx.actions();
+
+      if (hex) {
+        std::printf("%u actions, %zu bytes, %u us: ", trx.actions(),
+                    trx.size(), trx.cpu_us());
+        for (size_t i = 0; i < trx.size(); i++) {
+          std::printf("%02x", trx.data()[i]);
+        }
+        std::printf("\n");
+      }
+    });
+
+    for (const relay_action &a : actions) {
+      uint64_t user = name_value(a.user);
+      permission_level auth = {relayer.empty() ? user : name_value(relayer),
+                               active};
+      bool ok;
+
+      if (a.action == "claim") {
+        ok = batch.add(freeos, auth, freeos::claim{user});
+      } else if (a.action == "unvest") {
+        ok = batch.add(freeos, auth, freeos::unvest{user});
+      } else if (a.action == "reguser") {
+        ok = batch.add(freeos, auth, freeos::reguser{user});
+      } else if (a.action == "unstake") {
+        ok = batch.add(freeos, auth, freeos::unstake{user});
+      } else if (a.action == "stake") {
+        ok = batch.add(token, auth,
+                       token::transfer{user, freeos, a.quantity,
+                                       "freeos stake"});
+      } else {
+        std::fprintf(stderr, "unknown action %s\n", a.action.c_str());
+        return 1;
+      }
+
+      if (!ok) {
+        std::fprintf(stderr, "%s %s is over the limits on its own\n",
+                     a.action.c_str(), a.user.c_str());
+        return 1;
+      }
+    }
+  }
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - started)
+                       .count();
+
+  std::printf("%llu actions in %llu transactions, %llu bytes, %.1f actions "
+              "per transaction\n",
+              (unsigned long long)packed_actions,
+              (unsigned long long)transactions,
+              (unsigned long long)packed_bytes,
+              transactions == 0 ? 0.0 : double(packed_actions) / transactions);
+  std::printf("packed in %.3f s, %.0f actions/s\n", seconds,
+              seconds > 0 ? packed_actions / seconds : 0.0);
+
+  return 0;
+}
@@ -0,0 +1,297 @@
+#pragma once
+
+// Native action packing for relayers.
+//
+// The action structs in freeosactions.hpp (generated from the contracts'
+// ABIs by abi_actions.sh) serialize their arguments with write_value, in ABI
+// field order, with no ABI lookup or JSON at run time. A batcher packs
+// actions straight into the bytes of a transaction - the action data is
+// written in place, not built separately and copied - and hands each
+// transaction to a sink when the next action would take it over the
+// configured size, CPU or action limits. Signing and submission are up to the
+// sink, so everything here runs offline.
+
+#include "eosname.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace freedao {
+namespace relay {
+
+using sim::name_value;
+
+struct asset {
+  int64_t amount;
+  uint64_t symbol; // precision in the low byte, then the code
+};
+
+// a symbol's value, e.g. symbol_value("XPR", 4)
+constexpr uint64_t symbol_value(std::string_view code, uint8_t precision) {
+  uint64_t symbol = 0;
+  for (size_t i = code.size(); i > 0; i--) {
+    symbol = symbol << 8 | uint8_t(code[i - 1]);
+  }
+  return symbol << 8 | precision;
+}
+
+// parse an asset written as e.g. "10.0000 XPR". Returns false if it is not
+// one.
+inline bool parse_asset(std::string_view text, asset &a) {
+  size_t space = text.find(' ');
+  if (space == std::string_view::npos || space == 0) {
+    return false;
+  }
+
+  std::string_view number = text.substr(0, space);
+  bool negative = number[0] == '-';
+  if (negative) {
+    number.remove_prefix(1);
+  }
+
+  int64_t amount = 0;
+  uint8_t precision = 0;
+  bool point = false;
+  for (char c : number) {
+    if (c == '.' && !point) {
+      point = true;
+    } else if (c >= '0' && c <= '9') {
+      amount = amount * 10 + (c - '0');
+      precision += point;
+    } else {
+      return false;
+    }
+  }
+
+  std::string_view code = text.substr(space + 1);
+  if (code.empty() || code.size() > 7) {
+    return false;
+  }
+
+  a.amount = negative ? -amount : amount;
+  a.symbol = symbol_value(code, precision);
+  return true;
+}
+
+struct permission_level {
+  uint64_t actor;
+  uint64_t permission;
+};
+
+// a stream that only counts bytes, for sizing an action before writing it
+class size_stream {
+public:
+  void write(const void *, size_t n) { size += n; }
+  size_t size = 0;
+};
+
+// a stream over memory already sized with size_stream
+class buffer_stream {
+public:
+  explicit buffer_stream(uint8_t *pos) : pos(pos) {}
+  void write(const void *bytes, size_t n) {
+    std::memcpy(pos, bytes, n);
+    pos += n;
+  }
+  uint8_t *pos;
+};
+
+// the ABI serialization of each field type. Integers and floats are little
+// endian, as on every host nodeos runs on.
+template <typename Stream> void write_varuint32(Stream &s, uint32_t value) {
+  do {
+    uint8_t b = value & 0x7f;
+    value >>= 7;
+    b |= (value > 0) << 7;
+    s.write(&b, 1);
+  } while (value > 0);
+}
+
+template <typename Stream, typename T>
+std::enable_if_t<std::is_arithmetic_v<T>> write_value(Stream &s, T value) {
+  s.write(&value, sizeof(value));
+}
+
+template <typename Stream> void write_value(Stream &s, const asset &value) {
+  write_value(s, value.amount);
+  write_value(s, value.symbol);
+}
+
+template <typename Stream>
+void write_value(Stream &s, std::string_view value) {
+  write_varuint32(s, value.size());
+  s.write(value.data(), value.size());
+}
+
+// an ABI struct argument, e.g. freeos::pair_name_asset - its fields in order
+template <typename Stream, typename T>
+auto write_value(Stream &s, const T &value) -> decltype(value.write(s)) {
+  value.write(s);
+}
+
+template <typename Stream, typename T>
+void write_value(Stream &s, const std::vector<T> &values) {
+  write_varuint32(s, values.size());
+  for (const auto &value : values) {
+    write_value(s, value);
+  }
+}
+
+namespace token {
+
+// eosio.token::transfer - the stake is a transfer to freeos with the memo
+// "freeos stake"
+struct transfer {
+  static constexpr uint64_t action_name = name_value("transfer");
+  uint64_t from;
+  uint64_t to;
+  asset quantity;
+  std::string_view memo;
+
+  template <typename Stream> void write(Stream &s) const {
+    write_value(s, from);
+    write_value(s, to);
+    write_value(s, quantity);
+    write_value(s, memo);
+  }
+};
+
+} // namespace token
+
+// a transaction, as the bytes of a packed (unsigned) transaction. The header
+// is fixed-size - no net limit, no delay, no context-free actions and fewer
+// than 128 actions, so that each varuint32 in it is one byte - which lets
+// the actions be written in place as they are added.
+class packed_transaction {
+public:
+  static constexpr size_t HEADER_SIZE = 4 + 2 + 4 + 1 + 1 + 1 + 1 + 1;
+  static constexpr uint32_t MAX_ACTIONS = 127;
+
+  packed_transaction() { clear(); }
+
+  // the TaPoS and CPU limit fields - set by the sink before signing
+  void set_header(uint32_t expiration, uint16_t ref_block_num,
+                  uint32_t ref_block_prefix, uint8_t max_cpu_usage_ms = 0) {
+    std::memcpy(&bytes[0], &expiration, 4);
+    std::memcpy(&bytes[4], &ref_block_num, 2);
+    std::memcpy(&bytes[6], &ref_block_prefix, 4);
+    bytes[11] = max_cpu_usage_ms;
+  }
+
+  const uint8_t *data() const { return bytes.data(); }
+  size_t size() const { return bytes.size(); }
+  uint32_t actions() const { return action_count; }
+  uint32_t cpu_us() const { return cpu_estimate; }
+
+private:
+  friend class batcher;
+
+  void clear() {
+    bytes.assign(HEADER_SIZE, 0);
+    action_count = 0;
+    cpu_estimate = 0;
+  }
+
+  // append the transaction extensions and set the action count
+  void finish() {
+    bytes[HEADER_SIZE - 1] = action_count;
+    bytes.push_back(0);
+  }
+
+  std::vector<uint8_t> bytes;
+  uint32_t action_count;
+  uint32_t cpu_estimate;
+};
+
+struct batch_limits {
+  uint32_t max_bytes = 2048;   // packed transaction size
+  uint32_t max_cpu_us = 10000; // estimated CPU per transaction
+  uint32_t max_actions = 50;   // no more than packed_transaction::MAX_ACTIONS
+  uint32_t default_cpu_us = 500;
+  std::map<uint64_t, uint32_t> cpu_us; // estimates by action name
+};
+
+// packs actions into transactions within the limits
+class batcher {
+public:
+  // signs and submits a transaction - the transaction is reused afterwards
+  using sink = std::function<void(packed_transaction &)>;
+
+  batcher(batch_limits limits, sink flushed)
+      : limits(std::move(limits)), flushed(std::move(flushed)) {
+    if (this->limits.max_actions > packed_transaction::MAX_ACTIONS) {
+      this->limits.max_actions = packed_transaction::MAX_ACTIONS;
+    }
+    current.bytes.reserve(this->limits.max_bytes);
+  }
+
+  ~batcher() { flush(); }
+
+  // add an action, flushing the current transaction first if the action
+  // does not fit in it. Returns false if the action alone is over a limit.
+  template <typename Action>
+  bool add(uint64_t contract, const permission_level &authorization,
+           const Action &action) {
+    size_stream data;
+    action.write(data);
+    size_stream header;
+    write_varuint32(header, data.size);
+
+    size_t size = 8 + 8 + 1 + sizeof(permission_level) + header.size +
+                  data.size;
+    auto estimate = limits.cpu_us.find(Action::action_name);
+    uint32_t cpu_us = estimate == limits.cpu_us.end() ? limits.default_cpu_us
+                                                      : estimate->second;
+
+    if (packed_transaction::HEADER_SIZE + size + 1 > limits.max_bytes ||
+        cpu_us > limits.max_cpu_us) {
+      return false;
+    }
+
+    if (current.action_count == limits.max_actions ||
+        current.bytes.size() + size + 1 > limits.max_bytes ||
+        current.cpu_estimate + cpu_us > limits.max_cpu_us) {
+      flush();
+    }
+
+    size_t offset = current.bytes.size();
+    current.bytes.resize(offset + size);
+    buffer_stream out(&current.bytes[offset]);
+
+    write_value(out, contract);
+    write_value(out, Action::action_name);
+    write_varuint32(out, 1);
+    write_value(out, authorization.actor);
+    write_value(out, authorization.permission);
+    write_varuint32(out, data.size);
+    action.write(out);
+
+    current.action_count++;
+    current.cpu_estimate += cpu_us;
+    return true;
+  }
+
+  // hand the current transaction, if it has any actions, to the sink
+  void flush() {
+    if (current.action_count == 0) {
+      return;
+    }
+    current.finish();
+    flushed(current);
+    current.clear();
+  }
+
+private:
+  batch_limits limits;
+  sink flushed;
+  packed_transaction current;
+};
+
+} // namespace relay
+} // namespace freedao
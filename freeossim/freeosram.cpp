@@ -0,0 +1,249 @@
+// freeosram - RAM accounting for the freeos contract.
+//
+// Reads the freeos table scopes with their row counts, as listed by
+// ram_scopes.sh (from a chain) or freeossim --scopes (from a simulation), one
+// line per table and scope:
+//
+//   <table> <scope> <rows> <payer>
+//
+// and reports, using the packed row sizes and the nodeos overheads in
+// freeossim.hpp:
+//   - the RAM of each table, and who pays for it
+//   - the RAM per registered user
+//   - the RAM needed at the --target user counts
+//   - the RAM of alternative user table layouts
+//   - the rows that could be reclaimed
+//
+// Build it with -DLAZY_UNLOCK (compile.sh -DLAZY_UNLOCK) for the rows of a
+// LAZY_UNLOCK build of the contract.
+//
+// usage: ./freeosram [--contract NAME] [--target USERS]... <scopes file>
+
+#include "freeossim.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+
+using namespace freedao::sim;
+
+// the freeos tables and their packed row sizes
+struct table_layout {
+  const char *table;
+  int64_t row_size;
+  int64_t row_overhead;
+  bool user_scoped; // one scope per user
+};
+
+constexpr table_layout TABLES[] = {
+    {"users", USER_ROW_SIZE, ROW_OVERHEAD_BYTES, true},
+    {"vestaccounts", VESTACCOUNT_ROW_SIZE, ROW_OVERHEAD_BYTES, true},
+    {"accounts", ACCOUNT_ROW_SIZE, ROW_OVERHEAD_BYTES, true},
+    {"unvests", UNVEST_ROW_SIZE, ROW_OVERHEAD_BYTES, true},
+    {"unstakereqs", UNSTAKEREQ_ROW_SIZE,
+     ROW_OVERHEAD_BYTES + SECONDARY_INDEX_BYTES, false},
+    {"deposits", DEPOSIT_ROW_SIZE, ROW_OVERHEAD_BYTES, false},
+    {"statistics", STATISTIC_ROW_SIZE, ROW_OVERHEAD_BYTES, false},
+    {"iterstats", ITERSTAT_ROW_SIZE, ROW_OVERHEAD_BYTES, false},
+    {"claimquote", CLAIMQUOTE_ROW_SIZE, ROW_OVERHEAD_BYTES, false},
+    {"aggstats", AGGSTAT_ROW_SIZE, ROW_OVERHEAD_BYTES, false},
+    {"convreqs", CONVREQUEST_ROW_SIZE,
+     ROW_OVERHEAD_BYTES + SECONDARY_INDEX_BYTES, false},
+    {"stat", CURRENCY_STATS_ROW_SIZE, ROW_OVERHEAD_BYTES, false},
+};
+
+constexpr int TABLE_COUNT = sizeof(TABLES) / sizeof(TABLES[0]);
+enum user_table { tbl_users, tbl_vestaccounts, tbl_accounts, tbl_unvests };
+
+struct table_totals {
+  uint64_t scopes = 0;
+  uint64_t rows = 0;
+  int64_t contract_bytes = 0; // paid for by the contract
+  int64_t user_bytes = 0;     // paid for by someone else
+};
+
+static int table_index(const std::string &table) {
+  for (int i = 0; i < TABLE_COUNT; i++) {
+    if (table == TABLES[i].table) {
+      return i;
+    }
+  }
+
+  return -1;
+}
+
+static int64_t table_bytes(int table, uint64_t rows) {
+  return TABLE_SCOPE_BYTES +
+         rows * (TABLES[table].row_overhead + TABLES[table].row_size);
+}
+
+static void usage(const char *program) {
+  std::printf("usage: %s [--contract NAME] [--target USERS]... <scopes file>\n",
+              program);
+}
+
+int main(int argc, char *argv[]) {
+  std::string contract = "freeos";
+  std::vector<uint64_t> targets;
+  int arg = 1;
+
+  for (; arg + 1 < argc && argv[arg][0] == '-'; arg += 2) {
+    if (std::strcmp(argv[arg], "--contract") == 0) {
+      contract = argv[arg + 1];
+    } else if (std::strcmp(argv[arg], "--target") == 0) {
+      targets.push_back(std::strtoull(argv[arg + 1], nullptr, 10));
+    } else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  if (arg + 1 != argc) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  std::ifstream scopes(argv[arg]);
+  if (!scopes) {
+    std::perror(argv[arg]);
+    return 1;
+  }
+
+  table_totals totals[TABLE_COUNT];
+  std::unordered_map<std::string, uint8_t> user_tables; // scope -> table bits
+  uint64_t other_rows = 0;
+
+  std::string table, scope, payer;
+  uint64_t rows;
+  while (scopes >> table >> scope >> rows >> payer) {
+    int t = table_index(table);
+    if (t < 0) {
+      other_rows += rows;
+      continue;
+    }
+
+    int64_t bytes = table_bytes(t, rows);
+    totals[t].scopes++;
+    totals[t].rows += rows;
+    (payer == contract ? totals[t].contract_bytes : totals[t].user_bytes) +=
+        bytes;
+
+    if (TABLES[t].user_scoped && rows > 0) {
+      user_tables[scope] |= 1 << t;
+    }
+  }
+
+  // per table
+  uint64_t users = totals[tbl_users].rows;
+  int64_t user_scoped_bytes = 0;
+  int64_t shared_bytes = 0;
+
+  std::printf("%-14s %12s %12s %16s %16s %10s\n", "table", "scopes", "rows",
+              "contract bytes", "other bytes", "per user");
+  for (int t = 0; t < TABLE_COUNT; t++) {
+    int64_t bytes = totals[t].contract_bytes + totals[t].user_bytes;
+    (TABLES[t].user_scoped ? user_scoped_bytes : shared_bytes) += bytes;
+
+    std::printf("%-14s %12llu %12llu %16lld %16lld %10.1f\n", TABLES[t].table,
+                (unsigned long long)totals[t].scopes,
+                (unsigned long long)totals[t].rows,
+                (long long)totals[t].contract_bytes,
+                (long long)totals[t].user_bytes,
+                users == 0 ? 0.0 : double(bytes) / users);
+  }
+  if (other_rows > 0) {
+    std::printf("(%llu rows of other tables not counted)\n",
+                (unsigned long long)other_rows);
+  }
+
+  int64_t total_bytes = user_scoped_bytes + shared_bytes;
+  double per_user = users == 0 ? 0.0 : double(total_bytes) / users;
+  std::printf("\n%llu registered users, %lld bytes, %.1f bytes per user\n",
+              (unsigned long long)users, (long long)total_bytes, per_user);
+
+  // projection - the per-user cost of the current population, scaled
+  for (uint64_t target : targets) {
+    std::printf("projection for %llu users: %.1f MiB\n",
+                (unsigned long long)target, per_user * target / 1048576.0);
+  }
+
+  // alternative layouts of the user-scoped tables, for the same users
+  int64_t unvests_in_users = 0; // unvests.iteration_number in the users row
+  int64_t vested_in_users = 0;  // the vested balance in the users row
+  int64_t single_users = 0;     // one contract-scoped row per user
+  uint64_t orphan_vestaccounts = 0;
+  uint64_t orphan_unvests = 0;
+
+  const int64_t user_row = table_bytes(tbl_users, 1);
+  const int64_t vest_row = table_bytes(tbl_vestaccounts, 1);
+  const int64_t unvest_row = table_bytes(tbl_unvests, 1);
+  const int64_t account_row = table_bytes(tbl_accounts, 1);
+
+  for (const auto &[name, tables] : user_tables) {
+    bool has_user = tables & (1 << tbl_users);
+    bool has_vest = tables & (1 << tbl_vestaccounts);
+    bool has_unvest = tables & (1 << tbl_unvests);
+    bool has_account = tables & (1 << tbl_accounts);
+
+    int64_t accounts = has_account ? account_row : 0;
+    int64_t vest = has_vest ? vest_row : 0;
+    int64_t unvest = has_unvest ? unvest_row : 0;
+
+    if (!has_user) {
+      // left behind by deregister
+      orphan_vestaccounts += has_vest;
+      orphan_unvests += has_unvest;
+      unvests_in_users += accounts + vest + unvest;
+      vested_in_users += accounts + vest + unvest;
+      single_users += accounts + vest + unvest;
+      continue;
+    }
+
+    unvests_in_users += user_row + UNVEST_ROW_SIZE + vest + accounts;
+    vested_in_users += user_row + VESTACCOUNT_ROW_SIZE + unvest + accounts;
+    single_users += ROW_OVERHEAD_BYTES + 8 + USER_ROW_SIZE +
+                    VESTACCOUNT_ROW_SIZE + UNVEST_ROW_SIZE + accounts;
+  }
+
+  struct layout {
+    const char *description;
+    int64_t bytes;
+  } layouts[] = {
+      {"current", user_scoped_bytes},
+      {"unvests.iteration_number in users", unvests_in_users},
+      {"vested balance in users", vested_in_users},
+      {"one contract-scoped row per user", single_users},
+  };
+
+  std::printf("\n%-36s %16s %10s %10s\n", "user table layout", "bytes",
+              "per user", "saving");
+  for (const layout &l : layouts) {
+    std::printf("%-36s %16lld %10.1f %9.1f%%\n", l.description,
+                (long long)(l.bytes + shared_bytes),
+                users == 0 ? 0.0 : double(l.bytes + shared_bytes) / users,
+                total_bytes == 0
+                    ? 0.0
+                    : 100.0 * (user_scoped_bytes - l.bytes) / total_bytes);
+  }
+
+  // reclaimable rows
+  const table_totals &deposits = totals[table_index("deposits")];
+  uint64_t old_deposits = deposits.rows > 0 ? deposits.rows - 1 : 0;
+
+  std::printf("\nreclaimable:\n");
+  std::printf("  %llu unvests rows of deregistered users (%lld bytes)\n",
+              (unsigned long long)orphan_unvests,
+              (long long)(orphan_unvests * unvest_row));
+  std::printf("  %llu vestaccounts rows of deregistered users (%lld bytes) - "
+              "check for a balance first\n",
+              (unsigned long long)orphan_vestaccounts,
+              (long long)(orphan_vestaccounts * vest_row));
+  std::printf("  %llu deposits rows before the latest iteration (%lld bytes) "
+              "- depositclear once freedao has processed them\n",
+              (unsigned long long)old_deposits,
+              (long long)(old_deposits * (ROW_OVERHEAD_BYTES + DEPOSIT_ROW_SIZE)));
+
+  return 0;
+}
@@ -0,0 +1,530 @@
+// freeosreplay - replays an exported freeos action history on the host build
+// of the contracts (../host, see freeoshost.hpp) and flags the expensive
+// actions.
+//
+// The replay starts from a new freeos system - the freeosconfig parameters
+// and stakereqs from the options, no iterations and empty freeos tables -
+// and pushes the history's actions one at a time, in history order, with
+// their arguments and authorizations and the chain clock at their original
+// timestamps. The freeosconfig actions (iterupsert, paramupsert,
+// currentrate, targetrate, ...) rebuild the iterations, parameters and
+// rates as they were at each point of the history, so the rollover ticks,
+// unstake refunds and freedao tiers happen where they happened on chain. An
+// action is flagged if its table accesses (db_reads + db_writes, counted by
+// the host chain for the whole transaction) or its recorded CPU exceed the
+// thresholds.
+//
+// The history only contains actions that succeeded. If one fails in the
+// replay (e.g. because of a balance the history does not show, such as an
+// AIRKEY), it is reported as a divergence with the contract's error, and -
+// as on chain - leaves the tables as they were. A stake is the user's
+// transfer to freeos, which the user is issued first.
+//
+// An account is an 'e' account until the verification contract's actions
+// in the history give it a usersinfo record: addkyc, updatekyc and
+// removekyc set its KYC entries, remove deletes the record and the other
+// actions on a user's record create it. So reguser and reverify see the
+// account type the user had at the time.
+//
+// Input is the text file written by replay_convert.sh, an action per line:
+//   <time> <contract> <action> <actor>[,<actor>...] <cpu_us or -> <field> ...
+// with the time in seconds since the epoch and the action's arguments as
+// type:value fields (see freeosscript.hpp). The contracts are the accounts
+// the host build is compiled for (see compile.sh) - freeos, freeosconfig,
+// the stake currency's token contract (transfer) and the verification
+// contract. The replay stops at an action it does not know.
+//
+// usage: ./freeosreplay [options] <actions file>
+
+#include "freeoshost.hpp"
+
+#include "../common/freeoscommon.hpp"
+#include "../common/freeoseconomics.hpp"
+
+#include "freeosactions.hpp"
+#include "freeosscript.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+
+using namespace freedao;
+using namespace freedao::host;
+
+static void usage(const char *program) {
+  std::printf(
+      "usage: %s [options] <actions file>\n"
+      "  --vest N           'vestpercent' parameter (50)\n"
+      "  --failsafe N       'failsafefreq' parameter (not set: 24)\n"
+      "  --unstakesnum N    'unstakesnum' parameter (3)\n"
+      "  --stakereq U:V,D,E stakereqs band from U users - repeat for more bands\n"
+      "                     (0:0,10,20)\n"
+      "  --max-db N         flag actions with more table accesses (64)\n"
+      "  --max-cpu N        flag actions with more CPU, microseconds (1000)\n",
+      program);
+}
+
+// the words of a line of the actions file
+enum action_word {
+  word_time,
+  word_contract,
+  word_action,
+  word_actors,
+  word_cpu,
+  word_fields, // the first argument
+};
+
+// a line of the actions file
+struct replay_action {
+  int64_t time;
+  int64_t cpu_us; // -1 if not recorded
+  std::vector<std::string> words;
+
+  const std::string &contract() const { return words[word_contract]; }
+  const std::string &action() const { return words[word_action]; }
+  const std::string &actors() const { return words[word_actors]; }
+
+  // the action in the report - a freeos action by its name, a stake as
+  // "stake" and any other as contract::action
+  std::string label() const {
+    if (contract() == freeos_account().to_string()) {
+      return action();
+    }
+    if (contract() == system_token_account().to_string()) {
+      return "stake";
+    }
+    return contract() + "::" + action();
+  }
+};
+
+// per action totals
+struct replay_summary {
+  uint64_t count = 0;
+  uint64_t flagged = 0;
+  uint64_t divergent = 0;
+  uint64_t db_total = 0;
+  uint64_t db_max = 0;
+  uint64_t wall_ns = 0;
+  uint64_t cpu_total = 0;
+  uint64_t cpu_count = 0;
+  int64_t cpu_max = 0;
+};
+
+// the verification contract's actions that create a user's usersinfo record
+// if it has none, besides the KYC actions
+static const std::set<std::string> USERSINFO_ACTIONS = {
+    "setperm",    "setperm2",    "reqperm",     "setuserava", "setusername",
+    "userverify", "updateraccs", "updateaacts", "updateac"};
+
+template <size_t N>
+static bool in_abi(const uint64_t (&actions)[N], const std::string &action) {
+  return std::find(std::begin(actions), std::end(actions),
+                   eosio::name(action).value) != std::end(actions);
+}
+
+class replayer {
+public:
+  replayer(const system_config &config, const char *failsafe);
+
+  // push a freeos, freeosconfig or stake action. Returns false, with the
+  // reason in error, if the replay does not know the action or cannot pack
+  // its arguments.
+  bool apply(const replay_action &a, transaction_trace &trace,
+             std::string &error);
+
+  // apply a verification contract action to the account's usersinfo record.
+  // Returns false, with the reason in error, if the replay does not know the
+  // action.
+  bool verify(const replay_action &a, std::string &error);
+
+  const chain &state() const { return c; }
+
+private:
+  void create_accounts(const replay_action &a);
+
+  chain c;
+  // the KYC levels of each account with a usersinfo record, by provider
+  std::map<uint64_t, std::map<uint64_t, std::string>> usersinfo_records;
+};
+
+replayer::replayer(const system_config &config, const char *failsafe) {
+  bootstrap_freeos(c, config);
+
+  const eosio::name freeosconfig = freeosconfig_account();
+  if (failsafe != nullptr) {
+    expect_success(c.push(freeosconfig, eosio::name("paramupsert"),
+                          freeosconfig, eosio::name(),
+                          eosio::name("failsafefreq"), std::string(failsafe)));
+  }
+}
+
+// the action's accounts exist - its actors and the accounts its name fields
+// name
+void replayer::create_accounts(const replay_action &a) {
+  for (size_t i = word_fields; i < a.words.size(); i++) {
+    const std::string &word = a.words[i];
+    if (word.compare(0, 5, "name:") == 0 && word.size() > 5) {
+      c.create_account(eosio::name(word.substr(5)));
+    }
+  }
+
+  std::stringstream actors(a.actors());
+  std::string actor;
+  while (std::getline(actors, actor, ',')) {
+    c.create_account(eosio::name(actor));
+  }
+}
+
+bool replayer::apply(const replay_action &a, transaction_trace &trace,
+                     std::string &error) {
+  eosio::name contract(a.contract());
+  bool stake = false;
+  trace = transaction_trace();
+
+  if (contract == freeos_account()) {
+    if (!in_abi(relay::freeos::action_names, a.action())) {
+      error = "unknown freeos action " + a.action();
+      return false;
+    }
+  } else if (contract == freeosconfig_account()) {
+    if (!in_abi(relay::freeosconfig::action_names, a.action())) {
+      error = "unknown freeosconfig action " + a.action();
+      return false;
+    }
+  } else if (contract == system_token_account() && a.action() == "transfer") {
+    stake = true;
+  } else {
+    error = "unknown action " + a.contract() + "::" + a.action();
+    return false;
+  }
+
+  eosio::action action;
+  action.account = contract;
+  action.name = eosio::name(a.action());
+  std::stringstream actors(a.actors());
+  std::string actor;
+  while (std::getline(actors, actor, ',')) {
+    action.authorization.push_back({eosio::name(actor), eosio::name("active")});
+  }
+  std::vector<uint8_t> data;
+  if (!script::pack_fields(a.words, word_fields, data, error)) {
+    return false;
+  }
+  action.data.assign(data.begin(), data.end());
+
+  c.set_time(eosio::time_point(eosio::seconds(a.time)));
+  create_accounts(a);
+
+  if (stake) {
+    // transfer(from, to, quantity, memo) - the sender is issued the
+    // quantity, which the history does not show them holding
+    relay::asset quantity;
+    if (a.words.size() != word_fields + 4 ||
+        a.words[word_fields].compare(0, 5, "name:") != 0 ||
+        a.words[word_fields + 2].compare(0, 6, "asset:") != 0 ||
+        !relay::parse_asset(a.words[word_fields + 2].substr(6), quantity)) {
+      error = "bad transfer arguments";
+      return false;
+    }
+    fund_user(c, eosio::name(a.words[word_fields].substr(5)),
+              eosio::asset(quantity.amount, eosio::symbol(quantity.symbol)));
+  }
+
+  trace = c.push_action(action);
+  return true;
+}
+
+bool replayer::verify(const replay_action &a, std::string &error) {
+  // every action on a user's record has the account as its first argument
+  const std::string &first =
+      a.words.size() > word_fields ? a.words[word_fields] : std::string();
+  if (first.compare(0, 5, "name:") != 0) {
+    error = "no account in " + a.action();
+    return false;
+  }
+  eosio::name account(first.substr(5));
+  auto field = [&](size_t i, const char *type) {
+    size_t n = std::strlen(type);
+    return i < a.words.size() && a.words[i].compare(0, n, type) == 0
+               ? a.words[i].substr(n)
+               : std::string();
+  };
+
+  if (a.action() == "addkyc" || a.action() == "updatekyc") {
+    // (acc, kyc_prov{kyc_provider, kyc_level, kyc_date})
+    eosio::name provider(field(word_fields + 1, "name:"));
+    usersinfo_records[account.value][provider.value] =
+        field(word_fields + 2, "string:");
+  } else if (a.action() == "removekyc") {
+    // (acc, kyc_provider)
+    eosio::name provider(field(word_fields + 1, "name:"));
+    auto record = usersinfo_records.find(account.value);
+    if (record != usersinfo_records.end()) {
+      record->second.erase(provider.value);
+    }
+  } else if (a.action() == "remove") {
+    usersinfo_records.erase(account.value);
+  } else if (USERSINFO_ACTIONS.count(a.action())) {
+    usersinfo_records[account.value];
+  } else {
+    error = "unknown verification action " + a.action();
+    return false;
+  }
+
+  auto record = usersinfo_records.find(account.value);
+  if (record != usersinfo_records.end()) {
+    std::vector<std::string> kyc_levels;
+    for (const auto &[provider, level] : record->second) {
+      kyc_levels.push_back(level);
+    }
+    set_verification(c, account, kyc_levels);
+    return true;
+  }
+
+  c.create_account(account);
+  eosio::name verifier = verification_account();
+  c.run_as(verifier, [&] {
+    usersinfo verification_table(verifier, verifier.value);
+    auto row = verification_table.find(account.value);
+    if (row != verification_table.end()) {
+      verification_table.erase(row);
+    }
+  });
+  return true;
+}
+
+// what the replayed transaction did besides its action - the rollover, and
+// the unstake refunds, which are the stake currency's inline transfers
+static std::string describe(const transaction_trace &trace) {
+  bool rollover = false;
+  uint32_t refunds = 0;
+
+  for (const action_trace &t : trace.actions) {
+    if (t.depth == 0 || t.receiver != t.account) {
+      continue;
+    }
+    if (t.account == freeosconfig_account() &&
+        t.action == eosio::name("iterclear")) {
+      rollover = true;
+    } else if (t.account == system_token_account() &&
+               t.action == eosio::name("transfer")) {
+      refunds++;
+    }
+  }
+
+  std::string note;
+  if (rollover) {
+    note = "rollover";
+  }
+  if (refunds > 0) {
+    note += (note.empty() ? "" : " ") + std::string("refunds=") +
+            std::to_string(refunds);
+  }
+  return note;
+}
+
+// parse a stakereqs band given as <users>:<v>,<d>,<e>
+static bool parse_stake_band(const char *value, stake_band &band) {
+  unsigned long long threshold;
+  if (std::sscanf(value, "%llu:%u,%u,%u", &threshold, &band.requirement_v,
+                  &band.requirement_d, &band.requirement_e) != 4) {
+    return false;
+  }
+  band.threshold = threshold;
+  return true;
+}
+
+static void print_state(const chain &c) {
+  const eosio::name freeos = freeos_account();
+  auto statistics =
+      c.get_row<statistic>(freeos, freeos.value, eosio::name("statistics"), 0);
+  auto stat = c.get_row<currency_stats>(freeos, point_symbol().code().raw(),
+                                        eosio::name("stat"),
+                                        point_symbol().code().raw());
+  auto freedao = c.get_row<account>(freeos, freedao_account().value,
+                                    eosio::name("accounts"),
+                                    point_symbol().code().raw());
+
+  if (statistics) {
+    std::printf("\nstatistics: usercount=%u claimevents=%u unvestpercent=%u "
+                "iteration=%u\n",
+                statistics->usercount, statistics->claimevents,
+                statistics->unvestpercent, statistics->iteration);
+  } else {
+    std::printf("\nstatistics: no record\n");
+  }
+  std::printf("POINT supply=%.4f freedao=%.4f\n",
+              stat ? double(stat->supply.amount) / economics::POINT_UNITS : 0.0,
+              freedao ? double(freedao->balance.amount) / economics::POINT_UNITS
+                      : 0.0);
+}
+
+int main(int argc, char *argv[]) {
+  system_config config;
+  config.iterations = 0; // from the iterupsert actions
+  const char *failsafe = nullptr;
+  uint64_t max_db = 64;
+  int64_t max_cpu = 1000;
+  bool default_bands = true;
+  int arg = 1;
+
+  for (; arg + 1 < argc && argv[arg][0] == '-'; arg += 2) {
+    std::string option = argv[arg];
+    const char *value = argv[arg + 1];
+
+    if (option == "--vest") {
+      config.vest_percent = std::strtoul(value, nullptr, 10);
+    } else if (option == "--failsafe") {
+      failsafe = value;
+    } else if (option == "--unstakesnum") {
+      config.unstakes_per_tick = std::strtoul(value, nullptr, 10);
+    } else if (option == "--stakereq") {
+      stake_band band;
+      if (!parse_stake_band(value, band)) {
+        usage(argv[0]);
+        return 1;
+      }
+      if (default_bands) {
+        config.stake_bands.clear();
+        default_bands = false;
+      }
+      config.stake_bands.push_back(band);
+    } else if (option == "--max-db") {
+      max_db = std::strtoull(value, nullptr, 10);
+    } else if (option == "--max-cpu") {
+      max_cpu = std::strtoll(value, nullptr, 10);
+    } else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  if (arg + 1 != argc) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  const char *file = argv[arg];
+  std::ifstream actions(file);
+  if (!actions) {
+    std::perror(file);
+    return 1;
+  }
+
+  std::optional<replayer> replay;
+  try {
+    replay.emplace(config, failsafe);
+  } catch (const eosio::check_failure &e) {
+    std::fprintf(stderr, "setup failed: %s\n", e.what());
+    return 1;
+  }
+  std::map<std::string, replay_summary> summaries;
+
+  std::printf("%-10s %-22s %-13s %-12s %8s %9s %6s %6s %8s  %s\n", "time",
+              "action", "account", "result", "db_reads", "db_writes", "inline",
+              "cpu_us", "wall_us", "note");
+
+  std::string line;
+  int number = 0;
+  while (std::getline(actions, line)) {
+    number++;
+    replay_action a;
+    a.words = script::split(line);
+    if (a.words.empty()) {
+      continue;
+    }
+
+    std::string error;
+    auto fail = [&] {
+      std::fprintf(stderr, "%s:%d: %s\n", file, number, error.c_str());
+      return 1;
+    };
+    if (a.words.size() < word_fields ||
+        !script::parse_time(a.words[word_time], a.time)) {
+      error = "usage: <time> <contract> <action> <actor> <cpu_us or -> "
+              "<field> ...";
+      return fail();
+    }
+    a.cpu_us = a.words[word_cpu] == "-"
+                   ? -1
+                   : std::strtoll(a.words[word_cpu].c_str(), nullptr, 10);
+
+    if (a.contract() == verification_account().to_string()) {
+      if (!replay->verify(a, error)) {
+        return fail();
+      }
+      continue;
+    }
+
+    transaction_trace trace;
+    try {
+      if (!replay->apply(a, trace, error)) {
+        return fail();
+      }
+    } catch (const eosio::check_failure &e) {
+      // funding a stake's sender failed
+      error = e.what();
+      return fail();
+    }
+
+    replay_summary &summary = summaries[a.label()];
+    summary.count++;
+    if (a.cpu_us >= 0) {
+      summary.cpu_total += a.cpu_us;
+      summary.cpu_count++;
+      summary.cpu_max = std::max(summary.cpu_max, a.cpu_us);
+    }
+
+    counters cost = trace.total();
+    uint64_t db = cost.db_reads() + cost.db_writes();
+    summary.db_total += db;
+    summary.db_max = std::max(summary.db_max, db);
+    summary.wall_ns += cost.wall_ns;
+
+    const char *flag = nullptr;
+    std::string note;
+    if (!trace.succeeded) {
+      summary.divergent++;
+      flag = "DIVERGES";
+      note = trace.error;
+    } else if (db > max_db || a.cpu_us > max_cpu) {
+      summary.flagged++;
+      flag = "FLAGGED";
+      note = describe(trace);
+    }
+
+    if (flag != nullptr) {
+      std::printf("%-10lld %-22s %-13s %-12s %8llu %9llu %6llu %6lld %8.1f  "
+                  "%s\n",
+                  (long long)a.time, a.label().c_str(), a.actors().c_str(),
+                  flag,
+                  (unsigned long long)cost.db_reads(),
+                  (unsigned long long)cost.db_writes(),
+                  (unsigned long long)cost.inline_actions,
+                  (long long)a.cpu_us, cost.wall_ns / 1000.0, note.c_str());
+    }
+  }
+
+  std::printf("\n%-22s %10s %9s %9s %10s %8s %10s %8s %10s\n", "action",
+              "count", "flagged", "diverges", "db_mean", "db_max", "cpu_mean",
+              "cpu_max", "wall_mean");
+  for (const auto &[action, s] : summaries) {
+    std::printf("%-22s %10llu %9llu %9llu %10.1f %8llu %10.1f %8lld %10.1f\n",
+                action.c_str(), (unsigned long long)s.count,
+                (unsigned long long)s.flagged, (unsigned long long)s.divergent,
+                double(s.db_total) / s.count, (unsigned long long)s.db_max,
+                s.cpu_count == 0 ? 0.0 : double(s.cpu_total) / s.cpu_count,
+                (long long)s.cpu_max, s.wall_ns / 1000.0 / s.count);
+  }
+
+  print_state(replay->state());
+
+  return 0;
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+// The script lines of freeoswasm and freeosbench --scenario: the words of a
+// line, and the action data (or row) fields written as type:value -
+// name:alice, string:"freeos stake", asset:"10.0000 XPR", symbol:4,XPR,
+// u8/u16/u32/u64/i32/i64:N, bool:1 (or true/false), f64:1.5,
+// time_point:<time>, time_point_sec:<time>, vector:N (the length of the
+// vector whose elements follow) or hex:0a0b. A time is seconds since the
+// epoch or YYYY-MM-DDTHH:MM:SS in UTC.
+
+#include "eosname.hpp"
+#include "freeospack.hpp"
+
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <string>
+#include <vector>
+
+namespace freedao {
+namespace script {
+
+using sim::name_value;
+
+// the words of a line, with "quoted" words kept whole and comments removed
+inline std::vector<std::string> split(const std::string &line) {
+  std::vector<std::string> words;
+  std::string word;
+  bool quoted = false, in_word = false;
+  for (char c : line) {
+    if (c == '"') {
+      quoted = !quoted;
+      in_word = true;
+    } else if (!quoted && c == '#') {
+      break;
+    } else if (!quoted && std::isspace(static_cast<unsigned char>(c))) {
+      if (in_word) {
+        words.push_back(word);
+      }
+      word.clear();
+      in_word = false;
+    } else {
+      word += c;
+      in_word = true;
+    }
+  }
+  if (in_word) {
+    words.push_back(word);
+  }
+  return words;
+}
+
+// seconds since the epoch, from a number or YYYY-MM-DDTHH:MM:SS in UTC
+inline bool parse_time(const std::string &text, int64_t &seconds) {
+  char *end;
+  seconds = std::strtoll(text.c_str(), &end, 10);
+  if (*end == '\0' && !text.empty()) {
+    return true;
+  }
+  std::tm tm = {};
+  if (sscanf(text.c_str(), "%d-%d-%dT%d:%d:%d", &tm.tm_year, &tm.tm_mon,
+             &tm.tm_mday, &tm.tm_hour, &tm.tm_min, &tm.tm_sec) != 6) {
+    return false;
+  }
+  tm.tm_year -= 1900;
+  tm.tm_mon -= 1;
+  seconds = timegm(&tm);
+  return true;
+}
+
+class vector_stream {
+public:
+  void write(const void *bytes, size_t n) {
+    auto p = static_cast<const uint8_t *>(bytes);
+    data.insert(data.end(), p, p + n);
+  }
+  std::vector<uint8_t> data;
+};
+
+// serialize type:value fields. Returns false, with the bad field in error,
+// if one cannot be.
+inline bool pack_fields(const std::vector<std::string> &fields, size_t first,
+                        std::vector<uint8_t> &data, std::string &error) {
+  vector_stream out;
+  for (size_t i = first; i < fields.size(); i++) {
+    const std::string &field = fields[i];
+    size_t colon = field.find(':');
+    std::string type = field.substr(0, colon);
+    std::string value = colon == std::string::npos ? "" : field.substr(colon + 1);
+    int64_t seconds;
+    relay::asset a;
+    bool ok = colon != std::string::npos;
+
+    if (!ok) {
+    } else if (type == "name") {
+      relay::write_value(out, name_value(value));
+    } else if (type == "string") {
+      relay::write_value(out, std::string_view(value));
+    } else if (type == "asset") {
+      ok = relay::parse_asset(value, a);
+      relay::write_value(out, a);
+    } else if (type == "symbol") {
+      size_t comma = value.find(',');
+      ok = comma != std::string::npos;
+      relay::write_value(out, relay::symbol_value(
+                                  value.substr(comma + 1),
+                                  std::atoi(value.substr(0, comma).c_str())));
+    } else if (type == "u8" || type == "i8" || type == "bool") {
+      relay::write_value(out, uint8_t(value == "true"    ? 1
+                                      : value == "false" ? 0
+                                                         : std::stoll(value)));
+    } else if (type == "u16" || type == "i16") {
+      relay::write_value(out, uint16_t(std::stoll(value)));
+    } else if (type == "u32" || type == "i32") {
+      relay::write_value(out, uint32_t(std::stoll(value)));
+    } else if (type == "u64") {
+      relay::write_value(out, uint64_t(std::stoull(value)));
+    } else if (type == "i64") {
+      relay::write_value(out, int64_t(std::stoll(value)));
+    } else if (type == "f64") {
+      relay::write_value(out, std::stod(value));
+    } else if (type == "time_point") {
+      ok = parse_time(value, seconds);
+      relay::write_value(out, int64_t(seconds) * 1000000);
+    } else if (type == "time_point_sec") {
+      ok = parse_time(value, seconds);
+      relay::write_value(out, uint32_t(seconds));
+    } else if (type == "vector") {
+      relay::write_varuint32(out, uint32_t(std::stoul(value)));
+    } else if (type == "hex" && value.size() % 2 == 0) {
+      for (size_t j = 0; j < value.size(); j += 2) {
+        relay::write_value(
+            out, uint8_t(std::stoul(value.substr(j, 2), nullptr, 16)));
+      }
+    } else {
+      ok = false;
+    }
+
+    if (!ok) {
+      error = "bad field " + field;
+      return false;
+    }
+  }
+  data = std::move(out.data);
+  return true;
+}
+
+} // namespace script
+} // namespace freedao
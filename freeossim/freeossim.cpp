@@ -0,0 +1,1190 @@
+// freeossim - runs a population of users through the host build of the
+// freeos contracts (../host, see freeoshost.hpp) for a number of iterations
+// and reports the cost of each action and the growth of the contract's RAM.
+//
+// Each iteration starts with the ticker's rollover tick. Then every user
+// takes their turn: reguser in their join iteration, then stake (if they have
+// no stake and their stake requirement is not 0), claim, unvest and unstake,
+// each with the configured probability. Users take their turns in account
+// order. An action's cost is the host chain's count for its whole
+// transaction - the contract, the accounts it notifies and its inline
+// actions. A stake is a transfer of the user's stake requirement, which the
+// user is issued first.
+//
+// The users are split into fixed-size chunks, each with a host chain of its
+// own that holds its users' rows, and the worker threads take chunks from a
+// shared counter, so an idle thread always picks up the next chunk of work.
+// The rows every user's actions share - statistics, iterstats, aggstats,
+// claimquote, stat, the iteration's deposits and the freeos and freedao
+// balances - are the same on every chain at the start of an iteration, which
+// is run in passes:
+//
+//   1. every chain runs the rollover tick, and then its users' actions in a
+//      session that is rolled back, to count its registrations and claims
+//      (parallel)
+//   2. each chain's shared rows are moved on by the chunks before it - the
+//      usercount, the claim event counts and the claimquote's freedao tier,
+//      and the deposits and balance rows their claims create - and its users'
+//      actions run again, for good (parallel)
+//   3. the changes each chain made to the shared rows are added up in chunk
+//      order and written to every chain
+//
+// Until the first registration there is no statistics record and the ticks
+// fail, so the iteration with the first registrations runs its chunks one
+// after another instead, each from the shared rows the one before it left.
+// Those ticks are not counted in the tick-rollover costs.
+//
+// The results do not depend on the number of threads. Where they differ from
+// running every user on one chain: a tick refunds only the unstake requests
+// of its own chunk's users, an issue is checked against the supply as it was
+// at the start of the iteration plus the chunk's own issues, and freeos's
+// balance of the stake currency is a row on every chain, so its RAM is
+// billed once per chain.
+//
+// --save writes the chains to a snapshot file (freeossnap.hpp) and --snapshot
+// starts a run from one, so a large population is built once and every later
+// run starts from the same state.
+//
+// usage: ./freeossim [options] - see usage() below
+
+#include "freeoshost.hpp"
+#include "freeossnap.hpp"
+
+#include "../common/freeoscommon.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+using namespace freedao;
+using namespace freedao::host;
+using namespace freedao::sim;
+
+static void usage(const char *program) {
+  std::printf(
+      "usage: %s [options]\n"
+      "  --users N          number of users (10000)\n"
+      "  --iterations N     number of iterations (52)\n"
+      "  --join N           users register over the first N iterations (4)\n"
+      "  --threads N        worker threads, 0 for one per core (0)\n"
+      "  --seed N           random seed (1)\n"
+      "  --claim N          iteration claim amount, POINTs (100)\n"
+      "  --hold N           iteration tokens required, POINTs (0)\n"
+      "  --vest N           'vestpercent' parameter (50)\n"
+      "  --failsafe N       'failsafefreq' parameter (24)\n"
+      "  --unstakesnum N    'unstakesnum' parameter (3)\n"
+      "  --stakereq U:V,D,E stakereqs band from U users - repeat for more bands\n"
+      "                     (0:0,10,20)\n"
+      "  --verified P       proportion of verified ('v') users (0.6)\n"
+      "  --kyc P            proportion of 'd' users (0.3)\n"
+      "  --airkey P         proportion of users holding an AIRKEY (0.01)\n"
+      "  --p-stake P        probability of staking when required (0.9)\n"
+      "  --p-claim P        probability of claiming each iteration (0.85)\n"
+      "  --p-unvest P       probability of unvesting each iteration (0.3)\n"
+      "  --p-unstake P      probability of unstaking each iteration (0.005)\n"
+      "  --csv FILE         write per-iteration results to FILE\n"
+      "  --scopes FILE      write the final table scopes to FILE, for freeosram\n"
+      "  --snapshot FILE    start from the chains saved in FILE, and run\n"
+      "                     --iterations more iterations. The users, seed,\n"
+      "                     join and population options are the snapshot's.\n"
+      "  --save FILE        save the final chains to FILE as a snapshot\n",
+      program);
+}
+
+struct config {
+  uint64_t users = 10000;
+  uint32_t iterations = 52;
+  uint32_t join_iterations = 4; // users register evenly over these iterations
+  unsigned threads = 0;         // 0 = one per hardware thread
+  uint64_t seed = 1;
+
+  // the freeosconfig records - system.iterations is set to the last
+  // iteration run
+  system_config system;
+  uint8_t failsafe_frequency = 24; // 'failsafefreq'
+
+  // the population
+  double verified = 0.6;    // proportion of 'v' accounts
+  double kyc_record = 0.3;  // proportion of 'd' accounts
+  double airkey = 0.01;     // proportion holding an AIRKEY
+  double p_stake = 0.9;     // stake when required, per iteration
+  double p_claim = 0.85;    // claim, per iteration
+  double p_unvest = 0.3;    // unvest, per iteration
+  double p_unstake = 0.005; // request an unstake, per iteration
+};
+
+// parse a stakereqs band given as <users>:<v>,<d>,<e>
+static bool parse_stake_band(const char *value, stake_band &band) {
+  unsigned long long threshold;
+  if (std::sscanf(value, "%llu:%u,%u,%u", &threshold, &band.requirement_v,
+                  &band.requirement_d, &band.requirement_e) != 4) {
+    return false;
+  }
+  band.threshold = threshold;
+  return true;
+}
+
+static bool parse_options(int argc, char *argv[], config &cfg,
+                          const char *&csv, const char *&scopes,
+                          const char *&snapshot_path, const char *&save) {
+  bool default_bands = true;
+
+  for (int i = 1; i < argc; i++) {
+    std::string option = argv[i];
+
+    if (i + 1 >= argc) {
+      return false;
+    }
+    const char *value = argv[++i];
+
+    if (option == "--users") {
+      cfg.users = std::strtoull(value, nullptr, 10);
+    } else if (option == "--iterations") {
+      cfg.iterations = std::strtoul(value, nullptr, 10);
+    } else if (option == "--join") {
+      cfg.join_iterations = std::strtoul(value, nullptr, 10);
+    } else if (option == "--threads") {
+      cfg.threads = std::strtoul(value, nullptr, 10);
+    } else if (option == "--seed") {
+      cfg.seed = std::strtoull(value, nullptr, 10);
+    } else if (option == "--claim") {
+      cfg.system.claim_amount = std::strtoul(value, nullptr, 10);
+    } else if (option == "--hold") {
+      cfg.system.tokens_required = std::strtoul(value, nullptr, 10);
+    } else if (option == "--vest") {
+      cfg.system.vest_percent = std::strtoul(value, nullptr, 10);
+    } else if (option == "--failsafe") {
+      cfg.failsafe_frequency = std::strtoul(value, nullptr, 10);
+    } else if (option == "--unstakesnum") {
+      cfg.system.unstakes_per_tick = std::strtoul(value, nullptr, 10);
+    } else if (option == "--stakereq") {
+      stake_band band;
+      if (!parse_stake_band(value, band)) {
+        return false;
+      }
+      if (default_bands) {
+        cfg.system.stake_bands.clear();
+        default_bands = false;
+      }
+      cfg.system.stake_bands.push_back(band);
+    } else if (option == "--verified") {
+      cfg.verified = std::strtod(value, nullptr);
+    } else if (option == "--kyc") {
+      cfg.kyc_record = std::strtod(value, nullptr);
+    } else if (option == "--airkey") {
+      cfg.airkey = std::strtod(value, nullptr);
+    } else if (option == "--p-stake") {
+      cfg.p_stake = std::strtod(value, nullptr);
+    } else if (option == "--p-claim") {
+      cfg.p_claim = std::strtod(value, nullptr);
+    } else if (option == "--p-unvest") {
+      cfg.p_unvest = std::strtod(value, nullptr);
+    } else if (option == "--p-unstake") {
+      cfg.p_unstake = std::strtod(value, nullptr);
+    } else if (option == "--csv") {
+      csv = value;
+    } else if (option == "--scopes") {
+      scopes = value;
+    } else if (option == "--snapshot") {
+      snapshot_path = value;
+    } else if (option == "--save") {
+      save = value;
+    } else {
+      return false;
+    }
+  }
+
+  // the stakereqs lookup needs the bands in threshold order
+  std::sort(cfg.system.stake_bands.begin(), cfg.system.stake_bands.end(),
+            [](const stake_band &a, const stake_band &b) {
+              return a.threshold < b.threshold;
+            });
+
+  // a failsafefreq of 0 would divide by zero in the contract
+  return cfg.users > 0 && cfg.iterations > 0 && cfg.join_iterations > 0 &&
+         cfg.failsafe_frequency > 0;
+}
+
+// the user's part in the population
+struct user_plan {
+  uint32_t join_iteration; // the iteration in which the user calls reguser
+  char account_type;       // made by the user's verification record
+  bool airkey;             // holds an AIRKEY
+};
+
+static user_plan make_user(const config &cfg, uint64_t user) {
+  user_random random(cfg.seed, user, 0);
+  user_plan plan;
+
+  plan.join_iteration = 1 + random.next() % cfg.join_iterations;
+
+  double type = (random.next() >> 11) * 0x1.0p-53;
+  plan.account_type = type < cfg.verified                    ? 'v'
+                      : type < cfg.verified + cfg.kyc_record ? 'd'
+                                                             : 'e';
+  plan.airkey = random.chance(cfg.airkey);
+
+  return plan;
+}
+
+// user<index in base 26>, e.g. useraaaaaaab for user 1
+static eosio::name user_name(uint64_t index) {
+  char name[] = "useraaaaaaaa";
+  for (int i = 11; i >= 4; i--) {
+    name[i] = 'a' + index % 26;
+    index /= 26;
+  }
+  return eosio::name(name);
+}
+
+static const eosio::name ticker("ticker");
+
+enum action_type {
+  act_reguser,
+  act_stake,
+  act_claim,
+  act_unvest,
+  act_unstake,
+  act_rollover, // the ticker's tick at the start of an iteration
+  action_types,
+};
+
+constexpr const char *ACTION_NAMES[action_types] = {
+    "reguser", "stake", "claim", "unvest", "unstake", "tick-rollover"};
+
+// cost distributions of one action type
+constexpr uint32_t HISTOGRAM_BUCKETS = 256; // the last bucket collects the rest
+
+struct action_stats {
+  uint64_t ok = 0;
+  uint64_t failed = 0;
+  uint64_t inline_actions = 0;
+  uint64_t notifications = 0;
+  int64_t ram_bytes = 0;
+  uint64_t wall_ns = 0;
+  std::array<uint64_t, HISTOGRAM_BUCKETS> db_reads = {};
+  std::array<uint64_t, HISTOGRAM_BUCKETS> db_writes = {};
+
+  void record(const transaction_trace &trace) {
+    if (!trace.succeeded) {
+      failed++;
+      return;
+    }
+
+    counters cost = trace.total();
+    ok++;
+    inline_actions += cost.inline_actions;
+    notifications += cost.notifications;
+    ram_bytes += cost.ram_bytes;
+    wall_ns += cost.wall_ns;
+    db_reads[std::min<uint64_t>(cost.db_reads(), HISTOGRAM_BUCKETS - 1)]++;
+    db_writes[std::min<uint64_t>(cost.db_writes(), HISTOGRAM_BUCKETS - 1)]++;
+  }
+
+  void merge(const action_stats &other) {
+    ok += other.ok;
+    failed += other.failed;
+    inline_actions += other.inline_actions;
+    notifications += other.notifications;
+    ram_bytes += other.ram_bytes;
+    wall_ns += other.wall_ns;
+    for (uint32_t i = 0; i < HISTOGRAM_BUCKETS; i++) {
+      db_reads[i] += other.db_reads[i];
+      db_writes[i] += other.db_writes[i];
+    }
+  }
+};
+
+using iteration_stats = std::array<action_stats, action_types>;
+
+// the rows of the freeos contract that every user's actions share
+struct shared_rows {
+  std::optional<statistic> statistics;
+  std::optional<iterstat> iterstats;
+  std::optional<aggstat> aggstats;
+  std::optional<claimquote> quote;
+  std::optional<currency_stats> point_stat;
+  std::optional<deposit> deposit_row; // the iteration's
+  std::optional<account> freeos_balance;
+  std::optional<account> freedao_balance;
+};
+
+static shared_rows read_shared(const chain &c, uint32_t iteration) {
+  const eosio::name freeos = freeos_account();
+  const uint64_t point = point_symbol().code().raw();
+  shared_rows rows;
+
+  rows.statistics =
+      c.get_row<statistic>(freeos, freeos.value, eosio::name("statistics"), 0);
+  rows.iterstats =
+      c.get_row<iterstat>(freeos, freeos.value, eosio::name("iterstats"), 0);
+  rows.aggstats =
+      c.get_row<aggstat>(freeos, freeos.value, eosio::name("aggstats"), 0);
+  rows.quote =
+      c.get_row<claimquote>(freeos, freeos.value, eosio::name("claimquote"), 0);
+  rows.point_stat =
+      c.get_row<currency_stats>(freeos, point, eosio::name("stat"), point);
+  rows.deposit_row = c.get_row<deposit>(freeos, freeos.value,
+                                        eosio::name("deposits"), iteration);
+  rows.freeos_balance =
+      c.get_row<account>(freeos, freeos.value, eosio::name("accounts"), point);
+  rows.freedao_balance = c.get_row<account>(
+      freeos, freedao_account().value, eosio::name("accounts"), point);
+
+  return rows;
+}
+
+// write the rows that rows has. The contract pays for them all. None of the
+// tables has a secondary index, so chain::set_row_data can write them.
+static void write_shared(chain &c, const shared_rows &rows) {
+  const eosio::name freeos = freeos_account();
+  const uint64_t point = point_symbol().code().raw();
+
+  auto write = [&](uint64_t scope, const char *table, uint64_t pk,
+                   const auto &row) {
+    if (row) {
+      c.set_row_data(freeos, scope, eosio::name(table), freeos, pk,
+                     eosio::pack(*row));
+    }
+  };
+
+  write(freeos.value, "statistics", 0, rows.statistics);
+  write(freeos.value, "iterstats", 0, rows.iterstats);
+  write(freeos.value, "aggstats", 0, rows.aggstats);
+  write(freeos.value, "claimquote", 0, rows.quote);
+  write(point, "stat", point, rows.point_stat);
+  if (rows.deposit_row) {
+    write(freeos.value, "deposits", rows.deposit_row->iteration,
+          rows.deposit_row);
+  }
+  write(freeos.value, "accounts", point, rows.freeos_balance);
+  write(freedao_account().value, "accounts", point, rows.freedao_balance);
+}
+
+template <typename T>
+static bool same_row(const std::optional<T> &a, const std::optional<T> &b) {
+  return a.has_value() == b.has_value() &&
+         (!a || eosio::pack(*a) == eosio::pack(*b));
+}
+
+// a balance row's change, 0 if it has none after
+static int64_t balance_change(const std::optional<account> &before,
+                              const std::optional<account> &after) {
+  if (!after) {
+    return 0;
+  }
+  return after->balance.amount - (before ? before->balance.amount : 0);
+}
+
+// add a balance row's change to total, creating it if need be
+static void add_balance(std::optional<account> &total,
+                        const std::optional<account> &before,
+                        const std::optional<account> &after) {
+  if (after) {
+    if (!total) {
+      total = account{eosio::asset(0, point_symbol())};
+    }
+    total->balance.amount += balance_change(before, after);
+  }
+}
+
+// requote_freedao_tier - the claimquote after the given number of the
+// iteration's claim events
+static void requote(claimquote &quote, uint32_t claimevents) {
+  if (claimevents > quote.tier_boundary) {
+    economics::freedao_tier tier = economics::freedao_tier_for(claimevents);
+    quote.freedao_tokens = quote.claim_tokens * tier.multiplier;
+    quote.tier_boundary = tier.last_claimevent;
+  }
+}
+
+// a chunk of users and its chain
+struct chunk_state {
+  std::unique_ptr<chain> c;
+  uint64_t first = 0;
+  uint64_t last = 0;
+
+  // the iteration's results
+  uint32_t registrations = 0; // pass 1
+  uint32_t claims = 0;        // pass 1
+  bool freeos_balance = false;  // pass 1 created freeos's POINT balance row
+  bool freedao_balance = false; // pass 1 created freedao's
+  shared_rows before;           // pass 2
+  shared_rows after;            // pass 2
+  uint64_t refunds = 0;         // pass 2
+  iteration_stats stats = {};   // pass 2
+};
+
+// run work(chunk) for every chunk on the given number of threads. The first
+// exception a chunk throws is rethrown, once the threads have stopped.
+template <typename Work>
+static void for_each_chunk(unsigned threads, uint64_t chunks, Work &&work) {
+  std::atomic<uint64_t> next_chunk{0};
+  std::exception_ptr error;
+  std::mutex error_mutex;
+
+  auto worker = [&] {
+    try {
+      for (uint64_t chunk = next_chunk++; chunk < chunks;
+           chunk = next_chunk++) {
+        work(chunk);
+      }
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(error_mutex);
+      if (!error) {
+        error = std::current_exception();
+      }
+      next_chunk = chunks;
+    }
+  };
+
+  std::vector<std::thread> pool;
+  for (unsigned t = 1; t < threads; t++) {
+    pool.emplace_back(worker);
+  }
+  worker();
+
+  for (std::thread &thread : pool) {
+    thread.join();
+  }
+
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+static eosio::time_point iteration_start(const system_config &system,
+                                         uint32_t iteration) {
+  return system.start + eosio::microseconds(system.iteration_length.count() *
+                                            int64_t(iteration - 1));
+}
+
+// iterupsert the iterations from first to last - bootstrap_freeos adds them
+// to a new chain
+static void add_iterations(chain &c, const system_config &system,
+                           uint32_t first, uint32_t last) {
+  for (uint32_t i = first; i <= last; i++) {
+    eosio::time_point start = iteration_start(system, i);
+    eosio::time_point end =
+        start + system.iteration_length - eosio::seconds(1);
+    expect_success(c.push(freeosconfig_account(), eosio::name("iterupsert"),
+                          freeosconfig_account(), i, start, end,
+                          system.claim_amount, system.tokens_required));
+  }
+}
+
+// a new chain for the chunk's users: a freeos system, the ticker, and the
+// users with their verification records and AIRKEYs
+static void make_chain(const config &cfg, chunk_state &chunk) {
+  chunk.c = std::make_unique<chain>();
+  chain &c = *chunk.c;
+  const eosio::name freeos = freeos_account();
+  const eosio::name freeosconfig = freeosconfig_account();
+
+  bootstrap_freeos(c, cfg.system);
+  expect_success(c.push(freeosconfig, eosio::name("paramupsert"), freeosconfig,
+                        eosio::name(), eosio::name("failsafefreq"),
+                        std::to_string(cfg.failsafe_frequency)));
+  c.create_account(ticker);
+
+  std::vector<eosio::name> airkey_holders;
+  for (uint64_t index = chunk.first; index < chunk.last; index++) {
+    user_plan plan = make_user(cfg, index);
+    eosio::name user = user_name(index);
+
+    // a 'v' account has a KYC entry with its names, a 'd' account a record
+    // without one, and an 'e' account no record
+    if (plan.account_type == 'v') {
+      set_verification(c, user, {"firstname,lastname"});
+    } else if (plan.account_type == 'd') {
+      set_verification(c, user, {});
+    } else {
+      c.create_account(user);
+    }
+
+    if (plan.airkey) {
+      airkey_holders.push_back(user);
+    }
+  }
+
+  // freeos mints the AIRKEYs and allocates one to each holder
+  if (!airkey_holders.empty()) {
+    expect_success(
+        c.push(freeosconfig, eosio::name("minteradd"), freeosconfig, freeos));
+    expect_success(
+        c.push(freeosconfig, eosio::name("transfadd"), freeosconfig, freeos));
+    expect_success(c.push(freeos, eosio::name("mint"), freeos, freeos, freeos,
+                          eosio::asset(airkey_holders.size(), airkey_symbol()),
+                          std::string("airkey")));
+    for (eosio::name user : airkey_holders) {
+      expect_success(c.push(freeos, eosio::name("allocate"), freeos, freeos,
+                            user, eosio::asset(1, airkey_symbol()),
+                            std::string("airkey")));
+    }
+  }
+}
+
+// get_stake_requirement for the chain's usercount
+static eosio::asset stake_requirement(const config &cfg, const chain &c,
+                                      char account_type) {
+  const eosio::name freeos = freeos_account();
+  auto statistics =
+      c.get_row<statistic>(freeos, freeos.value, eosio::name("statistics"), 0);
+  uint64_t usercount = statistics ? statistics->usercount : 0;
+
+  const stake_band *band = &cfg.system.stake_bands.front();
+  for (const stake_band &b : cfg.system.stake_bands) {
+    if (b.threshold <= usercount) {
+      band = &b;
+    }
+  }
+
+  uint32_t whole = economics::stake_requirement(
+      account_type, band->requirement_v, band->requirement_d,
+      band->requirement_e);
+  return eosio::asset(whole * SYSTEM_CURRENCY_UNITS, system_symbol());
+}
+
+// every user of the chunk who has joined takes their turn. Returns the
+// number of unstake requests made.
+static uint64_t run_users(const config &cfg,
+                          const std::vector<user_plan> &plans,
+                          chunk_state &chunk, uint32_t iteration,
+                          iteration_stats &stats) {
+  chain &c = *chunk.c;
+  const eosio::name freeos = freeos_account();
+  uint64_t unstakes = 0;
+
+  for (uint64_t index = chunk.first; index < chunk.last; index++) {
+    if (plans[index].join_iteration > iteration) {
+      continue;
+    }
+    eosio::name user = user_name(index);
+
+    if (plans[index].join_iteration == iteration) {
+      stats[act_reguser].record(
+          c.push(freeos, eosio::name("reguser"), user, user));
+    }
+
+    user_random random(cfg.seed, index, iteration);
+    bool wants_stake = random.chance(cfg.p_stake);
+    bool wants_claim = random.chance(cfg.p_claim);
+    bool wants_unvest = random.chance(cfg.p_unvest);
+    bool wants_unstake = random.chance(cfg.p_unstake);
+
+    if (wants_stake) {
+      auto record = c.get_row<freedao::user>(freeos, user.value,
+                                             eosio::name("users"),
+                                             system_symbol().code().raw());
+      bool unstaking = c.row_data(freeos, freeos.value,
+                                  eosio::name("unstakereqs"), user.value)
+                           .has_value();
+      if (record && record->staked_iteration == 0 && !unstaking) {
+        eosio::asset requirement =
+            stake_requirement(cfg, c, record->account_type);
+        if (requirement.amount > 0) {
+          fund_user(c, user, requirement);
+          stats[act_stake].record(c.push(system_token_account(),
+                                         eosio::name("transfer"), user, user,
+                                         freeos, requirement,
+                                         std::string("freeos stake")));
+        }
+      }
+    }
+
+    if (wants_claim) {
+      stats[act_claim].record(c.push(freeos, eosio::name("claim"), user, user));
+    }
+
+    if (wants_unvest) {
+      stats[act_unvest].record(
+          c.push(freeos, eosio::name("unvest"), user, user));
+    }
+
+    if (wants_unstake) {
+      transaction_trace trace =
+          c.push(freeos, eosio::name("unstake"), user, user);
+      unstakes += trace.succeeded;
+      stats[act_unstake].record(trace);
+    }
+  }
+
+  return unstakes;
+}
+
+static uint32_t refund_count(const shared_rows &rows) {
+  return rows.aggstats ? rows.aggstats->refundcount : 0;
+}
+
+// pass 2 of a chunk, or its turn when the chunks run one after another:
+// write its shared rows, run its users and read the rows back
+static void run_chunk(const config &cfg, const std::vector<user_plan> &plans,
+                      chunk_state &chunk, uint32_t iteration,
+                      const shared_rows &rows) {
+  write_shared(*chunk.c, rows);
+  chunk.before = read_shared(*chunk.c, iteration);
+  chunk.stats = iteration_stats();
+  uint64_t unstakes = run_users(cfg, plans, chunk, iteration, chunk.stats);
+  chunk.after = read_shared(*chunk.c, iteration);
+  chunk.refunds =
+      unstakes + refund_count(chunk.before) - refund_count(chunk.after);
+}
+
+// the shared rows after the chunks of an iteration that ran in parallel,
+// from the rows they started from (start) and their changes, in chunk order
+static shared_rows merge_chunks(const shared_rows &start,
+                                const std::vector<chunk_state> &chunks) {
+  shared_rows merged = start;
+
+  for (const chunk_state &chunk : chunks) {
+    const shared_rows &before = chunk.before;
+    const shared_rows &after = chunk.after;
+
+    // the rows a chunk's actions rewrite - the last chunk to change them
+    // made them what they are. Its usercount and claimevents are added up
+    // below.
+    if (!same_row(before.statistics, after.statistics)) {
+      statistic statistics = *after.statistics;
+      statistics.usercount = merged.statistics->usercount;
+      statistics.claimevents = merged.statistics->claimevents;
+      merged.statistics = statistics;
+    }
+    if (!same_row(before.iterstats, after.iterstats)) {
+      merged.iterstats = after.iterstats;
+    }
+    if (!same_row(before.quote, after.quote)) {
+      merged.quote = after.quote;
+    }
+
+    // the totals
+    merged.statistics->usercount +=
+        after.statistics->usercount - before.statistics->usercount;
+    merged.statistics->claimevents +=
+        after.statistics->claimevents - before.statistics->claimevents;
+
+    aggstat &a = *merged.aggstats;
+    a.staked += after.aggstats->staked - before.aggstats->staked;
+    a.vested += after.aggstats->vested - before.aggstats->vested;
+    a.refunds += after.aggstats->refunds - before.aggstats->refunds;
+    a.refundcount += after.aggstats->refundcount - before.aggstats->refundcount;
+    a.verified += after.aggstats->verified - before.aggstats->verified;
+    a.unverified += after.aggstats->unverified - before.aggstats->unverified;
+
+    currency_stats &st = *merged.point_stat;
+    st.supply += after.point_stat->supply - before.point_stat->supply;
+    st.conditional_supply += after.point_stat->conditional_supply -
+                             before.point_stat->conditional_supply;
+
+    if (after.deposit_row) {
+      if (!merged.deposit_row) {
+        merged.deposit_row = deposit{after.deposit_row->iteration,
+                                     eosio::asset(0, point_symbol())};
+      }
+      merged.deposit_row->accrued.amount +=
+          after.deposit_row->accrued.amount -
+          (before.deposit_row ? before.deposit_row->accrued.amount : 0);
+    }
+
+    add_balance(merged.freeos_balance, before.freeos_balance,
+                after.freeos_balance);
+    add_balance(merged.freedao_balance, before.freedao_balance,
+                after.freedao_balance);
+  }
+
+  return merged;
+}
+
+// run an iteration. Returns the shared rows after it and the iteration's
+// costs in stats.
+static shared_rows run_iteration(const config &cfg,
+                                 const std::vector<user_plan> &plans,
+                                 std::vector<chunk_state> &chunks,
+                                 uint32_t iteration, iteration_stats &stats,
+                                 uint64_t &refunds) {
+  const eosio::name freeos = freeos_account();
+  eosio::time_point now = iteration_start(cfg.system, iteration);
+
+  // the rollover tick, on every chain
+  std::vector<transaction_trace> rollovers(chunks.size());
+  for_each_chunk(cfg.threads, chunks.size(), [&](uint64_t k) {
+    chunks[k].c->set_time(now);
+    rollovers[k] = chunks[k].c->push(freeos, eosio::name("tick"), ticker);
+  });
+
+  shared_rows start = read_shared(*chunks[0].c, iteration);
+  shared_rows merged;
+
+  if (!start.statistics) {
+    // no registrations yet - the chunks run one after another, and the tick,
+    // which failed for want of the statistics record, is not counted
+    merged = start;
+    for (chunk_state &chunk : chunks) {
+      run_chunk(cfg, plans, chunk, iteration, merged);
+      merged = chunk.after;
+    }
+  } else {
+    stats[act_rollover].record(rollovers[0]);
+
+    // pass 1 - each chunk's registrations and claims
+    std::vector<uint32_t> planned(chunks.size());
+    for (uint64_t k = 0; k < chunks.size(); k++) {
+      for (uint64_t index = chunks[k].first; index < chunks[k].last; index++) {
+        planned[k] += plans[index].join_iteration == iteration;
+      }
+    }
+
+    for_each_chunk(cfg.threads, chunks.size(), [&](uint64_t k) {
+      chunk_state &chunk = chunks[k];
+      shared_rows rows = start;
+      for (uint64_t j = 0; j < k; j++) {
+        rows.statistics->usercount += planned[j];
+      }
+
+      chunk.c->checkpoint();
+      write_shared(*chunk.c, rows);
+      iteration_stats ignored;
+      run_users(cfg, plans, chunk, iteration, ignored);
+      shared_rows after = read_shared(*chunk.c, iteration);
+      chunk.c->rollback();
+
+      chunk.registrations =
+          after.statistics->usercount - rows.statistics->usercount;
+      chunk.claims =
+          after.statistics->claimevents - rows.statistics->claimevents;
+      chunk.freeos_balance = after.freeos_balance && !rows.freeos_balance;
+      chunk.freedao_balance = after.freedao_balance && !rows.freedao_balance;
+    });
+
+    // pass 2 - each chunk from the rows the chunks before it leave
+    std::vector<shared_rows> chunk_rows(chunks.size(), start);
+    uint32_t registrations = 0;
+    uint32_t claims = 0;
+    bool freeos_balance = false;
+    bool freedao_balance = false;
+
+    for (uint64_t k = 0; k < chunks.size(); k++) {
+      shared_rows &rows = chunk_rows[k];
+      rows.statistics->usercount += registrations;
+      rows.statistics->claimevents += claims;
+      if (claims > 0) {
+        rows.iterstats = iterstat{claims};
+        rows.iterstats->iteration = iteration;
+        if (rows.quote) {
+          requote(*rows.quote, claims);
+        }
+        rows.deposit_row =
+            deposit{iteration, eosio::asset(0, point_symbol())};
+      }
+      if (freeos_balance && !rows.freeos_balance) {
+        rows.freeos_balance = account{eosio::asset(0, point_symbol())};
+      }
+      if (freedao_balance && !rows.freedao_balance) {
+        rows.freedao_balance = account{eosio::asset(0, point_symbol())};
+      }
+
+      registrations += chunks[k].registrations;
+      claims += chunks[k].claims;
+      freeos_balance = freeos_balance || chunks[k].freeos_balance;
+      freedao_balance = freedao_balance || chunks[k].freedao_balance;
+    }
+
+    for_each_chunk(cfg.threads, chunks.size(), [&](uint64_t k) {
+      run_chunk(cfg, plans, chunks[k], iteration, chunk_rows[k]);
+    });
+
+    merged = merge_chunks(start, chunks);
+  }
+
+  refunds = 0;
+  for (chunk_state &chunk : chunks) {
+    for (int type = 0; type < act_rollover; type++) {
+      stats[type].merge(chunk.stats[type]);
+    }
+    refunds += chunk.refunds;
+  }
+
+  // every chain starts the next iteration with the same shared rows
+  for_each_chunk(cfg.threads, chunks.size(),
+                 [&](uint64_t k) { write_shared(*chunks[k].c, merged); });
+
+  return merged;
+}
+
+// smallest value with at least the given proportion of samples at or below it
+static uint32_t percentile(const std::array<uint64_t, HISTOGRAM_BUCKETS> &h,
+                           uint64_t samples, double proportion) {
+  uint64_t target = uint64_t(samples * proportion);
+  uint64_t seen = 0;
+
+  for (uint32_t value = 0; value < HISTOGRAM_BUCKETS; value++) {
+    seen += h[value];
+    if (seen > 0 && seen >= target) {
+      return value;
+    }
+  }
+
+  return HISTOGRAM_BUCKETS - 1;
+}
+
+static double mean(const std::array<uint64_t, HISTOGRAM_BUCKETS> &h,
+                   uint64_t samples) {
+  uint64_t total = 0;
+  for (uint32_t value = 0; value < HISTOGRAM_BUCKETS; value++) {
+    total += h[value] * value;
+  }
+
+  return samples == 0 ? 0.0 : double(total) / samples;
+}
+
+static uint32_t maximum(const std::array<uint64_t, HISTOGRAM_BUCKETS> &h) {
+  for (uint32_t value = HISTOGRAM_BUCKETS; value > 0; value--) {
+    if (h[value - 1] > 0) {
+      return value - 1;
+    }
+  }
+
+  return 0;
+}
+
+// the freeos tables and scopes whose rows every chain has a copy of - see
+// shared_rows. The other rows are the chunk's own.
+static bool is_shared(eosio::name table, uint64_t scope) {
+  static const eosio::name shared_tables[] = {
+      eosio::name("statistics"), eosio::name("iterstats"),
+      eosio::name("aggstats"),   eosio::name("claimquote"),
+      eosio::name("stat"),       eosio::name("deposits")};
+
+  return std::find(std::begin(shared_tables), std::end(shared_tables),
+                   table) != std::end(shared_tables) ||
+         (table == eosio::name("accounts") &&
+          (scope == freeos_account().value ||
+           scope == freedao_account().value));
+}
+
+// the tables with a secondary index, one per row
+static bool is_indexed(eosio::name table) {
+  return table == eosio::name("unstakereqs") ||
+         table == eosio::name("convreqs");
+}
+
+// a freeos table scope, over every chain
+struct scope_rows {
+  uint64_t rows = 0;
+  int64_t ram_bytes = 0;
+  eosio::name payer;
+};
+
+// the freeos tables in every chain, keyed by table and scope. Scopes of stat
+// are symbol codes.
+static std::map<std::pair<std::string, std::string>, scope_rows>
+freeos_scopes(const std::vector<chunk_state> &chunks) {
+  const eosio::name freeos = freeos_account();
+  std::map<std::pair<std::string, std::string>, scope_rows> scopes;
+
+  for (uint64_t k = 0; k < chunks.size(); k++) {
+    const chain &c = *chunks[k].c;
+    c.for_each_table([&](eosio::name code, uint64_t scope, eosio::name table,
+                         size_t) {
+      if (code != freeos || (k > 0 && is_shared(table, scope))) {
+        return;
+      }
+
+      std::string scope_name = table == eosio::name("stat")
+                                   ? eosio::symbol_code(scope).to_string()
+                                   : eosio::name(scope).to_string();
+      scope_rows &s = scopes[{table.to_string(), scope_name}];
+      if (s.rows == 0) {
+        s.ram_bytes += TABLE_SCOPE_BYTES;
+      }
+      c.for_each_row(code, table, scope,
+                     [&](uint64_t, uint64_t, eosio::name payer,
+                         const std::vector<char> &data) {
+                       s.rows++;
+                       s.ram_bytes += int64_t(data.size()) + ROW_OVERHEAD_BYTES;
+                       if (is_indexed(table)) {
+                         s.ram_bytes += SECONDARY_INDEX_BYTES;
+                       }
+                       s.payer = payer;
+                     });
+    });
+  }
+
+  return scopes;
+}
+
+static void print_report(const config &cfg, const shared_rows &shared,
+                         const std::vector<chunk_state> &chunks,
+                         const iteration_stats &totals, double seconds) {
+  std::printf("\n%-14s %10s %9s   %-22s   %-22s %7s %7s %10s %8s\n", "action",
+              "ok", "failed", "db_reads p50/p99/max", "db_writes p50/p99/max",
+              "inline", "notify", "ram/action", "wall_us");
+
+  uint64_t actions = 0;
+  for (int type = 0; type < action_types; type++) {
+    const action_stats &s = totals[type];
+    actions += s.ok + s.failed;
+
+    char reads[32];
+    char writes[32];
+    std::snprintf(reads, sizeof(reads), "%u/%u/%u (%.1f)",
+                  percentile(s.db_reads, s.ok, 0.5),
+                  percentile(s.db_reads, s.ok, 0.99), maximum(s.db_reads),
+                  mean(s.db_reads, s.ok));
+    std::snprintf(writes, sizeof(writes), "%u/%u/%u (%.1f)",
+                  percentile(s.db_writes, s.ok, 0.5),
+                  percentile(s.db_writes, s.ok, 0.99), maximum(s.db_writes),
+                  mean(s.db_writes, s.ok));
+
+    if (s.ok == 0) {
+      std::snprintf(reads, sizeof(reads), "-");
+      std::snprintf(writes, sizeof(writes), "-");
+    }
+
+    double ok = s.ok == 0 ? 1.0 : double(s.ok);
+    std::printf("%-14s %10llu %9llu   %-22s   %-22s %7.2f %7.2f %10.1f %8.1f\n",
+                ACTION_NAMES[type], (unsigned long long)s.ok,
+                (unsigned long long)s.failed, reads, writes,
+                s.inline_actions / ok, s.notifications / ok, s.ram_bytes / ok,
+                s.wall_ns / ok / 1000.0);
+  }
+
+  // RAM by table
+  std::map<std::string, scope_rows> tables;
+  for (const auto &[key, s] : freeos_scopes(chunks)) {
+    scope_rows &t = tables[key.first];
+    t.rows += s.rows;
+    t.ram_bytes += s.ram_bytes;
+  }
+
+  uint32_t usercount = shared.statistics ? shared.statistics->usercount : 0;
+  std::printf("\n%-14s %12s %16s\n", "table", "rows", "ram bytes");
+  int64_t ram_total = 0;
+  for (const auto &[table, t] : tables) {
+    std::printf("%-14s %12llu %16lld\n", table.c_str(),
+                (unsigned long long)t.rows, (long long)t.ram_bytes);
+    ram_total += t.ram_bytes;
+  }
+  std::printf("%-14s %12s %16lld (%.1f bytes per registered user)\n", "total",
+              "", (long long)ram_total,
+              usercount == 0 ? 0.0 : double(ram_total) / usercount);
+
+  if (shared.statistics) {
+    std::printf("\nstatistics: usercount=%u claimevents=%u unvestpercent=%u "
+                "failsafecounter=%u\n",
+                shared.statistics->usercount, shared.statistics->claimevents,
+                shared.statistics->unvestpercent,
+                shared.statistics->failsafecounter);
+  }
+  std::printf(
+      "POINT supply=%.4f conditional_supply=%.4f freedao=%.4f staked=%lld\n",
+      double(shared.point_stat->supply.amount) / economics::POINT_UNITS,
+      double(shared.point_stat->conditional_supply.amount) /
+          economics::POINT_UNITS,
+      shared.freedao_balance
+          ? double(shared.freedao_balance->balance.amount) /
+                economics::POINT_UNITS
+          : 0.0,
+      shared.aggstats
+          ? (long long)(shared.aggstats->staked.amount / SYSTEM_CURRENCY_UNITS)
+          : 0LL);
+  std::printf("\n%llu users, %u iterations, %llu actions in %.2fs "
+              "(%.0f actions/s, %u threads, %zu chains)\n",
+              (unsigned long long)cfg.users, cfg.iterations,
+              (unsigned long long)actions, seconds, actions / seconds,
+              cfg.threads, chunks.size());
+}
+
+// write the table scopes and row counts in the freeosram input format
+static bool write_scopes(const char *path,
+                         const std::vector<chunk_state> &chunks) {
+  FILE *file = std::fopen(path, "w");
+  if (file == nullptr) {
+    return false;
+  }
+
+  for (const auto &[key, s] : freeos_scopes(chunks)) {
+    std::fprintf(file, "%s %s %llu %s\n", key.first.c_str(),
+                 key.second.c_str(), (unsigned long long)s.rows,
+                 s.payer.to_string().c_str());
+  }
+
+  return std::fclose(file) == 0;
+}
+
+int main(int argc, char *argv[]) {
+  config cfg;
+  const char *csv = nullptr;
+  const char *scopes = nullptr;
+  const char *snapshot_path = nullptr;
+  const char *save = nullptr;
+
+  if (!parse_options(argc, argv, cfg, csv, scopes, snapshot_path, save)) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  if (cfg.threads == 0) {
+    cfg.threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  FILE *csv_file = nullptr;
+  if (csv != nullptr) {
+    csv_file = std::fopen(csv, "w");
+    if (csv_file == nullptr) {
+      std::perror(csv);
+      return 1;
+    }
+    std::fprintf(csv_file, "iteration,usercount,registrations,claims,"
+                           "claim_failures,unvests,unstakes,refunds,"
+                           "unstake_queue,supply,ram_bytes,elapsed_ms\n");
+  }
+
+  auto start_time = std::chrono::steady_clock::now();
+
+  // the chains are either made here or restored from a snapshot
+  snapshot saved;
+  uint32_t first_iteration = 1;
+
+  if (snapshot_path != nullptr) {
+    std::string error;
+    if (!saved.open(snapshot_path, error)) {
+      std::fprintf(stderr, "%s: %s\n", snapshot_path, error.c_str());
+      return 1;
+    }
+
+    const snapshot_header &header = saved.header();
+    cfg.users = header.users;
+    cfg.seed = header.seed;
+    cfg.join_iterations = header.join_iterations;
+    cfg.verified = header.verified;
+    cfg.kyc_record = header.kyc_record;
+    cfg.airkey = header.airkey;
+    first_iteration = header.iteration + 1;
+  }
+
+  uint32_t last_iteration = first_iteration + cfg.iterations - 1;
+  cfg.system.iterations = last_iteration;
+
+  std::vector<user_plan> plans(cfg.users);
+  std::vector<chunk_state> chunks((cfg.users + CHUNK_USERS - 1) / CHUNK_USERS);
+  for (uint64_t k = 0; k < chunks.size(); k++) {
+    chunks[k].first = k * CHUNK_USERS;
+    chunks[k].last = std::min(cfg.users, (k + 1) * CHUNK_USERS);
+  }
+
+  if (snapshot_path != nullptr && saved.header().chunks != chunks.size()) {
+    std::fprintf(stderr, "%s: snapshot is truncated\n", snapshot_path);
+    return 1;
+  }
+
+  iteration_stats totals = {};
+  shared_rows shared;
+
+  try {
+    for_each_chunk(cfg.threads, chunks.size(), [&](uint64_t k) {
+      for (uint64_t index = chunks[k].first; index < chunks[k].last; index++) {
+        plans[index] = make_user(cfg, index);
+      }
+
+      if (snapshot_path == nullptr) {
+        make_chain(cfg, chunks[k]);
+      } else {
+        chunks[k].c = std::make_unique<chain>();
+        deploy_freeos(*chunks[k].c);
+        chunks[k].c->restore(saved.chunk_data(k), saved.chunk_size(k));
+        add_iterations(*chunks[k].c, cfg.system, first_iteration,
+                       last_iteration);
+      }
+    });
+
+    std::printf("%s %llu users in %zu chains in %.1f ms\n",
+                snapshot_path == nullptr ? "set up" : "restored",
+                (unsigned long long)cfg.users, chunks.size(),
+                std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - start_time)
+                    .count());
+
+    int64_t ram_bytes = 0;
+    for (uint32_t iteration = first_iteration; iteration <= last_iteration;
+         iteration++) {
+      auto iteration_start = std::chrono::steady_clock::now();
+      iteration_stats stats = {};
+      uint64_t refunds;
+
+      shared = run_iteration(cfg, plans, chunks, iteration, stats, refunds);
+
+      for (int type = 0; type < action_types; type++) {
+        ram_bytes += stats[type].ram_bytes;
+        totals[type].merge(stats[type]);
+      }
+
+      if (csv_file != nullptr) {
+        double elapsed_ms =
+            std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - iteration_start)
+                .count();
+        std::fprintf(
+            csv_file,
+            "%u,%u,%llu,%llu,%llu,%llu,%llu,%llu,%u,%lld,%lld,%.1f\n",
+            iteration, shared.statistics ? shared.statistics->usercount : 0,
+            (unsigned long long)stats[act_reguser].ok,
+            (unsigned long long)stats[act_claim].ok,
+            (unsigned long long)stats[act_claim].failed,
+            (unsigned long long)stats[act_unvest].ok,
+            (unsigned long long)stats[act_unstake].ok,
+            (unsigned long long)refunds, refund_count(shared),
+            (long long)shared.point_stat->supply.amount, (long long)ram_bytes,
+            elapsed_ms);
+      }
+    }
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "simulation failed: %s\n", e.what());
+    return 1;
+  }
+
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start_time)
+                       .count();
+
+  if (csv_file != nullptr) {
+    std::fclose(csv_file);
+  }
+
+  print_report(cfg, shared, chunks, totals, seconds);
+
+  if (scopes != nullptr && !write_scopes(scopes, chunks)) {
+    std::perror(scopes);
+    return 1;
+  }
+
+  if (save != nullptr) {
+    std::vector<std::vector<char>> chains(chunks.size());
+    for_each_chunk(cfg.threads, chunks.size(),
+                   [&](uint64_t k) { chains[k] = chunks[k].c->snapshot(); });
+
+    snapshot_header header = {};
+    header.iteration = last_iteration;
+    header.join_iterations = cfg.join_iterations;
+    header.users = cfg.users;
+    header.seed = cfg.seed;
+    header.verified = cfg.verified;
+    header.kyc_record = cfg.kyc_record;
+    header.airkey = cfg.airkey;
+
+    if (!write_snapshot(save, header, chains)) {
+      std::perror(save);
+      return 1;
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+// Definitions shared by the freeossim tools: the RAM nodeos bills for the
+// freeos tables (freeossim, freeosram), the size of freeossim's chunks of
+// users and the deterministic per-user random numbers (freeossim,
+// freeosecon).
+
+#include "../common/freeoseconomics.hpp"
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <utility>
+#include <vector>
+
+namespace freedao {
+namespace sim {
+
+// RAM billed by nodeos: a row is billed its packed size plus 108 bytes, a
+// secondary index entry 128 bytes, and the first row of a table in a scope
+// another 108 bytes for the table itself.
+constexpr int64_t ROW_OVERHEAD_BYTES = 108;
+constexpr int64_t SECONDARY_INDEX_BYTES = 128; // per uint64_t secondary key
+constexpr int64_t TABLE_SCOPE_BYTES = 108;
+
+// the unlockfactor extension of the vestaccounts and statistics rows, which
+// LAZY_UNLOCK builds write
+#ifdef LAZY_UNLOCK
+constexpr int64_t UNLOCKFACTOR_SIZE = 8;
+#else
+constexpr int64_t UNLOCKFACTOR_SIZE = 0;
+#endif
+
+// packed row sizes of the freeoscommon.hpp structs
+constexpr int64_t USER_ROW_SIZE = 37;
+constexpr int64_t VESTACCOUNT_ROW_SIZE = 16 + UNLOCKFACTOR_SIZE;
+constexpr int64_t ACCOUNT_ROW_SIZE = 16;
+constexpr int64_t UNVEST_ROW_SIZE = 8;
+constexpr int64_t UNSTAKEREQ_ROW_SIZE = 28;
+constexpr int64_t DEPOSIT_ROW_SIZE = 24;
+constexpr int64_t ITERSTAT_ROW_SIZE = 8; // with the iteration extension
+constexpr int64_t CLAIMQUOTE_ROW_SIZE = 18;
+constexpr int64_t STATISTIC_ROW_SIZE = 24 + UNLOCKFACTOR_SIZE;
+constexpr int64_t CURRENCY_STATS_ROW_SIZE = 56;
+constexpr int64_t AGGSTAT_ROW_SIZE = 60;
+constexpr int64_t CONVREQUEST_ROW_SIZE = 32;
+
+// users are processed in fixed-size chunks. The chunk size does not depend on
+// the number of threads, so neither do the results.
+constexpr uint64_t CHUNK_USERS = 4096;
+
+// deterministic per-user, per-iteration random numbers (splitmix64)
+class user_random {
+public:
+  user_random(uint64_t seed, uint64_t user, uint32_t iteration)
+      : state(seed ^ (user * 0x9e3779b97f4a7c15ULL) ^
+              (uint64_t(iteration) << 40)) {}
+
+  uint64_t next() {
+    uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+  }
+
+  // true with probability p
+  bool chance(double p) { return (next() >> 11) * 0x1.0p-53 < p; }
+
+private:
+  uint64_t state;
+};
+
+} // namespace sim
+} // namespace freedao
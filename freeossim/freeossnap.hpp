@@ -0,0 +1,199 @@
+#pragma once
+
+// Simulation snapshots, written and read by freeossim.
+//
+// A snapshot holds the host chain of every chunk of users after an iteration
+// (chain::snapshot, see freeoshost.hpp), so that a run can start from a large
+// population without building it again. The file is a snapshot_header, a
+// snapshot_chunk per chunk and then the chains' snapshots. Opening a snapshot
+// maps the file read-only: the threads of a run restore their chunks' chains
+// from the one mapping, each reading only its own chunks' pages, and the file
+// itself is never modified. Restoring rebuilds the chains' tables, so it
+// takes time in proportion to the rows.
+//
+// A snapshot is rejected if its version or its TEST_BUILD and LAZY_UNLOCK
+// settings do not match the reader's; SNAPSHOT_VERSION must change when the
+// header or the chunking change. The chains' own layout is versioned by
+// chain::restore.
+
+#include "freeossim.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace freedao {
+namespace sim {
+
+constexpr char SNAPSHOT_MAGIC[8] = {'F', 'R', 'E', 'E', 'S', 'N', 'P', '2'};
+constexpr uint32_t SNAPSHOT_VERSION = 2;
+
+// the contract build the chains ran
+constexpr uint32_t SNAPSHOT_TEST_BUILD = 1;
+constexpr uint32_t SNAPSHOT_LAZY_UNLOCK = 2;
+constexpr uint32_t SNAPSHOT_BUILD = 0
+#ifdef TEST_BUILD
+                                    | SNAPSHOT_TEST_BUILD
+#endif
+#ifdef LAZY_UNLOCK
+                                    | SNAPSHOT_LAZY_UNLOCK
+#endif
+    ;
+
+struct snapshot_header {
+  char magic[8];
+  uint32_t version;
+  uint32_t build;
+  uint32_t iteration; // the last iteration run
+  uint32_t join_iterations;
+  uint64_t users;
+  uint64_t seed;
+  uint64_t chunk_users;
+  uint64_t chunks;
+
+  // the population
+  double verified;
+  double kyc_record;
+  double airkey;
+};
+
+// where a chunk's chain is in the file
+struct snapshot_chunk {
+  uint64_t offset;
+  uint64_t size;
+};
+
+// write the snapshot of the chains after the given iteration. header's
+// magic, version, build, chunk_users and chunks are filled in. Returns false
+// on an I/O error.
+inline bool write_snapshot(const std::string &path, snapshot_header header,
+                           const std::vector<std::vector<char>> &chains) {
+  FILE *file = std::fopen(path.c_str(), "wb");
+  if (file == nullptr) {
+    return false;
+  }
+
+  std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+  header.version = SNAPSHOT_VERSION;
+  header.build = SNAPSHOT_BUILD;
+  header.chunk_users = CHUNK_USERS;
+  header.chunks = chains.size();
+
+  std::vector<snapshot_chunk> chunks;
+  uint64_t offset =
+      sizeof(snapshot_header) + chains.size() * sizeof(snapshot_chunk);
+  for (const std::vector<char> &chain : chains) {
+    chunks.push_back({offset, chain.size()});
+    offset += chain.size();
+  }
+
+  bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+            std::fwrite(chunks.data(), sizeof(snapshot_chunk), chunks.size(),
+                        file) == chunks.size();
+  for (const std::vector<char> &chain : chains) {
+    ok = ok && std::fwrite(chain.data(), 1, chain.size(), file) == chain.size();
+  }
+
+  return std::fclose(file) == 0 && ok;
+}
+
+// a snapshot file, mapped read-only
+class snapshot {
+public:
+  snapshot() = default;
+  snapshot(const snapshot &) = delete;
+  snapshot &operator=(const snapshot &) = delete;
+
+  ~snapshot() {
+    if (base != nullptr) {
+      munmap(base, length);
+    }
+  }
+
+  // map the file. Returns false, with the reason in error, if it cannot be
+  // read or was written by a different build.
+  bool open(const std::string &path, std::string &error) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      error = std::strerror(errno);
+      return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && size_t(st.st_size) >= sizeof(snapshot_header)) {
+      length = st.st_size;
+      void *mapping = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+      base = mapping == MAP_FAILED ? nullptr : static_cast<char *>(mapping);
+    }
+    ::close(fd);
+
+    if (base == nullptr) {
+      error = "not a snapshot";
+      return false;
+    }
+
+    const snapshot_header &h = header();
+    if (std::memcmp(h.magic, SNAPSHOT_MAGIC, sizeof(h.magic)) != 0) {
+      error = "not a snapshot";
+    } else if (h.version != SNAPSHOT_VERSION) {
+      error = "snapshot version " + std::to_string(h.version) +
+              ", expected " + std::to_string(SNAPSHOT_VERSION);
+    } else if (h.chunk_users != CHUNK_USERS) {
+      error = "snapshot of chunks of " + std::to_string(h.chunk_users) +
+              " users, expected " + std::to_string(CHUNK_USERS);
+    } else if (h.build != SNAPSHOT_BUILD) {
+      error = std::string("snapshot of a ") +
+              (h.build & SNAPSHOT_TEST_BUILD ? "TEST_BUILD" : "production") +
+              (h.build & SNAPSHOT_LAZY_UNLOCK ? " LAZY_UNLOCK" : "") +
+              " build";
+    } else if (!chunks_fit()) {
+      error = "snapshot is truncated";
+    } else {
+      return true;
+    }
+    return false;
+  }
+
+  const snapshot_header &header() const {
+    return *reinterpret_cast<const snapshot_header *>(base);
+  }
+
+  // the chain of a chunk, for chain::restore
+  const char *chunk_data(uint64_t chunk) const {
+    return base + chunks()[chunk].offset;
+  }
+  size_t chunk_size(uint64_t chunk) const { return chunks()[chunk].size; }
+
+private:
+  const snapshot_chunk *chunks() const {
+    return reinterpret_cast<const snapshot_chunk *>(base +
+                                                    sizeof(snapshot_header));
+  }
+
+  bool chunks_fit() const {
+    uint64_t count = header().chunks;
+    if (count > (length - sizeof(snapshot_header)) / sizeof(snapshot_chunk)) {
+      return false;
+    }
+    for (uint64_t i = 0; i < count; i++) {
+      if (chunks()[i].offset > length ||
+          chunks()[i].size > length - chunks()[i].offset) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  char *base = nullptr;
+  size_t length = 0;
+};
+
+} // namespace sim
+} // namespace freedao
@@ -0,0 +1,1287 @@
+// freeoswasm - runs freeos.wasm and freeosconfig.wasm offline, on an
+// in-memory chain, and reports the WebAssembly instructions each action
+// executes and where.
+//
+// freeossim and the FREEOS_PROFILE build count what the contract does -
+// table accesses, inline actions - and the host build times native code,
+// but nodeos bills CPU for the compiled WebAssembly, where long double
+// arithmetic is softfloat calls and every memcpy is an intrinsic. This runs
+// the .wasm files themselves (freeoswasm.hpp), provides the eosio
+// intrinsics they import against in-memory tables, and counts instructions
+// per action, per function and per intrinsic.
+//
+// A script drives the chain, one directive or action per line:
+//
+//   code <account> <wasm file>         deploy a contract
+//   time <seconds or YYYY-MM-DDTHH:MM:SS>  the block time, in UTC
+//   row <code> <scope> <table> <primary> <field> ...
+//                                      store a row written by a contract
+//                                      without code here, e.g. usersinfo
+//   <contract> <action> <actor>[,<actor>...] <field> ...
+//                                      push a transaction with one action
+//   <receiver>/<contract> <action> <actor> <field> ...
+//                                      deliver contract's action to receiver
+//                                      as a notification, e.g. a stake
+//   label <label>                      name the next transaction in the
+//                                      --report (contract::action, with #2,
+//                                      #3, ... for repeats, by default)
+//
+// Each field of the action data (or row) is written in ABI order as
+// type:value - name:alice, string:"freeos stake", asset:"10.0000 XPR",
+// symbol:4,XPR, u8/u16/u32/u64/i32/i64:N, bool:1, f64:1.5,
+// time_point:<time>, time_point_sec:<time>, vector:N (the length of the
+// vector whose elements follow) or hex:0a0b. Everything after a # is a
+// comment.
+//
+// Actions for accounts without code (e.g. the token transfers of a claim)
+// are recorded and skipped. Every account exists and every authorization
+// is satisfied, as there are no keys or permissions; require_auth only
+// checks the action names its account. A failed transaction's table
+// changes are undone. Functions are listed by index unless the .wasm has a
+// name section.
+//
+// usage: ./freeoswasm [options] <script> - see usage() below
+
+#include "eosname.hpp"
+#include "freeosscript.hpp"
+#include "freeoswasm.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <string>
+
+using namespace freedao;
+using freedao::sim::name_string;
+using freedao::sim::name_value;
+using namespace freedao::script;
+
+static void usage(const char *program) {
+  std::printf(
+      "usage: %s [options] <script>\n"
+      "  --top N            functions to list in the hotspots (20)\n"
+      "  --limit N          instructions per action before it is stopped\n"
+      "                     (100000000)\n"
+      "  --console          print what the contracts print\n"
+      "  --quiet            only the summary and hotspots\n"
+      "  --report FILE      write a line per transaction to FILE: label,\n"
+      "                     instructions, db reads, db writes, heap bytes\n"
+      "                     and ok or failed\n",
+      program);
+}
+
+constexpr uint32_t MAX_INLINE_DEPTH = 4; // nodeos' max_inline_action_depth
+
+// an assertion failure, or any other reason a transaction fails
+struct action_failed : std::runtime_error {
+  using std::runtime_error::runtime_error;
+};
+
+struct action {
+  uint64_t account = 0;
+  uint64_t name = 0;
+  std::vector<std::pair<uint64_t, uint64_t>> authorization;
+  std::vector<uint8_t> data;
+};
+
+// what one receiver's apply of an action cost
+struct apply_record {
+  uint64_t receiver;
+  uint64_t account;
+  uint64_t name;
+  bool code;
+  uint64_t instructions;
+};
+
+// the table accesses and intrinsic calls of a transaction
+struct usage_counts {
+  uint64_t db_reads = 0;
+  uint64_t db_writes = 0;
+  uint64_t inline_actions = 0;
+  uint64_t notifications = 0;
+  uint64_t memory_bytes = 0; // copied, moved or set by memcpy and friends
+  uint64_t heap_bytes = 0;   // linear memory grown by memory.grow
+  uint64_t softfloat = 0;
+};
+
+struct table_key {
+  uint64_t code;
+  uint64_t scope;
+  uint64_t table;
+
+  bool operator<(const table_key &o) const {
+    return std::tie(code, scope, table) < std::tie(o.code, o.scope, o.table);
+  }
+};
+
+struct table_row {
+  uint64_t payer;
+  std::vector<uint8_t> value;
+};
+
+using primary_table = std::map<uint64_t, table_row>;
+
+struct index_table {
+  std::set<std::pair<uint64_t, uint64_t>> by_secondary; // secondary, primary
+  std::map<uint64_t, uint64_t> by_primary;              // primary, secondary
+};
+
+class chain;
+
+// a contract deployed on the chain
+struct contract {
+  wasm::module code;
+  std::unique_ptr<wasm::instance> vm;
+  uint32_t apply = wasm::NO_FUNCTION;
+  std::vector<uint64_t (chain::*)(const uint64_t *)> imports;
+};
+
+// a 128-bit float passed to the softfloat intrinsics as two i64s
+static __float128 f128(uint64_t low, uint64_t high) {
+  __float128 value;
+  uint64_t words[2] = {low, high};
+  std::memcpy(&value, words, sizeof(value));
+  return value;
+}
+
+class chain : public wasm::host {
+public:
+  // deploy a contract. Returns false, with the reason in error, if the
+  // module cannot be run.
+  bool deploy(uint64_t account, std::vector<uint8_t> bytes,
+              std::string &error) {
+    auto c = std::make_unique<contract>();
+    if (!c->code.load(std::move(bytes), error)) {
+      return false;
+    }
+    c->apply = c->code.exported("apply");
+    if (c->apply == wasm::NO_FUNCTION) {
+      error = "no apply export";
+      return false;
+    }
+    for (uint32_t i = 0; i < c->code.imports; i++) {
+      auto intrinsic = intrinsics().find(c->code.functions[i].name);
+      c->imports.push_back(intrinsic == intrinsics().end() ? nullptr
+                                                           : intrinsic->second);
+    }
+    try {
+      c->vm = std::make_unique<wasm::instance>(c->code, *this);
+    } catch (const wasm::trap &e) {
+      error = e.what();
+      return false;
+    }
+    c->vm->limit = limit;
+    contracts[account] = std::move(c);
+    return true;
+  }
+
+  // push a transaction of one action, or deliver a notification of it to
+  // receiver. Throws action_failed, with the tables unchanged, if it fails.
+  void push(const action &a, uint64_t receiver) {
+    auto saved_rows = rows;
+    auto saved_indexes = indexes;
+    records.clear();
+    counts = usage_counts();
+    try {
+      execute(a, receiver, 0);
+    } catch (const std::exception &e) {
+      rows = std::move(saved_rows);
+      indexes = std::move(saved_indexes);
+      throw action_failed(e.what());
+    }
+  }
+
+  void store_row(const table_key &key, uint64_t primary,
+                 std::vector<uint8_t> value) {
+    rows[key][primary] = {key.code, std::move(value)};
+  }
+
+  const contract *find(uint64_t account) const {
+    auto c = contracts.find(account);
+    return c == contracts.end() ? nullptr : c->second.get();
+  }
+
+  uint64_t call(wasm::instance &, uint32_t index,
+                const uint64_t *args) override {
+    auto intrinsic = current->imports[index];
+    if (intrinsic == nullptr) {
+      throw wasm::trap("unimplemented intrinsic " +
+                       current->code.functions[index].name);
+    }
+    return (this->*intrinsic)(args);
+  }
+
+  uint64_t now_us = 0;
+  uint64_t limit = 100000000;
+  bool console = false;
+  std::string printed;
+  std::vector<apply_record> records;
+  usage_counts counts;
+  std::map<std::string, std::pair<uint64_t, uint64_t>> intrinsic_calls;
+  std::map<uint64_t, std::unique_ptr<contract>> contracts;
+
+private:
+  using intrinsic = uint64_t (chain::*)(const uint64_t *);
+
+  void execute(const action &a, uint64_t receiver, uint32_t depth) {
+    if (depth > MAX_INLINE_DEPTH) {
+      throw action_failed("max inline action depth exceeded");
+    }
+
+    std::vector<uint64_t> receivers = {receiver};
+    std::vector<action> inlines;
+    for (size_t i = 0; i < receivers.size(); i++) {
+      apply(a, receivers[i], receivers, inlines);
+    }
+    counts.notifications += receivers.size() - 1;
+    for (const action &next : inlines) {
+      execute(next, next.account, depth + 1);
+    }
+  }
+
+  void apply(const action &a, uint64_t receiver,
+             std::vector<uint64_t> &receivers, std::vector<action> &inlines) {
+    auto found = contracts.find(receiver);
+    if (found == contracts.end()) {
+      records.push_back({receiver, a.account, a.name, false, 0});
+      return;
+    }
+
+    contract &c = *found->second;
+    current = &c;
+    current_action = &a;
+    current_receiver = receiver;
+    notify = &receivers;
+    sent = &inlines;
+    row_iterators.clear();
+    row_iterator_of.clear();
+    index_iterators.clear();
+    index_iterator_of.clear();
+    end_iterators.clear();
+
+    c.vm->reset();
+    uint64_t before = c.vm->instructions;
+    size_t initial_memory = c.vm->memory_size();
+    auto finished = [&]() {
+      records.push_back(
+          {receiver, a.account, a.name, true, c.vm->instructions - before});
+      counts.heap_bytes += c.vm->memory_size() - initial_memory;
+    };
+
+    uint64_t args[3] = {receiver, a.account, a.name};
+    try {
+      c.vm->call(c.apply, args);
+    } catch (...) {
+      finished();
+      throw;
+    }
+    finished();
+  }
+
+  uint8_t *memory(uint64_t address, uint64_t length) {
+    return current->vm->at(uint32_t(address), length);
+  }
+
+  void count(const char *name, uint64_t bytes = 0) {
+    auto &calls = intrinsic_calls[name];
+    calls.first++;
+    calls.second += bytes;
+  }
+
+  // --- iterators, as nodeos numbers them: a row's iterator is its index in
+  // the cache and a table's end iterator is -2 - the table's index
+
+  int32_t end_iterator(const table_key &key) {
+    for (size_t i = 0; i < end_iterators.size(); i++) {
+      if (!(end_iterators[i] < key) && !(key < end_iterators[i])) {
+        return -2 - int32_t(i);
+      }
+    }
+    end_iterators.push_back(key);
+    return -2 - int32_t(end_iterators.size() - 1);
+  }
+
+  const table_key &end_table(int32_t iterator) {
+    size_t i = -2 - iterator;
+    if (iterator >= -1 || i >= end_iterators.size()) {
+      throw action_failed("invalid end iterator");
+    }
+    return end_iterators[i];
+  }
+
+  int32_t row_iterator(const table_key &key, uint64_t primary) {
+    auto cached = row_iterator_of.find({key, primary});
+    if (cached != row_iterator_of.end()) {
+      return cached->second;
+    }
+    row_iterators.push_back({key, primary});
+    int32_t iterator = row_iterators.size() - 1;
+    row_iterator_of[{key, primary}] = iterator;
+    return iterator;
+  }
+
+  // the row of an iterator
+  std::pair<table_key, primary_table::iterator> row_at(int32_t iterator) {
+    if (iterator < 0 || size_t(iterator) >= row_iterators.size()) {
+      throw action_failed("invalid iterator");
+    }
+    const auto &r = row_iterators[iterator];
+    auto table = rows.find(r.first);
+    if (table == rows.end() || table->second.count(r.second) == 0) {
+      throw action_failed("dereference of deleted object");
+    }
+    return {r.first, table->second.find(r.second)};
+  }
+
+  // the result of a lookup in a table: the row's iterator, the table's end
+  // iterator, or -1 if the table does not exist
+  int32_t lookup(const table_key &key, primary_table::iterator row) {
+    auto table = rows.find(key);
+    if (row == table->second.end()) {
+      return end_iterator(key);
+    }
+    return row_iterator(key, row->first);
+  }
+
+  primary_table *table(const table_key &key) {
+    auto table = rows.find(key);
+    return table == rows.end() || table->second.empty() ? nullptr
+                                                        : &table->second;
+  }
+
+  // --- the intrinsics
+
+  uint64_t abort(const uint64_t *) { throw action_failed("abort() called"); }
+
+  std::string c_string(uint64_t address) {
+    std::string s;
+    for (;; address++) {
+      char c = *memory(address, 1);
+      if (c == '\0') {
+        return s;
+      }
+      s += c;
+    }
+  }
+
+  uint64_t eosio_assert(const uint64_t *args) {
+    if (uint32_t(args[0]) == 0) {
+      throw action_failed("assertion failure with message: " +
+                          c_string(uint32_t(args[1])));
+    }
+    return 0;
+  }
+
+  uint64_t eosio_assert_code(const uint64_t *args) {
+    if (uint32_t(args[0]) == 0) {
+      throw action_failed("assertion failure with error code: " +
+                          std::to_string(args[1]));
+    }
+    return 0;
+  }
+
+  uint64_t memcpy_(const uint64_t *args) {
+    uint32_t dest = args[0], src = args[1], length = args[2];
+    if ((dest > src ? dest - src : src - dest) < length) {
+      throw action_failed("memcpy can only accept non-aliasing pointers");
+    }
+    std::memcpy(memory(dest, length), memory(src, length), length);
+    counts.memory_bytes += length;
+    count("memcpy", length);
+    return dest;
+  }
+
+  uint64_t memmove_(const uint64_t *args) {
+    uint32_t dest = args[0], src = args[1], length = args[2];
+    std::memmove(memory(dest, length), memory(src, length), length);
+    counts.memory_bytes += length;
+    count("memmove", length);
+    return dest;
+  }
+
+  uint64_t memset_(const uint64_t *args) {
+    uint32_t dest = args[0], length = args[2];
+    std::memset(memory(dest, length), int(args[1]), length);
+    counts.memory_bytes += length;
+    count("memset", length);
+    return dest;
+  }
+
+  uint64_t prints_l(const uint64_t *args) {
+    uint32_t length = args[1];
+    const char *text = reinterpret_cast<char *>(memory(args[0], length));
+    printed.append(text, length);
+    count("prints_l", length);
+    return 0;
+  }
+
+  // softfloat, on the host's binary128 - results are written to the first
+  // argument
+  uint64_t softfloat_result(uint64_t address, __float128 value) {
+    std::memcpy(memory(uint32_t(address), 16), &value, 16);
+    counts.softfloat++;
+    return 0;
+  }
+  uint64_t addtf3(const uint64_t *a) {
+    count("__addtf3");
+    return softfloat_result(a[0], f128(a[1], a[2]) + f128(a[3], a[4]));
+  }
+  uint64_t subtf3(const uint64_t *a) {
+    count("__subtf3");
+    return softfloat_result(a[0], f128(a[1], a[2]) - f128(a[3], a[4]));
+  }
+  uint64_t multf3(const uint64_t *a) {
+    count("__multf3");
+    return softfloat_result(a[0], f128(a[1], a[2]) * f128(a[3], a[4]));
+  }
+  uint64_t divtf3(const uint64_t *a) {
+    count("__divtf3");
+    return softfloat_result(a[0], f128(a[1], a[2]) / f128(a[3], a[4]));
+  }
+  uint64_t extendsftf2(const uint64_t *a) {
+    count("__extendsftf2");
+    float f;
+    uint32_t bits = a[1];
+    std::memcpy(&f, &bits, 4);
+    return softfloat_result(a[0], f);
+  }
+  uint64_t extenddftf2(const uint64_t *a) {
+    count("__extenddftf2");
+    double d;
+    std::memcpy(&d, &a[1], 8);
+    return softfloat_result(a[0], d);
+  }
+  uint64_t floatsitf(const uint64_t *a) {
+    count("__floatsitf");
+    return softfloat_result(a[0], int32_t(a[1]));
+  }
+  uint64_t floatunsitf(const uint64_t *a) {
+    count("__floatunsitf");
+    return softfloat_result(a[0], uint32_t(a[1]));
+  }
+  uint64_t trunctfdf2(const uint64_t *a) {
+    count("__trunctfdf2");
+    counts.softfloat++;
+    double d = f128(a[0], a[1]);
+    uint64_t bits;
+    std::memcpy(&bits, &d, 8);
+    return bits;
+  }
+  uint64_t trunctfsf2(const uint64_t *a) {
+    count("__trunctfsf2");
+    counts.softfloat++;
+    float f = f128(a[0], a[1]);
+    uint32_t bits;
+    std::memcpy(&bits, &f, 4);
+    return bits;
+  }
+  uint64_t fixtfsi(const uint64_t *a) {
+    count("__fixtfsi");
+    counts.softfloat++;
+    __float128 x = f128(a[0], a[1]);
+    x = x != x ? 0 : std::max<__float128>(std::min<__float128>(x, INT32_MAX),
+                                          INT32_MIN);
+    return uint32_t(int32_t(x));
+  }
+  uint64_t fixunstfsi(const uint64_t *a) {
+    count("__fixunstfsi");
+    counts.softfloat++;
+    __float128 x = f128(a[0], a[1]);
+    x = x != x ? 0 : std::max<__float128>(std::min<__float128>(x, UINT32_MAX),
+                                          0);
+    return uint32_t(x);
+  }
+  // the comparisons return libgcc's values: __eqtf2 and __netf2 0 if
+  // equal, __letf2 and __getf2 -1, 0 or 1, with unordered values as 1 for
+  // __letf2 (and the equalities) and -1 for __getf2
+  uint64_t compare(const uint64_t *a, int32_t unordered) {
+    counts.softfloat++;
+    __float128 x = f128(a[0], a[1]), y = f128(a[2], a[3]);
+    if (x != x || y != y) {
+      return uint32_t(unordered);
+    }
+    return uint32_t(x < y ? -1 : x > y ? 1 : 0);
+  }
+  uint64_t eqtf2(const uint64_t *a) {
+    count("__eqtf2");
+    return compare(a, 1);
+  }
+  uint64_t netf2(const uint64_t *a) {
+    count("__netf2");
+    return compare(a, 1);
+  }
+  uint64_t letf2(const uint64_t *a) {
+    count("__letf2");
+    return compare(a, 1);
+  }
+  uint64_t getf2(const uint64_t *a) {
+    count("__getf2");
+    return compare(a, -1);
+  }
+  uint64_t unordtf2(const uint64_t *a) {
+    count("__unordtf2");
+    counts.softfloat++;
+    __float128 x = f128(a[0], a[1]), y = f128(a[2], a[3]);
+    return x != x || y != y;
+  }
+
+  uint64_t current_time(const uint64_t *) {
+    count("current_time");
+    return now_us;
+  }
+
+  uint64_t current_receiver_(const uint64_t *) {
+    count("current_receiver");
+    return current_receiver;
+  }
+
+  uint64_t action_data_size(const uint64_t *) {
+    count("action_data_size");
+    return current_action->data.size();
+  }
+
+  uint64_t read_action_data(const uint64_t *args) {
+    uint32_t length = args[1];
+    count("read_action_data", length);
+    if (length == 0) {
+      return current_action->data.size();
+    }
+    length = std::min<uint32_t>(length, current_action->data.size());
+    std::memcpy(memory(uint32_t(args[0]), length),
+                current_action->data.data(), length);
+    return length;
+  }
+
+  uint64_t require_auth(const uint64_t *args) {
+    count("require_auth");
+    if (has_auth(args) == 0) {
+      throw action_failed("missing authority of " + name_string(args[0]));
+    }
+    return 0;
+  }
+
+  uint64_t has_auth(const uint64_t *args) {
+    count("has_auth");
+    for (const auto &level : current_action->authorization) {
+      if (level.first == args[0]) {
+        return 1;
+      }
+    }
+    return 0;
+  }
+
+  uint64_t is_account(const uint64_t *) {
+    count("is_account");
+    return 1;
+  }
+
+  uint64_t require_recipient(const uint64_t *args) {
+    count("require_recipient");
+    if (std::find(notify->begin(), notify->end(), args[0]) == notify->end()) {
+      notify->push_back(args[0]);
+    }
+    return 0;
+  }
+
+  uint64_t send_inline(const uint64_t *args) {
+    uint32_t length = args[1];
+    count("send_inline", length);
+    const uint8_t *p = memory(uint32_t(args[0]), length);
+    const uint8_t *end = p + length;
+
+    auto read = [&](void *to, size_t n) {
+      if (size_t(end - p) < n) {
+        throw action_failed("malformed inline action");
+      }
+      std::memcpy(to, p, n);
+      p += n;
+    };
+    auto varuint = [&]() {
+      uint32_t value = 0;
+      for (int shift = 0; shift < 35; shift += 7) {
+        uint8_t b;
+        read(&b, 1);
+        value |= uint32_t(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+          break;
+        }
+      }
+      return value;
+    };
+
+    action a;
+    read(&a.account, 8);
+    read(&a.name, 8);
+    for (uint32_t n = varuint(); n > 0; n--) {
+      std::pair<uint64_t, uint64_t> level;
+      read(&level.first, 8);
+      read(&level.second, 8);
+      a.authorization.push_back(level);
+    }
+    a.data.resize(varuint());
+    read(a.data.data(), a.data.size());
+
+    sent->push_back(std::move(a));
+    counts.inline_actions++;
+    return 0;
+  }
+
+  uint64_t get_active_producers(const uint64_t *) {
+    count("get_active_producers");
+    return 0;
+  }
+
+  // --- the primary index
+
+  uint64_t db_store_i64(const uint64_t *args) {
+    count("db_store_i64", uint32_t(args[5]));
+    counts.db_writes++;
+    table_key key = {current_receiver, args[0], args[1]};
+    uint32_t length = args[5];
+    const uint8_t *data = memory(uint32_t(args[4]), length);
+
+    primary_table &t = rows[key];
+    if (t.count(args[3]) != 0) {
+      throw action_failed("db_store_i64: primary key is already in the table");
+    }
+    t[args[3]] = {args[2], std::vector<uint8_t>(data, data + length)};
+    return row_iterator(key, args[3]);
+  }
+
+  uint64_t db_update_i64(const uint64_t *args) {
+    count("db_update_i64", uint32_t(args[3]));
+    counts.db_writes++;
+    auto row = row_at(args[0]);
+    if (row.first.code != current_receiver) {
+      throw action_failed("db access violation");
+    }
+    uint32_t length = args[3];
+    const uint8_t *data = memory(uint32_t(args[2]), length);
+    row.second->second.value.assign(data, data + length);
+    if (args[1] != 0) {
+      row.second->second.payer = args[1];
+    }
+    return 0;
+  }
+
+  uint64_t db_remove_i64(const uint64_t *args) {
+    count("db_remove_i64");
+    counts.db_writes++;
+    auto row = row_at(args[0]);
+    if (row.first.code != current_receiver) {
+      throw action_failed("db access violation");
+    }
+    rows[row.first].erase(row.second);
+    return 0;
+  }
+
+  uint64_t db_get_i64(const uint64_t *args) {
+    uint32_t length = args[2];
+    auto row = row_at(args[0]);
+    const auto &value = row.second->second.value;
+    count("db_get_i64", value.size());
+    if (length == 0) {
+      return value.size();
+    }
+    length = std::min<uint32_t>(length, value.size());
+    std::memcpy(memory(uint32_t(args[1]), length), value.data(), length);
+    return length;
+  }
+
+  uint64_t db_find_i64(const uint64_t *args) {
+    count("db_find_i64");
+    counts.db_reads++;
+    table_key key = {args[0], args[1], args[2]};
+    primary_table *t = table(key);
+    return t == nullptr ? -1 : uint32_t(lookup(key, t->find(args[3])));
+  }
+
+  uint64_t db_lowerbound_i64(const uint64_t *args) {
+    count("db_lowerbound_i64");
+    counts.db_reads++;
+    table_key key = {args[0], args[1], args[2]};
+    primary_table *t = table(key);
+    return t == nullptr ? -1 : uint32_t(lookup(key, t->lower_bound(args[3])));
+  }
+
+  uint64_t db_upperbound_i64(const uint64_t *args) {
+    count("db_upperbound_i64");
+    counts.db_reads++;
+    table_key key = {args[0], args[1], args[2]};
+    primary_table *t = table(key);
+    return t == nullptr ? -1 : uint32_t(lookup(key, t->upper_bound(args[3])));
+  }
+
+  uint64_t db_end_i64(const uint64_t *args) {
+    count("db_end_i64");
+    table_key key = {args[0], args[1], args[2]};
+    return table(key) == nullptr ? -1 : uint32_t(end_iterator(key));
+  }
+
+  uint64_t db_next_i64(const uint64_t *args) {
+    count("db_next_i64");
+    counts.db_reads++;
+    int32_t iterator = args[0];
+    if (iterator < -1) {
+      return -1; // past the end
+    }
+    auto row = row_at(iterator);
+    auto next = std::next(row.second);
+    int32_t result = lookup(row.first, next);
+    if (next != rows[row.first].end()) {
+      std::memcpy(memory(uint32_t(args[1]), 8), &next->first, 8);
+    }
+    return uint32_t(result);
+  }
+
+  uint64_t db_previous_i64(const uint64_t *args) {
+    count("db_previous_i64");
+    counts.db_reads++;
+    int32_t iterator = args[0];
+    primary_table::iterator previous;
+    table_key key;
+    if (iterator < -1) {
+      key = end_table(iterator);
+      primary_table *t = table(key);
+      if (t == nullptr) {
+        return uint32_t(-1);
+      }
+      previous = std::prev(t->end());
+    } else {
+      auto row = row_at(iterator);
+      key = row.first;
+      if (row.second == rows[key].begin()) {
+        return uint32_t(-1);
+      }
+      previous = std::prev(row.second);
+    }
+    std::memcpy(memory(uint32_t(args[1]), 8), &previous->first, 8);
+    return uint32_t(row_iterator(key, previous->first));
+  }
+
+  // --- idx64 secondary indexes
+
+  int32_t index_iterator(const table_key &key, uint64_t primary) {
+    auto cached = index_iterator_of.find({key, primary});
+    if (cached != index_iterator_of.end()) {
+      return cached->second;
+    }
+    index_iterators.push_back({key, primary});
+    int32_t iterator = index_iterators.size() - 1;
+    index_iterator_of[{key, primary}] = iterator;
+    return iterator;
+  }
+
+  std::pair<table_key, uint64_t> index_at(int32_t iterator) {
+    if (iterator < 0 || size_t(iterator) >= index_iterators.size()) {
+      throw action_failed("invalid index iterator");
+    }
+    const auto &i = index_iterators[iterator];
+    auto t = indexes.find(i.first);
+    if (t == indexes.end() || t->second.by_primary.count(i.second) == 0) {
+      throw action_failed("dereference of deleted index entry");
+    }
+    return i;
+  }
+
+  // the result of a search of an index: the entry's iterator (writing its
+  // primary key), the end iterator, or -1 if there is no index
+  uint32_t index_result(const table_key &key,
+                        std::set<std::pair<uint64_t, uint64_t>>::iterator e,
+                        uint64_t primary_address) {
+    if (e == indexes[key].by_secondary.end()) {
+      return uint32_t(end_iterator(key));
+    }
+    std::memcpy(memory(primary_address, 8), &e->second, 8);
+    return uint32_t(index_iterator(key, e->second));
+  }
+
+  index_table *index(const table_key &key) {
+    auto t = indexes.find(key);
+    return t == indexes.end() || t->second.by_primary.empty() ? nullptr
+                                                              : &t->second;
+  }
+
+  uint64_t db_idx64_store(const uint64_t *args) {
+    count("db_idx64_store");
+    counts.db_writes++;
+    table_key key = {current_receiver, args[0], args[1]};
+    uint64_t secondary;
+    std::memcpy(&secondary, memory(uint32_t(args[4]), 8), 8);
+    index_table &t = indexes[key];
+    t.by_secondary.insert({secondary, args[3]});
+    t.by_primary[args[3]] = secondary;
+    return uint32_t(index_iterator(key, args[3]));
+  }
+
+  uint64_t db_idx64_update(const uint64_t *args) {
+    count("db_idx64_update");
+    counts.db_writes++;
+    auto entry = index_at(args[0]);
+    if (entry.first.code != current_receiver) {
+      throw action_failed("db access violation");
+    }
+    uint64_t secondary;
+    std::memcpy(&secondary, memory(uint32_t(args[2]), 8), 8);
+    index_table &t = indexes[entry.first];
+    t.by_secondary.erase({t.by_primary[entry.second], entry.second});
+    t.by_secondary.insert({secondary, entry.second});
+    t.by_primary[entry.second] = secondary;
+    return 0;
+  }
+
+  uint64_t db_idx64_remove(const uint64_t *args) {
+    count("db_idx64_remove");
+    counts.db_writes++;
+    auto entry = index_at(args[0]);
+    if (entry.first.code != current_receiver) {
+      throw action_failed("db access violation");
+    }
+    index_table &t = indexes[entry.first];
+    t.by_secondary.erase({t.by_primary[entry.second], entry.second});
+    t.by_primary.erase(entry.second);
+    return 0;
+  }
+
+  uint64_t db_idx64_find_primary(const uint64_t *args) {
+    count("db_idx64_find_primary");
+    counts.db_reads++;
+    table_key key = {args[0], args[1], args[2]};
+    index_table *t = index(key);
+    if (t == nullptr) {
+      return uint32_t(-1);
+    }
+    auto e = t->by_primary.find(args[4]);
+    if (e == t->by_primary.end()) {
+      return uint32_t(end_iterator(key));
+    }
+    std::memcpy(memory(uint32_t(args[3]), 8), &e->second, 8);
+    return uint32_t(index_iterator(key, args[4]));
+  }
+
+  uint64_t idx64_bound(const uint64_t *args, bool upper) {
+    counts.db_reads++;
+    table_key key = {args[0], args[1], args[2]};
+    index_table *t = index(key);
+    if (t == nullptr) {
+      return uint32_t(-1);
+    }
+    uint8_t *secondary_at = memory(uint32_t(args[3]), 8);
+    uint64_t secondary;
+    std::memcpy(&secondary, secondary_at, 8);
+    auto e = upper ? t->by_secondary.upper_bound({secondary, UINT64_MAX})
+                   : t->by_secondary.lower_bound({secondary, 0});
+    if (e != t->by_secondary.end()) {
+      std::memcpy(secondary_at, &e->first, 8);
+    }
+    return index_result(key, e, uint32_t(args[4]));
+  }
+
+  uint64_t db_idx64_lowerbound(const uint64_t *args) {
+    count("db_idx64_lowerbound");
+    return idx64_bound(args, false);
+  }
+
+  uint64_t db_idx64_upperbound(const uint64_t *args) {
+    count("db_idx64_upperbound");
+    return idx64_bound(args, true);
+  }
+
+  uint64_t db_idx64_end(const uint64_t *args) {
+    count("db_idx64_end");
+    table_key key = {args[0], args[1], args[2]};
+    return index(key) == nullptr ? uint32_t(-1)
+                                 : uint32_t(end_iterator(key));
+  }
+
+  uint64_t db_idx64_next(const uint64_t *args) {
+    count("db_idx64_next");
+    counts.db_reads++;
+    int32_t iterator = args[0];
+    if (iterator < -1) {
+      return uint32_t(-1);
+    }
+    auto entry = index_at(iterator);
+    index_table &t = indexes[entry.first];
+    auto e = t.by_secondary.find({t.by_primary[entry.second], entry.second});
+    return index_result(entry.first, std::next(e), uint32_t(args[1]));
+  }
+
+  uint64_t db_idx64_previous(const uint64_t *args) {
+    count("db_idx64_previous");
+    counts.db_reads++;
+    int32_t iterator = args[0];
+    table_key key;
+    std::set<std::pair<uint64_t, uint64_t>>::iterator e;
+    if (iterator < -1) {
+      key = end_table(iterator);
+      index_table *t = index(key);
+      if (t == nullptr) {
+        return uint32_t(-1);
+      }
+      e = t->by_secondary.end();
+    } else {
+      auto entry = index_at(iterator);
+      key = entry.first;
+      index_table &t = indexes[key];
+      e = t.by_secondary.find({t.by_primary[entry.second], entry.second});
+    }
+    if (e == indexes[key].by_secondary.begin()) {
+      return uint32_t(-1);
+    }
+    return index_result(key, std::prev(e), uint32_t(args[1]));
+  }
+
+  static const std::map<std::string, intrinsic> &intrinsics() {
+    static const std::map<std::string, intrinsic> table = {
+        {"abort", &chain::abort},
+        {"eosio_assert", &chain::eosio_assert},
+        {"eosio_assert_code", &chain::eosio_assert_code},
+        {"memcpy", &chain::memcpy_},
+        {"memmove", &chain::memmove_},
+        {"memset", &chain::memset_},
+        {"prints_l", &chain::prints_l},
+        {"__addtf3", &chain::addtf3},
+        {"__subtf3", &chain::subtf3},
+        {"__multf3", &chain::multf3},
+        {"__divtf3", &chain::divtf3},
+        {"__extendsftf2", &chain::extendsftf2},
+        {"__extenddftf2", &chain::extenddftf2},
+        {"__floatsitf", &chain::floatsitf},
+        {"__floatunsitf", &chain::floatunsitf},
+        {"__trunctfdf2", &chain::trunctfdf2},
+        {"__trunctfsf2", &chain::trunctfsf2},
+        {"__fixtfsi", &chain::fixtfsi},
+        {"__fixunstfsi", &chain::fixunstfsi},
+        {"__eqtf2", &chain::eqtf2},
+        {"__netf2", &chain::netf2},
+        {"__letf2", &chain::letf2},
+        {"__getf2", &chain::getf2},
+        {"__unordtf2", &chain::unordtf2},
+        {"current_time", &chain::current_time},
+        {"current_receiver", &chain::current_receiver_},
+        {"action_data_size", &chain::action_data_size},
+        {"read_action_data", &chain::read_action_data},
+        {"require_auth", &chain::require_auth},
+        {"has_auth", &chain::has_auth},
+        {"is_account", &chain::is_account},
+        {"require_recipient", &chain::require_recipient},
+        {"send_inline", &chain::send_inline},
+        {"get_active_producers", &chain::get_active_producers},
+        {"db_store_i64", &chain::db_store_i64},
+        {"db_update_i64", &chain::db_update_i64},
+        {"db_remove_i64", &chain::db_remove_i64},
+        {"db_get_i64", &chain::db_get_i64},
+        {"db_find_i64", &chain::db_find_i64},
+        {"db_lowerbound_i64", &chain::db_lowerbound_i64},
+        {"db_upperbound_i64", &chain::db_upperbound_i64},
+        {"db_end_i64", &chain::db_end_i64},
+        {"db_next_i64", &chain::db_next_i64},
+        {"db_previous_i64", &chain::db_previous_i64},
+        {"db_idx64_store", &chain::db_idx64_store},
+        {"db_idx64_update", &chain::db_idx64_update},
+        {"db_idx64_remove", &chain::db_idx64_remove},
+        {"db_idx64_find_primary", &chain::db_idx64_find_primary},
+        {"db_idx64_lowerbound", &chain::db_idx64_lowerbound},
+        {"db_idx64_upperbound", &chain::db_idx64_upperbound},
+        {"db_idx64_end", &chain::db_idx64_end},
+        {"db_idx64_next", &chain::db_idx64_next},
+        {"db_idx64_previous", &chain::db_idx64_previous},
+    };
+    return table;
+  }
+
+  std::map<table_key, primary_table> rows;
+  std::map<table_key, index_table> indexes;
+
+  // the apply being run
+  contract *current = nullptr;
+  const action *current_action = nullptr;
+  uint64_t current_receiver = 0;
+  std::vector<uint64_t> *notify = nullptr;
+  std::vector<action> *sent = nullptr;
+  std::vector<std::pair<table_key, uint64_t>> row_iterators;
+  std::map<std::pair<table_key, uint64_t>, int32_t> row_iterator_of;
+  std::vector<std::pair<table_key, uint64_t>> index_iterators;
+  std::map<std::pair<table_key, uint64_t>, int32_t> index_iterator_of;
+  std::vector<table_key> end_iterators;
+};
+
+// ---------------------------------------------------------------------------
+// the script
+
+// a list of names from actor[,actor...]
+static std::vector<std::pair<uint64_t, uint64_t>>
+authorization(const std::string &actors) {
+  std::vector<std::pair<uint64_t, uint64_t>> levels;
+  std::stringstream list(actors);
+  std::string actor;
+  while (std::getline(list, actor, ',')) {
+    levels.emplace_back(name_value(actor), name_value("active"));
+  }
+  return levels;
+}
+
+static std::string function_name(const wasm::module &m, uint32_t index) {
+  const wasm::function &f = m.functions[index];
+  return f.name.empty() ? "func[" + std::to_string(index) + "]" : f.name;
+}
+
+int main(int argc, char *argv[]) {
+  size_t top = 20;
+  chain c;
+  bool quiet = false;
+  const char *report_file = nullptr;
+  int arg = 1;
+
+  for (; arg < argc && argv[arg][0] == '-' && argv[arg][1] != '\0'; arg++) {
+    std::string option = argv[arg];
+
+    if (option == "--console") {
+      c.console = true;
+      continue;
+    }
+    if (option == "--quiet") {
+      quiet = true;
+      continue;
+    }
+    if (arg + 1 >= argc) {
+      usage(argv[0]);
+      return 1;
+    }
+    const char *value = argv[++arg];
+
+    if (option == "--top") {
+      top = std::strtoul(value, nullptr, 10);
+    } else if (option == "--limit") {
+      c.limit = std::strtoull(value, nullptr, 10);
+    } else if (option == "--report") {
+      report_file = value;
+    } else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  if (arg + 1 != argc) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  std::ifstream script(argv[arg]);
+  if (!script) {
+    std::perror(argv[arg]);
+    return 1;
+  }
+
+  FILE *report = nullptr;
+  if (report_file != nullptr && (report = std::fopen(report_file, "w")) ==
+                                    nullptr) {
+    std::perror(report_file);
+    return 1;
+  }
+
+  uint64_t transactions = 0, failed = 0, total_instructions = 0;
+  std::map<std::string, int> occurrences;
+  std::string label;
+  std::string line;
+  for (int number = 1; std::getline(script, line); number++) {
+    std::vector<std::string> words = split(line);
+    if (words.empty()) {
+      continue;
+    }
+    std::string error;
+    auto fail = [&](const std::string &why) {
+      std::fprintf(stderr, "%s:%d: %s\n", argv[arg], number, why.c_str());
+      return 1;
+    };
+
+    if (words[0] == "code") {
+      if (words.size() != 3) {
+        return fail("usage: code <account> <wasm file>");
+      }
+      std::ifstream file(words[2], std::ios::binary);
+      if (!file) {
+        return fail(words[2] + ": " + std::strerror(errno));
+      }
+      std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)),
+                                 std::istreambuf_iterator<char>());
+      if (!c.deploy(name_value(words[1]), std::move(bytes), error)) {
+        return fail(words[2] + ": " + error);
+      }
+      continue;
+    }
+
+    if (words[0] == "time") {
+      int64_t seconds;
+      if (words.size() != 2 || !parse_time(words[1], seconds)) {
+        return fail("usage: time <seconds or YYYY-MM-DDTHH:MM:SS>");
+      }
+      c.now_us = uint64_t(seconds) * 1000000;
+      continue;
+    }
+
+    if (words[0] == "label") {
+      if (words.size() != 2) {
+        return fail("usage: label <label>");
+      }
+      label = words[1];
+      continue;
+    }
+
+    if (words[0] == "row") {
+      std::vector<uint8_t> primary, value;
+      if (words.size() < 6 || !pack_fields({words[4]}, 0, primary, error) ||
+          primary.size() != 8 || !pack_fields(words, 5, value, error)) {
+        return fail(error.empty()
+                        ? "usage: row <code> <scope> <table> <primary> ..."
+                        : error);
+      }
+      uint64_t key;
+      std::memcpy(&key, primary.data(), 8);
+      c.store_row({name_value(words[1]), name_value(words[2]),
+                   name_value(words[3])},
+                  key, std::move(value));
+      continue;
+    }
+
+    // an action
+    action a;
+    if (words.size() < 3) {
+      return fail("usage: <contract> <action> <actor> <field> ...");
+    }
+    size_t slash = words[0].find('/');
+    uint64_t receiver = name_value(words[0].substr(0, slash));
+    a.account = slash == std::string::npos
+                    ? receiver
+                    : name_value(words[0].substr(slash + 1));
+    a.name = name_value(words[1]);
+    a.authorization = authorization(words[2]);
+    if (!pack_fields(words, 3, a.data, error)) {
+      return fail(error);
+    }
+
+    std::string outcome = "ok";
+    c.printed.clear();
+    transactions++;
+    try {
+      c.push(a, receiver);
+    } catch (const action_failed &e) {
+      outcome = e.what();
+      failed++;
+    }
+
+    uint64_t instructions = 0;
+    for (const apply_record &r : c.records) {
+      instructions += r.instructions;
+    }
+    total_instructions += instructions;
+
+    if (label.empty()) {
+      label = name_string(a.account) + "::" + words[1];
+      int n = ++occurrences[label];
+      if (n > 1) {
+        label += "#" + std::to_string(n);
+      }
+    }
+    if (report != nullptr) {
+      std::fprintf(report, "%s %llu %llu %llu %llu %s\n", label.c_str(),
+                   (unsigned long long)instructions,
+                   (unsigned long long)c.counts.db_reads,
+                   (unsigned long long)c.counts.db_writes,
+                   (unsigned long long)c.counts.heap_bytes,
+                   outcome == "ok" ? "ok" : "failed");
+    }
+    label.clear();
+
+    if (quiet) {
+      continue;
+    }
+    std::printf("%d: %s %s: %llu instructions, %llu db reads, %llu db "
+                "writes, %llu inline, %llu notified, %llu softfloat, %llu "
+                "bytes copied, %llu heap bytes - %s\n",
+                number, words[0].c_str(), words[1].c_str(),
+                (unsigned long long)instructions,
+                (unsigned long long)c.counts.db_reads,
+                (unsigned long long)c.counts.db_writes,
+                (unsigned long long)c.counts.inline_actions,
+                (unsigned long long)c.counts.notifications,
+                (unsigned long long)c.counts.softfloat,
+                (unsigned long long)c.counts.memory_bytes,
+                (unsigned long long)c.counts.heap_bytes, outcome.c_str());
+    for (const apply_record &r : c.records) {
+      std::string target = name_string(r.account) + "::" + name_string(r.name);
+      if (r.receiver != r.account) {
+        target += " -> " + name_string(r.receiver);
+      }
+      if (r.code) {
+        std::printf("  %-40s %llu\n", target.c_str(),
+                    (unsigned long long)r.instructions);
+      } else {
+        std::printf("  %-40s (no code)\n", target.c_str());
+      }
+    }
+    if (c.console && !c.printed.empty()) {
+      std::printf("  console: %s\n", c.printed.c_str());
+    }
+  }
+
+  if (report != nullptr && std::fclose(report) != 0) {
+    std::perror(report_file);
+    return 1;
+  }
+
+  std::printf("\n%llu transactions, %llu failed, %llu instructions\n",
+              (unsigned long long)transactions, (unsigned long long)failed,
+              (unsigned long long)total_instructions);
+
+  for (const auto &deployed : c.contracts) {
+    const wasm::module &m = deployed.second->code;
+    const wasm::instance &vm = *deployed.second->vm;
+    if (vm.instructions == 0) {
+      continue;
+    }
+
+    std::vector<uint32_t> functions;
+    for (uint32_t i = m.imports; i < m.functions.size(); i++) {
+      if (vm.calls[i] != 0) {
+        functions.push_back(i);
+      }
+    }
+    std::sort(functions.begin(), functions.end(), [&](uint32_t a, uint32_t b) {
+      return vm.self_instructions[a] > vm.self_instructions[b];
+    });
+    if (functions.size() > top) {
+      functions.resize(top);
+    }
+
+    std::printf("\n%s: %llu instructions - hotspots (self instructions, "
+                "calls)\n",
+                name_string(deployed.first).c_str(),
+                (unsigned long long)vm.instructions);
+    for (uint32_t i : functions) {
+      std::printf("  %-40s %12llu %5.1f%% %10llu\n",
+                  function_name(m, i).c_str(),
+                  (unsigned long long)vm.self_instructions[i],
+                  100.0 * vm.self_instructions[i] / vm.instructions,
+                  (unsigned long long)vm.calls[i]);
+    }
+  }
+
+  if (!c.intrinsic_calls.empty()) {
+    std::printf("\nintrinsics (calls, bytes)\n");
+    for (const auto &i : c.intrinsic_calls) {
+      std::printf("  %-40s %12llu %12llu\n", i.first.c_str(),
+                  (unsigned long long)i.second.first,
+                  (unsigned long long)i.second.second);
+    }
+  }
+
+  return 0;
+}
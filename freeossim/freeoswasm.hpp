@@ -0,0 +1,1199 @@
+#pragma once
+
+// A WebAssembly interpreter for running the contracts' .wasm files natively,
+// as freeoswasm does.
+//
+// It loads a module and runs the MVP instruction set the CDT emits, counting
+// every instruction executed, in total and by function. Imported functions -
+// the eosio intrinsics - are called through a host. There is no validation
+// beyond what executing the code needs, as the modules are the CDT's own
+// output; traps (out of bounds memory, division by zero, unreachable, ...)
+// are thrown as wasm::trap, as are the host's errors.
+//
+// Instruction counts are what nodeos' CPU billing follows most closely
+// without a node: an eos-vm or wabt instruction is a few nanoseconds, and
+// the counts take in everything the native build of the contract hides -
+// the softfloat calls behind long double arithmetic, memcpy and memset,
+// serialization and the CDT's allocator.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace freedao {
+namespace wasm {
+
+struct trap : std::runtime_error {
+  using std::runtime_error::runtime_error;
+};
+
+constexpr uint8_t I32 = 0x7f;
+constexpr uint8_t I64 = 0x7e;
+constexpr uint8_t F32 = 0x7d;
+constexpr uint8_t F64 = 0x7c;
+
+constexpr uint32_t PAGE_SIZE = 65536;
+constexpr uint32_t MAX_PAGES = 528;       // nodeos' 33 MiB of linear memory
+constexpr uint32_t MAX_CALL_DEPTH = 250;  // eos-vm's
+constexpr uint32_t NO_FUNCTION = UINT32_MAX;
+
+struct function_type {
+  std::vector<uint8_t> params;
+  std::vector<uint8_t> results;
+
+  bool operator==(const function_type &other) const {
+    return params == other.params && results == other.results;
+  }
+};
+
+struct function {
+  uint32_t type = 0;
+  bool imported = false;
+  std::string module; // of an import
+  std::string name;   // import, export or name section name, if any
+  uint32_t body = 0;  // offset of the first instruction in the module
+  uint32_t end = 0;   // offset of the final end
+  uint32_t locals = 0;
+
+  // for each block, loop, if and else, by offset from body: the offset of
+  // its end, and for an if its else (0 if none)
+  std::vector<uint32_t> end_of;
+  std::vector<uint32_t> else_of;
+};
+
+struct global {
+  uint8_t type;
+  bool mutable_;
+  uint64_t init;
+};
+
+struct data_segment {
+  uint32_t address;
+  uint32_t offset; // in the module
+  uint32_t size;
+};
+
+// the bytes of a module reader, throwing trap if they run out
+class reader {
+public:
+  reader(const std::vector<uint8_t> &bytes, size_t pos, size_t end)
+      : bytes(bytes), pos(pos), end(end) {}
+
+  uint8_t byte() {
+    if (pos >= end) {
+      throw trap("module is truncated");
+    }
+    return bytes[pos++];
+  }
+
+  uint32_t u32() {
+    uint32_t result = 0;
+    for (int shift = 0;; shift += 7) {
+      uint8_t b = byte();
+      if (shift < 32) {
+        result |= uint32_t(b & 0x7f) << shift;
+      }
+      if (!(b & 0x80)) {
+        return result;
+      }
+    }
+  }
+
+  int64_t s64() {
+    int64_t result = 0;
+    int shift = 0;
+    uint8_t b;
+    do {
+      b = byte();
+      if (shift < 64) {
+        result |= int64_t(b & 0x7f) << shift;
+      }
+      shift += 7;
+    } while (b & 0x80);
+    if (shift < 64 && (b & 0x40)) {
+      result |= -(int64_t(1) << shift);
+    }
+    return result;
+  }
+
+  std::string string() {
+    uint32_t length = u32();
+    if (end - pos < length) {
+      throw trap("module is truncated");
+    }
+    std::string s(bytes.begin() + pos, bytes.begin() + pos + length);
+    pos += length;
+    return s;
+  }
+
+  // a constant expression - only the constants, as there are no imported
+  // globals
+  uint64_t constant() {
+    uint64_t value;
+    switch (byte()) {
+    case 0x41:
+      value = uint32_t(s64());
+      break;
+    case 0x42:
+      value = s64();
+      break;
+    case 0x43:
+      value = 0;
+      skip(4);
+      std::memcpy(&value, &bytes[pos - 4], 4);
+      break;
+    case 0x44:
+      skip(8);
+      std::memcpy(&value, &bytes[pos - 8], 8);
+      break;
+    default:
+      throw trap("unsupported constant expression");
+    }
+    if (byte() != 0x0b) {
+      throw trap("unsupported constant expression");
+    }
+    return value;
+  }
+
+  void skip(size_t n) {
+    if (end - pos < n) {
+      throw trap("module is truncated");
+    }
+    pos += n;
+  }
+
+  const std::vector<uint8_t> &bytes;
+  size_t pos;
+  size_t end;
+};
+
+class module {
+public:
+  // parse a module. Returns false, with the reason in error, if it is not
+  // one this interpreter runs.
+  bool load(std::vector<uint8_t> contents, std::string &error) {
+    bytes = std::move(contents);
+    try {
+      parse();
+    } catch (const trap &e) {
+      error = e.what();
+      return false;
+    }
+    return true;
+  }
+
+  // the index of an exported function, or NO_FUNCTION
+  uint32_t exported(const std::string &name) const {
+    for (const auto &e : exports) {
+      if (e.first == name) {
+        return e.second;
+      }
+    }
+    return NO_FUNCTION;
+  }
+
+  std::vector<uint8_t> bytes;
+  std::vector<function_type> types;
+  std::vector<function> functions; // the imports first
+  uint32_t imports = 0;
+  std::vector<uint32_t> table;
+  uint32_t memory_pages = 0;
+  uint32_t max_pages = MAX_PAGES;
+  std::vector<global> globals;
+  std::vector<data_segment> data;
+  std::vector<std::pair<std::string, uint32_t>> exports;
+
+private:
+  void parse() {
+    static const uint8_t header[8] = {0, 'a', 's', 'm', 1, 0, 0, 0};
+    if (bytes.size() < 8 || std::memcmp(bytes.data(), header, 8) != 0) {
+      throw trap("not a wasm module");
+    }
+
+    reader in(bytes, 8, bytes.size());
+    uint32_t defined = 0;
+    while (in.pos < bytes.size()) {
+      uint8_t id = in.byte();
+      uint32_t size = in.u32();
+      if (bytes.size() - in.pos < size) {
+        throw trap("module is truncated");
+      }
+      reader section(bytes, in.pos, in.pos + size);
+      in.pos += size;
+
+      switch (id) {
+      case 0:
+        if (section.string() == "name") {
+          parse_names(section);
+        }
+        break;
+      case 1: // types
+        for (uint32_t n = section.u32(); n > 0; n--) {
+          function_type t;
+          section.byte();
+          t.params.resize(section.u32());
+          for (auto &p : t.params) {
+            p = section.byte();
+          }
+          t.results.resize(section.u32());
+          for (auto &r : t.results) {
+            r = section.byte();
+          }
+          types.push_back(t);
+        }
+        break;
+      case 2: // imports - functions only
+        for (uint32_t n = section.u32(); n > 0; n--) {
+          function f;
+          f.module = section.string();
+          f.name = section.string();
+          if (section.byte() != 0) {
+            throw trap("unsupported import of " + f.name);
+          }
+          f.type = section.u32();
+          f.imported = true;
+          functions.push_back(f);
+          imports++;
+        }
+        break;
+      case 3: // functions
+        for (uint32_t n = section.u32(); n > 0; n--) {
+          function f;
+          f.type = section.u32();
+          functions.push_back(f);
+        }
+        break;
+      case 4: { // table
+        section.u32();
+        section.byte();
+        uint8_t flags = section.byte();
+        table.assign(section.u32(), NO_FUNCTION);
+        if (flags & 1) {
+          section.u32();
+        }
+        break;
+      }
+      case 5: { // memory
+        section.u32();
+        uint8_t flags = section.byte();
+        memory_pages = section.u32();
+        if (flags & 1) {
+          max_pages = std::min(section.u32(), MAX_PAGES);
+        }
+        break;
+      }
+      case 6: // globals
+        for (uint32_t n = section.u32(); n > 0; n--) {
+          global g;
+          g.type = section.byte();
+          g.mutable_ = section.byte();
+          g.init = section.constant();
+          globals.push_back(g);
+        }
+        break;
+      case 7: // exports
+        for (uint32_t n = section.u32(); n > 0; n--) {
+          std::string name = section.string();
+          uint8_t kind = section.byte();
+          uint32_t index = section.u32();
+          if (kind == 0) {
+            exports.emplace_back(name, index);
+          }
+        }
+        break;
+      case 9: // elements
+        for (uint32_t n = section.u32(); n > 0; n--) {
+          section.u32();
+          uint64_t offset = section.constant();
+          for (uint32_t count = section.u32(), i = 0; i < count; i++) {
+            if (offset + i >= table.size()) {
+              throw trap("element segment out of bounds");
+            }
+            table[offset + i] = section.u32();
+          }
+        }
+        break;
+      case 10: // code
+        for (uint32_t n = section.u32(); n > 0; n--, defined++) {
+          if (imports + defined >= functions.size()) {
+            throw trap("more bodies than functions");
+          }
+          function &f = functions[imports + defined];
+          uint32_t size = section.u32();
+          reader body(bytes, section.pos, section.pos + size);
+          section.pos += size;
+          for (uint32_t groups = body.u32(); groups > 0; groups--) {
+            f.locals += body.u32();
+            body.byte();
+          }
+          f.body = body.pos;
+          f.end = body.end - 1;
+          match_blocks(f);
+        }
+        break;
+      case 11: // data
+        for (uint32_t n = section.u32(); n > 0; n--) {
+          section.u32();
+          data_segment d;
+          d.address = section.constant();
+          d.size = section.u32();
+          d.offset = section.pos;
+          section.skip(d.size);
+          data.push_back(d);
+        }
+        break;
+      }
+    }
+
+    for (const auto &e : exports) {
+      if (e.second < functions.size() && functions[e.second].name.empty()) {
+        functions[e.second].name = e.first;
+      }
+    }
+  }
+
+  void parse_names(reader &section) {
+    while (section.pos < section.end) {
+      uint8_t id = section.byte();
+      uint32_t size = section.u32();
+      size_t next = section.pos + size;
+      if (id == 1) {
+        for (uint32_t n = section.u32(); n > 0; n--) {
+          uint32_t index = section.u32();
+          std::string name = section.string();
+          if (index < functions.size()) {
+            functions[index].name = name;
+          }
+        }
+      }
+      section.pos = next;
+    }
+  }
+
+  // find the end (and else) of every block in a function body
+  void match_blocks(function &f) {
+    f.end_of.assign(f.end - f.body + 1, 0);
+    f.else_of.assign(f.end - f.body + 1, 0);
+
+    std::vector<uint32_t> open;
+    reader code(bytes, f.body, f.end + 1);
+    while (code.pos <= f.end) {
+      uint32_t at = code.pos - f.body;
+      uint8_t op = code.byte();
+      switch (op) {
+      case 0x02:
+      case 0x03:
+      case 0x04:
+        code.byte();
+        open.push_back(at);
+        break;
+      case 0x05:
+        if (open.empty()) {
+          throw trap("else outside a block");
+        }
+        f.else_of[open.back()] = at;
+        break;
+      case 0x0b:
+        if (!open.empty()) {
+          uint32_t begin = open.back();
+          open.pop_back();
+          f.end_of[begin] = at;
+          if (f.else_of[begin] != 0) {
+            f.end_of[f.else_of[begin]] = at;
+          }
+        }
+        break;
+      case 0x0c:
+      case 0x0d:
+      case 0x10:
+      case 0x20:
+      case 0x21:
+      case 0x22:
+      case 0x23:
+      case 0x24:
+        code.u32();
+        break;
+      case 0x0e:
+        for (uint32_t n = code.u32() + 1; n > 0; n--) {
+          code.u32();
+        }
+        break;
+      case 0x11:
+        code.u32();
+        code.u32();
+        break;
+      case 0x3f:
+      case 0x40:
+        code.byte();
+        break;
+      case 0x41:
+      case 0x42:
+        code.s64();
+        break;
+      case 0x43:
+        code.skip(4);
+        break;
+      case 0x44:
+        code.skip(8);
+        break;
+      default:
+        if (op >= 0x28 && op <= 0x3e) {
+          code.u32();
+          code.u32();
+        } else if (op > 0xc4 || (op > 0x11 && op < 0x1a) ||
+                   (op > 0x1b && op < 0x20) || (op > 0x24 && op < 0x28)) {
+          throw trap("unsupported instruction 0x" + hex(op));
+        }
+      }
+    }
+    if (!open.empty()) {
+      throw trap("unterminated block");
+    }
+  }
+
+  static std::string hex(uint8_t b) {
+    static const char digits[] = "0123456789abcdef";
+    return std::string{digits[b >> 4], digits[b & 15]};
+  }
+};
+
+class instance;
+
+// provides a module's imports
+class host {
+public:
+  virtual ~host() = default;
+  // call import number index with its arguments, returning its result (if
+  // any)
+  virtual uint64_t call(instance &vm, uint32_t index,
+                        const uint64_t *args) = 0;
+};
+
+class instance {
+public:
+  instance(const module &m, host &h)
+      : m(m), self_instructions(m.functions.size()),
+        calls(m.functions.size()), h(h), stack(1 << 20), labels(1 << 16) {
+    reset();
+  }
+
+  // the initial memory and globals, for a new action
+  void reset() {
+    memory.assign(size_t(m.memory_pages) * PAGE_SIZE, 0);
+    for (const auto &d : m.data) {
+      if (uint64_t(d.address) + d.size > memory.size()) {
+        throw trap("data segment out of bounds");
+      }
+      std::memcpy(&memory[d.address], &m.bytes[d.offset], d.size);
+    }
+    globals.clear();
+    for (const auto &g : m.globals) {
+      globals.push_back(g.init);
+    }
+    sp = 0;
+    label_count = 0;
+    depth = 0;
+  }
+
+  // call a function with its arguments, returning its result (if any)
+  uint64_t call(uint32_t index, const uint64_t *args) {
+    const function_type &type = m.types[m.functions[index].type];
+    sp = 0;
+    label_count = 0;
+    depth = 0;
+    for (size_t i = 0; i < type.params.size(); i++) {
+      stack[sp++] = args[i];
+    }
+    invoke(index);
+    return type.results.empty() ? 0 : stack[sp - 1];
+  }
+
+  // the size of the linear memory, which memory.grow adds to
+  size_t memory_size() const { return memory.size(); }
+
+  // memory for the host, bounds checked
+  uint8_t *at(uint64_t address, uint64_t length) {
+    if (address + length > memory.size()) {
+      throw trap("memory access out of bounds");
+    }
+    return memory.data() + address;
+  }
+
+  const module &m;
+  uint64_t instructions = 0;
+  uint64_t limit = UINT64_MAX;
+  std::vector<uint64_t> self_instructions; // by function
+  std::vector<uint64_t> calls;             // by function
+
+private:
+  struct label {
+    uint32_t continuation;
+    uint32_t height;
+    uint8_t arity;
+    bool loop;
+  };
+
+  void invoke(uint32_t index) {
+    const function &f = m.functions[index];
+    const function_type &type = m.types[f.type];
+    calls[index]++;
+
+    if (f.imported) {
+      size_t params = type.params.size();
+      uint64_t result = h.call(*this, index, &stack[sp - params]);
+      sp -= params;
+      if (!type.results.empty()) {
+        bool narrow = type.results[0] == I32 || type.results[0] == F32;
+        stack[sp++] = narrow ? uint32_t(result) : result;
+      }
+      return;
+    }
+
+    if (++depth > MAX_CALL_DEPTH) {
+      throw trap("call depth exceeded");
+    }
+    if (sp + f.locals + 4096 > stack.size() || label_count + 1 >= labels.size()) {
+      throw trap("stack overflow");
+    }
+    execute(index, f, type);
+    depth--;
+  }
+
+  static float f32_of(uint64_t v) {
+    uint32_t bits = v;
+    float f;
+    std::memcpy(&f, &bits, 4);
+    return f;
+  }
+  static double f64_of(uint64_t v) {
+    double d;
+    std::memcpy(&d, &v, 8);
+    return d;
+  }
+  static uint64_t bits(float f) {
+    uint32_t b;
+    std::memcpy(&b, &f, 4);
+    return b;
+  }
+  static uint64_t bits(double d) {
+    uint64_t b;
+    std::memcpy(&b, &d, 8);
+    return b;
+  }
+
+  template <typename T> static T min(T a, T b) {
+    if (std::isnan(a) || std::isnan(b)) {
+      return std::numeric_limits<T>::quiet_NaN();
+    }
+    if (a == b) {
+      return std::signbit(a) ? a : b;
+    }
+    return a < b ? a : b;
+  }
+  template <typename T> static T max(T a, T b) {
+    if (std::isnan(a) || std::isnan(b)) {
+      return std::numeric_limits<T>::quiet_NaN();
+    }
+    if (a == b) {
+      return std::signbit(a) ? b : a;
+    }
+    return a > b ? a : b;
+  }
+
+  // the truncations trap on NaN and values out of the result's range
+  template <typename T> static T truncate(double x, double low, double high) {
+    if (std::isnan(x)) {
+      throw trap("invalid conversion to integer");
+    }
+    if (!(x > low && x < high)) {
+      throw trap("integer overflow");
+    }
+    return T(x);
+  }
+
+  static uint32_t u32(const uint8_t *code, uint32_t &pc) {
+    uint32_t result = 0;
+    for (int shift = 0;; shift += 7) {
+      uint8_t b = code[pc++];
+      if (shift < 32) {
+        result |= uint32_t(b & 0x7f) << shift;
+      }
+      if (!(b & 0x80)) {
+        return result;
+      }
+    }
+  }
+
+  static int64_t s64(const uint8_t *code, uint32_t &pc) {
+    int64_t result = 0;
+    int shift = 0;
+    uint8_t b;
+    do {
+      b = code[pc++];
+      if (shift < 64) {
+        result |= int64_t(b & 0x7f) << shift;
+      }
+      shift += 7;
+    } while (b & 0x80);
+    if (shift < 64 && (b & 0x40)) {
+      result |= -(int64_t(1) << shift);
+    }
+    return result;
+  }
+
+  uint8_t *address(const uint8_t *code, uint32_t &pc, uint32_t size) {
+    u32(code, pc); // alignment
+    uint64_t offset = u32(code, pc);
+    uint64_t ea = uint32_t(stack[--sp]) + offset;
+    if (ea + size > memory.size()) {
+      throw trap("memory access out of bounds");
+    }
+    return memory.data() + ea;
+  }
+
+  template <typename T> T load(const uint8_t *code, uint32_t &pc) {
+    T value;
+    std::memcpy(&value, address(code, pc, sizeof(T)), sizeof(T));
+    return value;
+  }
+
+  template <typename T> void store(const uint8_t *code, uint32_t &pc) {
+    T value = T(stack[--sp]);
+    std::memcpy(address(code, pc, sizeof(T)), &value, sizeof(T));
+  }
+
+  void execute(uint32_t index, const function &f, const function_type &type) {
+    const uint8_t *code = m.bytes.data();
+    uint64_t *self = &self_instructions[index];
+    const uint32_t base = sp - type.params.size();
+    for (uint32_t i = 0; i < f.locals; i++) {
+      stack[sp++] = 0;
+    }
+    const uint32_t label_base = label_count;
+    labels[label_count++] = {f.end, sp, uint8_t(type.results.size()), false};
+
+    // branch to the nth enclosing label. Returns true if that returns from
+    // the function.
+    auto branch = [&](uint32_t n, uint32_t &pc) {
+      const label &l = labels[label_count - 1 - n];
+      if (l.loop) {
+        sp = l.height;
+        label_count -= n;
+      } else {
+        if (l.arity != 0) {
+          stack[l.height] = stack[sp - 1];
+        }
+        sp = l.height + l.arity;
+        label_count -= n + 1;
+      }
+      pc = l.continuation;
+      return label_count == label_base;
+    };
+
+#define POP() stack[--sp]
+#define TOP() stack[sp - 1]
+#define PUSH(v) stack[sp++] = (v)
+#define PUSH32(v) stack[sp++] = uint32_t(v)
+#define UNARY(T, from, to, expr)                                               \
+  {                                                                            \
+    T a = from(TOP());                                                         \
+    TOP() = to(expr);                                                          \
+  }                                                                            \
+  break
+#define BINARY(T, from, to, expr)                                              \
+  {                                                                            \
+    T b = from(POP());                                                         \
+    T a = from(TOP());                                                         \
+    TOP() = to(expr);                                                          \
+  }                                                                            \
+  break
+#define AS_U32(v) uint32_t(v)
+#define AS_S32(v) int32_t(uint32_t(v))
+#define AS_U64(v) uint64_t(v)
+#define AS_S64(v) int64_t(v)
+#define TO_32(v) uint64_t(uint32_t(v))
+#define TO_64(v) uint64_t(v)
+
+    uint32_t pc = f.body;
+    for (;;) {
+      if (++instructions > limit) {
+        throw trap("instruction limit exceeded");
+      }
+      ++*self;
+      const uint32_t at = pc - f.body;
+      const uint8_t op = code[pc++];
+
+      switch (op) {
+      case 0x00:
+        throw trap("unreachable executed");
+      case 0x01:
+        break;
+      case 0x02: { // block
+        uint8_t arity = code[pc++] != 0x40;
+        labels[label_count++] = {f.body + f.end_of[at] + 1, sp, arity, false};
+        break;
+      }
+      case 0x03: // loop
+        pc++;
+        labels[label_count++] = {pc, sp, 0, true};
+        break;
+      case 0x04: { // if
+        uint8_t arity = code[pc++] != 0x40;
+        uint32_t condition = POP();
+        label l = {f.body + f.end_of[at] + 1, sp, arity, false};
+        if (condition != 0) {
+          labels[label_count++] = l;
+        } else if (f.else_of[at] != 0) {
+          pc = f.body + f.else_of[at] + 1;
+          labels[label_count++] = l;
+        } else {
+          pc = l.continuation;
+        }
+        break;
+      }
+      case 0x05: // else, at the end of the taken branch
+        pc = f.body + f.end_of[at] + 1;
+        label_count--;
+        break;
+      case 0x0b: // end
+        if (--label_count == label_base) {
+          goto done;
+        }
+        break;
+      case 0x0c:
+        if (branch(u32(code, pc), pc)) {
+          goto done;
+        }
+        break;
+      case 0x0d: {
+        uint32_t target = u32(code, pc);
+        if (uint32_t(POP()) != 0 && branch(target, pc)) {
+          goto done;
+        }
+        break;
+      }
+      case 0x0e: {
+        uint32_t count = u32(code, pc);
+        uint32_t i = POP();
+        uint32_t target = 0;
+        for (uint32_t n = 0; n <= count; n++) {
+          uint32_t entry = u32(code, pc);
+          if (n == std::min(i, count)) {
+            target = entry;
+          }
+        }
+        if (branch(target, pc)) {
+          goto done;
+        }
+        break;
+      }
+      case 0x0f:
+        branch(label_count - 1 - label_base, pc);
+        goto done;
+      case 0x10:
+        invoke(u32(code, pc));
+        break;
+      case 0x11: {
+        uint32_t expected = u32(code, pc);
+        u32(code, pc);
+        uint32_t i = POP();
+        if (i >= m.table.size() || m.table[i] == NO_FUNCTION) {
+          throw trap("undefined table element");
+        }
+        if (!(m.types[m.functions[m.table[i]].type] == m.types[expected])) {
+          throw trap("indirect call signature mismatch");
+        }
+        invoke(m.table[i]);
+        break;
+      }
+      case 0x1a:
+        sp--;
+        break;
+      case 0x1b: {
+        uint32_t condition = POP();
+        uint64_t b = POP();
+        if (condition == 0) {
+          TOP() = b;
+        }
+        break;
+      }
+      case 0x20:
+        PUSH(stack[base + u32(code, pc)]);
+        break;
+      case 0x21:
+        stack[base + u32(code, pc)] = POP();
+        break;
+      case 0x22:
+        stack[base + u32(code, pc)] = TOP();
+        break;
+      case 0x23:
+        PUSH(globals[u32(code, pc)]);
+        break;
+      case 0x24:
+        globals[u32(code, pc)] = POP();
+        break;
+
+      case 0x28:
+        PUSH32(load<uint32_t>(code, pc));
+        break;
+      case 0x29:
+        PUSH(load<uint64_t>(code, pc));
+        break;
+      case 0x2a:
+        PUSH32(load<uint32_t>(code, pc));
+        break;
+      case 0x2b:
+        PUSH(load<uint64_t>(code, pc));
+        break;
+      case 0x2c:
+        PUSH32(int32_t(load<int8_t>(code, pc)));
+        break;
+      case 0x2d:
+        PUSH32(load<uint8_t>(code, pc));
+        break;
+      case 0x2e:
+        PUSH32(int32_t(load<int16_t>(code, pc)));
+        break;
+      case 0x2f:
+        PUSH32(load<uint16_t>(code, pc));
+        break;
+      case 0x30:
+        PUSH(uint64_t(int64_t(load<int8_t>(code, pc))));
+        break;
+      case 0x31:
+        PUSH(load<uint8_t>(code, pc));
+        break;
+      case 0x32:
+        PUSH(uint64_t(int64_t(load<int16_t>(code, pc))));
+        break;
+      case 0x33:
+        PUSH(load<uint16_t>(code, pc));
+        break;
+      case 0x34:
+        PUSH(uint64_t(int64_t(load<int32_t>(code, pc))));
+        break;
+      case 0x35:
+        PUSH(load<uint32_t>(code, pc));
+        break;
+      case 0x36:
+      case 0x38:
+        store<uint32_t>(code, pc);
+        break;
+      case 0x37:
+      case 0x39:
+        store<uint64_t>(code, pc);
+        break;
+      case 0x3a:
+      case 0x3c:
+        store<uint8_t>(code, pc);
+        break;
+      case 0x3b:
+      case 0x3d:
+        store<uint16_t>(code, pc);
+        break;
+      case 0x3e:
+        store<uint32_t>(code, pc);
+        break;
+      case 0x3f:
+        pc++;
+        PUSH32(memory.size() / PAGE_SIZE);
+        break;
+      case 0x40: {
+        pc++;
+        uint32_t pages = memory.size() / PAGE_SIZE;
+        uint32_t more = POP();
+        if (uint64_t(pages) + more > m.max_pages) {
+          PUSH32(-1);
+        } else {
+          memory.resize(size_t(pages + more) * PAGE_SIZE, 0);
+          PUSH32(pages);
+        }
+        break;
+      }
+      case 0x41:
+        PUSH32(s64(code, pc));
+        break;
+      case 0x42:
+        PUSH(uint64_t(s64(code, pc)));
+        break;
+      case 0x43: {
+        uint32_t v;
+        std::memcpy(&v, code + pc, 4);
+        pc += 4;
+        PUSH32(v);
+        break;
+      }
+      case 0x44: {
+        uint64_t v;
+        std::memcpy(&v, code + pc, 8);
+        pc += 8;
+        PUSH(v);
+        break;
+      }
+
+      case 0x45: UNARY(uint32_t, AS_U32, TO_32, a == 0);
+      case 0x46: BINARY(uint32_t, AS_U32, TO_32, a == b);
+      case 0x47: BINARY(uint32_t, AS_U32, TO_32, a != b);
+      case 0x48: BINARY(int32_t, AS_S32, TO_32, a < b);
+      case 0x49: BINARY(uint32_t, AS_U32, TO_32, a < b);
+      case 0x4a: BINARY(int32_t, AS_S32, TO_32, a > b);
+      case 0x4b: BINARY(uint32_t, AS_U32, TO_32, a > b);
+      case 0x4c: BINARY(int32_t, AS_S32, TO_32, a <= b);
+      case 0x4d: BINARY(uint32_t, AS_U32, TO_32, a <= b);
+      case 0x4e: BINARY(int32_t, AS_S32, TO_32, a >= b);
+      case 0x4f: BINARY(uint32_t, AS_U32, TO_32, a >= b);
+      case 0x50: UNARY(uint64_t, AS_U64, TO_64, a == 0);
+      case 0x51: BINARY(uint64_t, AS_U64, TO_64, a == b);
+      case 0x52: BINARY(uint64_t, AS_U64, TO_64, a != b);
+      case 0x53: BINARY(int64_t, AS_S64, TO_64, a < b);
+      case 0x54: BINARY(uint64_t, AS_U64, TO_64, a < b);
+      case 0x55: BINARY(int64_t, AS_S64, TO_64, a > b);
+      case 0x56: BINARY(uint64_t, AS_U64, TO_64, a > b);
+      case 0x57: BINARY(int64_t, AS_S64, TO_64, a <= b);
+      case 0x58: BINARY(uint64_t, AS_U64, TO_64, a <= b);
+      case 0x59: BINARY(int64_t, AS_S64, TO_64, a >= b);
+      case 0x5a: BINARY(uint64_t, AS_U64, TO_64, a >= b);
+      case 0x5b: BINARY(float, f32_of, TO_64, a == b);
+      case 0x5c: BINARY(float, f32_of, TO_64, a != b);
+      case 0x5d: BINARY(float, f32_of, TO_64, a < b);
+      case 0x5e: BINARY(float, f32_of, TO_64, a > b);
+      case 0x5f: BINARY(float, f32_of, TO_64, a <= b);
+      case 0x60: BINARY(float, f32_of, TO_64, a >= b);
+      case 0x61: BINARY(double, f64_of, TO_64, a == b);
+      case 0x62: BINARY(double, f64_of, TO_64, a != b);
+      case 0x63: BINARY(double, f64_of, TO_64, a < b);
+      case 0x64: BINARY(double, f64_of, TO_64, a > b);
+      case 0x65: BINARY(double, f64_of, TO_64, a <= b);
+      case 0x66: BINARY(double, f64_of, TO_64, a >= b);
+
+      case 0x67: UNARY(uint32_t, AS_U32, TO_32, a == 0 ? 32 : __builtin_clz(a));
+      case 0x68: UNARY(uint32_t, AS_U32, TO_32, a == 0 ? 32 : __builtin_ctz(a));
+      case 0x69: UNARY(uint32_t, AS_U32, TO_32, __builtin_popcount(a));
+      case 0x6a: BINARY(uint32_t, AS_U32, TO_32, a + b);
+      case 0x6b: BINARY(uint32_t, AS_U32, TO_32, a - b);
+      case 0x6c: BINARY(uint32_t, AS_U32, TO_32, a * b);
+      case 0x6d: {
+        int32_t b = AS_S32(POP());
+        int32_t a = AS_S32(TOP());
+        if (b == 0) {
+          throw trap("integer divide by zero");
+        }
+        if (a == INT32_MIN && b == -1) {
+          throw trap("integer overflow");
+        }
+        TOP() = TO_32(a / b);
+        break;
+      }
+      case 0x6e: {
+        uint32_t b = AS_U32(POP());
+        if (b == 0) {
+          throw trap("integer divide by zero");
+        }
+        TOP() = TO_32(AS_U32(TOP()) / b);
+        break;
+      }
+      case 0x6f: {
+        int32_t b = AS_S32(POP());
+        int32_t a = AS_S32(TOP());
+        if (b == 0) {
+          throw trap("integer divide by zero");
+        }
+        TOP() = TO_32(b == -1 ? 0 : a % b);
+        break;
+      }
+      case 0x70: {
+        uint32_t b = AS_U32(POP());
+        if (b == 0) {
+          throw trap("integer divide by zero");
+        }
+        TOP() = TO_32(AS_U32(TOP()) % b);
+        break;
+      }
+      case 0x71: BINARY(uint32_t, AS_U32, TO_32, a & b);
+      case 0x72: BINARY(uint32_t, AS_U32, TO_32, a | b);
+      case 0x73: BINARY(uint32_t, AS_U32, TO_32, a ^ b);
+      case 0x74: BINARY(uint32_t, AS_U32, TO_32, a << (b & 31));
+      case 0x75: BINARY(int32_t, AS_S32, TO_32, a >> (b & 31));
+      case 0x76: BINARY(uint32_t, AS_U32, TO_32, a >> (b & 31));
+      case 0x77: BINARY(uint32_t, AS_U32, TO_32,
+                        (a << (b & 31)) | (a >> ((32 - (b & 31)) & 31)));
+      case 0x78: BINARY(uint32_t, AS_U32, TO_32,
+                        (a >> (b & 31)) | (a << ((32 - (b & 31)) & 31)));
+
+      case 0x79: UNARY(uint64_t, AS_U64, TO_64, a == 0 ? 64 : __builtin_clzll(a));
+      case 0x7a: UNARY(uint64_t, AS_U64, TO_64, a == 0 ? 64 : __builtin_ctzll(a));
+      case 0x7b: UNARY(uint64_t, AS_U64, TO_64, __builtin_popcountll(a));
+      case 0x7c: BINARY(uint64_t, AS_U64, TO_64, a + b);
+      case 0x7d: BINARY(uint64_t, AS_U64, TO_64, a - b);
+      case 0x7e: BINARY(uint64_t, AS_U64, TO_64, a * b);
+      case 0x7f: {
+        int64_t b = AS_S64(POP());
+        int64_t a = AS_S64(TOP());
+        if (b == 0) {
+          throw trap("integer divide by zero");
+        }
+        if (a == INT64_MIN && b == -1) {
+          throw trap("integer overflow");
+        }
+        TOP() = TO_64(a / b);
+        break;
+      }
+      case 0x80: {
+        uint64_t b = POP();
+        if (b == 0) {
+          throw trap("integer divide by zero");
+        }
+        TOP() = TOP() / b;
+        break;
+      }
+      case 0x81: {
+        int64_t b = AS_S64(POP());
+        int64_t a = AS_S64(TOP());
+        if (b == 0) {
+          throw trap("integer divide by zero");
+        }
+        TOP() = TO_64(b == -1 ? 0 : a % b);
+        break;
+      }
+      case 0x82: {
+        uint64_t b = POP();
+        if (b == 0) {
+          throw trap("integer divide by zero");
+        }
+        TOP() = TOP() % b;
+        break;
+      }
+      case 0x83: BINARY(uint64_t, AS_U64, TO_64, a & b);
+      case 0x84: BINARY(uint64_t, AS_U64, TO_64, a | b);
+      case 0x85: BINARY(uint64_t, AS_U64, TO_64, a ^ b);
+      case 0x86: BINARY(uint64_t, AS_U64, TO_64, a << (b & 63));
+      case 0x87: BINARY(int64_t, AS_S64, TO_64, a >> (b & 63));
+      case 0x88: BINARY(uint64_t, AS_U64, TO_64, a >> (b & 63));
+      case 0x89: BINARY(uint64_t, AS_U64, TO_64,
+                        (a << (b & 63)) | (a >> ((64 - (b & 63)) & 63)));
+      case 0x8a: BINARY(uint64_t, AS_U64, TO_64,
+                        (a >> (b & 63)) | (a << ((64 - (b & 63)) & 63)));
+
+      case 0x8b: UNARY(float, f32_of, bits, std::fabs(a));
+      case 0x8c: UNARY(float, f32_of, bits, -a);
+      case 0x8d: UNARY(float, f32_of, bits, std::ceil(a));
+      case 0x8e: UNARY(float, f32_of, bits, std::floor(a));
+      case 0x8f: UNARY(float, f32_of, bits, std::trunc(a));
+      case 0x90: UNARY(float, f32_of, bits, std::nearbyint(a));
+      case 0x91: UNARY(float, f32_of, bits, std::sqrt(a));
+      case 0x92: BINARY(float, f32_of, bits, a + b);
+      case 0x93: BINARY(float, f32_of, bits, a - b);
+      case 0x94: BINARY(float, f32_of, bits, a * b);
+      case 0x95: BINARY(float, f32_of, bits, a / b);
+      case 0x96: BINARY(float, f32_of, bits, min(a, b));
+      case 0x97: BINARY(float, f32_of, bits, max(a, b));
+      case 0x98: BINARY(float, f32_of, bits, std::copysign(a, b));
+      case 0x99: UNARY(double, f64_of, bits, std::fabs(a));
+      case 0x9a: UNARY(double, f64_of, bits, -a);
+      case 0x9b: UNARY(double, f64_of, bits, std::ceil(a));
+      case 0x9c: UNARY(double, f64_of, bits, std::floor(a));
+      case 0x9d: UNARY(double, f64_of, bits, std::trunc(a));
+      case 0x9e: UNARY(double, f64_of, bits, std::nearbyint(a));
+      case 0x9f: UNARY(double, f64_of, bits, std::sqrt(a));
+      case 0xa0: BINARY(double, f64_of, bits, a + b);
+      case 0xa1: BINARY(double, f64_of, bits, a - b);
+      case 0xa2: BINARY(double, f64_of, bits, a * b);
+      case 0xa3: BINARY(double, f64_of, bits, a / b);
+      case 0xa4: BINARY(double, f64_of, bits, min(a, b));
+      case 0xa5: BINARY(double, f64_of, bits, max(a, b));
+      case 0xa6: BINARY(double, f64_of, bits, std::copysign(a, b));
+
+      case 0xa7: UNARY(uint64_t, AS_U64, TO_32, a);
+      case 0xa8:
+        UNARY(float, f32_of, TO_32,
+              truncate<int32_t>(a, -2147483649.0, 2147483648.0));
+      case 0xa9:
+        UNARY(float, f32_of, TO_32, truncate<uint32_t>(a, -1.0, 4294967296.0));
+      case 0xaa:
+        UNARY(double, f64_of, TO_32,
+              truncate<int32_t>(a, -2147483649.0, 2147483648.0));
+      case 0xab:
+        UNARY(double, f64_of, TO_32, truncate<uint32_t>(a, -1.0, 4294967296.0));
+      case 0xac: UNARY(int32_t, AS_S32, TO_64, int64_t(a));
+      case 0xad: UNARY(uint32_t, AS_U32, TO_64, a);
+      case 0xae:
+        UNARY(float, f32_of, TO_64,
+              truncate<int64_t>(a, -9223372036854777856.0,
+                                9223372036854775808.0));
+      case 0xaf:
+        UNARY(float, f32_of, TO_64,
+              truncate<uint64_t>(a, -1.0, 18446744073709551616.0));
+      case 0xb0:
+        UNARY(double, f64_of, TO_64,
+              truncate<int64_t>(a, -9223372036854777856.0,
+                                9223372036854775808.0));
+      case 0xb1:
+        UNARY(double, f64_of, TO_64,
+              truncate<uint64_t>(a, -1.0, 18446744073709551616.0));
+      case 0xb2: UNARY(int32_t, AS_S32, bits, float(a));
+      case 0xb3: UNARY(uint32_t, AS_U32, bits, float(a));
+      case 0xb4: UNARY(int64_t, AS_S64, bits, float(a));
+      case 0xb5: UNARY(uint64_t, AS_U64, bits, float(a));
+      case 0xb6: UNARY(double, f64_of, bits, float(a));
+      case 0xb7: UNARY(int32_t, AS_S32, bits, double(a));
+      case 0xb8: UNARY(uint32_t, AS_U32, bits, double(a));
+      case 0xb9: UNARY(int64_t, AS_S64, bits, double(a));
+      case 0xba: UNARY(uint64_t, AS_U64, bits, double(a));
+      case 0xbb: UNARY(float, f32_of, bits, double(a));
+      case 0xbc: // the reinterpretations are the bits already on the stack
+      case 0xbd:
+      case 0xbe:
+      case 0xbf:
+        break;
+
+      // sign extension
+      case 0xc0: UNARY(uint32_t, AS_U32, TO_32, int32_t(int8_t(a)));
+      case 0xc1: UNARY(uint32_t, AS_U32, TO_32, int32_t(int16_t(a)));
+      case 0xc2: UNARY(uint64_t, AS_U64, TO_64, int64_t(int8_t(a)));
+      case 0xc3: UNARY(uint64_t, AS_U64, TO_64, int64_t(int16_t(a)));
+      case 0xc4: UNARY(uint64_t, AS_U64, TO_64, int64_t(int32_t(a)));
+
+      default:
+        throw trap("unsupported instruction");
+      }
+    }
+
+#undef POP
+#undef TOP
+#undef PUSH
+#undef PUSH32
+#undef UNARY
+#undef BINARY
+#undef AS_U32
+#undef AS_S32
+#undef AS_U64
+#undef AS_S64
+#undef TO_32
+#undef TO_64
+
+  done:
+    uint64_t result = type.results.empty() ? 0 : stack[sp - 1];
+    sp = base;
+    if (!type.results.empty()) {
+      stack[sp++] = result;
+    }
+    label_count = label_base;
+  }
+
+  host &h;
+  std::vector<uint8_t> memory;
+  std::vector<uint64_t> globals;
+  std::vector<uint64_t> stack;
+  std::vector<label> labels;
+  uint32_t sp = 0;
+  uint32_t label_count = 0;
+  uint32_t depth = 0;
+};
+
+} // namespace wasm
+} // namespace freedao
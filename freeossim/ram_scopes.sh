@@ -0,0 +1,25 @@
+# List the freeos table scopes with their row counts, for freeosram.
+#
+# usage: ./ram_scopes.sh <endpoint> <freeos account> >scopes.txt
+#
+# Pages through get_table_by_scope (cleos get scope), which returns the row
+# count of every table in every scope without reading the rows themselves.
+#
+# Needs cleos and jq.
+
+ENDPOINT=$1
+FREEOS=$2
+
+if [ -z "$ENDPOINT" ] || [ -z "$FREEOS" ]; then
+  echo "usage: $0 <endpoint> <freeos account>"
+  exit 1
+fi
+
+LOWER=""
+while :; do
+  PAGE=$(cleos -u $ENDPOINT get scope $FREEOS -l 1000 ${LOWER:+-L "$LOWER"})
+  echo "$PAGE" | jq -r '.rows[] | "\(.table) \(.scope) \(.count) \(.payer)"'
+
+  LOWER=$(echo "$PAGE" | jq -r '.more // ""')
+  [ -z "$LOWER" ] && break
+done
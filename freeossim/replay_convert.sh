@@ -0,0 +1,94 @@
+# Convert exported history into the actions file of freeosreplay.
+#
+# usage: ./replay_convert.sh <freeos account> <freeosconfig account> <actions json>... >actions.txt
+#
+# The actions json files are Hyperion /v2/history/get_actions responses (any
+# number of pages, in any order - actions are put in global sequence order):
+# those of the freeos and freeosconfig accounts, with the stakes - the token
+# transfers to the freeos account with the memo "freeos stake" - and those of
+# the verification contract (eosio.proton) for the users' accounts, which set
+# their account types. Only the actions a transaction was sent with are
+# written, not the inline actions the contracts sent.
+#
+# A freeos or freeosconfig action's arguments are written as the type:value
+# fields of freeosreplay (see freeosscript.hpp), in the order and with the
+# types of the contract's ABI in ../freeos or ../freeosconfig. An action that
+# is not in the ABI stops the conversion.
+#
+# Needs jq.
+
+FREEOS=$1
+FREEOSCONFIG=$2
+
+if [ -z "$FREEOS" ] || [ -z "$FREEOSCONFIG" ] || [ $# -lt 3 ]; then
+  echo "usage: $0 <freeos account> <freeosconfig account> <actions json>..."
+  exit 1
+fi
+shift 2
+
+DIR=$(dirname "$0")
+
+jq -r -s --arg freeos $FREEOS --arg freeosconfig $FREEOSCONFIG \
+  --slurpfile freeos_abi "$DIR/../freeos/freeos.abi" \
+  --slurpfile freeosconfig_abi "$DIR/../freeosconfig/freeosconfig.abi" '
+  # seconds since the epoch from a chain timestamp, e.g. 2021-06-01T12:00:00.500
+  def epoch: sub("\\.[0-9]+$"; "") + "Z" | fromdateiso8601;
+  def quoted: tostring | gsub("[\"\n]"; " ") | "\"\(.)\"";
+  def structs($abi): $abi.structs | map({key: .name, value: .fields}) | from_entries;
+
+  # the fields of a value of an ABI type
+  def fields($structs; $type):
+    if $type | endswith("$") then
+      if . == null then empty else fields($structs; $type[:-1]) end
+    elif $type | endswith("[]") then
+      "vector:\(length)", (.[] | fields($structs; $type[:-2]))
+    elif $structs[$type] != null then
+      . as $value | $structs[$type][] | . as $field |
+      $value[$field.name] | fields($structs; $field.type)
+    else
+      ({"name": "name", "string": "string", "asset": "asset", "bool": "bool",
+        "uint8": "u8", "int8": "i8", "uint16": "u16", "int16": "i16",
+        "uint32": "u32", "int32": "i32", "uint64": "u64", "int64": "i64",
+        "float64": "f64", "symbol": "symbol", "time_point": "time_point",
+        "time_point_sec": "time_point_sec"}[$type]
+        // error("unsupported ABI type " + $type)) as $t |
+      "\($t):" + (if $t == "string" or $t == "asset" then quoted else tostring end)
+    end;
+
+  # the fields of an action of a contract
+  def arguments($abi; $contract):
+    .act.name as $action |
+    (($abi.actions[] | select(.name == $action) | .type)
+      // error("unknown action \($contract)::\($action)")) as $type |
+    .act.data | fields(structs($abi); $type);
+
+  # the fields of a verification contract action on a user record
+  def usersinfo:
+    .act.data as $data |
+    if .act.name == "addkyc" or .act.name == "updatekyc" then
+      "name:\($data.acc)", "name:\($data.kyc.kyc_provider)",
+      "string:" + ($data.kyc.kyc_level | quoted)
+    elif .act.name == "removekyc" then
+      "name:\($data.acc)", "name:\($data.kyc_provider)"
+    else
+      "name:\($data.acc)"
+    end;
+
+  def line(fields):
+    [(.["@timestamp"] | epoch), .act.account, .act.name,
+     ([.act.authorization[].actor] | join(",")), (.cpu_usage_us // "-"),
+     fields] | map(tostring) | join(" ");
+
+  [.[].actions[]] | unique_by(.global_sequence) | .[] |
+  select((.creator_action_ordinal // 0) == 0) |
+  if .act.account == $freeos then
+    line(arguments($freeos_abi[0]; $freeos))
+  elif .act.account == $freeosconfig then
+    line(arguments($freeosconfig_abi[0]; $freeosconfig))
+  elif .act.name == "transfer" and .act.data.to == $freeos and
+       .act.data.memo == "freeos stake" then
+    line("name:\(.act.data.from)", "name:\(.act.data.to)",
+         "asset:" + (.act.data.quantity | quoted), "string:\"freeos stake\"")
+  elif .act.account == "eosio.proton" and .act.data.acc != null then
+    line(usersinfo)
+  else empty end' "$@"
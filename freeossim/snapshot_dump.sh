@@ -0,0 +1,83 @@
+# Dump the freeos and freeosconfig tables for freeosexport.
+#
+# usage: ./snapshot_dump.sh <endpoint> <freeos account> <freeosconfig account> >dump.txt
+#        ./freeosexport dump.txt <output dir>
+#
+# Writes a layout line per table, from the deployed ABI, then the table's
+# rows as hex (get_table_rows with --binary, so the API node does not convert
+# the rows to JSON). The user-scoped tables are read scope by scope, with the
+# scopes from get_table_by_scope.
+#
+# This is a stopgap. It makes a get_table_rows request per user and user
+# table - four per registered user - so a full dump loads the API node with
+# as many requests as the JSON paging did. Point it at a node of your own
+# rather than a public endpoint. The replacement is to write the same row lines from a
+# bulk source of the contract rows, such as a nodeos state snapshot or a
+# state-history node; freeosexport reads the dump the same way whatever
+# wrote it.
+#
+# Needs cleos and jq.
+
+ENDPOINT=$1
+FREEOS=$2
+FREEOSCONFIG=$3
+
+if [ -z "$ENDPOINT" ] || [ -z "$FREEOS" ] || [ -z "$FREEOSCONFIG" ]; then
+  echo "usage: $0 <endpoint> <freeos account> <freeosconfig account>"
+  exit 1
+fi
+
+# usage: layout <contract> <table>
+layout() {
+  cleos -u $ENDPOINT get abi $1 | jq -r --arg table $2 '. as $abi |
+    (.tables[] | select(.name == $table) | .type) as $type |
+    $abi.structs[] | select(.name == $type) |
+    "layout \($table) " + ([.fields[] | "\(.name):\(.type)"] | join(" "))'
+}
+
+# usage: rows <contract> <scope> <table>
+rows() {
+  LOWER=""
+  while :; do
+    PAGE=$(cleos -u $ENDPOINT get table -b $1 $2 $3 -l 1000 ${LOWER:+-L "$LOWER"})
+    echo "$PAGE" | jq -r --arg table $3 --arg scope $2 '.rows[] | "row \($table) \($scope) \(.)"'
+
+    [ "$(echo "$PAGE" | jq -r '.more')" = "true" ] || break
+    LOWER=$(echo "$PAGE" | jq -r '.next_key')
+  done
+}
+
+# usage: scopes <contract> <table>
+scopes() {
+  LOWER=""
+  while :; do
+    PAGE=$(cleos -u $ENDPOINT get scope $1 -t $2 -l 1000 ${LOWER:+-L "$LOWER"})
+    echo "$PAGE" | jq -r '.rows[].scope'
+
+    LOWER=$(echo "$PAGE" | jq -r '.more // ""')
+    [ -z "$LOWER" ] && break
+  done
+}
+
+for TABLE in users accounts vestaccounts unvests; do
+  layout $FREEOS $TABLE
+  scopes $FREEOS $TABLE | while read SCOPE; do
+    rows $FREEOS $SCOPE $TABLE
+  done
+done
+
+# stat is scoped on the symbol code
+layout $FREEOS stat
+scopes $FREEOS stat | while read SCOPE; do
+  rows $FREEOS $SCOPE stat
+done
+
+for TABLE in unstakereqs deposits; do
+  layout $FREEOS $TABLE
+  rows $FREEOS $FREEOS $TABLE
+done
+
+for TABLE in iterations parameters; do
+  layout $FREEOSCONFIG $TABLE
+  rows $FREEOSCONFIG $FREEOSCONFIG $TABLE
+done
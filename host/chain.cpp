@@ -0,0 +1,1495 @@
+// The host chain - see freeoshost.hpp.
+
+#include "freeoshost.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <malloc.h>
+#include <new>
+#include <set>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+namespace freedao {
+namespace host {
+
+namespace {
+
+// nodeos's billable sizes
+constexpr int64_t row_overhead_bytes = 108;   // key_value_object
+constexpr int64_t index64_entry_bytes = 128;  // index64_object
+constexpr int64_t table_overhead_bytes = 108; // table_id_object
+
+constexpr uint32_t max_inline_action_depth = 4;
+constexpr size_t max_action_return_value_size = 256;
+
+// Tables are kept in (code, table, scope) order, so that the scopes of a
+// table are adjacent.
+struct table_key {
+  uint64_t code;
+  uint64_t table;
+  uint64_t scope;
+
+  friend bool operator<(const table_key &a, const table_key &b) {
+    return std::tie(a.code, a.table, a.scope) <
+           std::tie(b.code, b.table, b.scope);
+  }
+  friend bool operator==(const table_key &a, const table_key &b) {
+    return a.code == b.code && a.table == b.table && a.scope == b.scope;
+  }
+};
+
+struct row {
+  uint64_t payer;
+  std::vector<char> data;
+};
+
+struct primary_table {
+  uint64_t payer; // billed for the table
+  std::map<uint64_t, row> rows;
+};
+
+struct index_entry {
+  uint64_t secondary;
+  uint64_t payer;
+};
+
+struct index_table {
+  uint64_t payer;
+  std::set<std::pair<uint64_t, uint64_t>> by_secondary; // secondary, primary
+  std::map<uint64_t, index_entry> by_primary;
+};
+
+// a change to undo
+struct undo_entry {
+  enum kind_type : uint8_t {
+    primary_row,    // a row changed - restore old (none: remove the row)
+    index_row,      // an index entry changed - restore old_entry
+    table_created,  // remove the table
+    table_removed,  // recreate the table, for payer
+    index_created,  // remove the index table
+    index_removed,  // recreate the index table, for payer
+    ram             // un-bill delta to account
+  };
+
+  kind_type kind;
+  table_key key;
+  uint64_t primary_key = 0;
+  std::optional<row> old_row;
+  std::optional<index_entry> old_entry;
+  uint64_t payer = 0;
+  uint64_t account = 0;
+  int64_t delta = 0;
+};
+
+// Snapshots (chain::snapshot) are the snapshot magic and version, then the
+// accounts, the clock, the tables, the index tables and the RAM billed, each
+// map as its size and then its entries in key order, in host byte order.
+constexpr char snapshot_magic[8] = {'F', 'R', 'E', 'E', 'C', 'H', 'N', 'S'};
+constexpr uint32_t snapshot_version = 1;
+
+class snapshot_writer {
+public:
+  explicit snapshot_writer(std::vector<char> &out) : out(out) {}
+
+  template <typename T> void value(const T &v) {
+    static_assert(std::is_trivially_copyable<T>::value, "");
+    const char *p = reinterpret_cast<const char *>(&v);
+    out.insert(out.end(), p, p + sizeof(T));
+  }
+  void bytes(const std::vector<char> &data) {
+    value(uint64_t(data.size()));
+    out.insert(out.end(), data.begin(), data.end());
+  }
+
+private:
+  std::vector<char> &out;
+};
+
+class snapshot_reader {
+public:
+  snapshot_reader(const char *data, size_t size)
+      : next(data), end(data + size) {}
+
+  template <typename T> T value() {
+    static_assert(std::is_trivially_copyable<T>::value, "");
+    eosio::check(size_t(end - next) >= sizeof(T), "snapshot is truncated");
+    T v;
+    std::memcpy(&v, next, sizeof(T));
+    next += sizeof(T);
+    return v;
+  }
+  std::vector<char> bytes() {
+    uint64_t size = value<uint64_t>();
+    eosio::check(uint64_t(end - next) >= size, "snapshot is truncated");
+    std::vector<char> data(next, next + size);
+    next += size;
+    return data;
+  }
+  bool done() const { return next == end; }
+
+private:
+  const char *next;
+  const char *end;
+};
+
+// the contract code running on this thread, if any
+struct apply_context;
+thread_local apply_context *current_context = nullptr;
+
+// where the contract's heap allocations on this thread are counted
+thread_local heap_category heap_category_now = heap_category::none;
+thread_local counters *heap_counters = nullptr;
+thread_local uint64_t heap_live = 0;
+
+// the host chain's own allocations are not counted
+class untracked_heap {
+public:
+  untracked_heap() : previous(heap_category_now) {
+    heap_category_now = heap_category::none;
+  }
+  ~untracked_heap() { heap_category_now = previous; }
+
+private:
+  heap_category previous;
+};
+
+void count_allocation(void *p) {
+  if (heap_category_now != heap_category::none && heap_counters && p) {
+    size_t size = malloc_usable_size(p);
+    heap_counters->heap_allocs[size_t(heap_category_now)]++;
+    heap_counters->heap_bytes += size;
+    heap_live += size;
+    heap_counters->heap_peak = std::max(heap_counters->heap_peak, heap_live);
+  }
+}
+
+void count_free(void *p) {
+  if (heap_category_now != heap_category::none && heap_counters && p) {
+    size_t size = malloc_usable_size(p);
+    heap_live = heap_live > size ? heap_live - size : 0;
+  }
+}
+
+[[noreturn]] void fail(const std::string &message) {
+  throw eosio::check_failure(message);
+}
+
+} // namespace
+
+heap_category &current_heap_category() { return heap_category_now; }
+
+counters &counters::operator+=(const counters &other) {
+  finds += other.finds;
+  lower_bounds += other.lower_bounds;
+  nexts += other.nexts;
+  gets += other.gets;
+  stores += other.stores;
+  updates += other.updates;
+  removes += other.removes;
+  idx_finds += other.idx_finds;
+  idx_lower_bounds += other.idx_lower_bounds;
+  idx_nexts += other.idx_nexts;
+  idx_stores += other.idx_stores;
+  idx_updates += other.idx_updates;
+  idx_removes += other.idx_removes;
+  bytes_unpacked += other.bytes_unpacked;
+  bytes_packed += other.bytes_packed;
+  for (size_t i = 0; i < 4; i++) {
+    heap_allocs[i] += other.heap_allocs[i];
+  }
+  heap_bytes += other.heap_bytes;
+  heap_peak = std::max(heap_peak, other.heap_peak);
+  inline_actions += other.inline_actions;
+  notifications += other.notifications;
+  ram_bytes += other.ram_bytes;
+  wall_ns += other.wall_ns;
+  return *this;
+}
+
+counters transaction_trace::total() const {
+  counters sum;
+  for (const auto &trace : actions) {
+    sum += trace.cost;
+  }
+  return sum;
+}
+
+struct chain::impl {
+  std::set<uint64_t> accounts;
+  std::map<uint64_t, apply_function> contracts;
+  int64_t now = 0; // microseconds
+
+  std::map<table_key, primary_table> tables;
+  std::map<table_key, index_table> indices;
+  std::map<uint64_t, int64_t> ram;
+
+  std::vector<undo_entry> journal;
+  std::vector<size_t> sessions; // journal positions
+
+  void journal_row(const table_key &key, uint64_t pk,
+                   std::optional<row> old) {
+    if (!sessions.empty()) {
+      undo_entry e{undo_entry::primary_row, key};
+      e.primary_key = pk;
+      e.old_row = std::move(old);
+      journal.push_back(std::move(e));
+    }
+  }
+
+  void journal_entry(const table_key &key, uint64_t pk,
+                     std::optional<index_entry> old) {
+    if (!sessions.empty()) {
+      undo_entry e{undo_entry::index_row, key};
+      e.primary_key = pk;
+      e.old_entry = old;
+      journal.push_back(std::move(e));
+    }
+  }
+
+  void journal_table(undo_entry::kind_type kind, const table_key &key,
+                     uint64_t payer) {
+    if (!sessions.empty()) {
+      undo_entry e{kind, key};
+      e.payer = payer;
+      journal.push_back(std::move(e));
+    }
+  }
+
+  void bill(uint64_t account, int64_t delta) {
+    if (delta == 0) {
+      return;
+    }
+    ram[account] += delta;
+    if (!sessions.empty()) {
+      undo_entry e{undo_entry::ram, {}};
+      e.account = account;
+      e.delta = delta;
+      journal.push_back(std::move(e));
+    }
+  }
+
+  void undo(const undo_entry &e) {
+    switch (e.kind) {
+    case undo_entry::primary_row: {
+      auto &rows = tables[e.key].rows;
+      if (e.old_row) {
+        rows[e.primary_key] = *e.old_row;
+      } else {
+        rows.erase(e.primary_key);
+      }
+      break;
+    }
+    case undo_entry::index_row: {
+      auto &index = indices[e.key];
+      auto existing = index.by_primary.find(e.primary_key);
+      if (existing != index.by_primary.end()) {
+        index.by_secondary.erase({existing->second.secondary, e.primary_key});
+        index.by_primary.erase(existing);
+      }
+      if (e.old_entry) {
+        index.by_primary[e.primary_key] = *e.old_entry;
+        index.by_secondary.insert({e.old_entry->secondary, e.primary_key});
+      }
+      break;
+    }
+    case undo_entry::table_created:
+      tables.erase(e.key);
+      break;
+    case undo_entry::table_removed:
+      tables[e.key].payer = e.payer;
+      break;
+    case undo_entry::index_created:
+      indices.erase(e.key);
+      break;
+    case undo_entry::index_removed:
+      indices[e.key].payer = e.payer;
+      break;
+    case undo_entry::ram:
+      ram[e.account] -= e.delta;
+      break;
+    }
+  }
+
+  void begin_session() { sessions.push_back(journal.size()); }
+
+  void rollback_session() {
+    untracked_heap untracked;
+    size_t start = sessions.back();
+    sessions.pop_back();
+    while (journal.size() > start) {
+      undo(journal.back());
+      journal.pop_back();
+    }
+  }
+
+  void commit_session() {
+    sessions.pop_back();
+    if (sessions.empty()) {
+      journal.clear();
+    }
+  }
+
+  void execute(const eosio::action &act, uint32_t depth, bool read_only,
+               transaction_trace &trace, uint64_t first_receiver = 0);
+};
+
+namespace {
+
+// one receiver's execution of an action - nodeos's apply_context
+struct apply_context {
+  chain::impl *state;
+  uint64_t receiver;
+  const eosio::action *act; // nullptr for run_as
+  bool notification;
+  bool read_only;
+  const std::vector<char> *action_data;
+  std::vector<uint64_t> *notified;
+  std::vector<eosio::action> *inline_actions;
+  action_trace *trace;
+
+  // the iterator cache - an iterator is an index into iterators, an end
+  // iterator -(table's index in cached_tables + 2)
+  struct cached_table {
+    table_key key;
+    bool index;
+  };
+  std::vector<cached_table> cached_tables;
+  std::map<std::pair<bool, table_key>, int32_t> table_positions;
+  std::vector<std::pair<int32_t, uint64_t>> iterators; // table, primary key
+  std::map<std::pair<int32_t, uint64_t>, int32_t> iterator_positions;
+
+  counters &cost() { return trace->cost; }
+
+  int32_t cache_table(const table_key &key, bool index) {
+    auto [itr, inserted] = table_positions.emplace(
+        std::make_pair(index, key), int32_t(cached_tables.size()));
+    if (inserted) {
+      cached_tables.push_back({key, index});
+    }
+    return itr->second;
+  }
+
+  int32_t end_iterator(int32_t table) { return -(table + 2); }
+
+  int32_t iterator_of(int32_t table, uint64_t pk) {
+    auto [itr, inserted] = iterator_positions.emplace(
+        std::make_pair(table, pk), int32_t(iterators.size()));
+    if (inserted) {
+      iterators.push_back({table, pk});
+    }
+    return itr->second;
+  }
+
+  int32_t table_of_end(int32_t itr) {
+    int32_t table = -itr - 2;
+    if (itr >= -1 || table >= int32_t(cached_tables.size())) {
+      fail("invalid iterator");
+    }
+    return table;
+  }
+
+  const std::pair<int32_t, uint64_t> &iterator(int32_t itr) {
+    if (itr < 0) {
+      fail("dereference of end iterator");
+    }
+    if (size_t(itr) >= iterators.size()) {
+      fail("dereference of invalid iterator");
+    }
+    return iterators[itr];
+  }
+
+  primary_table *find_table(const table_key &key) {
+    auto itr = state->tables.find(key);
+    return itr == state->tables.end() ? nullptr : &itr->second;
+  }
+
+  index_table *find_index(const table_key &key) {
+    auto itr = state->indices.find(key);
+    return itr == state->indices.end() ? nullptr : &itr->second;
+  }
+
+  void check_write(const char *intrinsic) {
+    if (read_only) {
+      fail(std::string(intrinsic) + " not allowed in a read-only transaction");
+    }
+  }
+
+  bool has_auth(uint64_t account) const {
+    if (!act) {
+      return true;
+    }
+    for (const auto &auth : act->authorization) {
+      if (auth.actor.value == account) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void require_auth(uint64_t account) const {
+    if (!has_auth(account)) {
+      fail("missing authority of " + eosio::name(account).to_string());
+    }
+  }
+
+  // bill RAM as nodeos does - an unprivileged contract can only bill RAM to
+  // an account other than itself if that account authorized the action, and
+  // not at all in a notification
+  void bill(uint64_t payer, int64_t delta) {
+    if (delta > 0 && payer != receiver && act) {
+      if (notification) {
+        fail("cannot charge RAM to other accounts during notify");
+      }
+      require_auth(payer);
+    }
+    state->bill(payer, delta);
+    cost().ram_bytes += delta;
+  }
+
+  primary_table &find_or_create_table(const table_key &key, uint64_t payer) {
+    auto itr = state->tables.find(key);
+    if (itr != state->tables.end()) {
+      return itr->second;
+    }
+    auto &table = state->tables[key];
+    table.payer = payer;
+    state->journal_table(undo_entry::table_created, key, payer);
+    bill(payer, table_overhead_bytes);
+    return table;
+  }
+
+  index_table &find_or_create_index(const table_key &key, uint64_t payer) {
+    auto itr = state->indices.find(key);
+    if (itr != state->indices.end()) {
+      return itr->second;
+    }
+    auto &index = state->indices[key];
+    index.payer = payer;
+    state->journal_table(undo_entry::index_created, key, payer);
+    bill(payer, table_overhead_bytes);
+    return index;
+  }
+
+  void remove_table_if_empty(const table_key &key) {
+    auto itr = state->tables.find(key);
+    if (itr != state->tables.end() && itr->second.rows.empty()) {
+      uint64_t payer = itr->second.payer;
+      state->tables.erase(itr);
+      state->journal_table(undo_entry::table_removed, key, payer);
+      bill(payer, -table_overhead_bytes);
+    }
+  }
+
+  void remove_index_if_empty(const table_key &key) {
+    auto itr = state->indices.find(key);
+    if (itr != state->indices.end() && itr->second.by_primary.empty()) {
+      uint64_t payer = itr->second.payer;
+      state->indices.erase(itr);
+      state->journal_table(undo_entry::index_removed, key, payer);
+      bill(payer, -table_overhead_bytes);
+    }
+  }
+
+  // primary index
+
+  int32_t db_store_i64(uint64_t scope, uint64_t table, uint64_t payer,
+                       uint64_t id, const void *data, uint32_t len) {
+    check_write("db_store_i64");
+    cost().stores++;
+    cost().bytes_packed += len;
+
+    if (payer == 0) {
+      fail("must specify a valid account to pay for new record");
+    }
+    table_key key{receiver, table, scope};
+    auto &t = find_or_create_table(key, payer);
+    if (t.rows.count(id)) {
+      fail("could not insert object, most likely a uniqueness constraint "
+           "was violated");
+    }
+    const char *bytes = static_cast<const char *>(data);
+    t.rows[id] = row{payer, std::vector<char>(bytes, bytes + len)};
+    state->journal_row(key, id, std::nullopt);
+    bill(payer, int64_t(len) + row_overhead_bytes);
+
+    return iterator_of(cache_table(key, false), id);
+  }
+
+  row &row_at(int32_t itr, table_key &key) {
+    auto [table, pk] = iterator(itr);
+    key = cached_tables[table].key;
+    auto *t = find_table(key);
+    auto r = t ? t->rows.find(pk) : decltype(t->rows.end()){};
+    if (!t || r == t->rows.end()) {
+      fail("dereference of deleted object");
+    }
+    return r->second;
+  }
+
+  void db_update_i64(int32_t itr, uint64_t payer, const void *data,
+                     uint32_t len) {
+    check_write("db_update_i64");
+    cost().updates++;
+    cost().bytes_packed += len;
+
+    table_key key;
+    row &r = row_at(itr, key);
+    if (key.code != receiver) {
+      fail("db access violation");
+    }
+    if (payer == 0) {
+      payer = r.payer;
+    }
+    state->journal_row(key, iterators[itr].second, r);
+
+    int64_t old_size = int64_t(r.data.size()) + row_overhead_bytes;
+    int64_t new_size = int64_t(len) + row_overhead_bytes;
+    if (payer != r.payer) {
+      bill(r.payer, -old_size);
+      bill(payer, new_size);
+    } else {
+      bill(payer, new_size - old_size);
+    }
+
+    const char *bytes = static_cast<const char *>(data);
+    r.payer = payer;
+    r.data.assign(bytes, bytes + len);
+  }
+
+  void db_remove_i64(int32_t itr) {
+    check_write("db_remove_i64");
+    cost().removes++;
+
+    table_key key;
+    row &r = row_at(itr, key);
+    if (key.code != receiver) {
+      fail("db access violation");
+    }
+    uint64_t pk = iterators[itr].second;
+    bill(r.payer, -(int64_t(r.data.size()) + row_overhead_bytes));
+    state->journal_row(key, pk, r);
+    state->tables[key].rows.erase(pk);
+    remove_table_if_empty(key);
+  }
+
+  int32_t db_get_i64(int32_t itr, void *data, uint32_t len) {
+    table_key key;
+    const row &r = row_at(itr, key);
+    if (len == 0) {
+      return int32_t(r.data.size());
+    }
+    cost().gets++;
+    size_t copy = std::min<size_t>(len, r.data.size());
+    cost().bytes_unpacked += copy;
+    std::copy_n(r.data.data(), copy, static_cast<char *>(data));
+    return int32_t(r.data.size());
+  }
+
+  int32_t db_next_i64(int32_t itr, uint64_t *primary) {
+    cost().nexts++;
+    if (itr < -1) {
+      return -1; // cannot increment past end
+    }
+    auto [table, pk] = iterator(itr);
+    auto *t = find_table(cached_tables[table].key);
+    if (!t) {
+      return end_iterator(table);
+    }
+    auto next = t->rows.upper_bound(pk);
+    if (next == t->rows.end()) {
+      return end_iterator(table);
+    }
+    *primary = next->first;
+    return iterator_of(table, next->first);
+  }
+
+  int32_t db_previous_i64(int32_t itr, uint64_t *primary) {
+    cost().nexts++;
+    int32_t table;
+    primary_table *t;
+    std::map<uint64_t, row>::iterator position;
+    if (itr < -1) {
+      table = table_of_end(itr);
+      t = find_table(cached_tables[table].key);
+      if (!t) {
+        return -1;
+      }
+      position = t->rows.end();
+    } else {
+      uint64_t pk;
+      std::tie(table, pk) = iterator(itr);
+      t = find_table(cached_tables[table].key);
+      if (!t) {
+        return -1;
+      }
+      position = t->rows.lower_bound(pk);
+    }
+    if (position == t->rows.begin()) {
+      return -1;
+    }
+    --position;
+    *primary = position->first;
+    return iterator_of(table, position->first);
+  }
+
+  int32_t db_find_i64(uint64_t code, uint64_t scope, uint64_t table,
+                      uint64_t id) {
+    cost().finds++;
+    table_key key{code, table, scope};
+    auto *t = find_table(key);
+    if (!t) {
+      return -1;
+    }
+    int32_t position = cache_table(key, false);
+    if (!t->rows.count(id)) {
+      return end_iterator(position);
+    }
+    return iterator_of(position, id);
+  }
+
+  template <typename Bound>
+  int32_t db_bound_i64(uint64_t code, uint64_t scope, uint64_t table,
+                       Bound &&bound) {
+    cost().lower_bounds++;
+    table_key key{code, table, scope};
+    auto *t = find_table(key);
+    if (!t) {
+      return -1;
+    }
+    int32_t position = cache_table(key, false);
+    auto itr = bound(t->rows);
+    if (itr == t->rows.end()) {
+      return end_iterator(position);
+    }
+    return iterator_of(position, itr->first);
+  }
+
+  int32_t db_end_i64(uint64_t code, uint64_t scope, uint64_t table) {
+    cost().lower_bounds++;
+    table_key key{code, table, scope};
+    if (!find_table(key)) {
+      return -1;
+    }
+    return end_iterator(cache_table(key, false));
+  }
+
+  // secondary indices
+
+  index_table &index_at(int32_t itr, table_key &key, uint64_t &pk) {
+    auto [table, primary] = iterator(itr);
+    key = cached_tables[table].key;
+    pk = primary;
+    auto *index = find_index(key);
+    if (!index || !index->by_primary.count(pk)) {
+      fail("dereference of deleted object");
+    }
+    return *index;
+  }
+
+  int32_t db_idx64_store(uint64_t scope, uint64_t table, uint64_t payer,
+                         uint64_t id, const uint64_t *secondary) {
+    check_write("db_idx64_store");
+    cost().idx_stores++;
+
+    if (payer == 0) {
+      fail("must specify a valid account to pay for new record");
+    }
+    table_key key{receiver, table, scope};
+    auto &index = find_or_create_index(key, payer);
+    index.by_primary[id] = index_entry{*secondary, payer};
+    index.by_secondary.insert({*secondary, id});
+    state->journal_entry(key, id, std::nullopt);
+    bill(payer, index64_entry_bytes);
+
+    return iterator_of(cache_table(key, true), id);
+  }
+
+  void db_idx64_update(int32_t itr, uint64_t payer, const uint64_t *secondary) {
+    check_write("db_idx64_update");
+    cost().idx_updates++;
+
+    table_key key;
+    uint64_t pk;
+    auto &index = index_at(itr, key, pk);
+    if (key.code != receiver) {
+      fail("db access violation");
+    }
+    auto &entry = index.by_primary[pk];
+    if (payer == 0) {
+      payer = entry.payer;
+    }
+    state->journal_entry(key, pk, entry);
+    if (payer != entry.payer) {
+      bill(entry.payer, -index64_entry_bytes);
+      bill(payer, index64_entry_bytes);
+    }
+    index.by_secondary.erase({entry.secondary, pk});
+    index.by_secondary.insert({*secondary, pk});
+    entry = index_entry{*secondary, payer};
+  }
+
+  void db_idx64_remove(int32_t itr) {
+    check_write("db_idx64_remove");
+    cost().idx_removes++;
+
+    table_key key;
+    uint64_t pk;
+    auto &index = index_at(itr, key, pk);
+    if (key.code != receiver) {
+      fail("db access violation");
+    }
+    auto entry = index.by_primary[pk];
+    state->journal_entry(key, pk, entry);
+    bill(entry.payer, -index64_entry_bytes);
+    index.by_secondary.erase({entry.secondary, pk});
+    index.by_primary.erase(pk);
+    remove_index_if_empty(key);
+  }
+
+  int32_t db_idx64_next(int32_t itr, uint64_t *primary) {
+    cost().idx_nexts++;
+    if (itr < -1) {
+      return -1; // cannot increment past end
+    }
+    table_key key;
+    uint64_t pk;
+    auto &index = index_at(itr, key, pk);
+    int32_t table = iterators[itr].first;
+    auto position =
+        index.by_secondary.upper_bound({index.by_primary[pk].secondary, pk});
+    if (position == index.by_secondary.end()) {
+      return end_iterator(table);
+    }
+    *primary = position->second;
+    return iterator_of(table, position->second);
+  }
+
+  int32_t db_idx64_previous(int32_t itr, uint64_t *primary) {
+    cost().idx_nexts++;
+    int32_t table;
+    index_table *index;
+    std::set<std::pair<uint64_t, uint64_t>>::iterator position;
+    if (itr < -1) {
+      table = table_of_end(itr);
+      index = find_index(cached_tables[table].key);
+      if (!index) {
+        return -1;
+      }
+      position = index->by_secondary.end();
+    } else {
+      table_key key;
+      uint64_t pk;
+      index = &index_at(itr, key, pk);
+      table = iterators[itr].first;
+      position =
+          index->by_secondary.lower_bound({index->by_primary[pk].secondary, pk});
+    }
+    if (position == index->by_secondary.begin()) {
+      return -1;
+    }
+    --position;
+    *primary = position->second;
+    return iterator_of(table, position->second);
+  }
+
+  int32_t db_idx64_find_primary(uint64_t code, uint64_t scope, uint64_t table,
+                                uint64_t *secondary, uint64_t primary) {
+    cost().idx_finds++;
+    table_key key{code, table, scope};
+    auto *index = find_index(key);
+    if (!index) {
+      return -1;
+    }
+    int32_t position = cache_table(key, true);
+    auto entry = index->by_primary.find(primary);
+    if (entry == index->by_primary.end()) {
+      return end_iterator(position);
+    }
+    *secondary = entry->second.secondary;
+    return iterator_of(position, primary);
+  }
+
+  int32_t db_idx64_find_secondary(uint64_t code, uint64_t scope,
+                                  uint64_t table, const uint64_t *secondary,
+                                  uint64_t *primary) {
+    cost().idx_finds++;
+    table_key key{code, table, scope};
+    auto *index = find_index(key);
+    if (!index) {
+      return -1;
+    }
+    int32_t position = cache_table(key, true);
+    auto entry = index->by_secondary.lower_bound({*secondary, 0});
+    if (entry == index->by_secondary.end() || entry->first != *secondary) {
+      return end_iterator(position);
+    }
+    *primary = entry->second;
+    return iterator_of(position, entry->second);
+  }
+
+  template <typename Bound>
+  int32_t db_idx64_bound(uint64_t code, uint64_t scope, uint64_t table,
+                         uint64_t *secondary, uint64_t *primary,
+                         Bound &&bound) {
+    cost().idx_lower_bounds++;
+    table_key key{code, table, scope};
+    auto *index = find_index(key);
+    if (!index) {
+      return -1;
+    }
+    int32_t position = cache_table(key, true);
+    auto entry = bound(index->by_secondary);
+    if (entry == index->by_secondary.end()) {
+      return end_iterator(position);
+    }
+    *secondary = entry->first;
+    *primary = entry->second;
+    return iterator_of(position, entry->second);
+  }
+
+  int32_t db_idx64_end(uint64_t code, uint64_t scope, uint64_t table) {
+    cost().idx_lower_bounds++;
+    table_key key{code, table, scope};
+    if (!find_index(key)) {
+      return -1;
+    }
+    return end_iterator(cache_table(key, true));
+  }
+};
+
+apply_context &context() {
+  if (!current_context) {
+    fail("contract API called outside of a contract");
+  }
+  return *current_context;
+}
+
+// runs contract code: makes ctx the thread's context and counts the code's
+// heap allocations
+class contract_scope {
+public:
+  explicit contract_scope(apply_context &ctx)
+      : previous_context(current_context),
+        previous_category(heap_category_now), previous_counters(heap_counters),
+        previous_live(heap_live) {
+    current_context = &ctx;
+    heap_category_now = heap_category::contract;
+    heap_counters = &ctx.trace->cost;
+    heap_live = 0;
+  }
+  ~contract_scope() {
+    current_context = previous_context;
+    heap_category_now = previous_category;
+    heap_counters = previous_counters;
+    heap_live = previous_live;
+  }
+
+private:
+  apply_context *previous_context;
+  heap_category previous_category;
+  counters *previous_counters;
+  uint64_t previous_live;
+};
+
+} // namespace
+
+void chain::impl::execute(const eosio::action &act, uint32_t depth,
+                          bool read_only, transaction_trace &trace,
+                          uint64_t first_receiver) {
+  if (!accounts.count(act.account.value)) {
+    fail("action's code account " + act.account.to_string() +
+         " does not exist");
+  }
+
+  std::vector<uint64_t> notified{first_receiver != 0 ? first_receiver
+                                                     : act.account.value};
+  std::vector<eosio::action> inline_actions;
+
+  for (size_t i = 0; i < notified.size(); i++) {
+    trace.actions.push_back(action_trace{eosio::name(notified[i]), act.account,
+                                         act.name, depth});
+    // the trace may be moved as more are added - keep its index
+    size_t trace_index = trace.actions.size() - 1;
+
+    auto contract = contracts.find(notified[i]);
+    if (contract == contracts.end()) {
+      continue;
+    }
+
+    action_trace receiver_trace = trace.actions[trace_index];
+    apply_context ctx{this,
+                      notified[i],
+                      &act,
+                      notified[i] != act.account.value,
+                      read_only,
+                      &act.data,
+                      &notified,
+                      &inline_actions,
+                      &receiver_trace};
+    receiver_trace.cost.bytes_unpacked += act.data.size();
+
+    auto start = std::chrono::steady_clock::now();
+    try {
+      contract_scope scope(ctx);
+      contract->second(notified[i], act.account.value, act.name.value);
+    } catch (...) {
+      trace.actions[trace_index] = std::move(receiver_trace);
+      throw;
+    }
+    receiver_trace.cost.wall_ns = uint64_t(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start)
+            .count());
+    trace.actions[trace_index] = std::move(receiver_trace);
+  }
+
+  if (!inline_actions.empty() && depth >= max_inline_action_depth) {
+    fail("max inline action depth per transaction reached");
+  }
+  for (const auto &inline_action : inline_actions) {
+    execute(inline_action, depth + 1, read_only, trace);
+  }
+}
+
+chain::chain() : my(std::make_unique<impl>()) {}
+chain::~chain() = default;
+
+void chain::create_account(eosio::name account) {
+  my->accounts.insert(account.value);
+}
+
+bool chain::is_account(eosio::name account) const {
+  return my->accounts.count(account.value) > 0;
+}
+
+void chain::set_contract(eosio::name account, apply_function apply) {
+  create_account(account);
+  my->contracts[account.value] = apply;
+}
+
+void chain::set_time(eosio::time_point now) {
+  my->now = now.time_since_epoch().count();
+}
+
+eosio::time_point chain::time() const {
+  return eosio::time_point(eosio::microseconds(my->now));
+}
+
+transaction_trace
+chain::push_transaction(const std::vector<eosio::action> &actions,
+                        bool read_only) {
+  untracked_heap untracked;
+  transaction_trace trace;
+
+  my->begin_session();
+  try {
+    for (const auto &act : actions) {
+      my->execute(act, 0, read_only, trace);
+    }
+    trace.succeeded = true;
+  } catch (const std::exception &e) {
+    trace.error = e.what();
+  }
+
+  if (trace.succeeded) {
+    my->commit_session();
+  } else {
+    my->rollback_session();
+  }
+  return trace;
+}
+
+transaction_trace chain::push_notification(eosio::name receiver,
+                                           const eosio::action &action) {
+  untracked_heap untracked;
+  transaction_trace trace;
+
+  my->begin_session();
+  try {
+    my->execute(action, 0, false, trace, receiver.value);
+    trace.succeeded = true;
+  } catch (const std::exception &e) {
+    trace.error = e.what();
+  }
+
+  if (trace.succeeded) {
+    my->commit_session();
+  } else {
+    my->rollback_session();
+  }
+  return trace;
+}
+
+void chain::run_as(eosio::name receiver, const std::function<void()> &f) {
+  untracked_heap untracked;
+  std::vector<uint64_t> notified{receiver.value};
+  std::vector<eosio::action> inline_actions;
+  action_trace trace{receiver, receiver, eosio::name()};
+  apply_context ctx{my.get(), receiver.value, nullptr, false, false, nullptr,
+                    &notified, &inline_actions, &trace};
+
+  my->begin_session();
+  try {
+    contract_scope scope(ctx);
+    f();
+  } catch (...) {
+    my->rollback_session();
+    throw;
+  }
+  my->commit_session();
+}
+
+std::optional<std::vector<char>> chain::row_data(eosio::name code,
+                                                 uint64_t scope,
+                                                 eosio::name table,
+                                                 uint64_t primary_key) const {
+  auto t = my->tables.find({code.value, table.value, scope});
+  if (t == my->tables.end()) {
+    return std::nullopt;
+  }
+  auto r = t->second.rows.find(primary_key);
+  if (r == t->second.rows.end()) {
+    return std::nullopt;
+  }
+  return r->second.data;
+}
+
+void chain::for_each_row(eosio::name code, eosio::name table,
+                         const row_visitor &visit) const {
+  for (auto t = my->tables.lower_bound({code.value, table.value, 0});
+       t != my->tables.end() && t->first.code == code.value &&
+       t->first.table == table.value;
+       ++t) {
+    for (const auto &[pk, r] : t->second.rows) {
+      visit(t->first.scope, pk, eosio::name(r.payer), r.data);
+    }
+  }
+}
+
+void chain::for_each_row(eosio::name code, eosio::name table, uint64_t scope,
+                         const row_visitor &visit) const {
+  auto t = my->tables.find({code.value, table.value, scope});
+  if (t == my->tables.end()) {
+    return;
+  }
+  for (const auto &[pk, r] : t->second.rows) {
+    visit(scope, pk, eosio::name(r.payer), r.data);
+  }
+}
+
+void chain::for_each_table(
+    const std::function<void(eosio::name, uint64_t, eosio::name, size_t)>
+        &visit) const {
+  for (const auto &[key, t] : my->tables) {
+    visit(eosio::name(key.code), key.scope, eosio::name(key.table),
+          t.rows.size());
+  }
+}
+
+std::vector<uint64_t> chain::scopes(eosio::name code,
+                                    eosio::name table) const {
+  std::vector<uint64_t> result;
+  for (auto t = my->tables.lower_bound({code.value, table.value, 0});
+       t != my->tables.end() && t->first.code == code.value &&
+       t->first.table == table.value;
+       ++t) {
+    result.push_back(t->first.scope);
+  }
+  return result;
+}
+
+size_t chain::row_count(eosio::name code, uint64_t scope,
+                        eosio::name table) const {
+  auto t = my->tables.find({code.value, table.value, scope});
+  return t == my->tables.end() ? 0 : t->second.rows.size();
+}
+
+void chain::set_row_data(eosio::name code, uint64_t scope, eosio::name table,
+                         eosio::name payer, uint64_t primary_key,
+                         const std::vector<char> &data) {
+  untracked_heap untracked;
+  table_key key{code.value, table.value, scope};
+  auto t = my->tables.find(key);
+  if (t == my->tables.end()) {
+    t = my->tables.emplace(key, primary_table{payer.value, {}}).first;
+    my->journal_table(undo_entry::table_created, key, payer.value);
+    my->bill(payer.value, table_overhead_bytes);
+  }
+  auto r = t->second.rows.find(primary_key);
+  if (r == t->second.rows.end()) {
+    my->journal_row(key, primary_key, std::nullopt);
+    my->bill(payer.value, int64_t(data.size()) + row_overhead_bytes);
+    t->second.rows[primary_key] = row{payer.value, data};
+  } else {
+    my->journal_row(key, primary_key, r->second);
+    my->bill(r->second.payer,
+             -(int64_t(r->second.data.size()) + row_overhead_bytes));
+    my->bill(payer.value, int64_t(data.size()) + row_overhead_bytes);
+    r->second = row{payer.value, data};
+  }
+}
+
+int64_t chain::ram_usage(eosio::name account) const {
+  auto itr = my->ram.find(account.value);
+  return itr == my->ram.end() ? 0 : itr->second;
+}
+
+void chain::checkpoint() { my->begin_session(); }
+
+void chain::rollback() {
+  eosio::check(!my->sessions.empty(), "no checkpoint to roll back to");
+  my->rollback_session();
+}
+
+void chain::commit() {
+  eosio::check(!my->sessions.empty(), "no checkpoint to commit");
+  my->commit_session();
+}
+
+size_t chain::session_depth() const { return my->sessions.size(); }
+
+std::vector<char> chain::snapshot() const {
+  eosio::check(my->sessions.empty(), "a snapshot needs every session closed");
+  untracked_heap untracked;
+  std::vector<char> out;
+  snapshot_writer w(out);
+
+  for (char c : snapshot_magic) {
+    w.value(c);
+  }
+  w.value(snapshot_version);
+
+  w.value(uint64_t(my->accounts.size()));
+  for (uint64_t account : my->accounts) {
+    w.value(account);
+  }
+  w.value(my->now);
+
+  w.value(uint64_t(my->tables.size()));
+  for (const auto &[key, t] : my->tables) {
+    w.value(key);
+    w.value(t.payer);
+    w.value(uint64_t(t.rows.size()));
+    for (const auto &[pk, r] : t.rows) {
+      w.value(pk);
+      w.value(r.payer);
+      w.bytes(r.data);
+    }
+  }
+
+  w.value(uint64_t(my->indices.size()));
+  for (const auto &[key, index] : my->indices) {
+    w.value(key);
+    w.value(index.payer);
+    w.value(uint64_t(index.by_primary.size()));
+    for (const auto &[pk, entry] : index.by_primary) {
+      w.value(pk);
+      w.value(entry);
+    }
+  }
+
+  w.value(uint64_t(my->ram.size()));
+  for (const auto &[account, bytes] : my->ram) {
+    w.value(account);
+    w.value(bytes);
+  }
+
+  return out;
+}
+
+void chain::restore(const char *data, size_t size) {
+  eosio::check(my->sessions.empty(), "a restore needs every session closed");
+  untracked_heap untracked;
+  snapshot_reader r(data, size);
+
+  char magic[sizeof(snapshot_magic)];
+  for (char &c : magic) {
+    c = r.value<char>();
+  }
+  eosio::check(std::memcmp(magic, snapshot_magic, sizeof(magic)) == 0,
+               "not a chain snapshot");
+  uint32_t version = r.value<uint32_t>();
+  eosio::check(version == snapshot_version,
+               "chain snapshot version " + std::to_string(version) +
+                   ", expected " + std::to_string(snapshot_version));
+
+  // read into a new database, so that a bad snapshot changes nothing
+  impl restored;
+
+  for (uint64_t n = r.value<uint64_t>(); n > 0; n--) {
+    restored.accounts.insert(r.value<uint64_t>());
+  }
+  restored.now = r.value<int64_t>();
+
+  for (uint64_t n = r.value<uint64_t>(); n > 0; n--) {
+    table_key key = r.value<table_key>();
+    primary_table &t = restored.tables[key];
+    t.payer = r.value<uint64_t>();
+    for (uint64_t rows = r.value<uint64_t>(); rows > 0; rows--) {
+      uint64_t pk = r.value<uint64_t>();
+      uint64_t payer = r.value<uint64_t>();
+      t.rows.emplace_hint(t.rows.end(), pk, row{payer, r.bytes()});
+    }
+  }
+
+  for (uint64_t n = r.value<uint64_t>(); n > 0; n--) {
+    table_key key = r.value<table_key>();
+    index_table &index = restored.indices[key];
+    index.payer = r.value<uint64_t>();
+    for (uint64_t entries = r.value<uint64_t>(); entries > 0; entries--) {
+      uint64_t pk = r.value<uint64_t>();
+      index_entry entry = r.value<index_entry>();
+      index.by_primary.emplace_hint(index.by_primary.end(), pk, entry);
+      index.by_secondary.insert({entry.secondary, pk});
+    }
+  }
+
+  for (uint64_t n = r.value<uint64_t>(); n > 0; n--) {
+    uint64_t account = r.value<uint64_t>();
+    restored.ram[account] = r.value<int64_t>();
+  }
+  eosio::check(r.done(), "chain snapshot has trailing bytes");
+
+  my->accounts = std::move(restored.accounts);
+  my->now = restored.now;
+  my->tables = std::move(restored.tables);
+  my->indices = std::move(restored.indices);
+  my->ram = std::move(restored.ram);
+}
+
+} // namespace host
+} // namespace freedao
+
+// the intrinsics
+namespace eosio {
+namespace internal_use_do_not_use {
+
+using freedao::host::context;
+
+uint32_t read_action_data(void *msg, uint32_t len) {
+  auto &ctx = context();
+  if (!ctx.action_data) {
+    return 0;
+  }
+  uint32_t copy = std::min<uint32_t>(len, uint32_t(ctx.action_data->size()));
+  std::copy_n(ctx.action_data->data(), copy, static_cast<char *>(msg));
+  return copy;
+}
+
+uint32_t action_data_size() {
+  auto &ctx = context();
+  return ctx.action_data ? uint32_t(ctx.action_data->size()) : 0;
+}
+
+void require_recipient(uint64_t recipient) {
+  freedao::host::untracked_heap untracked;
+  auto &ctx = context();
+  auto &notified = *ctx.notified;
+  if (std::find(notified.begin(), notified.end(), recipient) ==
+      notified.end()) {
+    notified.push_back(recipient);
+    ctx.cost().notifications++;
+  }
+}
+
+void require_auth(uint64_t name) { context().require_auth(name); }
+
+bool has_auth(uint64_t name) { return context().has_auth(name); }
+
+bool is_account(uint64_t name) {
+  return context().state->accounts.count(name) > 0;
+}
+
+void send_inline(char *serialized_action, size_t size) {
+  freedao::host::untracked_heap untracked;
+  auto &ctx = context();
+  ctx.check_write("send_inline");
+  ctx.cost().inline_actions++;
+  ctx.cost().bytes_packed += size;
+
+  auto act = unpack<eosio::action>(serialized_action, size);
+  if (!ctx.state->accounts.count(act.account.value)) {
+    freedao::host::fail("inline action's code account " +
+                        act.account.to_string() + " does not exist");
+  }
+  for (const auto &auth : act.authorization) {
+    if (auth.actor.value != ctx.receiver) {
+      freedao::host::fail("inline action authorized by " +
+                          auth.actor.to_string() + "@" +
+                          auth.permission.to_string() +
+                          " - a contract can only authorize inline actions "
+                          "with its own permissions");
+    }
+  }
+  ctx.inline_actions->push_back(std::move(act));
+}
+
+uint64_t current_receiver() { return context().receiver; }
+
+void set_action_return_value(void *return_value, size_t size) {
+  freedao::host::untracked_heap untracked;
+  auto &ctx = context();
+  if (size > freedao::host::max_action_return_value_size) {
+    freedao::host::fail("action return value size must be less or equal to " +
+                        std::to_string(
+                            freedao::host::max_action_return_value_size) +
+                        " bytes");
+  }
+  ctx.cost().bytes_packed += size;
+  const char *bytes = static_cast<const char *>(return_value);
+  ctx.trace->return_value.assign(bytes, bytes + size);
+}
+
+uint64_t current_time() { return uint64_t(context().state->now); }
+
+void prints_l(const char *cstr, uint32_t len) {
+  freedao::host::untracked_heap untracked;
+  context().trace->console.append(cstr, len);
+}
+
+#define HOST_INTRINSIC(call)                                                   \
+  freedao::host::untracked_heap untracked;                                     \
+  return context().call
+
+int32_t db_store_i64(uint64_t scope, uint64_t table, uint64_t payer,
+                     uint64_t id, const void *data, uint32_t len) {
+  HOST_INTRINSIC(db_store_i64(scope, table, payer, id, data, len));
+}
+
+void db_update_i64(int32_t iterator, uint64_t payer, const void *data,
+                   uint32_t len) {
+  HOST_INTRINSIC(db_update_i64(iterator, payer, data, len));
+}
+
+void db_remove_i64(int32_t iterator) {
+  HOST_INTRINSIC(db_remove_i64(iterator));
+}
+
+int32_t db_get_i64(int32_t iterator, const void *data, uint32_t len) {
+  HOST_INTRINSIC(db_get_i64(iterator, const_cast<void *>(data), len));
+}
+
+int32_t db_next_i64(int32_t iterator, uint64_t *primary) {
+  HOST_INTRINSIC(db_next_i64(iterator, primary));
+}
+
+int32_t db_previous_i64(int32_t iterator, uint64_t *primary) {
+  HOST_INTRINSIC(db_previous_i64(iterator, primary));
+}
+
+int32_t db_find_i64(uint64_t code, uint64_t scope, uint64_t table,
+                    uint64_t id) {
+  HOST_INTRINSIC(db_find_i64(code, scope, table, id));
+}
+
+int32_t db_lowerbound_i64(uint64_t code, uint64_t scope, uint64_t table,
+                          uint64_t id) {
+  HOST_INTRINSIC(db_bound_i64(code, scope, table,
+                              [&](auto &rows) { return rows.lower_bound(id); }));
+}
+
+int32_t db_upperbound_i64(uint64_t code, uint64_t scope, uint64_t table,
+                          uint64_t id) {
+  HOST_INTRINSIC(db_bound_i64(code, scope, table,
+                              [&](auto &rows) { return rows.upper_bound(id); }));
+}
+
+int32_t db_end_i64(uint64_t code, uint64_t scope, uint64_t table) {
+  HOST_INTRINSIC(db_end_i64(code, scope, table));
+}
+
+int32_t db_idx64_store(uint64_t scope, uint64_t table, uint64_t payer,
+                       uint64_t id, const uint64_t *secondary) {
+  HOST_INTRINSIC(db_idx64_store(scope, table, payer, id, secondary));
+}
+
+void db_idx64_update(int32_t iterator, uint64_t payer,
+                     const uint64_t *secondary) {
+  HOST_INTRINSIC(db_idx64_update(iterator, payer, secondary));
+}
+
+void db_idx64_remove(int32_t iterator) {
+  HOST_INTRINSIC(db_idx64_remove(iterator));
+}
+
+int32_t db_idx64_next(int32_t iterator, uint64_t *primary) {
+  HOST_INTRINSIC(db_idx64_next(iterator, primary));
+}
+
+int32_t db_idx64_previous(int32_t iterator, uint64_t *primary) {
+  HOST_INTRINSIC(db_idx64_previous(iterator, primary));
+}
+
+int32_t db_idx64_find_primary(uint64_t code, uint64_t scope, uint64_t table,
+                              uint64_t *secondary, uint64_t primary) {
+  HOST_INTRINSIC(db_idx64_find_primary(code, scope, table, secondary, primary));
+}
+
+int32_t db_idx64_find_secondary(uint64_t code, uint64_t scope, uint64_t table,
+                                const uint64_t *secondary, uint64_t *primary) {
+  HOST_INTRINSIC(
+      db_idx64_find_secondary(code, scope, table, secondary, primary));
+}
+
+int32_t db_idx64_lowerbound(uint64_t code, uint64_t scope, uint64_t table,
+                            uint64_t *secondary, uint64_t *primary) {
+  HOST_INTRINSIC(db_idx64_bound(code, scope, table, secondary, primary,
+                                [&](auto &entries) {
+                                  return entries.lower_bound({*secondary, 0});
+                                }));
+}
+
+int32_t db_idx64_upperbound(uint64_t code, uint64_t scope, uint64_t table,
+                            uint64_t *secondary, uint64_t *primary) {
+  HOST_INTRINSIC(db_idx64_bound(
+      code, scope, table, secondary, primary, [&](auto &entries) {
+        return entries.upper_bound({*secondary, UINT64_MAX});
+      }));
+}
+
+int32_t db_idx64_end(uint64_t code, uint64_t scope, uint64_t table) {
+  HOST_INTRINSIC(db_idx64_end(code, scope, table));
+}
+
+#undef HOST_INTRINSIC
+
+} // namespace internal_use_do_not_use
+} // namespace eosio
+
+// the contract's heap allocations are counted through the global allocation
+// functions
+void *operator new(size_t size) {
+  void *p = std::malloc(size ? size : 1);
+  if (!p) {
+    throw std::bad_alloc();
+  }
+  freedao::host::count_allocation(p);
+  return p;
+}
+
+void *operator new[](size_t size) { return ::operator new(size); }
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+  void *p = std::malloc(size ? size : 1);
+  freedao::host::count_allocation(p);
+  return p;
+}
+
+void *operator new[](size_t size, const std::nothrow_t &tag) noexcept {
+  return ::operator new(size, tag);
+}
+
+void operator delete(void *p) noexcept {
+  freedao::host::count_free(p);
+  std::free(p);
+}
+
+void operator delete[](void *p) noexcept { ::operator delete(p); }
+void operator delete(void *p, size_t) noexcept { ::operator delete(p); }
+void operator delete[](void *p, size_t) noexcept { ::operator delete(p); }
@@ -0,0 +1,17 @@
+# Build the host build of the contracts, libfreeoshost.a: freeos,
+# freeosconfig and an eosio.token compiled natively with g++ against the eosio
+# shim headers in eosio/, running on the host chain in chain.cpp - see
+# freeoshost.hpp. The tools in ../freeossim link it and test.sh runs the host
+# tests on it.
+# The contracts are built with the production account names. Add -DTEST_BUILD
+# for a test build or -DLAZY_UNLOCK for a lazy unlock build - and build the
+# tools and tests with the same flags.
+set -e
+cd "$(dirname "$0")"
+FLAGS="-std=c++17 -O2 -Wno-attributes -I. -DFREEOS=freeosclaim \
+  -DFREEOSCONFIG=freeoscfg -DFREEOSTOKENS=freeostokens -DDIVIDEND=freeosdivide"
+for source in chain freeos_apply freeosconfig_apply token fixture; do
+  g++ $FLAGS "$@" -c -o $source.o $source.cpp
+done
+rm -f libfreeoshost.a
+ar rcs libfreeoshost.a chain.o freeos_apply.o freeosconfig_apply.o token.o fixture.o
@@ -0,0 +1,156 @@
+#pragma once
+
+// eosio::action, permission_level and the action intrinsics for the host
+// build.
+
+#include "datastream.hpp"
+#include "intrinsics.hpp"
+#include "name.hpp"
+#include "serialize.hpp"
+
+#include <cstdint>
+#include <new>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace eosio {
+
+struct permission_level {
+  permission_level(name a, name p) : actor(a), permission(p) {}
+  permission_level() {}
+
+  name actor;
+  name permission;
+
+  friend constexpr bool operator==(const permission_level &a,
+                                   const permission_level &b) {
+    return std::tie(a.actor, a.permission) == std::tie(b.actor, b.permission);
+  }
+  friend constexpr bool operator<(const permission_level &a,
+                                  const permission_level &b) {
+    return std::tie(a.actor, a.permission) < std::tie(b.actor, b.permission);
+  }
+
+  EOSLIB_SERIALIZE(permission_level, (actor)(permission))
+};
+
+inline uint32_t read_action_data(void *msg, uint32_t len) {
+  return internal_use_do_not_use::read_action_data(msg, len);
+}
+
+inline uint32_t action_data_size() {
+  return internal_use_do_not_use::action_data_size();
+}
+
+template <typename T> T unpack_action_data() {
+  constexpr size_t max_stack_buffer_size = 512;
+  size_t size = action_data_size();
+  char stack_buffer[max_stack_buffer_size];
+  char *buffer = max_stack_buffer_size < size
+                     ? static_cast<char *>(::operator new(size))
+                     : stack_buffer;
+  read_action_data(buffer, size);
+  auto result = unpack<T>(buffer, size);
+  if (max_stack_buffer_size < size) {
+    ::operator delete(buffer);
+  }
+  return result;
+}
+
+inline void require_recipient(name notify_account) {
+  internal_use_do_not_use::require_recipient(notify_account.value);
+}
+
+template <typename... accounts>
+void require_recipient(name notify_account, accounts... remaining_accounts) {
+  internal_use_do_not_use::require_recipient(notify_account.value);
+  require_recipient(remaining_accounts...);
+}
+
+inline void require_auth(name n) {
+  internal_use_do_not_use::require_auth(n.value);
+}
+
+inline bool has_auth(name n) { return internal_use_do_not_use::has_auth(n.value); }
+
+inline bool is_account(name n) {
+  return internal_use_do_not_use::is_account(n.value);
+}
+
+inline name current_receiver() {
+  return name(internal_use_do_not_use::current_receiver());
+}
+
+template <typename T> void set_action_return_value(T &&return_value) {
+  auto packed = pack(std::forward<T>(return_value));
+  internal_use_do_not_use::set_action_return_value(packed.data(),
+                                                   packed.size());
+}
+
+struct action {
+  eosio::name account;
+  eosio::name name;
+  std::vector<permission_level> authorization;
+  std::vector<char> data;
+
+  action() = default;
+
+  template <typename T>
+  action(const permission_level &auth, eosio::name a, eosio::name n,
+         T &&value)
+      : account(a), name(n), authorization(1, auth),
+        data(pack(std::forward<T>(value))) {}
+
+  template <typename T>
+  action(std::vector<permission_level> auths, eosio::name a, eosio::name n,
+         T &&value)
+      : account(a), name(n), authorization(std::move(auths)),
+        data(pack(std::forward<T>(value))) {}
+
+  void send() const {
+    auto serialize = pack(*this);
+    internal_use_do_not_use::send_inline(serialize.data(), serialize.size());
+  }
+
+  template <typename T> T data_as() { return unpack<T>(data); }
+
+  EOSLIB_SERIALIZE(action, (account)(name)(authorization)(data))
+};
+
+// wraps an action of another contract so that it can be sent inline
+template <eosio::name::raw Name, auto Action> struct action_wrapper {
+  template <typename Code>
+  constexpr action_wrapper(Code &&code,
+                           std::vector<eosio::permission_level> &&perms)
+      : code_name(std::forward<Code>(code)), permissions(std::move(perms)) {}
+
+  template <typename Code>
+  constexpr action_wrapper(Code &&code,
+                           const std::vector<eosio::permission_level> &perms)
+      : code_name(std::forward<Code>(code)), permissions(perms) {}
+
+  template <typename Code>
+  constexpr action_wrapper(Code &&code, eosio::permission_level &&perm)
+      : code_name(std::forward<Code>(code)), permissions({1, perm}) {}
+
+  template <typename Code>
+  constexpr action_wrapper(Code &&code, const eosio::permission_level &perm)
+      : code_name(std::forward<Code>(code)), permissions({1, perm}) {}
+
+  static constexpr eosio::name action_name = eosio::name(Name);
+
+  template <typename... Args> action to_action(Args &&...args) const {
+    return action(permissions, code_name, action_name,
+                  std::make_tuple(std::forward<Args>(args)...));
+  }
+
+  template <typename... Args> void send(Args &&...args) const {
+    to_action(std::forward<Args>(args)...).send();
+  }
+
+  eosio::name code_name;
+  std::vector<eosio::permission_level> permissions;
+};
+
+} // namespace eosio
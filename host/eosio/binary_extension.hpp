@@ -0,0 +1,60 @@
+#pragma once
+
+// eosio::binary_extension for the host build. A field that is only packed
+// when it has a value, and only unpacked when there are bytes left - see
+// datastream.hpp.
+
+#include "check.hpp"
+
+#include <optional>
+#include <utility>
+
+namespace eosio {
+
+template <typename T> class binary_extension {
+public:
+  using value_type = T;
+
+  constexpr binary_extension() = default;
+  constexpr binary_extension(const T &ext) : _value(ext) {}
+  constexpr binary_extension(T &&ext) : _value(std::move(ext)) {}
+
+  binary_extension &operator=(const T &ext) {
+    _value = ext;
+    return *this;
+  }
+  binary_extension &operator=(T &&ext) {
+    _value = std::move(ext);
+    return *this;
+  }
+
+  constexpr bool has_value() const { return _value.has_value(); }
+
+  T &value() {
+    check(_value.has_value(), "cannot get value of empty binary_extension");
+    return *_value;
+  }
+  const T &value() const {
+    check(_value.has_value(), "cannot get value of empty binary_extension");
+    return *_value;
+  }
+
+  T value_or(const T &def = {}) const { return _value.value_or(def); }
+
+  T &operator*() { return value(); }
+  const T &operator*() const { return value(); }
+  T *operator->() { return &value(); }
+  const T *operator->() const { return &value(); }
+
+  template <typename... Args> binary_extension &emplace(Args &&...args) {
+    _value.emplace(std::forward<Args>(args)...);
+    return *this;
+  }
+
+  void reset() { _value.reset(); }
+
+private:
+  std::optional<T> _value;
+};
+
+} // namespace eosio
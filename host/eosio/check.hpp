@@ -0,0 +1,53 @@
+#pragma once
+
+// eosio::check for the host build. A failed check throws check_failure, which
+// the host chain (freeoshost.hpp) catches and turns into a failed
+// transaction, undoing its table changes - as eosio_assert does on chain.
+
+#include <cstdint>
+#include <exception>
+#include <string>
+#include <string_view>
+
+namespace eosio {
+
+struct check_failure : std::exception {
+  explicit check_failure(std::string message) : message(std::move(message)) {}
+
+  const char *what() const noexcept override { return message.c_str(); }
+
+  std::string message;
+};
+
+inline void check(bool pred, const char *msg) {
+  if (!pred) {
+    throw check_failure(msg);
+  }
+}
+
+inline void check(bool pred, const std::string &msg) {
+  if (!pred) {
+    throw check_failure(msg);
+  }
+}
+
+inline void check(bool pred, std::string &&msg) {
+  if (!pred) {
+    throw check_failure(std::move(msg));
+  }
+}
+
+inline void check(bool pred, const char *msg, size_t n) {
+  if (!pred) {
+    throw check_failure(std::string(msg, n));
+  }
+}
+
+inline void check(bool pred, uint64_t code) {
+  if (!pred) {
+    throw check_failure("assertion failure with error code: " +
+                        std::to_string(code));
+  }
+}
+
+} // namespace eosio
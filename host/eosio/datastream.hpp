@@ -0,0 +1,525 @@
+#pragma once
+
+// eosio::datastream and the eosio binary serialization for the host build -
+// the byte layout the ABI describes, so that rows and action data packed
+// here are the bytes a chain stores.
+//
+// Structs are serialized field by field, in declaration order: those with an
+// EOSLIB_SERIALIZE list (see serialize.hpp) through it, aggregates (every
+// table and action struct in freeoscommon.hpp and freeos.hpp) through their
+// structured bindings, up to 24 fields.
+
+#include "asset.hpp"
+#include "binary_extension.hpp"
+#include "check.hpp"
+#include "name.hpp"
+#include "symbol.hpp"
+#include "time.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace eosio {
+
+template <typename T> class datastream {
+public:
+  datastream(T start, size_t s) : _start(start), _pos(start), _end(start + s) {}
+
+  void skip(size_t s) { _pos += s; }
+
+  bool read(char *d, size_t s) {
+    check(size_t(_end - _pos) >= s, "datastream attempted to read past the end");
+    std::memcpy(d, _pos, s);
+    _pos += s;
+    return true;
+  }
+
+  bool write(const char *d, size_t s) {
+    check(_end - _pos >= (int32_t)s,
+          "datastream attempted to write past the end");
+    std::memcpy((void *)_pos, d, s);
+    _pos += s;
+    return true;
+  }
+
+  bool write(char d) { return write(&d, 1); }
+
+  bool get(char &c) { return read(&c, 1); }
+
+  T pos() const { return _pos; }
+  bool valid() const { return _pos <= _end && _pos >= _start; }
+
+  bool seekp(size_t p) {
+    _pos = _start + p;
+    return _pos <= _end;
+  }
+
+  size_t tellp() const { return size_t(_pos - _start); }
+  size_t remaining() const { return _end - _pos; }
+
+private:
+  T _start;
+  T _pos;
+  T _end;
+};
+
+// the size counting stream - pack_size
+template <> class datastream<size_t> {
+public:
+  datastream(size_t init_size = 0) : _size(init_size) {}
+
+  bool skip(size_t s) {
+    _size += s;
+    return true;
+  }
+  bool write(const char *, size_t s) {
+    _size += s;
+    return true;
+  }
+  bool write(char) {
+    _size++;
+    return true;
+  }
+  bool seekp(size_t p) {
+    _size = p;
+    return true;
+  }
+  size_t tellp() const { return _size; }
+  size_t remaining() const { return 0; }
+
+private:
+  size_t _size;
+};
+
+// a variable length unsigned integer, e.g. the length of a vector
+struct unsigned_int {
+  unsigned_int(uint32_t v = 0) : value(v) {}
+  operator uint32_t() const { return value; }
+
+  uint32_t value;
+};
+
+namespace reflection {
+
+struct ignore_field {
+  template <typename U> void operator()(U &) const {}
+};
+
+// a struct with an EOSLIB_SERIALIZE list
+template <typename T, typename = void>
+struct has_field_list : std::false_type {};
+template <typename T>
+struct has_field_list<T, std::void_t<decltype(std::declval<T &>()
+                                                  .eosio_for_each_field(
+                                                      ignore_field{}))>>
+    : std::true_type {};
+
+struct any_field {
+  template <typename U> operator U() const;
+};
+
+template <typename T, typename... A>
+constexpr auto brace_constructible(int)
+    -> decltype(T{std::declval<A>()...}, true) {
+  return true;
+}
+template <typename T, typename... A>
+constexpr bool brace_constructible(...) {
+  return false;
+}
+
+template <typename T, size_t... I>
+constexpr bool constructible_from(std::index_sequence<I...>) {
+  return brace_constructible<T, decltype((void)I, any_field{})...>(0);
+}
+
+// the number of fields of an aggregate
+template <typename T, size_t N = 0> constexpr size_t field_count() {
+  if constexpr (N < 24 &&
+                constructible_from<T>(std::make_index_sequence<N + 1>{})) {
+    return field_count<T, N + 1>();
+  } else {
+    return N;
+  }
+}
+
+#define HOST_FIELDS_1 f1
+#define HOST_FIELDS_2 HOST_FIELDS_1, f2
+#define HOST_FIELDS_3 HOST_FIELDS_2, f3
+#define HOST_FIELDS_4 HOST_FIELDS_3, f4
+#define HOST_FIELDS_5 HOST_FIELDS_4, f5
+#define HOST_FIELDS_6 HOST_FIELDS_5, f6
+#define HOST_FIELDS_7 HOST_FIELDS_6, f7
+#define HOST_FIELDS_8 HOST_FIELDS_7, f8
+#define HOST_FIELDS_9 HOST_FIELDS_8, f9
+#define HOST_FIELDS_10 HOST_FIELDS_9, f10
+#define HOST_FIELDS_11 HOST_FIELDS_10, f11
+#define HOST_FIELDS_12 HOST_FIELDS_11, f12
+#define HOST_FIELDS_13 HOST_FIELDS_12, f13
+#define HOST_FIELDS_14 HOST_FIELDS_13, f14
+#define HOST_FIELDS_15 HOST_FIELDS_14, f15
+#define HOST_FIELDS_16 HOST_FIELDS_15, f16
+#define HOST_FIELDS_17 HOST_FIELDS_16, f17
+#define HOST_FIELDS_18 HOST_FIELDS_17, f18
+#define HOST_FIELDS_19 HOST_FIELDS_18, f19
+#define HOST_FIELDS_20 HOST_FIELDS_19, f20
+#define HOST_FIELDS_21 HOST_FIELDS_20, f21
+#define HOST_FIELDS_22 HOST_FIELDS_21, f22
+#define HOST_FIELDS_23 HOST_FIELDS_22, f23
+#define HOST_FIELDS_24 HOST_FIELDS_23, f24
+#define HOST_VISIT_FIELDS(n)                                                   \
+  if constexpr (count == n) {                                                  \
+    auto &[HOST_FIELDS_##n] = t;                                               \
+    auto visit = [&](auto &...fields) { (f(fields), ...); };                   \
+    visit(HOST_FIELDS_##n);                                                    \
+  }
+
+// call f with each field of t, in declaration order
+template <typename T, typename F> void for_each_field(T &t, F &&f) {
+  using type = std::remove_const_t<T>;
+  if constexpr (has_field_list<type>::value) {
+    t.eosio_for_each_field(f);
+  } else {
+    static_assert(std::is_aggregate_v<type>,
+                  "only aggregates and EOSLIB_SERIALIZE structs are "
+                  "serializable");
+    constexpr size_t count = field_count<type>();
+    static_assert(count > 0 && count <= 24, "unsupported number of fields");
+    HOST_VISIT_FIELDS(1) HOST_VISIT_FIELDS(2) HOST_VISIT_FIELDS(3)
+    HOST_VISIT_FIELDS(4) HOST_VISIT_FIELDS(5) HOST_VISIT_FIELDS(6)
+    HOST_VISIT_FIELDS(7) HOST_VISIT_FIELDS(8) HOST_VISIT_FIELDS(9)
+    HOST_VISIT_FIELDS(10) HOST_VISIT_FIELDS(11) HOST_VISIT_FIELDS(12)
+    HOST_VISIT_FIELDS(13) HOST_VISIT_FIELDS(14) HOST_VISIT_FIELDS(15)
+    HOST_VISIT_FIELDS(16) HOST_VISIT_FIELDS(17) HOST_VISIT_FIELDS(18)
+    HOST_VISIT_FIELDS(19) HOST_VISIT_FIELDS(20) HOST_VISIT_FIELDS(21)
+    HOST_VISIT_FIELDS(22) HOST_VISIT_FIELDS(23) HOST_VISIT_FIELDS(24)
+  }
+}
+
+#undef HOST_VISIT_FIELDS
+
+template <typename T>
+constexpr bool is_struct =
+    std::is_class_v<T> && (has_field_list<T>::value || std::is_aggregate_v<T>);
+
+} // namespace reflection
+
+// arithmetic types and enums - little endian, as on chain
+template <typename Stream, typename T,
+          std::enable_if_t<std::is_arithmetic_v<T> || std::is_enum_v<T>, int> = 0>
+datastream<Stream> &operator<<(datastream<Stream> &ds, const T &v) {
+  if constexpr (std::is_same_v<T, bool>) {
+    char b = v ? 1 : 0;
+    ds.write(&b, 1);
+  } else {
+    ds.write(reinterpret_cast<const char *>(&v), sizeof(T));
+  }
+  return ds;
+}
+
+template <typename Stream, typename T,
+          std::enable_if_t<std::is_arithmetic_v<T> || std::is_enum_v<T>, int> = 0>
+datastream<Stream> &operator>>(datastream<Stream> &ds, T &v) {
+  if constexpr (std::is_same_v<T, bool>) {
+    char b = 0;
+    ds.read(&b, 1);
+    check(b == 0 || b == 1, "invalid bool value");
+    v = b;
+  } else {
+    ds.read(reinterpret_cast<char *>(&v), sizeof(T));
+  }
+  return ds;
+}
+
+template <typename Stream>
+datastream<Stream> &operator<<(datastream<Stream> &ds, const unsigned_int &v) {
+  uint64_t val = v.value;
+  do {
+    uint8_t b = uint8_t(val) & 0x7f;
+    val >>= 7;
+    b |= ((val > 0) << 7);
+    ds.write((char)b);
+  } while (val);
+  return ds;
+}
+
+template <typename Stream>
+datastream<Stream> &operator>>(datastream<Stream> &ds, unsigned_int &vi) {
+  uint64_t v = 0;
+  char b = 0;
+  uint8_t by = 0;
+  do {
+    ds.get(b);
+    check(by < 35, "varuint32 is too long");
+    v |= uint32_t(uint8_t(b) & 0x7f) << by;
+    by += 7;
+  } while (uint8_t(b) & 0x80);
+  vi.value = static_cast<uint32_t>(v);
+  return ds;
+}
+
+template <typename Stream>
+datastream<Stream> &operator<<(datastream<Stream> &ds, const name &n) {
+  return ds << n.value;
+}
+template <typename Stream>
+datastream<Stream> &operator>>(datastream<Stream> &ds, name &n) {
+  return ds >> n.value;
+}
+
+template <typename Stream>
+datastream<Stream> &operator<<(datastream<Stream> &ds, const symbol_code &s) {
+  return ds << s.raw();
+}
+template <typename Stream>
+datastream<Stream> &operator>>(datastream<Stream> &ds, symbol_code &s) {
+  uint64_t raw = 0;
+  ds >> raw;
+  s = symbol_code(raw);
+  return ds;
+}
+
+template <typename Stream>
+datastream<Stream> &operator<<(datastream<Stream> &ds, const symbol &s) {
+  return ds << s.raw();
+}
+template <typename Stream>
+datastream<Stream> &operator>>(datastream<Stream> &ds, symbol &s) {
+  uint64_t raw = 0;
+  ds >> raw;
+  s = symbol(raw);
+  return ds;
+}
+
+template <typename Stream>
+datastream<Stream> &operator<<(datastream<Stream> &ds, const asset &a) {
+  return ds << a.amount << a.symbol;
+}
+template <typename Stream>
+datastream<Stream> &operator>>(datastream<Stream> &ds, asset &a) {
+  return ds >> a.amount >> a.symbol;
+}
+
+template <typename Stream>
+datastream<Stream> &operator<<(datastream<Stream> &ds, const microseconds &m) {
+  return ds << m._count;
+}
+template <typename Stream>
+datastream<Stream> &operator>>(datastream<Stream> &ds, microseconds &m) {
+  return ds >> m._count;
+}
+
+template <typename Stream>
+datastream<Stream> &operator<<(datastream<Stream> &ds, const time_point &t) {
+  return ds << t.elapsed;
+}
+template <typename Stream>
+datastream<Stream> &operator>>(datastream<Stream> &ds, time_point &t) {
+  return ds >> t.elapsed;
+}
+
+template <typename Stream>
+datastream<Stream> &operator<<(datastream<Stream> &ds,
+                               const time_point_sec &t) {
+  return ds << t.utc_seconds;
+}
+template <typename Stream>
+datastream<Stream> &operator>>(datastream<Stream> &ds, time_point_sec &t) {
+  return ds >> t.utc_seconds;
+}
+
+template <typename Stream>
+datastream<Stream> &operator<<(datastream<Stream> &ds, std::string_view s) {
+  ds << unsigned_int(uint32_t(s.size()));
+  if (!s.empty()) {
+    ds.write(s.data(), s.size());
+  }
+  return ds;
+}
+
+template <typename Stream>
+datastream<Stream> &operator<<(datastream<Stream> &ds, const std::string &s) {
+  return ds << std::string_view(s);
+}
+template <typename Stream>
+datastream<Stream> &operator>>(datastream<Stream> &ds, std::string &s) {
+  unsigned_int size;
+  ds >> size;
+  check(ds.remaining() >= size.value,
+        "datastream attempted to read past the end");
+  s.resize(size.value);
+  if (size.value > 0) {
+    ds.read(s.data(), size.value);
+  }
+  return ds;
+}
+
+template <typename Stream, typename T>
+datastream<Stream> &operator<<(datastream<Stream> &ds,
+                               const binary_extension<T> &be) {
+  if (be.has_value()) {
+    ds << be.value();
+  }
+  return ds;
+}
+template <typename Stream, typename T>
+datastream<Stream> &operator>>(datastream<Stream> &ds, binary_extension<T> &be) {
+  if (ds.remaining()) {
+    T val;
+    ds >> val;
+    be.emplace(std::move(val));
+  }
+  return ds;
+}
+
+template <typename Stream, typename T>
+datastream<Stream> &operator<<(datastream<Stream> &ds,
+                               const std::optional<T> &opt) {
+  char has = opt.has_value() ? 1 : 0;
+  ds << has;
+  if (has) {
+    ds << *opt;
+  }
+  return ds;
+}
+template <typename Stream, typename T>
+datastream<Stream> &operator>>(datastream<Stream> &ds, std::optional<T> &opt) {
+  bool has = false;
+  ds >> has;
+  if (has) {
+    T val;
+    ds >> val;
+    opt = std::move(val);
+  } else {
+    opt.reset();
+  }
+  return ds;
+}
+
+template <typename Stream, typename T>
+datastream<Stream> &operator<<(datastream<Stream> &ds, const std::vector<T> &v) {
+  ds << unsigned_int(uint32_t(v.size()));
+  if constexpr (std::is_same_v<T, char> || std::is_same_v<T, uint8_t>) {
+    if (!v.empty()) {
+      ds.write(reinterpret_cast<const char *>(v.data()), v.size());
+    }
+  } else {
+    for (const auto &i : v) {
+      ds << i;
+    }
+  }
+  return ds;
+}
+template <typename Stream, typename T>
+datastream<Stream> &operator>>(datastream<Stream> &ds, std::vector<T> &v) {
+  unsigned_int s;
+  ds >> s;
+  // every element is at least a byte - stops a corrupt length allocating
+  check(ds.remaining() >= s.value, "datastream attempted to read past the end");
+  v.resize(s.value);
+  if constexpr (std::is_same_v<T, char> || std::is_same_v<T, uint8_t>) {
+    if (s.value > 0) {
+      ds.read(reinterpret_cast<char *>(v.data()), v.size());
+    }
+  } else {
+    for (auto &i : v) {
+      ds >> i;
+    }
+  }
+  return ds;
+}
+
+template <typename Stream, typename K, typename V>
+datastream<Stream> &operator<<(datastream<Stream> &ds,
+                               const std::map<K, V> &m) {
+  ds << unsigned_int(uint32_t(m.size()));
+  for (const auto &i : m) {
+    ds << i.first << i.second;
+  }
+  return ds;
+}
+template <typename Stream, typename K, typename V>
+datastream<Stream> &operator>>(datastream<Stream> &ds, std::map<K, V> &m) {
+  m.clear();
+  unsigned_int s;
+  ds >> s;
+  for (uint32_t i = 0; i < s.value; ++i) {
+    K k;
+    V v;
+    ds >> k >> v;
+    m.emplace(std::move(k), std::move(v));
+  }
+  return ds;
+}
+
+template <typename Stream, typename A, typename B>
+datastream<Stream> &operator<<(datastream<Stream> &ds,
+                               const std::pair<A, B> &p) {
+  return ds << p.first << p.second;
+}
+template <typename Stream, typename A, typename B>
+datastream<Stream> &operator>>(datastream<Stream> &ds, std::pair<A, B> &p) {
+  return ds >> p.first >> p.second;
+}
+
+template <typename Stream, typename... Args>
+datastream<Stream> &operator<<(datastream<Stream> &ds,
+                               const std::tuple<Args...> &t) {
+  std::apply([&](const auto &...fields) { (ds << ... << fields); }, t);
+  return ds;
+}
+template <typename Stream, typename... Args>
+datastream<Stream> &operator>>(datastream<Stream> &ds, std::tuple<Args...> &t) {
+  std::apply([&](auto &...fields) { (ds >> ... >> fields); }, t);
+  return ds;
+}
+
+// structs
+template <typename Stream, typename T,
+          std::enable_if_t<reflection::is_struct<T>, int> = 0>
+datastream<Stream> &operator<<(datastream<Stream> &ds, const T &v) {
+  reflection::for_each_field(v, [&](const auto &field) { ds << field; });
+  return ds;
+}
+template <typename Stream, typename T,
+          std::enable_if_t<reflection::is_struct<T>, int> = 0>
+datastream<Stream> &operator>>(datastream<Stream> &ds, T &v) {
+  reflection::for_each_field(v, [&](auto &field) { ds >> field; });
+  return ds;
+}
+
+template <typename T> size_t pack_size(const T &value) {
+  datastream<size_t> ps;
+  ps << value;
+  return ps.tellp();
+}
+
+template <typename T> std::vector<char> pack(const T &value) {
+  std::vector<char> result;
+  result.resize(pack_size(value));
+
+  datastream<char *> ds(result.data(), result.size());
+  ds << value;
+  return result;
+}
+
+template <typename T> T unpack(const char *buffer, size_t len) {
+  T result{};
+  datastream<const char *> ds(buffer, len);
+  ds >> result;
+  return result;
+}
+
+template <typename T> T unpack(const std::vector<char> &bytes) {
+  return unpack<T>(bytes.data(), bytes.size());
+}
+
+} // namespace eosio
@@ -0,0 +1,61 @@
+#pragma once
+
+// Action dispatch for the host build. execute_action unpacks an action's
+// arguments and calls the contract's handler the way the dispatcher cdt-cpp
+// generates from the [[eosio::action]] and [[eosio::on_notify]] attributes
+// does: the action data is read into a stack buffer (the heap above 512
+// bytes), each argument is unpacked into a local and the handler is called
+// with the locals, so a by-value parameter is a copy. A handler's return
+// value is packed and set as the action's return value.
+
+#include "action.hpp"
+#include "datastream.hpp"
+#include "intrinsics.hpp"
+#include "name.hpp"
+
+#include <new>
+#include <tuple>
+#include <type_traits>
+
+namespace eosio {
+
+template <typename T, typename R, typename... Args>
+bool execute_action(name self, name code, R (T::*func)(Args...)) {
+  constexpr size_t max_stack_buffer_size = 512;
+  size_t size = action_data_size();
+
+  char stack_buffer[max_stack_buffer_size];
+  char *buffer = stack_buffer;
+  if (size > 0) {
+    if (max_stack_buffer_size <= size) {
+      freedao::host::heap_scope heap(freedao::host::heap_category::args);
+      buffer = static_cast<char *>(::operator new(size));
+    }
+    read_action_data(buffer, size);
+  }
+
+  datastream<const char *> ds(buffer, size);
+
+  std::tuple<std::decay_t<Args>...> args;
+  {
+    freedao::host::heap_scope heap(freedao::host::heap_category::args);
+    ds >> args;
+  }
+
+  T inst(self, code, ds);
+
+  if constexpr (std::is_void_v<R>) {
+    std::apply([&](auto &...a) { (inst.*func)(a...); }, args);
+  } else {
+    auto result = std::apply([&](auto &...a) { return (inst.*func)(a...); },
+                             args);
+    set_action_return_value(result);
+  }
+
+  if (max_stack_buffer_size <= size) {
+    ::operator delete(buffer);
+  }
+  return true;
+}
+
+} // namespace eosio
@@ -0,0 +1,20 @@
+#pragma once
+
+// The host build's eosio/eosio.hpp - the CDT's contract API, implemented on
+// the host chain in freeoshost.hpp so that the contracts can be compiled and
+// run natively, without a node. See host/compile.sh.
+
+#include "action.hpp"
+#include "asset.hpp"
+#include "binary_extension.hpp"
+#include "check.hpp"
+#include "contract.hpp"
+#include "datastream.hpp"
+#include "dispatcher.hpp"
+#include "multi_index.hpp"
+#include "name.hpp"
+#include "print.hpp"
+#include "serialize.hpp"
+#include "symbol.hpp"
+#include "system.hpp"
+#include "time.hpp"
@@ -0,0 +1,98 @@
+#pragma once
+
+// The chain intrinsics the host shim headers are built on - the same names
+// and signatures as the CDT's eosio::internal_use_do_not_use imports,
+// implemented by the host chain in chain.cpp.
+
+#include <cstddef>
+#include <cstdint>
+
+namespace eosio {
+namespace internal_use_do_not_use {
+
+// action
+uint32_t read_action_data(void *msg, uint32_t len);
+uint32_t action_data_size();
+void require_recipient(uint64_t name);
+void require_auth(uint64_t name);
+bool has_auth(uint64_t name);
+bool is_account(uint64_t name);
+void send_inline(char *serialized_action, size_t size);
+uint64_t current_receiver();
+void set_action_return_value(void *return_value, size_t size);
+
+// system
+uint64_t current_time();
+void prints_l(const char *cstr, uint32_t len);
+
+// primary index
+int32_t db_store_i64(uint64_t scope, uint64_t table, uint64_t payer,
+                     uint64_t id, const void *data, uint32_t len);
+void db_update_i64(int32_t iterator, uint64_t payer, const void *data,
+                   uint32_t len);
+void db_remove_i64(int32_t iterator);
+int32_t db_get_i64(int32_t iterator, const void *data, uint32_t len);
+int32_t db_next_i64(int32_t iterator, uint64_t *primary);
+int32_t db_previous_i64(int32_t iterator, uint64_t *primary);
+int32_t db_find_i64(uint64_t code, uint64_t scope, uint64_t table,
+                    uint64_t id);
+int32_t db_lowerbound_i64(uint64_t code, uint64_t scope, uint64_t table,
+                          uint64_t id);
+int32_t db_upperbound_i64(uint64_t code, uint64_t scope, uint64_t table,
+                          uint64_t id);
+int32_t db_end_i64(uint64_t code, uint64_t scope, uint64_t table);
+
+// uint64_t secondary indices - the only kind the freeos tables use
+int32_t db_idx64_store(uint64_t scope, uint64_t table, uint64_t payer,
+                       uint64_t id, const uint64_t *secondary);
+void db_idx64_update(int32_t iterator, uint64_t payer,
+                     const uint64_t *secondary);
+void db_idx64_remove(int32_t iterator);
+int32_t db_idx64_next(int32_t iterator, uint64_t *primary);
+int32_t db_idx64_previous(int32_t iterator, uint64_t *primary);
+int32_t db_idx64_find_primary(uint64_t code, uint64_t scope, uint64_t table,
+                              uint64_t *secondary, uint64_t primary);
+int32_t db_idx64_find_secondary(uint64_t code, uint64_t scope, uint64_t table,
+                                const uint64_t *secondary, uint64_t *primary);
+int32_t db_idx64_lowerbound(uint64_t code, uint64_t scope, uint64_t table,
+                            uint64_t *secondary, uint64_t *primary);
+int32_t db_idx64_upperbound(uint64_t code, uint64_t scope, uint64_t table,
+                            uint64_t *secondary, uint64_t *primary);
+int32_t db_idx64_end(uint64_t code, uint64_t scope, uint64_t table);
+
+} // namespace internal_use_do_not_use
+} // namespace eosio
+
+namespace freedao {
+namespace host {
+
+// What a heap allocation made while a contract runs is for. The host chain
+// counts the contract's allocations by category: contract is the contract
+// code itself, rows the multi_index row cache (a CDT multi_index allocates
+// every row it loads or creates) and args the unpacked action arguments. none
+// is the host chain's own bookkeeping, which is not counted.
+enum class heap_category : uint8_t { none, contract, rows, args };
+
+// the category of the allocations made on this thread
+heap_category &current_heap_category();
+
+// sets the heap category for the lifetime of the scope
+class heap_scope {
+public:
+  explicit heap_scope(heap_category category)
+      : previous(current_heap_category()) {
+    if (previous != heap_category::none) {
+      current_heap_category() = category;
+    }
+  }
+  ~heap_scope() { current_heap_category() = previous; }
+
+  heap_scope(const heap_scope &) = delete;
+  heap_scope &operator=(const heap_scope &) = delete;
+
+private:
+  heap_category previous;
+};
+
+} // namespace host
+} // namespace freedao
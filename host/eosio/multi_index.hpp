@@ -0,0 +1,831 @@
+#pragma once
+
+// eosio::multi_index for the host build. A port of the CDT's multi_index that
+// makes the same intrinsic calls in the same order - the row cache is checked
+// before db_find_i64, a row is read with a size query and then a db_get_i64,
+// secondary iterators find their primary row lazily - so that the host
+// chain's counts are the counts of the contract on chain.
+//
+// Only uint64_t secondary keys (idx64) are supported, which is all the freeos
+// tables use.
+
+#include "check.hpp"
+#include "datastream.hpp"
+#include "intrinsics.hpp"
+#include "name.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace eosio {
+
+// the payer for modify that keeps the row's payer
+constexpr name same_payer{};
+
+template <name::raw IndexName, typename Extractor> struct indexed_by {
+  enum constants { index_name = static_cast<uint64_t>(IndexName) };
+  typedef Extractor secondary_extractor_type;
+};
+
+template <class Class, typename Type,
+          Type (Class::*PtrToMemberFunction)() const>
+struct const_mem_fun {
+  typedef typename std::remove_reference<Type>::type result_type;
+
+  Type operator()(const Class &x) const { return (x.*PtrToMemberFunction)(); }
+};
+
+template <name::raw TableName, typename T, typename... Indices>
+class multi_index {
+private:
+  static_assert(sizeof...(Indices) <= 16,
+                "multi_index only supports a maximum of 16 secondary indices");
+
+  constexpr static bool validate_table_name(name::raw n) {
+    // Limit table names to 12 characters so that the last character (4 bits)
+    // can be used to distinguish between the secondary indices.
+    return (static_cast<uint64_t>(n) & 0x000000000000000FULL) == 0;
+  }
+
+  static_assert(validate_table_name(TableName),
+                "multi_index does not support table names with a length "
+                "greater than 12");
+
+  // must be the smallest uint64_t value compared to all other tags
+  constexpr static uint64_t no_available_primary_key =
+      static_cast<uint64_t>(-2);
+  constexpr static uint64_t unset_next_primary_key = static_cast<uint64_t>(-1);
+
+  constexpr static size_t max_stack_buffer_size = 512;
+
+  name _code;
+  uint64_t _scope;
+
+  mutable uint64_t _next_primary_key;
+
+  struct item : public T {
+    template <typename Constructor>
+    item(const multi_index *idx, Constructor &&c) : T(), __idx(idx) {
+      c(*this);
+    }
+
+    const multi_index *__idx;
+    int32_t __primary_itr;
+    int32_t __iters[sizeof...(Indices) + (sizeof...(Indices) == 0)];
+  };
+
+  struct item_ptr {
+    item_ptr(std::unique_ptr<item> &&i, uint64_t pk, int32_t pi)
+        : _item(std::move(i)), _primary_key(pk), _primary_itr(pi) {}
+
+    std::unique_ptr<item> _item;
+    uint64_t _primary_key;
+    int32_t _primary_itr;
+  };
+
+  mutable std::vector<item_ptr> _items_vector;
+
+  template <name::raw IndexName, typename Extractor, uint64_t Number>
+  struct index {
+  public:
+    typedef Extractor secondary_extractor_type;
+    typedef typename std::decay<typename Extractor::result_type>::type
+        secondary_key_type;
+
+    static_assert(std::is_same<secondary_key_type, uint64_t>::value,
+                  "the host multi_index only supports uint64_t secondary "
+                  "keys");
+
+    constexpr static bool validate_index_name(name::raw n) {
+      return static_cast<uint64_t>(n) != 0;
+    }
+
+    static_assert(validate_index_name(IndexName),
+                  "invalid index name used in multi_index");
+
+    enum constants {
+      table_name = static_cast<uint64_t>(TableName),
+      index_name = static_cast<uint64_t>(IndexName),
+      index_number = Number,
+      index_table_name = (static_cast<uint64_t>(TableName) &
+                          0xFFFFFFFFFFFFFFF0ULL) |
+                         (Number & 0x000000000000000FULL)
+    };
+
+    constexpr static uint64_t name() { return index_table_name; }
+    constexpr static uint64_t number() { return Number; }
+
+    struct const_iterator {
+    public:
+      using iterator_category = std::bidirectional_iterator_tag;
+      using value_type = const T;
+      using difference_type = std::ptrdiff_t;
+      using pointer = const T *;
+      using reference = const T &;
+
+      friend bool operator==(const const_iterator &a, const const_iterator &b) {
+        return a._item == b._item;
+      }
+      friend bool operator!=(const const_iterator &a, const const_iterator &b) {
+        return a._item != b._item;
+      }
+
+      const T &operator*() const { return *static_cast<const T *>(_item); }
+      const T *operator->() const { return static_cast<const T *>(_item); }
+
+      const_iterator operator++(int) {
+        const_iterator result(*this);
+        ++(*this);
+        return result;
+      }
+
+      const_iterator operator--(int) {
+        const_iterator result(*this);
+        --(*this);
+        return result;
+      }
+
+      const_iterator &operator++() {
+        using namespace internal_use_do_not_use;
+        check(_item != nullptr, "cannot increment end iterator");
+
+        if (_item->__iters[Number] == -1) {
+          secondary_key_type temp_secondary_key;
+          auto idxitr = db_idx64_find_primary(
+              _idx->get_code().value, _idx->get_scope(), _idx->name(),
+              &temp_secondary_key, _item->primary_key());
+          auto &mi = const_cast<item &>(*_item);
+          mi.__iters[Number] = idxitr;
+        }
+
+        uint64_t next_pk = 0;
+        auto next_itr = db_idx64_next(_item->__iters[Number], &next_pk);
+        if (next_itr < 0) {
+          _item = nullptr;
+          return *this;
+        }
+
+        const T &obj = *_idx->_multidx->find(next_pk);
+        auto &mi = const_cast<item &>(static_cast<const item &>(obj));
+        mi.__iters[Number] = next_itr;
+        _item = &mi;
+
+        return *this;
+      }
+
+      const_iterator &operator--() {
+        using namespace internal_use_do_not_use;
+        uint64_t prev_pk = 0;
+        int32_t prev_itr = -1;
+
+        if (!_item) {
+          auto ei = db_idx64_end(_idx->get_code().value, _idx->get_scope(),
+                                 _idx->name());
+          check(ei != -1,
+                "cannot decrement end iterator when the index is empty");
+          prev_itr = db_idx64_previous(ei, &prev_pk);
+          check(prev_itr >= 0,
+                "cannot decrement end iterator when the index is empty");
+        } else {
+          if (_item->__iters[Number] == -1) {
+            secondary_key_type temp_secondary_key;
+            auto idxitr = db_idx64_find_primary(
+                _idx->get_code().value, _idx->get_scope(), _idx->name(),
+                &temp_secondary_key, _item->primary_key());
+            auto &mi = const_cast<item &>(*_item);
+            mi.__iters[Number] = idxitr;
+          }
+          prev_itr = db_idx64_previous(_item->__iters[Number], &prev_pk);
+          check(prev_itr >= 0, "cannot decrement iterator at beginning of index");
+        }
+
+        const T &obj = *_idx->_multidx->find(prev_pk);
+        auto &mi = const_cast<item &>(static_cast<const item &>(obj));
+        mi.__iters[Number] = prev_itr;
+        _item = &mi;
+
+        return *this;
+      }
+
+      const_iterator() : _item(nullptr) {}
+
+    private:
+      friend struct index;
+
+      const_iterator(const index *idx, const item *i = nullptr)
+          : _idx(idx), _item(i) {}
+
+      const index *_idx = nullptr;
+      const item *_item;
+    };
+
+    typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
+    const_iterator cbegin() const { return lower_bound(0); }
+    const_iterator begin() const { return cbegin(); }
+
+    const_iterator cend() const { return const_iterator(this); }
+    const_iterator end() const { return cend(); }
+
+    const_reverse_iterator crbegin() const {
+      return std::make_reverse_iterator(cend());
+    }
+    const_reverse_iterator rbegin() const { return crbegin(); }
+
+    const_reverse_iterator crend() const {
+      return std::make_reverse_iterator(cbegin());
+    }
+    const_reverse_iterator rend() const { return crend(); }
+
+    const_iterator find(secondary_key_type secondary) const {
+      auto lb = lower_bound(secondary);
+      auto e = cend();
+      if (lb == e) {
+        return e;
+      }
+
+      if (secondary != secondary_extractor_type()(*lb)) {
+        return e;
+      }
+      return lb;
+    }
+
+    const_iterator require_find(
+        secondary_key_type secondary,
+        const char *error_msg = "unable to find secondary key") const {
+      auto lb = lower_bound(secondary);
+      check(lb != cend(), error_msg);
+      check(secondary == secondary_extractor_type()(*lb), error_msg);
+      return lb;
+    }
+
+    const T &get(secondary_key_type secondary,
+                 const char *error_msg = "unable to find secondary key") const {
+      auto result = find(secondary);
+      check(result != cend(), error_msg);
+      return *result;
+    }
+
+    const_iterator lower_bound(secondary_key_type secondary) const {
+      uint64_t primary = 0;
+      secondary_key_type secondary_copy(secondary);
+      auto itr = internal_use_do_not_use::db_idx64_lowerbound(
+          get_code().value, get_scope(), name(), &secondary_copy, &primary);
+      if (itr < 0) {
+        return cend();
+      }
+
+      const T &obj = *_multidx->find(primary);
+      auto &mi = const_cast<item &>(static_cast<const item &>(obj));
+      mi.__iters[Number] = itr;
+
+      return {this, &mi};
+    }
+
+    const_iterator upper_bound(secondary_key_type secondary) const {
+      uint64_t primary = 0;
+      secondary_key_type secondary_copy(secondary);
+      auto itr = internal_use_do_not_use::db_idx64_upperbound(
+          get_code().value, get_scope(), name(), &secondary_copy, &primary);
+      if (itr < 0) {
+        return cend();
+      }
+
+      const T &obj = *_multidx->find(primary);
+      auto &mi = const_cast<item &>(static_cast<const item &>(obj));
+      mi.__iters[Number] = itr;
+
+      return {this, &mi};
+    }
+
+    const_iterator iterator_to(const T &obj) {
+      const auto &objitem = static_cast<const item &>(obj);
+      check(objitem.__idx == _multidx,
+            "object passed to iterator_to is not in multi_index");
+
+      if (objitem.__iters[Number] == -1) {
+        secondary_key_type temp_secondary_key;
+        auto idxitr = internal_use_do_not_use::db_idx64_find_primary(
+            get_code().value, get_scope(), name(), &temp_secondary_key,
+            objitem.primary_key());
+        auto &mi = const_cast<item &>(objitem);
+        mi.__iters[Number] = idxitr;
+      }
+
+      return {this, &objitem};
+    }
+
+    template <typename Lambda>
+    void modify(const_iterator itr, eosio::name payer, Lambda &&updater) {
+      check(itr != cend(), "cannot pass end iterator to modify");
+
+      _multidx->modify(*itr, payer, std::forward<Lambda &&>(updater));
+    }
+
+    const_iterator erase(const_iterator itr) {
+      check(itr != cend(), "cannot pass end iterator to erase");
+
+      const auto &obj = *itr;
+      ++itr;
+
+      _multidx->erase(obj);
+
+      return itr;
+    }
+
+    eosio::name get_code() const { return _multidx->get_code(); }
+    uint64_t get_scope() const { return _multidx->get_scope(); }
+
+    static auto extract_secondary_key(const T &obj) {
+      return secondary_extractor_type()(obj);
+    }
+
+  private:
+    friend class multi_index;
+
+    // the CDT's get_index() const returns an index that cannot modify - the
+    // contracts only use get_index on tables they can write to
+    index(const multi_index *midx) : _multidx(const_cast<multi_index *>(midx)) {}
+
+    multi_index *_multidx;
+  };
+
+  template <uint64_t I, typename... Idx> struct make_indices;
+
+  template <uint64_t I> struct make_indices<I> { using type = std::tuple<>; };
+
+  template <uint64_t I, typename First, typename... Rest>
+  struct make_indices<I, First, Rest...> {
+    using type = decltype(std::tuple_cat(
+        std::declval<std::tuple<
+            index<static_cast<name::raw>(First::index_name),
+                  typename First::secondary_extractor_type, I>>>(),
+        std::declval<typename make_indices<I + 1, Rest...>::type>()));
+  };
+
+  typedef typename make_indices<0, Indices...>::type indices_type;
+
+  template <typename F, size_t... I>
+  static void for_each_index(F &&f, std::index_sequence<I...>) {
+    (f(static_cast<std::tuple_element_t<I, indices_type> *>(nullptr)), ...);
+  }
+
+  template <typename F> static void for_each_index(F &&f) {
+    for_each_index(std::forward<F>(f),
+                   std::make_index_sequence<sizeof...(Indices)>{});
+  }
+
+  template <uint64_t IndexName, size_t I = 0>
+  static constexpr size_t index_position() {
+    if constexpr (I == sizeof...(Indices)) {
+      return I;
+    } else if constexpr (std::tuple_element_t<I, indices_type>::index_name ==
+                         IndexName) {
+      return I;
+    } else {
+      return index_position<IndexName, I + 1>();
+    }
+  }
+
+  const item &load_object_by_primary_iterator(int32_t itr) const {
+    using namespace internal_use_do_not_use;
+
+    auto itr2 = std::find_if(
+        _items_vector.rbegin(), _items_vector.rend(),
+        [&](const item_ptr &ptr) { return ptr._primary_itr == itr; });
+    if (itr2 != _items_vector.rend()) {
+      return *itr2->_item;
+    }
+
+    auto size = db_get_i64(itr, nullptr, 0);
+    check(size >= 0, "error reading iterator");
+
+    freedao::host::heap_scope heap(freedao::host::heap_category::rows);
+
+    // the CDT reads rows of up to 512 bytes into a stack buffer
+    char stack_buffer[max_stack_buffer_size];
+    char *buffer = max_stack_buffer_size < size_t(size)
+                       ? static_cast<char *>(::operator new(size_t(size)))
+                       : stack_buffer;
+
+    db_get_i64(itr, buffer, uint32_t(size));
+
+    datastream<const char *> ds(buffer, uint32_t(size));
+
+    auto itm = std::make_unique<item>(this, [&](auto &i) {
+      T &val = static_cast<T &>(i);
+      ds >> val;
+
+      i.__primary_itr = itr;
+      for (auto &iter : i.__iters) {
+        iter = -1;
+      }
+    });
+
+    const item *ptr = itm.get();
+    auto pk = itm->primary_key();
+    auto pitr = itm->__primary_itr;
+
+    _items_vector.emplace_back(std::move(itm), pk, pitr);
+
+    if (max_stack_buffer_size < size_t(size)) {
+      ::operator delete(buffer);
+    }
+
+    return *ptr;
+  }
+
+public:
+  multi_index(eosio::name code, uint64_t scope)
+      : _code(code), _scope(scope), _next_primary_key(unset_next_primary_key) {}
+
+  eosio::name get_code() const { return _code; }
+  uint64_t get_scope() const { return _scope; }
+
+  struct const_iterator {
+  public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = const T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const T *;
+    using reference = const T &;
+
+    friend bool operator==(const const_iterator &a, const const_iterator &b) {
+      return a._item == b._item;
+    }
+    friend bool operator!=(const const_iterator &a, const const_iterator &b) {
+      return a._item != b._item;
+    }
+
+    const T &operator*() const { return *static_cast<const T *>(_item); }
+    const T *operator->() const { return static_cast<const T *>(_item); }
+
+    const_iterator operator++(int) {
+      const_iterator result(*this);
+      ++(*this);
+      return result;
+    }
+
+    const_iterator operator--(int) {
+      const_iterator result(*this);
+      --(*this);
+      return result;
+    }
+
+    const_iterator &operator++() {
+      check(_item != nullptr, "cannot increment end iterator");
+
+      uint64_t next_pk;
+      auto next_itr = internal_use_do_not_use::db_next_i64(
+          _item->__primary_itr, &next_pk);
+      if (next_itr < 0) {
+        _item = nullptr;
+      } else {
+        _item = &_multidx->load_object_by_primary_iterator(next_itr);
+      }
+      return *this;
+    }
+
+    const_iterator &operator--() {
+      using namespace internal_use_do_not_use;
+      uint64_t prev_pk;
+      if (!_item) {
+        auto ei = db_end_i64(_multidx->get_code().value,
+                             _multidx->get_scope(),
+                             static_cast<uint64_t>(TableName));
+        check(ei != -1,
+              "cannot decrement end iterator when the table is empty");
+        auto prev_itr = db_previous_i64(ei, &prev_pk);
+        check(prev_itr >= 0,
+              "cannot decrement end iterator when the table is empty");
+        _item = &_multidx->load_object_by_primary_iterator(prev_itr);
+      } else {
+        auto prev_itr = db_previous_i64(_item->__primary_itr, &prev_pk);
+        check(prev_itr >= 0, "cannot decrement iterator at beginning of table");
+        _item = &_multidx->load_object_by_primary_iterator(prev_itr);
+      }
+      return *this;
+    }
+
+    const_iterator() : _item(nullptr) {}
+
+  private:
+    const_iterator(const multi_index *mi, const item *i = nullptr)
+        : _multidx(mi), _item(i) {}
+
+    const multi_index *_multidx = nullptr;
+    const item *_item;
+    friend class multi_index;
+  };
+
+  typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
+  const_iterator cbegin() const { return lower_bound(0); }
+  const_iterator begin() const { return cbegin(); }
+
+  const_iterator cend() const { return const_iterator(this); }
+  const_iterator end() const { return cend(); }
+
+  const_reverse_iterator crbegin() const {
+    return std::make_reverse_iterator(cend());
+  }
+  const_reverse_iterator rbegin() const { return crbegin(); }
+
+  const_reverse_iterator crend() const {
+    return std::make_reverse_iterator(cbegin());
+  }
+  const_reverse_iterator rend() const { return crend(); }
+
+  const_iterator lower_bound(uint64_t primary) const {
+    auto itr = internal_use_do_not_use::db_lowerbound_i64(
+        _code.value, _scope, static_cast<uint64_t>(TableName), primary);
+    if (itr < 0) {
+      return end();
+    }
+    const auto &obj = load_object_by_primary_iterator(itr);
+    return {this, &obj};
+  }
+
+  const_iterator upper_bound(uint64_t primary) const {
+    auto itr = internal_use_do_not_use::db_upperbound_i64(
+        _code.value, _scope, static_cast<uint64_t>(TableName), primary);
+    if (itr < 0) {
+      return end();
+    }
+    const auto &obj = load_object_by_primary_iterator(itr);
+    return {this, &obj};
+  }
+
+  uint64_t available_primary_key() const {
+    if (_next_primary_key == unset_next_primary_key) {
+      // This is the first time available_primary_key() is called for this
+      // multi_index instance.
+      if (begin() == end()) { // empty table
+        _next_primary_key = 0;
+      } else {
+        auto itr = --end(); // Find the last element in the table
+        if (itr->primary_key() < no_available_primary_key) {
+          _next_primary_key = itr->primary_key() + 1;
+        } else {
+          _next_primary_key = no_available_primary_key;
+        }
+      }
+    }
+    check(_next_primary_key < no_available_primary_key,
+          "next primary key in table is at autoincrement limit");
+    return _next_primary_key;
+  }
+
+  template <name::raw IndexName> auto get_index() const {
+    constexpr size_t position =
+        index_position<static_cast<uint64_t>(IndexName)>();
+    static_assert(position < sizeof...(Indices),
+                  "name provided is not the name of any secondary index "
+                  "within multi_index");
+    return std::tuple_element_t<position, indices_type>(this);
+  }
+
+  const_iterator iterator_to(const T &obj) const {
+    const auto &objitem = static_cast<const item &>(obj);
+    check(objitem.__idx == this,
+          "object passed to iterator_to is not in multi_index");
+    return {this, &objitem};
+  }
+
+  template <typename Lambda>
+  const_iterator emplace(eosio::name payer, Lambda &&constructor) {
+    using namespace internal_use_do_not_use;
+
+    check(_code.value == internal_use_do_not_use::current_receiver(),
+          "cannot create objects in table of another contract");
+
+    freedao::host::heap_scope heap(freedao::host::heap_category::rows);
+
+    auto itm = std::make_unique<item>(this, [&](auto &i) {
+      T &obj = static_cast<T &>(i);
+      {
+        // the constructor is the contract's code
+        freedao::host::heap_scope contract_heap(
+            freedao::host::heap_category::contract);
+        constructor(obj);
+      }
+
+      size_t size = pack_size(obj);
+
+      char stack_buffer[max_stack_buffer_size];
+      char *buffer = max_stack_buffer_size < size
+                         ? static_cast<char *>(::operator new(size))
+                         : stack_buffer;
+
+      datastream<char *> ds(buffer, size);
+      ds << obj;
+
+      auto pk = obj.primary_key();
+
+      i.__primary_itr = db_store_i64(_scope, static_cast<uint64_t>(TableName),
+                                     payer.value, pk, buffer, size);
+
+      if (max_stack_buffer_size < size) {
+        ::operator delete(buffer);
+      }
+
+      if (pk >= _next_primary_key) {
+        _next_primary_key =
+            (pk >= no_available_primary_key) ? no_available_primary_key
+                                             : (pk + 1);
+      }
+
+      for_each_index([&](auto *idx) {
+        typedef std::remove_pointer_t<decltype(idx)> index_type;
+        uint64_t secondary = index_type::extract_secondary_key(obj);
+        i.__iters[index_type::number()] =
+            db_idx64_store(_scope, index_type::name(), payer.value,
+                           obj.primary_key(), &secondary);
+      });
+    });
+
+    const item *ptr = itm.get();
+    auto pk = itm->primary_key();
+    auto pitr = itm->__primary_itr;
+
+    _items_vector.emplace_back(std::move(itm), pk, pitr);
+
+    return {this, ptr};
+  }
+
+  template <typename Lambda>
+  void modify(const_iterator itr, eosio::name payer, Lambda &&updater) {
+    check(itr != end(), "cannot pass end iterator to modify");
+
+    modify(*itr, payer, std::forward<Lambda &&>(updater));
+  }
+
+  template <typename Lambda>
+  void modify(const T &obj, eosio::name payer, Lambda &&updater) {
+    using namespace internal_use_do_not_use;
+
+    const auto &objitem = static_cast<const item &>(obj);
+    check(objitem.__idx == this,
+          "object passed to modify is not in this multi_index");
+    auto &mutableitem = const_cast<item &>(objitem);
+    check(_code.value == internal_use_do_not_use::current_receiver(),
+          "cannot modify objects in table of another contract");
+
+    auto pk = obj.primary_key();
+
+    uint64_t secondary_keys[sizeof...(Indices) + (sizeof...(Indices) == 0)];
+    for_each_index([&](auto *idx) {
+      typedef std::remove_pointer_t<decltype(idx)> index_type;
+      secondary_keys[index_type::number()] =
+          index_type::extract_secondary_key(obj);
+    });
+
+    updater(static_cast<T &>(mutableitem));
+
+    check(pk == obj.primary_key(),
+          "updater cannot change primary key when modifying an object");
+
+    size_t size = pack_size(obj);
+
+    char stack_buffer[max_stack_buffer_size];
+    char *buffer;
+    {
+      freedao::host::heap_scope heap(freedao::host::heap_category::rows);
+      buffer = max_stack_buffer_size < size
+                   ? static_cast<char *>(::operator new(size))
+                   : stack_buffer;
+    }
+
+    datastream<char *> ds(buffer, size);
+    ds << obj;
+
+    db_update_i64(objitem.__primary_itr, payer.value, buffer, size);
+
+    if (max_stack_buffer_size < size) {
+      ::operator delete(buffer);
+    }
+
+    if (pk >= _next_primary_key) {
+      _next_primary_key = (pk >= no_available_primary_key)
+                              ? no_available_primary_key
+                              : (pk + 1);
+    }
+
+    for_each_index([&](auto *idx) {
+      typedef std::remove_pointer_t<decltype(idx)> index_type;
+      uint64_t secondary = index_type::extract_secondary_key(obj);
+      if (secondary != secondary_keys[index_type::number()]) {
+        auto indexitr = mutableitem.__iters[index_type::number()];
+
+        if (indexitr < 0) {
+          uint64_t temp_secondary_key;
+          indexitr = mutableitem.__iters[index_type::number()] =
+              db_idx64_find_primary(_code.value, _scope, index_type::name(),
+                                    &temp_secondary_key, pk);
+        }
+
+        db_idx64_update(indexitr, payer.value, &secondary);
+      }
+    });
+  }
+
+  const T &get(uint64_t primary,
+               const char *error_msg = "unable to find key") const {
+    auto result = find(primary);
+    check(result != cend(), error_msg);
+    return *result;
+  }
+
+  const_iterator find(uint64_t primary) const {
+    auto itr2 = std::find_if(_items_vector.rbegin(), _items_vector.rend(),
+                             [&](const item_ptr &ptr) {
+                               return ptr._item->primary_key() == primary;
+                             });
+    if (itr2 != _items_vector.rend()) {
+      return iterator_to(*(itr2->_item));
+    }
+
+    auto itr = internal_use_do_not_use::db_find_i64(
+        _code.value, _scope, static_cast<uint64_t>(TableName), primary);
+    if (itr < 0) {
+      return end();
+    }
+
+    const item &i = load_object_by_primary_iterator(itr);
+    return iterator_to(static_cast<const T &>(i));
+  }
+
+  const_iterator require_find(uint64_t primary,
+                              const char *error_msg = "unable to find key") const {
+    auto itr2 = std::find_if(_items_vector.rbegin(), _items_vector.rend(),
+                             [&](const item_ptr &ptr) {
+                               return ptr._item->primary_key() == primary;
+                             });
+    if (itr2 != _items_vector.rend()) {
+      return iterator_to(*(itr2->_item));
+    }
+
+    auto itr = internal_use_do_not_use::db_find_i64(
+        _code.value, _scope, static_cast<uint64_t>(TableName), primary);
+    check(itr >= 0, error_msg);
+
+    const item &i = load_object_by_primary_iterator(itr);
+    return iterator_to(static_cast<const T &>(i));
+  }
+
+  const_iterator erase(const_iterator itr) {
+    check(itr != end(), "cannot pass end iterator to erase");
+
+    const auto &obj = *itr;
+    ++itr;
+
+    erase(obj);
+
+    return itr;
+  }
+
+  void erase(const T &obj) {
+    using namespace internal_use_do_not_use;
+
+    const auto &objitem = static_cast<const item &>(obj);
+    check(objitem.__idx == this,
+          "object passed to erase is not in this multi_index");
+    check(_code.value == internal_use_do_not_use::current_receiver(),
+          "cannot erase objects in table of another contract");
+
+    auto pk = objitem.primary_key();
+    auto itr2 = std::find_if(
+        _items_vector.rbegin(), _items_vector.rend(),
+        [&](const item_ptr &ptr) { return ptr._item->primary_key() == pk; });
+
+    check(itr2 != _items_vector.rend(),
+          "attempt to remove object that was not in multi_index");
+
+    db_remove_i64(objitem.__primary_itr);
+
+    for_each_index([&](auto *idx) {
+      typedef std::remove_pointer_t<decltype(idx)> index_type;
+      auto i = objitem.__iters[index_type::number()];
+      if (i < 0) {
+        uint64_t secondary;
+        i = db_idx64_find_primary(_code.value, _scope, index_type::name(),
+                                  &secondary, objitem.primary_key());
+      }
+      if (i >= 0) {
+        db_idx64_remove(i);
+      }
+    });
+
+    _items_vector.erase(--(itr2.base()));
+  }
+};
+
+} // namespace eosio
@@ -0,0 +1,57 @@
+#pragma once
+
+// eosio::print for the host build - the text goes to the action's console,
+// which the host chain keeps in the action trace.
+
+#include "asset.hpp"
+#include "intrinsics.hpp"
+#include "name.hpp"
+#include "symbol.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace eosio {
+
+inline void printl(const char *ptr, size_t len) {
+  internal_use_do_not_use::prints_l(ptr, uint32_t(len));
+}
+
+inline void print(const char *ptr) { printl(ptr, std::strlen(ptr)); }
+inline void print(const std::string &s) { printl(s.data(), s.size()); }
+inline void print(std::string_view s) { printl(s.data(), s.size()); }
+inline void print(char c) { printl(&c, 1); }
+inline void print(bool b) { print(b ? "true" : "false"); }
+inline void print(name n) { print(n.to_string()); }
+inline void print(symbol_code s) { print(s.to_string()); }
+inline void print(symbol s) {
+  print(std::to_string(s.precision()) + "," + s.code().to_string());
+}
+inline void print(const asset &a) { print(a.to_string()); }
+
+template <typename T,
+          std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool> &&
+                               !std::is_same_v<T, char>,
+                           int> = 0>
+void print(T num) {
+  print(std::to_string(num));
+}
+
+inline void print(double d) {
+  char buffer[32];
+  int length = std::snprintf(buffer, sizeof(buffer), "%.15e", d);
+  printl(buffer, size_t(length));
+}
+inline void print(float f) { print(double(f)); }
+
+template <typename Arg, typename... Args>
+void print(Arg &&a, Args &&...args) {
+  print(std::forward<Arg>(a));
+  print(std::forward<Args>(args)...);
+}
+
+} // namespace eosio
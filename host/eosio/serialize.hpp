@@ -0,0 +1,27 @@
+#pragma once
+
+// EOSLIB_SERIALIZE for the host build. Instead of the CDT's stream operators
+// it gives the struct an eosio_for_each_field member, which datastream.hpp
+// serializes through - the same fields in the same order.
+
+#define HOST_REFLECT_A(x)                                                      \
+  f(t.x);                                                                      \
+  HOST_REFLECT_B
+#define HOST_REFLECT_B(x)                                                      \
+  f(t.x);                                                                      \
+  HOST_REFLECT_A
+#define HOST_REFLECT_A_END
+#define HOST_REFLECT_B_END
+#define HOST_REFLECT_CAT(a, b) HOST_REFLECT_CAT_(a, b)
+#define HOST_REFLECT_CAT_(a, b) a##b
+#define HOST_REFLECT_MEMBERS(seq) HOST_REFLECT_CAT(HOST_REFLECT_A seq, _END)
+
+#define EOSLIB_SERIALIZE(TYPE, MEMBERS)                                        \
+  template <typename F> void eosio_for_each_field(F &&f) {                     \
+    auto &t = *this;                                                           \
+    HOST_REFLECT_MEMBERS(MEMBERS)                                              \
+  }                                                                            \
+  template <typename F> void eosio_for_each_field(F &&f) const {               \
+    auto &t = *this;                                                           \
+    HOST_REFLECT_MEMBERS(MEMBERS)                                              \
+  }
@@ -0,0 +1,21 @@
+#pragma once
+
+// eosio::current_time_point and friends for the host build - the time is the
+// host chain's clock, which a test sets (freeoshost.hpp).
+
+#include "check.hpp"
+#include "intrinsics.hpp"
+#include "time.hpp"
+
+namespace eosio {
+
+inline time_point current_time_point() {
+  return time_point(microseconds(
+      static_cast<int64_t>(internal_use_do_not_use::current_time())));
+}
+
+inline time_point_sec current_block_time() {
+  return time_point_sec(current_time_point());
+}
+
+} // namespace eosio
@@ -0,0 +1,122 @@
+// A freeos system ready for users - see bootstrap_freeos in freeoshost.hpp.
+
+#include "freeoshost.hpp"
+
+#include "../common/freeoscommon.hpp"
+
+#include <string>
+
+namespace freedao {
+namespace host {
+
+namespace {
+
+// the most of each token there can be
+constexpr int64_t max_token_supply = 350000000;   // POINT, FREEOS
+constexpr int64_t max_airkey_supply = 1000000;    // AIRKEY
+constexpr int64_t max_system_supply = 1000000000; // the stake currency
+
+eosio::asset units(int64_t whole, eosio::symbol sym) {
+  int64_t amount = whole;
+  for (uint8_t i = 0; i < sym.precision(); i++) {
+    amount *= 10;
+  }
+  return eosio::asset(amount, sym);
+}
+
+void set_parameter(chain &c, const char *paramname, const std::string &value) {
+  expect_success(c.push(freeosconfig_account(), eosio::name("paramupsert"),
+                        freeosconfig_account(), eosio::name(),
+                        eosio::name(paramname), value));
+}
+
+} // namespace
+
+void expect_success(const transaction_trace &trace) {
+  if (!trace.succeeded) {
+    throw eosio::check_failure(trace.error);
+  }
+}
+
+void bootstrap_freeos(chain &c, const system_config &config) {
+  deploy_freeos(c);
+
+  const eosio::name freeos = freeos_account();
+  const eosio::name freeosconfig = freeosconfig_account();
+  const eosio::name freeostokens = freeostokens_account();
+  const eosio::name system_token = system_token_account();
+
+  // the tokens
+  expect_success(c.push(freeos, eosio::name("create"), freeos, freeos,
+                        units(max_token_supply, point_symbol())));
+  expect_success(c.push(freeos, eosio::name("create"), freeos, freeos,
+                        units(max_airkey_supply, airkey_symbol())));
+  expect_success(c.push(freeostokens, eosio::name("create"), freeostokens,
+                        freeos, units(max_token_supply, freeos_symbol())));
+  expect_success(c.push(system_token, eosio::name("create"), system_token,
+                        system_token,
+                        units(max_system_supply, system_symbol())));
+
+  // the parameters
+  set_parameter(c, "masterswitch", "1");
+  set_parameter(c, "vestpercent", std::to_string(config.vest_percent));
+  set_parameter(c, "unstakesnum", std::to_string(config.unstakes_per_tick));
+
+  for (const auto &band : config.stake_bands) {
+    expect_success(c.push(freeosconfig, eosio::name("stakeupsert"),
+                          freeosconfig, band.threshold, uint32_t(0),
+                          uint32_t(0), uint32_t(0), band.requirement_d,
+                          band.requirement_e, uint32_t(0), band.requirement_v,
+                          uint32_t(0), uint32_t(0), uint32_t(0)));
+  }
+
+  // the iterations - each ends a second before the next starts
+  for (uint32_t i = 1; i <= config.iterations; i++) {
+    eosio::time_point start =
+        config.start + eosio::microseconds(config.iteration_length.count() *
+                                           int64_t(i - 1));
+    eosio::time_point end =
+        start + config.iteration_length - eosio::seconds(1);
+    expect_success(c.push(freeosconfig, eosio::name("iterupsert"),
+                          freeosconfig, i, start, end, config.claim_amount,
+                          config.tokens_required));
+  }
+
+  c.set_time(config.start);
+}
+
+void set_verification(chain &c, eosio::name user,
+                      const std::vector<std::string> &kyc_levels) {
+  c.create_account(user);
+  eosio::name verifier = verification_account();
+  c.run_as(verifier, [&] {
+    usersinfo verification_table(verifier, verifier.value);
+    auto record = verification_table.find(user.value);
+    auto set = [&](userinfo &info) {
+      info.acc = user;
+      info.kyc.clear();
+      for (const auto &level : kyc_levels) {
+        info.kyc.push_back(kyc_prov{verifier, level, 0});
+      }
+    };
+    if (record == verification_table.end()) {
+      verification_table.emplace(verifier, set);
+    } else {
+      verification_table.modify(record, verifier, set);
+    }
+  });
+}
+
+void fund_user(chain &c, eosio::name user, const eosio::asset &quantity) {
+  c.create_account(user);
+  eosio::name system_token = system_token_account();
+  expect_success(c.push_transaction(
+      {chain::make_action(system_token, eosio::name("issue"), system_token,
+                          system_token, quantity, std::string("fund")),
+       chain::make_action(system_token, eosio::name("transfer"), system_token,
+                          system_token, user, quantity,
+                          std::string("fund"))}));
+}
+
+} // namespace host
+} // namespace freedao
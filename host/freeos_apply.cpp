@@ -0,0 +1,73 @@
+// The freeos contract in the host build: freeos.cpp itself, and the apply
+// function cdt-cpp would generate from its [[eosio::action]] and
+// [[eosio::on_notify]] attributes.
+
+#include "../freeos/freeos.cpp"
+
+#include "freeoshost.hpp"
+
+namespace freedao {
+namespace host {
+
+void apply_freeos(uint64_t receiver, uint64_t code, uint64_t action) {
+  eosio::name self(receiver);
+  eosio::name first_receiver(code);
+
+  if (receiver == code) {
+    switch (action) {
+#define FREEOS_ACTION(handler)                                                 \
+  case eosio::name(#handler).value:                                            \
+    eosio::execute_action(self, first_receiver, &freeos::handler);             \
+    break;
+      FREEOS_ACTION(version)
+      FREEOS_ACTION(tick)
+      FREEOS_ACTION(cron)
+      FREEOS_ACTION(reguser)
+      FREEOS_ACTION(refundstake)
+      FREEOS_ACTION(deregister)
+      FREEOS_ACTION(unstake)
+      FREEOS_ACTION(create)
+      FREEOS_ACTION(convert)
+      FREEOS_ACTION(convreq)
+      FREEOS_ACTION(convsettle)
+      FREEOS_ACTION(convcancel)
+      FREEOS_ACTION(claim)
+      FREEOS_ACTION(unvest)
+      FREEOS_ACTION(depositclear)
+      FREEOS_ACTION(unstakecncl)
+      FREEOS_ACTION(reverify)
+      FREEOS_ACTION(allocate)
+      FREEOS_ACTION(mint)
+      FREEOS_ACTION(burn)
+      FREEOS_ACTION(allocmany)
+      FREEOS_ACTION(mintmany)
+      FREEOS_ACTION(getclaimq)
+      FREEOS_ACTION(getuser)
+      FREEOS_ACTION(getstats)
+      FREEOS_ACTION(aggset)
+#undef FREEOS_ACTION
+    default:
+      // what the generated dispatcher does with an unknown action
+      eosio::check(false, uint64_t(1));
+    }
+  } else if (first_receiver == eosio::name(SYSTEM_CURRENCY_CONTRACT) &&
+             action == "transfer"_n.value) {
+    eosio::execute_action(self, first_receiver, &freeos::stake);
+  }
+}
+
+eosio::name freeos_account() { return eosio::name(freeos_acct); }
+eosio::name freeosconfig_account() { return eosio::name(freeosconfig_acct); }
+eosio::name freeostokens_account() { return eosio::name(freeostokens_acct); }
+eosio::name freedao_account() { return eosio::name(freedao_acct); }
+eosio::name system_token_account() {
+  return eosio::name(SYSTEM_CURRENCY_CONTRACT);
+}
+eosio::name verification_account() { return VERIFICATION_CONTRACT; }
+eosio::symbol system_symbol() { return SYSTEM_CURRENCY_SYMBOL; }
+eosio::symbol point_symbol() { return NON_EXCHANGEABLE_SYMBOL; }
+eosio::symbol freeos_symbol() { return EXCHANGEABLE_SYMBOL; }
+eosio::symbol airkey_symbol() { return AIRKEY_SYMBOL; }
+
+} // namespace host
+} // namespace freedao
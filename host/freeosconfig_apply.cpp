@@ -0,0 +1,54 @@
+// The freeosconfig contract in the host build: freeosconfig.cpp itself, and
+// the apply function cdt-cpp would generate from its [[eosio::action]]
+// attributes.
+
+#include "../freeosconfig/freeosconfig.cpp"
+
+#include "freeoshost.hpp"
+
+namespace freedao {
+namespace host {
+
+void apply_freeosconfig(uint64_t receiver, uint64_t code, uint64_t action) {
+  eosio::name self(receiver);
+  eosio::name first_receiver(code);
+
+  if (receiver != code) {
+    return;
+  }
+
+  switch (action) {
+#define FREEOSCONFIG_ACTION(handler)                                           \
+  case eosio::name(#handler).value:                                            \
+    eosio::execute_action(self, first_receiver, &freeosconfig::handler);       \
+    break;
+    FREEOSCONFIG_ACTION(version)
+    FREEOSCONFIG_ACTION(paramupsert)
+    FREEOSCONFIG_ACTION(paramerase)
+    FREEOSCONFIG_ACTION(stakeupsert)
+    FREEOSCONFIG_ACTION(stakeerase)
+    FREEOSCONFIG_ACTION(iterupsert)
+    FREEOSCONFIG_ACTION(itererase)
+    FREEOSCONFIG_ACTION(iterclear)
+    FREEOSCONFIG_ACTION(currentrate)
+    FREEOSCONFIG_ACTION(targetrate)
+    FREEOSCONFIG_ACTION(rateerase)
+    FREEOSCONFIG_ACTION(transfadd)
+    FREEOSCONFIG_ACTION(transferase)
+    FREEOSCONFIG_ACTION(minteradd)
+    FREEOSCONFIG_ACTION(mintererase)
+    FREEOSCONFIG_ACTION(burneradd)
+    FREEOSCONFIG_ACTION(burnererase)
+#ifdef TEST_BUILD
+    FREEOSCONFIG_ACTION(userverify)
+    FREEOSCONFIG_ACTION(addkyc)
+#endif
+#undef FREEOSCONFIG_ACTION
+  default:
+    // what the generated dispatcher does with an unknown action
+    eosio::check(false, uint64_t(1));
+  }
+}
+
+} // namespace host
+} // namespace freedao
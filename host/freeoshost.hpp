@@ -0,0 +1,339 @@
+#pragma once
+
+// The host chain - a native stand-in for nodeos that runs the freeos,
+// freeosconfig and token contracts compiled with g++ against the eosio shim
+// headers in host/eosio. The contracts are the real sources
+// (freeos/freeos.cpp, freeosconfig/freeosconfig.cpp), not models of them, so
+// the tools built on this (freeosbench, freeossim, freeosreplay, freeosflow,
+// freeosdiff, freeosfuzz) and the host tests follow the contracts as they
+// change.
+//
+// What it implements of nodeos:
+// - tables with primary and uint64_t secondary indices, with nodeos's
+//   iterator semantics (end iterators, next/previous) and RAM billing (a row
+//   is its size + 108 bytes, an index entry 128, a table 108),
+// - actions: the receiver, then the accounts it notified with
+//   require_recipient, in order, then its inline actions, depth first, to a
+//   depth of 4,
+// - authorization: require_auth and has_auth check the action's
+//   authorizations. An inline action can only be authorized by the contract
+//   that sends it, and in a notification RAM can only be billed to the
+//   receiver.
+// - transactions: a failed check undoes every change the transaction made,
+// - read-only transactions, in which table writes and inline actions fail,
+// - a clock the caller sets.
+// It does not verify signatures, bill CPU or NET, or implement the system
+// contracts.
+//
+// Every receiver execution is costed: table intrinsic calls, bytes packed and
+// unpacked, heap allocations, inline actions, notifications, RAM and wall
+// time. See counters.
+//
+// A chain is used by one thread at a time; separate chains can run on
+// separate threads.
+
+#include <eosio/eosio.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace freedao {
+namespace host {
+
+// the cost of a receiver's execution of an action, as counted by the host
+// chain's intrinsics
+struct counters {
+  // primary index intrinsics
+  uint64_t finds = 0;        // db_find_i64
+  uint64_t lower_bounds = 0; // db_lowerbound_i64, db_upperbound_i64, db_end_i64
+  uint64_t nexts = 0;        // db_next_i64, db_previous_i64
+  uint64_t gets = 0;         // db_get_i64 row reads (not size queries)
+  uint64_t stores = 0;       // db_store_i64
+  uint64_t updates = 0;      // db_update_i64
+  uint64_t removes = 0;      // db_remove_i64
+
+  // secondary index intrinsics
+  uint64_t idx_finds = 0;        // db_idx64_find_primary, find_secondary
+  uint64_t idx_lower_bounds = 0; // db_idx64_lowerbound, upperbound, end
+  uint64_t idx_nexts = 0;        // db_idx64_next, previous
+  uint64_t idx_stores = 0;
+  uint64_t idx_updates = 0;
+  uint64_t idx_removes = 0;
+
+  uint64_t bytes_unpacked = 0; // action data and rows read
+  uint64_t bytes_packed = 0;   // rows written, inline actions, return values
+
+  // heap allocations by heap_category - [heap_category::none] is unused
+  uint64_t heap_allocs[4] = {};
+  uint64_t heap_bytes = 0; // bytes allocated, all categories
+  uint64_t heap_peak = 0;  // the most bytes allocated and not freed at once
+
+  uint64_t inline_actions = 0; // send_inline
+  uint64_t notifications = 0;  // require_recipient of a new recipient
+  int64_t ram_bytes = 0;       // RAM billed, less RAM refunded
+  uint64_t wall_ns = 0;        // host time, including the host chain's
+
+  uint64_t db_reads() const {
+    return finds + lower_bounds + nexts + idx_finds + idx_lower_bounds +
+           idx_nexts;
+  }
+  uint64_t db_writes() const {
+    return stores + updates + removes + idx_stores + idx_updates + idx_removes;
+  }
+  uint64_t heap_allocations() const {
+    return heap_allocs[size_t(heap_category::contract)] +
+           heap_allocs[size_t(heap_category::rows)] +
+           heap_allocs[size_t(heap_category::args)];
+  }
+  uint64_t heap_allocations(heap_category category) const {
+    return heap_allocs[size_t(category)];
+  }
+
+  counters &operator+=(const counters &other);
+};
+
+// an action's execution by one receiver
+struct action_trace {
+  eosio::name receiver;
+  eosio::name account; // the action's contract - receiver unless notified
+  eosio::name action;
+  uint32_t depth = 0; // 0 for the transaction's actions, +1 per inline level
+  counters cost;
+  std::string console;
+  std::vector<char> return_value;
+};
+
+struct transaction_trace {
+  bool succeeded = false;
+  std::string error; // the failed check's message
+  std::vector<action_trace> actions;
+
+  counters total() const;
+
+  // the return value of the i'th action trace that has one
+  template <typename T> T return_value(size_t i = 0) const {
+    for (const auto &trace : actions) {
+      if (!trace.return_value.empty() && i-- == 0) {
+        return eosio::unpack<T>(trace.return_value);
+      }
+    }
+    eosio::check(false, "no action return value");
+    return T{};
+  }
+};
+
+// a contract's entry point - the apply function cdt-cpp generates
+using apply_function = void (*)(uint64_t receiver, uint64_t code,
+                                uint64_t action);
+
+class chain {
+public:
+  chain();
+  ~chain();
+
+  chain(const chain &) = delete;
+  chain &operator=(const chain &) = delete;
+
+  // accounts and contracts
+  void create_account(eosio::name account);
+  bool is_account(eosio::name account) const;
+  void set_contract(eosio::name account, apply_function apply);
+
+  // the clock - current_time_point() in the contracts
+  void set_time(eosio::time_point now);
+  eosio::time_point time() const;
+  void advance(eosio::microseconds interval) { set_time(time() + interval); }
+
+  // push a transaction of one or more actions
+  transaction_trace push_transaction(const std::vector<eosio::action> &actions,
+                                     bool read_only = false);
+  transaction_trace push_action(const eosio::action &action) {
+    return push_transaction({action});
+  }
+  transaction_trace push_read_only(const eosio::action &action) {
+    return push_transaction({action}, true);
+  }
+
+  // deliver action to receiver as a notification of the action's account,
+  // as the account's require_recipient(receiver) would - e.g. a token
+  // transfer to a contract, without the token contract. Receiver's own
+  // require_recipient and inline actions run as usual.
+  transaction_trace push_notification(eosio::name receiver,
+                                      const eosio::action &action);
+
+  // push an action authorized by actor@active
+  template <typename... Args>
+  transaction_trace push(eosio::name account, eosio::name action,
+                         eosio::name actor, Args &&...args) {
+    return push_action(make_action(account, action, actor,
+                                   std::forward<Args>(args)...));
+  }
+
+  template <typename... Args>
+  static eosio::action make_action(eosio::name account, eosio::name action,
+                                   eosio::name actor, Args &&...args) {
+    return eosio::action(eosio::permission_level{actor, eosio::name("active")},
+                         account, action,
+                         std::make_tuple(std::forward<Args>(args)...));
+  }
+
+  // run f as contract code of receiver, outside of any action - e.g. to set
+  // up a fixture with the contract's own table types, which keeps their
+  // secondary indices and RAM billing right. Nothing is costed. A failed check
+  // throws eosio::check_failure, after undoing f's changes.
+  void run_as(eosio::name receiver, const std::function<void()> &f);
+
+  // the database, for tools and tests
+  std::optional<std::vector<char>> row_data(eosio::name code, uint64_t scope,
+                                            eosio::name table,
+                                            uint64_t primary_key) const;
+
+  template <typename T>
+  std::optional<T> get_row(eosio::name code, uint64_t scope, eosio::name table,
+                           uint64_t primary_key) const {
+    auto data = row_data(code, scope, table, primary_key);
+    if (!data) {
+      return std::nullopt;
+    }
+    return eosio::unpack<T>(*data);
+  }
+
+  // a table's rows in primary key order
+  template <typename T>
+  std::vector<T> get_table(eosio::name code, uint64_t scope,
+                           eosio::name table) const {
+    std::vector<T> rows;
+    for_each_row(code, table, scope,
+                 [&](uint64_t, uint64_t, eosio::name,
+                     const std::vector<char> &data) {
+                   rows.push_back(eosio::unpack<T>(data));
+                 });
+    return rows;
+  }
+
+  using row_visitor =
+      std::function<void(uint64_t scope, uint64_t primary_key,
+                         eosio::name payer, const std::vector<char> &data)>;
+
+  // the rows of a table in every scope (scope and then primary key order),
+  // or in one scope
+  void for_each_row(eosio::name code, eosio::name table,
+                    const row_visitor &visit) const;
+  void for_each_row(eosio::name code, eosio::name table, uint64_t scope,
+                    const row_visitor &visit) const;
+
+  // every table with rows - the index tables of secondary indices are not
+  // included
+  void for_each_table(const std::function<void(eosio::name code, uint64_t scope,
+                                               eosio::name table,
+                                               size_t rows)> &visit) const;
+
+  std::vector<uint64_t> scopes(eosio::name code, eosio::name table) const;
+  size_t row_count(eosio::name code, uint64_t scope, eosio::name table) const;
+
+  // write a row directly. Secondary indices are not updated, so this is only
+  // for tables without them (e.g. the single row freeos tables).
+  void set_row_data(eosio::name code, uint64_t scope, eosio::name table,
+                    eosio::name payer, uint64_t primary_key,
+                    const std::vector<char> &data);
+
+  // RAM billed to an account
+  int64_t ram_usage(eosio::name account) const;
+
+  // Sessions: checkpoint starts one, rollback undoes every change since the
+  // matching checkpoint, commit keeps them. Sessions nest.
+  void checkpoint();
+  void rollback();
+  void commit();
+  size_t session_depth() const;
+
+  // Snapshots: snapshot returns the accounts, the clock and the database
+  // (tables, secondary indices and RAM billed) as bytes, and restore replaces
+  // them with a snapshot's. Contracts are not included - set them before or
+  // after restoring. The layout is that of the host that wrote it. Neither
+  // can be used with a session open; restore throws eosio::check_failure,
+  // leaving the chain as it was, if data is not a snapshot of this version.
+  std::vector<char> snapshot() const;
+  void restore(const char *data, size_t size);
+
+  struct impl;
+
+private:
+  std::unique_ptr<impl> my;
+};
+
+// the contracts of the host build (freeos_apply.cpp, freeosconfig_apply.cpp,
+// token.cpp)
+void apply_freeos(uint64_t receiver, uint64_t code, uint64_t action);
+void apply_freeosconfig(uint64_t receiver, uint64_t code, uint64_t action);
+void apply_token(uint64_t receiver, uint64_t code, uint64_t action);
+
+// the accounts and symbols the contracts were built with - they depend on
+// the build's -DFREEOS... and -DTEST_BUILD flags (host/compile.sh)
+eosio::name freeos_account();
+eosio::name freeosconfig_account();
+eosio::name freeostokens_account();
+eosio::name freedao_account();
+eosio::name system_token_account(); // the stake currency contract
+eosio::name verification_account(); // eosio.proton
+eosio::symbol system_symbol();      // XUSDC, XPR in a test build
+eosio::symbol point_symbol();
+eosio::symbol freeos_symbol();
+eosio::symbol airkey_symbol();
+
+// create the accounts and deploy the contracts of a freeos system: freeos,
+// freeosconfig, the freeostokens token contract, the stake currency token
+// contract, the freedao account and eosio.proton (no contract - its
+// usersinfo table is written with run_as)
+void deploy_freeos(chain &c);
+
+// a band of the freeosconfig stakereqs table, in whole stake currency units
+struct stake_band {
+  uint64_t threshold; // applies from this number of registered users
+  uint32_t requirement_v;
+  uint32_t requirement_d;
+  uint32_t requirement_e;
+};
+
+// the freeosconfig records of a freeos system - see bootstrap_freeos
+struct system_config {
+  eosio::time_point start =
+      eosio::time_point(eosio::seconds(1640995200)); // 2022-01-01
+  uint32_t iterations = 52;
+  eosio::microseconds iteration_length = eosio::days(7);
+  uint16_t claim_amount = 100;
+  uint16_t tokens_required = 0;
+  uint8_t vest_percent = 50;      // 'vestpercent' - no exchangerate record
+  uint16_t unstakes_per_tick = 3; // 'unstakesnum'
+  std::vector<stake_band> stake_bands = {{0, 0, 10, 20}};
+};
+
+// deploy a freeos system (deploy_freeos) and make it ready for users: the
+// POINT, AIRKEY, FREEOS and stake currency tokens created, the masterswitch
+// on, the freeosconfig parameters, stakereqs and iterations set from config,
+// and the clock at the start of iteration 1. A failed setup action throws
+// eosio::check_failure.
+void bootstrap_freeos(chain &c, const system_config &config = {});
+
+// give user a usersinfo record in the verification contract with one KYC
+// entry per kyc_levels string - "firstname,lastname" makes a 'v' account, an
+// empty list a 'd' account. A user without a record is an 'e' account.
+void set_verification(chain &c, eosio::name user,
+                      const std::vector<std::string> &kyc_levels);
+
+// create user's account (if need be) and issue it quantity of the stake
+// currency
+void fund_user(chain &c, eosio::name user, const eosio::asset &quantity);
+
+// push an action and throw eosio::check_failure with its error if it fails -
+// for setup steps that must succeed
+void expect_success(const transaction_trace &trace);
+
+} // namespace host
+} // namespace freedao
@@ -0,0 +1,96 @@
+#pragma once
+
+// A minimal test harness for the host tests (test_*.cpp, run by test.sh).
+// HOST_TEST(name) { ... } defines a test, EXPECT(condition) and
+// EXPECT_EQ(a, b) record a failure and go on, and a test that throws fails.
+// Include it in one translation unit per test program - it defines main.
+
+#include "freeoshost.hpp"
+
+#include <cstdio>
+#include <exception>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace freedao {
+namespace host {
+namespace test {
+
+struct test_case {
+  const char *name;
+  void (*run)();
+};
+
+inline std::vector<test_case> &test_cases() {
+  static std::vector<test_case> cases;
+  return cases;
+}
+
+inline int &failures() {
+  static int count = 0;
+  return count;
+}
+
+struct registration {
+  registration(const char *name, void (*run)()) {
+    test_cases().push_back({name, run});
+  }
+};
+
+inline void fail(const char *file, int line, const std::string &message) {
+  std::fprintf(stderr, "%s:%d: %s\n", file, line, message.c_str());
+  failures()++;
+}
+
+template <typename A, typename B>
+void expect_eq(const A &a, const B &b, const char *expression, const char *file,
+               int line) {
+  if (!(a == b)) {
+    std::ostringstream message;
+    message << expression << ": " << a << " != " << b;
+    fail(file, line, message.str());
+  }
+}
+
+} // namespace test
+} // namespace host
+} // namespace freedao
+
+#define HOST_TEST(name)                                                        \
+  static void name();                                                          \
+  static ::freedao::host::test::registration name##_registration(#name,        \
+                                                                 name);        \
+  static void name()
+
+#define EXPECT(condition)                                                      \
+  ((condition) ? (void)0                                                       \
+               : ::freedao::host::test::fail(__FILE__, __LINE__,               \
+                                             "expected " #condition))
+
+#define EXPECT_EQ(a, b)                                                        \
+  ::freedao::host::test::expect_eq((a), (b), #a " == " #b, __FILE__, __LINE__)
+
+// a transaction that should succeed - its error if it did not
+#define EXPECT_SUCCESS(trace)                                                  \
+  do {                                                                         \
+    const auto &expect_trace = (trace);                                        \
+    if (!expect_trace.succeeded) {                                             \
+      ::freedao::host::test::fail(__FILE__, __LINE__,                          \
+                                  #trace " failed: " + expect_trace.error);    \
+    }                                                                          \
+  } while (0)
+
+int main() {
+  using namespace freedao::host::test;
+  for (const auto &test : test_cases()) {
+    int before = failures();
+    try {
+      test.run();
+    } catch (const std::exception &e) {
+      fail(test.name, 0, std::string("threw ") + e.what());
+    }
+    std::printf("%s %s\n", failures() == before ? "ok  " : "FAIL", test.name);
+  }
+  return failures() == 0 ? 0 : 1;
+}
@@ -0,0 +1,16 @@
+# Build libfreeoshost.a (compile.sh) and run the host tests, test_*.cpp - one
+# program each. Arguments are passed to the compiler, e.g. -DTEST_BUILD to
+# test a test build.
+set -e
+cd "$(dirname "$0")"
+./compile.sh "$@"
+FLAGS="-std=c++17 -O2 -Wno-attributes -I. -DFREEOS=freeosclaim \
+  -DFREEOSCONFIG=freeoscfg -DFREEOSTOKENS=freeostokens -DDIVIDEND=freeosdivide"
+status=0
+for source in test_*.cpp; do
+  test=${source%.cpp}
+  g++ $FLAGS "$@" -o $test $source libfreeoshost.a
+  echo "== $test"
+  ./$test || status=1
+done
+exit $status
@@ -0,0 +1,120 @@
+// The success paths of claim, stake, unvest and allocate (the freeos
+// transfer) make no heap allocations of their own (heap_category::contract).
+//
+// What they still allocate, in the CDT's code as well as the host build's, is
+// reported rather than tested:
+// - rows: the multi_index row cache allocates every row it loads or creates.
+//   This includes the freeosconfig parameters rows read by
+//   check_master_switch and get_vested_proportion - their string values
+//   ("1", "50") fit in the string itself, so each is one allocation.
+// - args: an argument that does not fit in its type inline, e.g. allocate's
+//   memo when longer than the string's inline capacity.
+// The first action of an iteration also sends tick's iterclear inline
+// action, which allocates its data and authorization. That is tested apart.
+//
+// The host's libstdc++ keeps strings of up to 15 characters inline, where the
+// wasm32 libc++ keeps up to 10, so a short string copy that allocates in the
+// wasm need not allocate here - the memos below are longer than both, except
+// stake's, which must be "freeos stake".
+
+#include "hosttest.hpp"
+
+#include "../freeos/freeos.hpp"
+
+#include <cstdio>
+
+using namespace freedao;
+using namespace freedao::host;
+
+namespace {
+
+const eosio::name alice("alice");
+const eosio::name bob("bob");
+
+// the freeos receiver's cost - stake is costed in freeos's notification of
+// the stake currency transfer, not in the token contract's execution
+counters freeos_cost(const transaction_trace &trace) {
+  counters cost;
+  for (const auto &action : trace.actions) {
+    if (action.receiver == freeos_account()) {
+      cost += action.cost;
+    }
+  }
+  return cost;
+}
+
+uint64_t contract_allocations(const char *action,
+                              const transaction_trace &trace) {
+  counters cost = freeos_cost(trace);
+  std::printf("%-9s allocations: contract %llu, rows %llu, args %llu\n", action,
+              (unsigned long long)cost.heap_allocations(heap_category::contract),
+              (unsigned long long)cost.heap_allocations(heap_category::rows),
+              (unsigned long long)cost.heap_allocations(heap_category::args));
+  return cost.heap_allocations(heap_category::contract);
+}
+
+transaction_trace stake(chain &c, eosio::name user) {
+  return c.push(system_token_account(), eosio::name("transfer"), user, user,
+                freeos_account(),
+                eosio::asset(20 * SYSTEM_CURRENCY_UNITS, system_symbol()),
+                std::string("freeos stake"));
+}
+
+transaction_trace tick(chain &c) {
+  return c.push(freeos_account(), eosio::name("tick"), alice);
+}
+
+} // namespace
+
+HOST_TEST(success_paths_do_not_allocate) {
+  chain c;
+  bootstrap_freeos(c);
+  fund_user(c, alice, eosio::asset(20 * SYSTEM_CURRENCY_UNITS, system_symbol()));
+  c.create_account(bob);
+  expect_success(c.push(freeos_account(), eosio::name("reguser"), alice, alice));
+  expect_success(c.push(freeosconfig_account(), eosio::name("transfadd"),
+                        freeosconfig_account(), alice));
+
+  // with the price at its target, iteration 2 has an unvest percentage
+  expect_success(c.push(freeosconfig_account(), eosio::name("targetrate"),
+                        freeosconfig_account(), 0.01));
+  expect_success(c.push(freeosconfig_account(), eosio::name("currentrate"),
+                        freeosconfig_account(), 1.0));
+
+  // the start of iteration 1
+  expect_success(tick(c));
+
+  auto staked = stake(c, alice);
+  EXPECT_SUCCESS(staked);
+  EXPECT_EQ(contract_allocations("stake", staked), 0u);
+
+  auto claimed = c.push(freeos_account(), eosio::name("claim"), alice, alice);
+  EXPECT_SUCCESS(claimed);
+  EXPECT_EQ(contract_allocations("claim", claimed), 0u);
+
+  c.advance(eosio::days(7));
+  expect_success(tick(c));
+
+  auto unvested = c.push(freeos_account(), eosio::name("unvest"), alice, alice);
+  EXPECT_SUCCESS(unvested);
+  EXPECT_EQ(contract_allocations("unvest", unvested), 0u);
+
+  auto allocated = c.push(
+      freeos_account(), eosio::name("allocate"), alice, alice, bob,
+      eosio::asset(10000, point_symbol()),
+      std::string("an allocation memo longer than any inline string"));
+  EXPECT_SUCCESS(allocated);
+  EXPECT_EQ(contract_allocations("allocate", allocated), 0u);
+}
+
+HOST_TEST(start_of_iteration_sends_iterclear) {
+  chain c;
+  bootstrap_freeos(c);
+  expect_success(c.push(freeos_account(), eosio::name("reguser"), alice, alice));
+  c.advance(eosio::days(7));
+
+  auto ticked = tick(c);
+  EXPECT_SUCCESS(ticked);
+  EXPECT_EQ(freeos_cost(ticked).inline_actions, 1u);
+  contract_allocations("tick", ticked);
+}
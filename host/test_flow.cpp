@@ -0,0 +1,706 @@
+// The host chain running the contracts end to end: registration, staking,
+// claiming across iterations, failed and read-only transactions.
+
+#include "hosttest.hpp"
+
+#include "../freeos/freeos.hpp"
+
+using namespace freedao;
+using namespace freedao::host;
+
+namespace {
+
+const eosio::name alice("alice");
+const eosio::name bob("bob");
+
+int64_t stake_units(uint32_t whole) {
+  return int64_t(whole) * SYSTEM_CURRENCY_UNITS;
+}
+
+int64_t point_balance(const chain &c, eosio::name user) {
+  auto row = c.get_row<account>(freeos_account(), user.value,
+                                eosio::name("accounts"),
+                                point_symbol().code().raw());
+  return row ? row->balance.amount : 0;
+}
+
+int64_t vested_balance(const chain &c, eosio::name user) {
+  auto row = c.get_row<vestaccount>(freeos_account(), user.value,
+                                    eosio::name("vestaccounts"),
+                                    point_symbol().code().raw());
+  return row ? row->balance.amount : 0;
+}
+
+std::optional<user> user_record(const chain &c, eosio::name u) {
+  return c.get_row<user>(freeos_account(), u.value, eosio::name("users"),
+                         system_symbol().code().raw());
+}
+
+transaction_trace stake(chain &c, eosio::name u, int64_t amount) {
+  return c.push(system_token_account(), eosio::name("transfer"), u, u,
+                freeos_account(), eosio::asset(amount, system_symbol()),
+                std::string("freeos stake"));
+}
+
+// alice, an 'e' account, registered and staked (20 units with the default
+// stake bands)
+void staked_alice(chain &c) {
+  bootstrap_freeos(c);
+  fund_user(c, alice, eosio::asset(stake_units(20), system_symbol()));
+  expect_success(c.push(freeos_account(), eosio::name("reguser"), alice, alice));
+  expect_success(stake(c, alice, stake_units(20)));
+}
+
+} // namespace
+
+HOST_TEST(register_stake_claim) {
+  chain c;
+  staked_alice(c);
+
+  auto registered = user_record(c, alice);
+  EXPECT(registered.has_value());
+  EXPECT_EQ(registered->account_type, 'e');
+  EXPECT_EQ(registered->stake.amount, stake_units(20));
+  EXPECT_EQ(registered->staked_iteration, 1u);
+
+  auto trace = c.push(freeos_account(), eosio::name("claim"), alice, alice);
+  EXPECT_SUCCESS(trace);
+
+  // 100 POINTs at a 50% vesting rate
+  EXPECT_EQ(point_balance(c, alice), 50 * 10000);
+  EXPECT_EQ(vested_balance(c, alice), 50 * 10000);
+  EXPECT(point_balance(c, freedao_account()) > 0);
+  EXPECT_EQ(user_record(c, alice)->issuances, 1u);
+  EXPECT_EQ(user_record(c, alice)->last_issuance, 1u);
+
+  // the iteration's claim quote was stored by stake's tick, so the claim
+  // writes the user's rows, the statistics and the supply but sends nothing
+  EXPECT_EQ(trace.total().inline_actions, 0u);
+  EXPECT(trace.total().stores + trace.total().updates > 0);
+}
+
+HOST_TEST(verified_user_needs_no_stake) {
+  chain c;
+  bootstrap_freeos(c);
+  set_verification(c, bob, {"firstname,lastname"});
+
+  // tick needs the statistics record, which the first registration creates
+  EXPECT_SUCCESS(c.push(freeos_account(), eosio::name("reguser"), bob, bob));
+  EXPECT_SUCCESS(c.push(freeos_account(), eosio::name("claim"), bob, bob));
+  EXPECT(user_record(c, bob).has_value());
+  EXPECT_EQ(user_record(c, bob)->account_type, 'v');
+  EXPECT_EQ(user_record(c, bob)->staked_iteration, 1u);
+  EXPECT_EQ(user_record(c, bob)->issuances, 1u);
+}
+
+HOST_TEST(one_claim_per_iteration) {
+  chain c;
+  staked_alice(c);
+
+  EXPECT_SUCCESS(c.push(freeos_account(), eosio::name("claim"), alice, alice));
+  auto again = c.push(freeos_account(), eosio::name("claim"), alice, alice);
+  EXPECT(!again.succeeded);
+  EXPECT_EQ(again.error,
+            std::string("user is not eligible to claim in this iteration"));
+
+  c.advance(eosio::days(7));
+  EXPECT_SUCCESS(c.push(freeos_account(), eosio::name("claim"), alice, alice));
+  EXPECT_EQ(user_record(c, alice)->last_issuance, 2u);
+  EXPECT_EQ(user_record(c, alice)->issuances, 2u);
+}
+
+HOST_TEST(failed_transaction_changes_nothing) {
+  chain c;
+  bootstrap_freeos(c);
+  fund_user(c, alice, eosio::asset(stake_units(20), system_symbol()));
+  int64_t ram = c.ram_usage(freeos_account());
+
+  // a claim registers the user, then fails - here in tick, as no one has
+  // registered yet
+  auto trace = c.push(freeos_account(), eosio::name("claim"), alice, alice);
+  EXPECT(!trace.succeeded);
+  EXPECT(!user_record(c, alice).has_value());
+  EXPECT_EQ(c.ram_usage(freeos_account()), ram);
+
+  // and here in the eligibility check, as alice, an 'e' account, has not
+  // staked
+  expect_success(c.push(freeos_account(), eosio::name("reguser"), alice, alice));
+  auto unstaked = c.push(freeos_account(), eosio::name("claim"), alice, alice);
+  EXPECT(!unstaked.succeeded);
+  EXPECT_EQ(user_record(c, alice)->issuances, 0u);
+
+  // the wrong stake amount
+  auto wrong = stake(c, alice, stake_units(10));
+  EXPECT(!wrong.succeeded);
+  EXPECT_EQ(user_record(c, alice)->staked_iteration, 0u);
+}
+
+HOST_TEST(authorization) {
+  chain c;
+  bootstrap_freeos(c);
+  c.create_account(alice);
+
+  auto trace = c.push(freeos_account(), eosio::name("reguser"), bob, alice);
+  EXPECT(!trace.succeeded);
+  EXPECT_EQ(trace.error, std::string("missing authority of alice"));
+}
+
+HOST_TEST(read_only_transactions) {
+  chain c;
+  staked_alice(c);
+
+  auto status = c.push_read_only(chain::make_action(
+      freeos_account(), eosio::name("getuser"), alice, alice));
+  EXPECT_SUCCESS(status);
+  EXPECT(status.return_value<user_status>().registered);
+  EXPECT_EQ(status.return_value<user_status>().record.stake.amount,
+            stake_units(20));
+
+  auto claim = c.push_read_only(chain::make_action(
+      freeos_account(), eosio::name("claim"), alice, alice));
+  EXPECT(!claim.succeeded);
+  EXPECT_EQ(user_record(c, alice)->issuances, 0u);
+}
+
+HOST_TEST(stake_notification_without_token_contract) {
+  chain c;
+  bootstrap_freeos(c);
+  c.create_account(alice);
+  expect_success(c.push(freeos_account(), eosio::name("reguser"), alice, alice));
+
+  // freeos receives the transfer as the token contract would notify it, but
+  // the transfer itself does not run - alice has no stake currency
+  auto trace = c.push_notification(
+      freeos_account(),
+      chain::make_action(system_token_account(), eosio::name("transfer"),
+                         alice, alice, freeos_account(),
+                         eosio::asset(stake_units(20), system_symbol()),
+                         std::string("freeos stake")));
+  EXPECT_SUCCESS(trace);
+  EXPECT(trace.actions[0].receiver == freeos_account());
+  EXPECT(trace.actions[0].account == system_token_account());
+  for (const auto &action : trace.actions) {
+    EXPECT(action.receiver != system_token_account());
+  }
+  EXPECT_EQ(user_record(c, alice)->stake.amount, stake_units(20));
+}
+
+HOST_TEST(sessions) {
+  chain c;
+  staked_alice(c);
+
+  c.checkpoint();
+  EXPECT_SUCCESS(c.push(freeos_account(), eosio::name("claim"), alice, alice));
+  EXPECT_EQ(user_record(c, alice)->issuances, 1u);
+  c.rollback();
+  EXPECT_EQ(user_record(c, alice)->issuances, 0u);
+  EXPECT_EQ(point_balance(c, alice), 0);
+  EXPECT_EQ(c.session_depth(), size_t(0));
+}
+
+HOST_TEST(snapshot_restores_the_chain) {
+  chain c;
+  staked_alice(c);
+  std::vector<char> saved = c.snapshot();
+
+  chain restored;
+  deploy_freeos(restored);
+  restored.restore(saved.data(), saved.size());
+  EXPECT(restored.snapshot() == saved);
+  EXPECT_EQ(restored.ram_usage(freeos_account()),
+            c.ram_usage(freeos_account()));
+
+  // the unstake request's secondary index was restored with it - the refund
+  // finds it
+  EXPECT_SUCCESS(
+      restored.push(freeos_account(), eosio::name("unstake"), alice, alice));
+  restored.advance(eosio::days(7));
+  EXPECT_SUCCESS(restored.push(freeos_account(), eosio::name("tick"), bob));
+  EXPECT_SUCCESS(restored.push(freeos_account(), eosio::name("tick"), bob));
+  EXPECT_EQ(user_record(restored, alice)->stake.amount, 0);
+  EXPECT_EQ(user_record(c, alice)->stake.amount, stake_units(20));
+
+  // a bad snapshot leaves the chain as it was
+  saved.pop_back();
+  bool threw = false;
+  try {
+    restored.restore(saved.data(), saved.size());
+  } catch (const eosio::check_failure &) {
+    threw = true;
+  }
+  EXPECT(threw);
+  EXPECT_EQ(user_record(restored, alice)->stake.amount, 0);
+}
+
+HOST_TEST(claim_preview_of_unregistered_user) {
+  chain c;
+  staked_alice(c);
+  set_verification(c, bob, {"firstname,lastname"});
+
+  // bob has no users record, but the claim would register him as a 'v'
+  // account, which needs no stake
+  auto preview = c.push_read_only(chain::make_action(
+      freeos_account(), eosio::name("getclaimq"), bob, bob));
+  EXPECT_SUCCESS(preview);
+  auto quote = preview.return_value<claim_preview>();
+  EXPECT(quote.eligible);
+  EXPECT(!user_record(c, bob).has_value());
+
+  EXPECT_SUCCESS(c.push(freeos_account(), eosio::name("claim"), bob, bob));
+  EXPECT_EQ(point_balance(c, bob), quote.liquid_amount.amount);
+  EXPECT_EQ(vested_balance(c, bob), quote.vested_amount.amount);
+
+  // an unverified account would be registered unstaked
+  const eosio::name carol("carol");
+  c.create_account(carol);
+  auto unstaked = c.push_read_only(chain::make_action(
+      freeos_account(), eosio::name("getclaimq"), carol, carol));
+  EXPECT_SUCCESS(unstaked);
+  EXPECT(!unstaked.return_value<claim_preview>().eligible);
+  EXPECT_EQ(unstaked.return_value<claim_preview>().reason,
+            std::string("user is not eligible to claim in this iteration"));
+}
+
+HOST_TEST(claim_preview_without_statistics_or_stake_bands) {
+  chain c;
+  bootstrap_freeos(c);
+  c.create_account(alice);
+
+  // no one has registered, so there is no statistics record
+  auto preview = c.push_read_only(chain::make_action(
+      freeos_account(), eosio::name("getclaimq"), alice, alice));
+  EXPECT_SUCCESS(preview);
+  EXPECT(!preview.return_value<claim_preview>().eligible);
+  EXPECT_EQ(preview.return_value<claim_preview>().reason,
+            std::string("statistics record is not found"));
+
+  // with the stake bands erased the stake requirement of a new registration
+  // cannot be determined
+  expect_success(c.push(freeos_account(), eosio::name("reguser"), alice, alice));
+  expect_success(c.push(freeosconfig_account(), eosio::name("stakeerase"),
+                        freeosconfig_account(), uint64_t(0)));
+  c.create_account(bob);
+  auto unbanded = c.push_read_only(chain::make_action(
+      freeos_account(), eosio::name("getclaimq"), bob, bob));
+  EXPECT_SUCCESS(unbanded);
+  EXPECT(!unbanded.return_value<claim_preview>().eligible);
+  EXPECT_EQ(unbanded.return_value<claim_preview>().reason,
+            std::string("stake requirements cannot be determined"));
+}
+
+HOST_TEST(claim_preview_matches_claim) {
+  chain c;
+  staked_alice(c);
+
+  // with the price at its target, every iteration unlocks some of the vested
+  // balance
+  expect_success(c.push(freeosconfig_account(), eosio::name("targetrate"),
+                        freeosconfig_account(), 0.01));
+  expect_success(c.push(freeosconfig_account(), eosio::name("currentrate"),
+                        freeosconfig_account(), 1.0));
+
+  for (int i = 0; i < 4; i++) {
+    // the first action of the iteration moves it on - the preview does not
+    expect_success(c.push(freeos_account(), eosio::name("tick"), alice));
+
+    auto preview = c.push_read_only(chain::make_action(
+        freeos_account(), eosio::name("getclaimq"), alice, alice));
+    EXPECT_SUCCESS(preview);
+    auto quote = preview.return_value<claim_preview>();
+    EXPECT(quote.eligible);
+
+    int64_t liquid = point_balance(c, alice);
+    EXPECT_SUCCESS(c.push(freeos_account(), eosio::name("claim"), alice, alice));
+    EXPECT_EQ(point_balance(c, alice) - liquid, quote.liquid_amount.amount);
+
+    c.advance(eosio::days(7));
+  }
+}
+
+HOST_TEST(mintmany_needs_minter_and_transferer) {
+  chain c;
+  bootstrap_freeos(c);
+  c.create_account(alice);
+  c.create_account(bob);
+  std::vector<std::pair<eosio::name, eosio::asset>> recipients = {
+      {bob, eosio::asset(10000, point_symbol())}};
+  auto mintmany = [&] {
+    return c.push(freeos_account(), eosio::name("mintmany"), alice, alice,
+                  recipients, std::string("bulk"));
+  };
+
+  expect_success(c.push(freeosconfig_account(), eosio::name("minteradd"),
+                        freeosconfig_account(), alice));
+  auto minter_only = mintmany();
+  EXPECT(!minter_only.succeeded);
+  EXPECT_EQ(minter_only.error,
+            std::string("the mintmany action is protected by transferers "
+                        "whitelist"));
+
+  expect_success(c.push(freeosconfig_account(), eosio::name("transfadd"),
+                        freeosconfig_account(), alice));
+  EXPECT_SUCCESS(mintmany());
+  EXPECT_EQ(point_balance(c, bob), 10000);
+}
+
+HOST_TEST(conversions_settle_in_request_order) {
+  chain c;
+  bootstrap_freeos(c);
+  const eosio::name zed("zed");
+  c.create_account(alice);
+  c.create_account(bob);
+  c.create_account(zed);
+  expect_success(c.push(freeosconfig_account(), eosio::name("minteradd"),
+                        freeosconfig_account(), alice));
+  expect_success(c.push(freeosconfig_account(), eosio::name("transfadd"),
+                        freeosconfig_account(), alice));
+  expect_success(c.push(freeos_account(), eosio::name("mintmany"), alice,
+                        alice,
+                        std::vector<std::pair<eosio::name, eosio::asset>>{
+                            {bob, eosio::asset(30000, point_symbol())},
+                            {zed, eosio::asset(30000, point_symbol())}},
+                        std::string("bulk")));
+  expect_success(c.push(freeosconfig_account(), eosio::name("paramupsert"),
+                        freeosconfig_account(), eosio::name(),
+                        eosio::name("convbatchnum"), std::string("1")));
+
+  auto convreq = [&](eosio::name owner, int64_t amount) {
+    return c.push(freeos_account(), eosio::name("convreq"), owner, owner,
+                  eosio::asset(amount, point_symbol()));
+  };
+  auto freeos_balance = [&](eosio::name owner) {
+    auto row = c.get_row<account>(freeostokens_account(), owner.value,
+                                  eosio::name("accounts"),
+                                  freeos_symbol().code().raw());
+    return row ? row->balance.amount : 0;
+  };
+
+  // zed asks first, though bob comes first in primary key order
+  EXPECT_SUCCESS(convreq(zed, 10000));
+  EXPECT_SUCCESS(convreq(bob, 10000));
+  EXPECT_SUCCESS(convreq(zed, 10000));
+
+  EXPECT_SUCCESS(c.push(freeos_account(), eosio::name("convsettle"), alice));
+  EXPECT_EQ(freeos_balance(zed), 20000);
+  EXPECT_EQ(freeos_balance(bob), 0);
+
+  // bob cancels, and gets his POINTs back
+  EXPECT_EQ(point_balance(c, bob), 20000);
+  EXPECT_SUCCESS(c.push(freeos_account(), eosio::name("convcancel"), bob, bob));
+  EXPECT_EQ(point_balance(c, bob), 30000);
+  EXPECT_EQ(c.row_count(freeos_account(), freeos_account().value,
+                        eosio::name("convreqs")),
+            size_t(0));
+  auto again = c.push(freeos_account(), eosio::name("convcancel"), bob, bob);
+  EXPECT(!again.succeeded);
+
+  auto supply = c.get_row<currency_stats>(freeos_account(),
+                                          point_symbol().code().raw(),
+                                          eosio::name("stat"),
+                                          point_symbol().code().raw());
+  EXPECT_EQ(supply->supply.amount, 40000);
+  EXPECT_EQ(supply->conditional_supply.amount, -20000);
+}
+
+namespace {
+
+std::optional<aggstat> aggregates(const chain &c) {
+  return c.get_row<aggstat>(freeos_account(), freeos_account().value,
+                            eosio::name("aggstats"), 0);
+}
+
+// the freeos receiver's cost, without the token contracts'
+counters freeos_cost(const transaction_trace &trace) {
+  counters cost;
+  for (const auto &action : trace.actions) {
+    if (action.receiver == freeos_account()) {
+      cost += action.cost;
+    }
+  }
+  return cost;
+}
+
+} // namespace
+
+HOST_TEST(aggregates_follow_stakes_and_refunds) {
+  chain c;
+  staked_alice(c);
+  fund_user(c, bob, eosio::asset(stake_units(20), system_symbol()));
+  expect_success(c.push(freeos_account(), eosio::name("reguser"), bob, bob));
+  expect_success(stake(c, bob, stake_units(20)));
+
+  // the first registration created the record
+  EXPECT_EQ(aggregates(c)->unverified, 2u);
+  EXPECT_EQ(aggregates(c)->staked.amount, stake_units(40));
+
+  EXPECT_SUCCESS(c.push(freeos_account(), eosio::name("unstake"), alice, alice));
+  EXPECT_SUCCESS(c.push(freeos_account(), eosio::name("unstake"), bob, bob));
+  EXPECT_EQ(aggregates(c)->refunds.amount, stake_units(40));
+  EXPECT_EQ(aggregates(c)->refundcount, 2u);
+
+  // the next iteration's first tick refunds both, and updates the aggregates
+  // once for the batch
+  c.advance(eosio::days(7));
+  expect_success(c.push(freeos_account(), eosio::name("tick"), alice));
+  c.advance(eosio::seconds(1));
+  auto refunded = c.push(freeos_account(), eosio::name("tick"), alice);
+  EXPECT_SUCCESS(refunded);
+  EXPECT_EQ(freeos_cost(refunded).inline_actions, 2u);
+  // each refund updates its users row, the batch the aggstats row
+  EXPECT_EQ(freeos_cost(refunded).updates, 3u);
+
+  EXPECT_EQ(aggregates(c)->staked.amount, 0);
+  EXPECT_EQ(aggregates(c)->refunds.amount, 0);
+  EXPECT_EQ(aggregates(c)->refundcount, 0u);
+}
+
+HOST_TEST(aggregates_wait_for_aggset) {
+  chain c;
+  staked_alice(c);
+
+  // a running system, from before the aggregates
+  c.run_as(freeos_account(), [&] {
+    aggstats_index aggstats_table(freeos_account(), freeos_account().value);
+    aggstats_table.erase(aggstats_table.begin());
+  });
+
+  EXPECT_SUCCESS(c.push(freeos_account(), eosio::name("unstake"), alice, alice));
+  EXPECT_SUCCESS(
+      c.push(freeos_account(), eosio::name("unstakecncl"), alice, alice));
+  EXPECT_SUCCESS(c.push(freeos_account(), eosio::name("deregister"),
+                        freeos_account(), alice));
+  EXPECT(!aggregates(c).has_value());
+
+  c.create_account(bob);
+  aggstat snapshot;
+  snapshot.staked = eosio::asset(stake_units(5), system_symbol());
+  snapshot.vested = eosio::asset(0, point_symbol());
+  snapshot.refunds = eosio::asset(0, system_symbol());
+  snapshot.verified = 3;
+  EXPECT_SUCCESS(c.push(freeos_account(), eosio::name("aggset"),
+                        freeos_account(), snapshot));
+
+  EXPECT_SUCCESS(c.push(freeos_account(), eosio::name("reguser"), bob, bob));
+  EXPECT_EQ(aggregates(c)->verified, 3u);
+  EXPECT_EQ(aggregates(c)->unverified, 1u);
+  EXPECT_EQ(aggregates(c)->staked.amount, stake_units(5));
+}
+
+namespace {
+
+std::optional<claimquote> claim_quote(const chain &c) {
+  return c.get_row<claimquote>(freeos_account(), freeos_account().value,
+                               eosio::name("claimquote"), 0);
+}
+
+// the nth of a series of user accounts
+eosio::name claimer(uint32_t n) {
+  std::string account = "claimer";
+  for (int i = 0; i < 3; i++, n /= 26) {
+    account += char('a' + n % 26);
+  }
+  return eosio::name(account);
+}
+
+} // namespace
+
+HOST_TEST(claims_cross_the_freedao_tiers) {
+  chain c;
+  bootstrap_freeos(c);
+
+  // one 'v' account per claim event, on into the third tier. The first
+  // registers before claiming, to create the statistics record tick needs.
+  uint32_t claims = economics::FREEDAO_TIERS[1].last_claimevent + 1;
+  for (uint32_t n = 1; n <= claims; n++) {
+    set_verification(c, claimer(n), {"firstname,lastname"});
+  }
+  expect_success(c.push(freeos_account(), eosio::name("reguser"), claimer(1),
+                        claimer(1)));
+
+  uint16_t claim_tokens = 0;
+  for (uint32_t n = 1; n <= claims; n++) {
+    eosio::name user = claimer(n);
+
+    int64_t deposited = point_balance(c, freedao_account());
+    EXPECT_SUCCESS(c.push(freeos_account(), eosio::name("claim"), user, user));
+    if (n == 1) {
+      claim_tokens = claim_quote(c)->claim_tokens;
+    }
+
+    // the nth claim event is paid at its tier's multiplier, and the stored
+    // quote has moved on to that tier
+    economics::freedao_tier tier = economics::freedao_tier_for(n);
+    int64_t freedao_tokens =
+        economics::split_claim(claim_tokens, 0.0f, tier.multiplier)
+            .freedao_tokens;
+    EXPECT_EQ(point_balance(c, freedao_account()) - deposited,
+              freedao_tokens * 10000);
+    EXPECT_EQ(claim_quote(c)->tier_boundary, tier.last_claimevent);
+  }
+}
+
+HOST_TEST(claim_requotes_a_stale_claimquote) {
+  // three systems in iteration 2, which has a larger claim than iteration 1:
+  // one ran the rollover tick that quotes iteration 2, the others were
+  // upgraded during iteration 2 and have iteration 1's quote, or none
+  chain current, stale, missing;
+  system_config config;
+  for (chain *c : {&current, &stale, &missing}) {
+    staked_alice(*c);
+    expect_success(c->push(freeos_account(), eosio::name("claim"), alice, alice));
+    expect_success(c->push(
+        freeosconfig_account(), eosio::name("iterupsert"),
+        freeosconfig_account(), uint32_t(2),
+        config.start + config.iteration_length,
+        config.start + config.iteration_length + config.iteration_length -
+            eosio::seconds(1),
+        uint16_t(config.claim_amount * 2), config.tokens_required));
+  }
+  claimquote first = *claim_quote(stale);
+
+  for (chain *c : {&current, &stale, &missing}) {
+    c->advance(config.iteration_length);
+    expect_success(c->push(freeos_account(), eosio::name("tick"), alice));
+  }
+  EXPECT_EQ(claim_quote(current)->iteration, 2u);
+
+  stale.run_as(freeos_account(), [&] {
+    claimquote_index claimquote_table(freeos_account(),
+                                      freeos_account().value);
+    claimquote_table.modify(claimquote_table.begin(), freeos_account(),
+                            [&](auto &q) { q = first; });
+  });
+  missing.run_as(freeos_account(), [&] {
+    claimquote_index claimquote_table(freeos_account(),
+                                      freeos_account().value);
+    claimquote_table.erase(claimquote_table.begin());
+  });
+
+  for (chain *c : {&current, &stale, &missing}) {
+    EXPECT_SUCCESS(c->push(freeos_account(), eosio::name("claim"), alice, alice));
+  }
+
+  // the upgraded systems claimed iteration 2's amounts, and stored its quote
+  for (chain *c : {&stale, &missing}) {
+    EXPECT_EQ(point_balance(*c, alice), point_balance(current, alice));
+    EXPECT_EQ(vested_balance(*c, alice), vested_balance(current, alice));
+    EXPECT_EQ(point_balance(*c, freedao_account()),
+              point_balance(current, freedao_account()));
+    EXPECT_EQ(claim_quote(*c)->iteration, 2u);
+    EXPECT_EQ(claim_quote(*c)->claim_tokens,
+              claim_quote(current)->claim_tokens);
+  }
+  EXPECT_EQ(claim_quote(current)->claim_tokens, first.claim_tokens * 2);
+}
+
+#ifdef LAZY_UNLOCK
+HOST_TEST(lazy_unlock_releases_each_unlock_once) {
+  chain c;
+  staked_alice(c);
+  expect_success(c.push(freeos_account(), eosio::name("claim"), alice, alice));
+  int64_t vested = vested_balance(c, alice);
+  EXPECT(vested > 0);
+
+  // with the price above its target, every rollover raises unvestpercent and
+  // unlocks more of the vested balance
+  expect_success(c.push(freeosconfig_account(), eosio::name("targetrate"),
+                        freeosconfig_account(), 0.01));
+  expect_success(c.push(freeosconfig_account(), eosio::name("currentrate"),
+                        freeosconfig_account(), 1.0));
+  auto roll = [&](int iterations) {
+    for (int i = 0; i < iterations; i++) {
+      c.advance(eosio::days(7));
+      expect_success(c.push(freeos_account(), eosio::name("tick"), alice));
+    }
+  };
+  // the POINTs unlocked since alice's balance was last settled
+  auto unlocked = [&] {
+    auto statistics = c.get_row<statistic>(freeos_account(),
+                                           freeos_account().value,
+                                           eosio::name("statistics"), 0);
+    auto account = c.get_row<vestaccount>(freeos_account(), alice.value,
+                                          eosio::name("vestaccounts"),
+                                          point_symbol().code().raw());
+    return int64_t(economics::unlocked_tokens(
+               account->balance.amount, unlock_factor_of(*statistics),
+               unlock_factor_of(*account))) *
+           10000;
+  };
+  auto unvest = [&] {
+    return c.push(freeos_account(), eosio::name("unvest"), alice, alice);
+  };
+
+  // unvest releases everything unlocked over the iterations, once
+  roll(3);
+  int64_t due = unlocked();
+  EXPECT(due > 0);
+  int64_t liquid = point_balance(c, alice);
+  EXPECT_SUCCESS(unvest());
+  EXPECT_EQ(point_balance(c, alice) - liquid, due);
+  EXPECT_EQ(vested_balance(c, alice), vested - due);
+  EXPECT_EQ(unlocked(), 0);
+  EXPECT(!unvest().succeeded);
+
+  // and so does a claim, with the claim's own amounts
+  roll(2);
+  due = unlocked();
+  EXPECT(due > 0);
+  liquid = point_balance(c, alice);
+  vested = vested_balance(c, alice);
+  claimquote quote = *claim_quote(c);
+  EXPECT_SUCCESS(c.push(freeos_account(), eosio::name("claim"), alice, alice));
+  EXPECT_EQ(point_balance(c, alice) - liquid,
+            quote.liquid_tokens * 10000 + due);
+  EXPECT_EQ(vested_balance(c, alice),
+            vested + quote.vested_tokens * 10000 - due);
+  EXPECT_EQ(unlocked(), 0);
+  EXPECT(!unvest().succeeded);
+}
+#endif
+
+HOST_TEST(allocmany_debits_once_and_writes_nothing_on_failure) {
+  chain c;
+  bootstrap_freeos(c);
+  const eosio::name carol("carol");
+  c.create_account(alice);
+  c.create_account(bob);
+  c.create_account(carol);
+  expect_success(c.push(freeosconfig_account(), eosio::name("minteradd"),
+                        freeosconfig_account(), alice));
+  expect_success(c.push(freeosconfig_account(), eosio::name("transfadd"),
+                        freeosconfig_account(), alice));
+  expect_success(c.push(freeos_account(), eosio::name("mintmany"), alice,
+                        alice,
+                        std::vector<std::pair<eosio::name, eosio::asset>>{
+                            {alice, eosio::asset(100000, point_symbol())}},
+                        std::string("bulk")));
+
+  auto points = [](int64_t amount) {
+    return eosio::asset(amount, point_symbol());
+  };
+  auto allocmany =
+      [&](std::vector<std::pair<eosio::name, eosio::asset>> recipients) {
+        return c.push(freeos_account(), eosio::name("allocmany"), alice, alice,
+                      recipients, std::string("bulk"));
+      };
+  auto expect_balances = [&](int64_t from, int64_t to_bob, int64_t to_carol) {
+    EXPECT_EQ(point_balance(c, alice), from);
+    EXPECT_EQ(point_balance(c, bob), to_bob);
+    EXPECT_EQ(point_balance(c, carol), to_carol);
+  };
+
+  EXPECT_SUCCESS(allocmany({{bob, points(20000)}, {carol, points(30000)}}));
+  expect_balances(50000, 20000, 30000);
+
+  // more than alice holds - bob's credit, written first, is undone too
+  auto over = allocmany({{bob, points(20000)}, {carol, points(40000)}});
+  EXPECT(!over.succeeded);
+  EXPECT_EQ(over.error, std::string("overdrawn balance"));
+  expect_balances(50000, 20000, 30000);
+
+  auto duplicate = allocmany(
+      {{bob, points(10000)}, {carol, points(10000)}, {bob, points(10000)}});
+  EXPECT(!duplicate.succeeded);
+  EXPECT_EQ(duplicate.error, std::string("duplicate recipient"));
+  expect_balances(50000, 20000, 30000);
+}
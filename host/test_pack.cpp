@@ -0,0 +1,112 @@
+// The relayer's action packing (../freeossim/freeosactions.hpp, generated by
+// abi_actions.sh from the ABIs) against known bytes, and against the
+// contracts' own serialization of the same arguments - so a struct generated
+// from a stale or wrong ABI fails here.
+
+#include "hosttest.hpp"
+
+#include "../freeos/freeos.hpp"
+#include "../freeossim/freeosactions.hpp"
+
+#include <string>
+#include <vector>
+
+using namespace freedao;
+using namespace freedao::host;
+
+namespace {
+
+const uint64_t POINT = relay::symbol_value("POINT", 4);
+const uint64_t XUSDC = relay::symbol_value("XUSDC", 6);
+
+template <typename Bytes> std::string hex(const Bytes &bytes) {
+  static const char digits[] = "0123456789abcdef";
+  std::string text;
+  for (auto b : bytes) {
+    text += digits[uint8_t(b) >> 4];
+    text += digits[uint8_t(b) & 15];
+  }
+  return text;
+}
+
+template <typename Action> std::string relay_hex(const Action &action) {
+  relay::size_stream size;
+  action.write(size);
+  std::vector<uint8_t> bytes(size.size);
+  relay::buffer_stream out(bytes.data());
+  action.write(out);
+  return hex(bytes);
+}
+
+template <typename... Args> std::string contract_hex(Args &&...args) {
+  return hex(eosio::pack(std::make_tuple(std::forward<Args>(args)...)));
+}
+
+eosio::asset points(int64_t amount) {
+  return eosio::asset(amount, point_symbol());
+}
+
+} // namespace
+
+HOST_TEST(pack_name_argument) {
+  relay::freeos::claim claim{relay::name_value("alice")};
+  EXPECT_EQ(relay_hex(claim), std::string("0000000000855c34"));
+  EXPECT_EQ(relay_hex(claim), contract_hex(eosio::name("alice")));
+}
+
+HOST_TEST(pack_no_arguments) {
+  EXPECT_EQ(relay_hex(relay::freeos::convsettle{}), std::string(""));
+  EXPECT_EQ(relay_hex(relay::freeos::getstats{}), std::string(""));
+}
+
+HOST_TEST(pack_pair_array) {
+  relay::freeos::allocmany allocmany{
+      relay::name_value("alice"),
+      {{relay::name_value("bob"), {10000, POINT}},
+       {relay::name_value("carol"), {25000, POINT}}},
+      "alloc"};
+
+  // from, a varuint32 count of 2, each pair's name and asset, then the memo
+  EXPECT_EQ(relay_hex(allocmany),
+            std::string("0000000000855c34"
+                        "02"
+                        "0000000000000e3d"
+                        "1027000000000000"
+                        "04504f494e540000"
+                        "000000008048af41"
+                        "a861000000000000"
+                        "04504f494e540000"
+                        "05616c6c6f63"));
+
+  std::vector<std::pair<eosio::name, eosio::asset>> recipients{
+      {eosio::name("bob"), points(10000)},
+      {eosio::name("carol"), points(25000)}};
+  EXPECT_EQ(relay_hex(allocmany),
+            contract_hex(eosio::name("alice"), recipients,
+                         std::string("alloc")));
+
+  relay::freeos::mintmany mintmany{relay::name_value("minter"),
+                                   allocmany.recipients, "alloc"};
+  EXPECT_EQ(relay_hex(mintmany),
+            contract_hex(eosio::name("minter"), recipients,
+                         std::string("alloc")));
+}
+
+HOST_TEST(pack_struct_argument) {
+  relay::freeos::aggset aggset{
+      {{200000000, XUSDC}, {500000, POINT}, {0, XUSDC}, 0, 3, 4}};
+
+  // the aggstat's three assets and three uint32s
+  EXPECT_EQ(relay_hex(aggset),
+            std::string("00c2eb0b000000000658555344430000"
+                        "20a107000000000004504f494e540000"
+                        "00000000000000000658555344430000"
+                        "00000000"
+                        "03000000"
+                        "04000000"));
+
+  eosio::symbol xusdc("XUSDC", 6);
+  aggstat aggregates{eosio::asset(200000000, xusdc), points(500000),
+                     eosio::asset(0, xusdc), 0, 3, 4};
+  EXPECT_EQ(relay_hex(aggset), contract_hex(aggregates));
+}
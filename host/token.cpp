@@ -0,0 +1,214 @@
+// eosio.token for the host build - the token contract freeostokens and the
+// stake currency contract (xtokens, eosio.token in a test build) run. The
+// actions and tables of the reference eosio.token contract.
+
+#include "freeoshost.hpp"
+
+#include <eosio/eosio.hpp>
+
+#include <string>
+
+namespace freedao {
+namespace host {
+namespace {
+
+using namespace eosio;
+
+class token : public contract {
+public:
+  using contract::contract;
+
+  void create(const name &issuer, const asset &maximum_supply) {
+    require_auth(get_self());
+
+    auto sym = maximum_supply.symbol;
+    check(sym.is_valid(), "invalid symbol name");
+    check(maximum_supply.is_valid(), "invalid supply");
+    check(maximum_supply.amount > 0, "max-supply must be positive");
+
+    stats statstable(get_self(), sym.code().raw());
+    auto existing = statstable.find(sym.code().raw());
+    check(existing == statstable.end(), "token with symbol already exists");
+
+    statstable.emplace(get_self(), [&](auto &s) {
+      s.supply.symbol = maximum_supply.symbol;
+      s.max_supply = maximum_supply;
+      s.issuer = issuer;
+    });
+  }
+
+  void issue(const name &to, const asset &quantity, const std::string &memo) {
+    auto sym = quantity.symbol;
+    check(sym.is_valid(), "invalid symbol name");
+    check(memo.size() <= 256, "memo has more than 256 bytes");
+
+    stats statstable(get_self(), sym.code().raw());
+    auto existing = statstable.find(sym.code().raw());
+    check(existing != statstable.end(),
+          "token with symbol does not exist, create token before issue");
+    const auto &st = *existing;
+    check(to == st.issuer, "tokens can only be issued to issuer account");
+
+    require_auth(st.issuer);
+    check(quantity.is_valid(), "invalid quantity");
+    check(quantity.amount > 0, "must issue positive quantity");
+
+    check(quantity.symbol == st.supply.symbol, "symbol precision mismatch");
+    check(quantity.amount <= st.max_supply.amount - st.supply.amount,
+          "quantity exceeds available supply");
+
+    statstable.modify(st, same_payer, [&](auto &s) { s.supply += quantity; });
+
+    add_balance(st.issuer, quantity, st.issuer);
+  }
+
+  void retire(const asset &quantity, const std::string &memo) {
+    auto sym = quantity.symbol;
+    check(sym.is_valid(), "invalid symbol name");
+    check(memo.size() <= 256, "memo has more than 256 bytes");
+
+    stats statstable(get_self(), sym.code().raw());
+    auto existing = statstable.find(sym.code().raw());
+    check(existing != statstable.end(), "token with symbol does not exist");
+    const auto &st = *existing;
+
+    require_auth(st.issuer);
+    check(quantity.is_valid(), "invalid quantity");
+    check(quantity.amount > 0, "must retire positive quantity");
+
+    check(quantity.symbol == st.supply.symbol, "symbol precision mismatch");
+
+    statstable.modify(st, same_payer, [&](auto &s) { s.supply -= quantity; });
+
+    sub_balance(st.issuer, quantity);
+  }
+
+  void transfer(const name &from, const name &to, const asset &quantity,
+                const std::string &memo) {
+    check(from != to, "cannot transfer to self");
+    require_auth(from);
+    check(is_account(to), "to account does not exist");
+    auto sym = quantity.symbol.code();
+    stats statstable(get_self(), sym.raw());
+    const auto &st = statstable.get(sym.raw());
+
+    require_recipient(from);
+    require_recipient(to);
+
+    check(quantity.is_valid(), "invalid quantity");
+    check(quantity.amount > 0, "must transfer positive quantity");
+    check(quantity.symbol == st.supply.symbol, "symbol precision mismatch");
+    check(memo.size() <= 256, "memo has more than 256 bytes");
+
+    auto payer = has_auth(to) ? to : from;
+
+    sub_balance(from, quantity);
+    add_balance(to, quantity, payer);
+  }
+
+  void open(const name &owner, const symbol &symbol, const name &ram_payer) {
+    require_auth(ram_payer);
+
+    check(is_account(owner), "owner account does not exist");
+
+    auto sym_code_raw = symbol.code().raw();
+    stats statstable(get_self(), sym_code_raw);
+    const auto &st = statstable.get(sym_code_raw, "symbol does not exist");
+    check(st.supply.symbol == symbol, "symbol precision mismatch");
+
+    accounts acnts(get_self(), owner.value);
+    auto it = acnts.find(sym_code_raw);
+    if (it == acnts.end()) {
+      acnts.emplace(ram_payer, [&](auto &a) { a.balance = asset{0, symbol}; });
+    }
+  }
+
+  void close(const name &owner, const symbol &symbol) {
+    require_auth(owner);
+    accounts acnts(get_self(), owner.value);
+    auto it = acnts.find(symbol.code().raw());
+    check(it != acnts.end(), "Balance row already deleted or never existed. "
+                             "Action won't have any effect.");
+    check(it->balance.amount == 0,
+          "Cannot close because the balance is not zero.");
+    acnts.erase(it);
+  }
+
+private:
+  struct account {
+    asset balance;
+
+    uint64_t primary_key() const { return balance.symbol.code().raw(); }
+  };
+
+  struct currency_stats {
+    asset supply;
+    asset max_supply;
+    name issuer;
+
+    uint64_t primary_key() const { return supply.symbol.code().raw(); }
+  };
+
+  typedef eosio::multi_index<"accounts"_n, account> accounts;
+  typedef eosio::multi_index<"stat"_n, currency_stats> stats;
+
+  void sub_balance(const name &owner, const asset &value) {
+    accounts from_acnts(get_self(), owner.value);
+
+    const auto &from =
+        from_acnts.get(value.symbol.code().raw(), "no balance object found");
+    check(from.balance.amount >= value.amount, "overdrawn balance");
+
+    from_acnts.modify(from, owner, [&](auto &a) { a.balance -= value; });
+  }
+
+  void add_balance(const name &owner, const asset &value,
+                   const name &ram_payer) {
+    accounts to_acnts(get_self(), owner.value);
+    auto to = to_acnts.find(value.symbol.code().raw());
+    if (to == to_acnts.end()) {
+      to_acnts.emplace(ram_payer, [&](auto &a) { a.balance = value; });
+    } else {
+      to_acnts.modify(to, same_payer, [&](auto &a) { a.balance += value; });
+    }
+  }
+};
+
+} // namespace
+
+void apply_token(uint64_t receiver, uint64_t code, uint64_t action) {
+  eosio::name self(receiver);
+  eosio::name first_receiver(code);
+
+  if (receiver != code) {
+    return;
+  }
+
+  switch (action) {
+#define TOKEN_ACTION(handler)                                                  \
+  case eosio::name(#handler).value:                                            \
+    eosio::execute_action(self, first_receiver, &token::handler);              \
+    break;
+    TOKEN_ACTION(create)
+    TOKEN_ACTION(issue)
+    TOKEN_ACTION(retire)
+    TOKEN_ACTION(transfer)
+    TOKEN_ACTION(open)
+    TOKEN_ACTION(close)
+#undef TOKEN_ACTION
+  default:
+    eosio::check(false, uint64_t(1));
+  }
+}
+
+void deploy_freeos(chain &c) {
+  c.set_contract(freeos_account(), apply_freeos);
+  c.set_contract(freeosconfig_account(), apply_freeosconfig);
+  c.set_contract(freeostokens_account(), apply_token);
+  c.set_contract(system_token_account(), apply_token);
+  c.create_account(freedao_account());
+  c.create_account(verification_account());
+}
+
+} // namespace host
+} // namespace freedao